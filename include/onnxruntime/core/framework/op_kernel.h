@@ -129,6 +129,25 @@ class OpKernel {
     return Status::OK();
   }
 
+  // Override this function to use pre-packed weights read from a file instead of calling PrePack().
+  // Unlike UseSharedPrePackedBuffers(), PrePack() is not called first, so the kernel must also restore any
+  // metadata PrePack() derives from the tensor (e.g. its shape). The buffers are what PrePack() stored in
+  // prepacked_weights for the same tensor and node on the same kind of CPU.
+  // Please refer to MatMulIntegerBase for a complete example
+  // @param tensor: The initialized constant tensor the buffers were pre-packed from
+  // @param prepacked_buffers: The pre-packed buffers to be used by this kernel for the provided input index.
+  //                           As in UseSharedPrePackedBuffers(), they are raw pointers and must not be written to.
+  // @param input_idx: The input index of the tensor in this kernel
+  // @param used_cached_buffers: Boolean flag set by the kernel implementation indicating
+  // that the provided weight has been used by the kernel.
+  virtual Status UseCachedPrePackedBuffers(const Tensor& /*tensor*/,
+                                           std::vector<BufferUniquePtr>& /*prepacked_buffers*/,
+                                           int /*input_idx*/,
+                                           /*out*/ bool& used_cached_buffers) {
+    used_cached_buffers = false;
+    return Status::OK();
+  }
+
   const OrtDevice GetDevice(OrtMemType mem_type) const;
   const OpKernelInfo& Info() const {
     return *op_kernel_info_;
@@ -39,7 +39,9 @@
 #pragma warning(disable : 4127)
 #pragma warning(disable : 4805)
 #endif
+#include <chrono>
 #include <memory>
+#include <vector>
 #include "unsupported/Eigen/CXX11/ThreadPool"
 
 #if defined(__GNUC__)
@@ -339,6 +341,25 @@ class ExtendedThreadPoolInterface : public Eigen::ThreadPoolInterface {
                              unsigned n, std::ptrdiff_t block_size) = 0;
   virtual void StartProfiling() = 0;
   virtual std::string StopProfiling() = 0;
+
+  // Starts counting the wait times below.  Once started, counting stays on
+  // for the lifetime of the pool.
+  virtual void EnableWaitTimes() = 0;
+
+  // Cumulative time, in nanoseconds, that threads entering parallel loops
+  // spent waiting for other threads to finish, and that worker threads spent
+  // spinning or blocked while waiting for work.  All zeros until
+  // EnableWaitTimes is called.
+  virtual void GetWaitTimes(uint64_t& caller_wait_ns,
+                            uint64_t& worker_spin_ns,
+                            uint64_t& worker_blocked_ns) const = 0;
+
+  // NUMA topology of the worker threads.  A pool created without
+  // per-thread NUMA node ids reports a single node holding all of
+  // its workers.
+  virtual int NumNumaNodes() const = 0;
+  virtual int NumThreadsOnNumaNode(int numa_node) const = 0;
+  virtual int CurrentNumaNode() const = 0;
 };
 
 class ThreadPoolParallelSection {
@@ -359,6 +380,11 @@ class ThreadPoolParallelSection {
   // and in the dispatcher.
   unsigned current_dop{0};
 
+  // NUMA node whose workers should run the section's tasks, or -1 to
+  // use any worker.  Set by the main thread before starting the
+  // section.
+  int numa_node{-1};
+
   // State shared between the main thread and worker threads
   // -------------------------------------------------------
 
@@ -730,6 +756,22 @@ class ThreadPoolTempl : public onnxruntime::concurrency::ExtendedThreadPoolInter
     return profiler_.Stop();
   }
 
+  void EnableWaitTimes() override {
+    wait_times_enabled_.store(true, std::memory_order_relaxed);
+  }
+
+  void GetWaitTimes(uint64_t& caller_wait_ns,
+                    uint64_t& worker_spin_ns,
+                    uint64_t& worker_blocked_ns) const override {
+    caller_wait_ns = caller_wait_ns_.load(std::memory_order_relaxed);
+    worker_spin_ns = 0;
+    worker_blocked_ns = 0;
+    for (const auto& td : worker_data_) {
+      worker_spin_ns += td.spin_ns.load(std::memory_order_relaxed);
+      worker_blocked_ns += td.blocked_ns.load(std::memory_order_relaxed);
+    }
+  }
+
   struct Tag {
     constexpr Tag() : v_(0) {
     }
@@ -790,6 +832,23 @@ class ThreadPoolTempl : public onnxruntime::concurrency::ExtendedThreadPoolInter
       ComputeCoprimes(i, &all_coprimes_.back());
     }
 
+    // Group workers by NUMA node.  Without node ids every worker is
+    // placed on node 0, which leaves scheduling and stealing unchanged.
+    worker_numa_node_.assign(num_threads_, 0);
+    if (thread_options.numa_node_ids.size() == num_threads_) {
+      for (auto i = 0u; i < num_threads_; i++) {
+        ORT_ENFORCE(thread_options.numa_node_ids[i] >= 0, "Invalid NUMA node id for thread ", i);
+        worker_numa_node_[i] = thread_options.numa_node_ids[i];
+      }
+    }
+    for (auto i = 0u; i < num_threads_; i++) {
+      auto node = static_cast<size_t>(worker_numa_node_[i]);
+      if (numa_node_workers_.size() <= node) {
+        numa_node_workers_.resize(node + 1);
+      }
+      numa_node_workers_[node].push_back(i);
+    }
+
     // Eigen::MaxSizeVector has neither essential exception safety features
     // such as swap, nor it is movable. So we have to join threads right here
     // on exception
@@ -949,7 +1008,9 @@ class ThreadPoolTempl : public onnxruntime::concurrency::ExtendedThreadPoolInter
 
   void EndParallelSection(ThreadPoolParallelSection& ps) override {
     PerThread* pt = GetPerThread();
+    WaitTimer wait_timer(wait_times_enabled_);
     EndParallelSectionInternal(*pt, ps);
+    AddCallerWait(wait_timer);
   }
 
   //----------------------------------------------------------------------
@@ -1080,6 +1141,29 @@ class ThreadPoolTempl : public onnxruntime::concurrency::ExtendedThreadPoolInter
     preferred_workers[par_idx] = ran_on_idx;
   }
 
+  // Map a preferred worker onto the worker that should run par_idx.
+  // Sections bound to a NUMA node only use that node's workers: a hint
+  // recorded on another node is replaced by a node-local worker chosen
+  // round-robin on par_idx, so that each task of the loop lands on a
+  // distinct queue where possible.
+  unsigned SelectWorkerForSection(const ThreadPoolParallelSection& ps,
+                                  unsigned preferred_q_idx,
+                                  unsigned par_idx) const {
+    if (ps.numa_node < 0 || worker_numa_node_[preferred_q_idx] == ps.numa_node) {
+      return preferred_q_idx;
+    }
+    const auto& node_workers = numa_node_workers_[ps.numa_node];
+    return node_workers[par_idx % node_workers.size()];
+  }
+
+  unsigned RandomWorkerForSection(PerThread& pt, const ThreadPoolParallelSection& ps) {
+    if (ps.numa_node < 0) {
+      return Rand(&pt.rand) % num_threads_;
+    }
+    const auto& node_workers = numa_node_workers_[ps.numa_node];
+    return node_workers[Rand(&pt.rand) % node_workers.size()];
+  }
+
   // Schedule [par_idx_start,par_idx_end) across the preferred workers
 
   void ScheduleOnPreferredWorkers(PerThread& pt,
@@ -1093,7 +1177,7 @@ class ThreadPoolTempl : public onnxruntime::concurrency::ExtendedThreadPoolInter
       // recorded from a prior thread pool with a different number of
       // threads, hence we must cap at num_threads_.
       assert(par_idx < preferred_workers.size());
-      unsigned q_idx = preferred_workers[par_idx] % num_threads_;
+      unsigned q_idx = SelectWorkerForSection(ps, preferred_workers[par_idx] % num_threads_, par_idx);
       assert(q_idx < num_threads_);
       WorkerData& td = worker_data_[q_idx];
       Queue& q = td.queue;
@@ -1116,7 +1200,7 @@ class ThreadPoolTempl : public onnxruntime::concurrency::ExtendedThreadPoolInter
         ps.tasks.push_back({q_idx, w_idx});
         td.EnsureAwake();
         if (push_status == PushResult::ACCEPTED_BUSY) {
-          worker_data_[Rand(&pt.rand) % num_threads_].EnsureAwake();
+          worker_data_[RandomWorkerForSection(pt, ps)].EnsureAwake();
         }
       }
     }
@@ -1207,7 +1291,8 @@ class ThreadPoolTempl : public onnxruntime::concurrency::ExtendedThreadPoolInter
         };
 
         profiler_.LogStart();
-        ps.dispatch_q_idx = preferred_workers[current_dop] % num_threads_;
+        ps.dispatch_q_idx = static_cast<int>(SelectWorkerForSection(ps, preferred_workers[current_dop] % num_threads_,
+                                                                    current_dop));
         WorkerData& dispatch_td = worker_data_[ps.dispatch_q_idx];
         Queue& dispatch_que = dispatch_td.queue;
 
@@ -1219,7 +1304,7 @@ class ThreadPoolTempl : public onnxruntime::concurrency::ExtendedThreadPoolInter
         if (push_status == PushResult::ACCEPTED_IDLE || push_status == PushResult::ACCEPTED_BUSY) {
           dispatch_td.EnsureAwake();
           if (push_status == PushResult::ACCEPTED_BUSY) {
-            worker_data_[Rand(&pt.rand) % num_threads_].EnsureAwake();
+            worker_data_[RandomWorkerForSection(pt, ps)].EnsureAwake();
           }
         } else {
           ps.dispatch_q_idx = -1;  // failed to enqueue dispatch_task
@@ -1279,10 +1364,12 @@ class ThreadPoolTempl : public onnxruntime::concurrency::ExtendedThreadPoolInter
     profiler_.LogEndAndStart(ThreadPoolProfiler::RUN);
 
     // Wait for workers to exit the loop
+    WaitTimer wait_timer(wait_times_enabled_);
     ps.current_loop = 0;
     while (ps.workers_in_loop) {
       onnxruntime::concurrency::SpinPause();
     }
+    AddCallerWait(wait_timer);
     profiler_.LogEnd(ThreadPoolProfiler::WAIT);
   }
 
@@ -1308,7 +1395,9 @@ class ThreadPoolTempl : public onnxruntime::concurrency::ExtendedThreadPoolInter
     profiler_.LogEndAndStart(ThreadPoolProfiler::DISTRIBUTION);
     fn(0);  // run fn(0)
     profiler_.LogEndAndStart(ThreadPoolProfiler::RUN);
+    WaitTimer wait_timer(wait_times_enabled_);
     EndParallelSectionInternal(*pt, ps);  // wait for all
+    AddCallerWait(wait_timer);
     profiler_.LogEnd(ThreadPoolProfiler::WAIT);
   }
 
@@ -1316,6 +1405,24 @@ class ThreadPoolTempl : public onnxruntime::concurrency::ExtendedThreadPoolInter
     return num_threads_;
   }
 
+  int NumNumaNodes() const final {
+    return static_cast<int>(numa_node_workers_.size());
+  }
+
+  int NumThreadsOnNumaNode(int numa_node) const final {
+    if (numa_node < 0 || numa_node >= NumNumaNodes()) {
+      return 0;
+    }
+    return static_cast<int>(numa_node_workers_[numa_node].size());
+  }
+
+  // NUMA node of the calling worker thread, or -1 if the caller is not
+  // one of this pool's workers.
+  int CurrentNumaNode() const final {
+    int thread_id = CurrentThreadId();
+    return thread_id < 0 ? -1 : worker_numa_node_[thread_id];
+  }
+
   int CurrentThreadId() const final {
     const PerThread* pt = const_cast<ThreadPoolTempl*>(this)->GetPerThread();
     if (pt->pool == this) {
@@ -1395,6 +1502,15 @@ class ThreadPoolTempl : public onnxruntime::concurrency::ExtendedThreadPoolInter
     std::unique_ptr<Thread> thread;
     Queue queue;
 
+    // Time spent waiting for work, once wait times are enabled.  Written only
+    // by the worker thread itself, and read by GetWaitTimes.
+    std::atomic<uint64_t> spin_ns{0};
+    std::atomic<uint64_t> blocked_ns{0};
+
+    static void AddTime(std::atomic<uint64_t>& counter, uint64_t ns) {
+      counter.store(counter.load(std::memory_order_relaxed) + ns, std::memory_order_relaxed);
+    }
+
     // Each thread has a status, available read-only without locking, and protected
     // by the mutex field below for updates.  The status is used for three
     // purposes:
@@ -1495,6 +1611,10 @@ class ThreadPoolTempl : public onnxruntime::concurrency::ExtendedThreadPoolInter
   const bool set_denormal_as_zero_;
   Eigen::MaxSizeVector<WorkerData> worker_data_;
   Eigen::MaxSizeVector<Eigen::MaxSizeVector<unsigned>> all_coprimes_;
+  // NUMA node of each worker, and the workers on each node.  Fixed at
+  // construction.
+  std::vector<int> worker_numa_node_;
+  std::vector<std::vector<unsigned>> numa_node_workers_;
   std::atomic<unsigned> blocked_;  // Count of blocked workers, used as a termination condition
   std::atomic<bool> done_;
 
@@ -1510,6 +1630,45 @@ class ThreadPoolTempl : public onnxruntime::concurrency::ExtendedThreadPoolInter
   // Default is no control over spinning
   std::atomic<SpinLoopStatus> spin_loop_status_{SpinLoopStatus::kBusy};
 
+  // Set by EnableWaitTimes.  Until then the waits are not timed, so the
+  // pool does not read the clock or update the counters below.
+  std::atomic<bool> wait_times_enabled_{false};
+
+  // Time spent by threads outside the pool waiting for parallel loops to
+  // complete.  See GetWaitTimes.
+  std::atomic<uint64_t> caller_wait_ns_{0};
+
+  // Times a wait if wait times were enabled when the wait started.
+  class WaitTimer {
+   public:
+    explicit WaitTimer(const std::atomic<bool>& wait_times_enabled)
+        : enabled_(wait_times_enabled.load(std::memory_order_relaxed)) {
+      if (enabled_) {
+        start_ = std::chrono::steady_clock::now();
+      }
+    }
+
+    bool Enabled() const {
+      return enabled_;
+    }
+
+    uint64_t ElapsedNs() const {
+      return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                       std::chrono::steady_clock::now() - start_)
+                                       .count());
+    }
+
+   private:
+    const bool enabled_;
+    std::chrono::steady_clock::time_point start_;
+  };
+
+  void AddCallerWait(const WaitTimer& wait_timer) {
+    if (wait_timer.Enabled()) {
+      caller_wait_ns_.fetch_add(wait_timer.ElapsedNs(), std::memory_order_relaxed);
+    }
+  }
+
   // Wake any blocked workers so that they can cleanly exit WorkerLoop().  For
   // a clean exit, each thread will observe (1) done_ set, indicating that the
   // destructor has been called, (2) all threads blocked, and (3) no
@@ -1543,6 +1702,7 @@ class ThreadPoolTempl : public onnxruntime::concurrency::ExtendedThreadPoolInter
       Task t = q.PopFront();
       if (!t) {
         // Spin waiting for work.
+        WaitTimer spin_timer(wait_times_enabled_);
         for (int i = 0; i < spin_count && !done_; i++) {
           if (((i + 1) % steal_count == 0)) {
             t = Steal(StealAttemptKind::TRY_ONE);
@@ -1556,9 +1716,13 @@ class ThreadPoolTempl : public onnxruntime::concurrency::ExtendedThreadPoolInter
           }
           onnxruntime::concurrency::SpinPause();
         }
+        if (spin_timer.Enabled()) {
+          WorkerData::AddTime(td.spin_ns, spin_timer.ElapsedNs());
+        }
 
         // Attempt to block
         if (!t) {
+          WaitTimer block_timer(wait_times_enabled_);
           td.SetBlocked(  // Pre-block test
               [&]() -> bool {
                 bool should_block = true;
@@ -1615,6 +1779,9 @@ class ThreadPoolTempl : public onnxruntime::concurrency::ExtendedThreadPoolInter
               [&]() {
                 blocked_--;
               });
+          if (block_timer.Enabled()) {
+            WorkerData::AddTime(td.blocked_ns, block_timer.ElapsedNs());
+          }
           // Thread just unblocked.  Unless we picked up work while
           // blocking, or are exiting, then either work was pushed to
           // us, or it was pushed to an overloaded queue
@@ -1645,18 +1812,40 @@ class ThreadPoolTempl : public onnxruntime::concurrency::ExtendedThreadPoolInter
   // "snatching" work from a thread which is just about to notice the
   // work itself.
 
+  //
+  // When the pool spans several NUMA nodes, victims are first chosen
+  // from the stealing thread's own node, keeping the stolen task's
+  // working set in node-local memory.  Opportunistic TRY_ONE attempts
+  // made while spinning never leave the node; TRY_ALL attempts made
+  // before blocking fall back to the other nodes so that work is not
+  // stranded on an overloaded node.
+
   Task Steal(StealAttemptKind steal_kind) {
     PerThread* pt = GetPerThread();
-    unsigned size = num_threads_;
-    unsigned num_attempts = (steal_kind == StealAttemptKind::TRY_ALL) ? size : 1;
+    const bool try_all = steal_kind == StealAttemptKind::TRY_ALL;
+    if (numa_node_workers_.size() > 1 && pt->pool == this) {
+      const auto& node_workers = numa_node_workers_[worker_numa_node_[pt->thread_id]];
+      Task t = StealFrom(pt, node_workers.data(), static_cast<unsigned>(node_workers.size()), try_all);
+      if (t || !try_all) {
+        return t;
+      }
+    }
+    return StealFrom(pt, nullptr, num_threads_, try_all);
+  }
+
+  // Random walk over size victims.  If victims is null the walk covers
+  // worker ids [0,size), otherwise the worker ids listed in victims.
+  Task StealFrom(PerThread* pt, const unsigned* victims, unsigned size, bool try_all) {
+    unsigned num_attempts = try_all ? size : 1;
     unsigned r = Rand(&pt->rand);
     unsigned inc = all_coprimes_[size - 1][r % all_coprimes_[size - 1].size()];
     unsigned victim = r % size;
 
     for (unsigned i = 0; i < num_attempts; i++) {
       assert(victim < size);
-      if (worker_data_[victim].GetStatus() == WorkerData::ThreadStatus::Active) {
-        Task t = worker_data_[victim].queue.PopBack();
+      WorkerData& td = worker_data_[victims ? victims[victim] : victim];
+      if (td.GetStatus() == WorkerData::ThreadStatus::Active) {
+        Task t = td.queue.PopBack();
         if (t) {
           return t;
         }
@@ -194,10 +194,19 @@ class ThreadPool {
   //
   // Parallel sections may not be nested, and may not be used inside
   // parallel loops.
+  //
+  // If numa_node is given (in the range [0,NumNumaNodes(tp))), the
+  // section's loops only enlist workers bound to that node, and
+  // DegreeOfParallelism reports the node-local degree of parallelism
+  // while the section is active.  Since pages are placed on the node
+  // of the thread that first writes them, buffers initialized inside
+  // such a section stay node-local for the loops that follow.  An
+  // out-of-range node, or a pool without NUMA information, behaves as
+  // an ordinary section.
 
   class ParallelSection {
    public:
-    explicit ParallelSection(ThreadPool* tp);
+    explicit ParallelSection(ThreadPool* tp, int numa_node = -1);
     ~ParallelSection();
 
    private:
@@ -360,17 +369,40 @@ class ThreadPool {
   // working in combination with the thread initiating the loop.
   static int DegreeOfParallelism(const ThreadPool* tp);
 
+  // Return the number of NUMA nodes spanned by the pool's threads.
+  // Pools created without NUMA awareness report a single node.
+  static int NumNumaNodes(const ThreadPool* tp);
+
   ORT_DISALLOW_COPY_AND_ASSIGNMENT(ThreadPool);
 
   // StartProfiling and StopProfiling are not to be consumed as public-facing API
   static void StartProfiling(concurrency::ThreadPool* tp);
   static std::string StopProfiling(concurrency::ThreadPool* tp);
 
+  // Starts counting the wait times of the pool's threads.  Counting stays on for the lifetime of the pool, which may
+  // be shared by several sessions.  Does nothing if tp is null or runs work on the calling thread only.
+  static void EnableWaitTimes(concurrency::ThreadPool* tp);
+
+  // Cumulative wait times of the pool's threads since EnableWaitTimes was first called.
+  struct WaitTimes {
+    // Time spent by threads running parallel loops waiting for the other threads to finish.
+    uint64_t caller_wait_ns{0};
+    // Time spent by worker threads spinning while waiting for work.
+    uint64_t worker_spin_ns{0};
+    // Time spent by worker threads blocked while waiting for work.
+    uint64_t worker_blocked_ns{0};
+  };
+
+  // Returns all zeros if tp is null or runs work on the calling thread only.
+  static WaitTimes GetWaitTimes(const concurrency::ThreadPool* tp);
+
  private:
   friend class LoopCounter;
 
-  // Returns the number of threads created in the pool.  This may be different from the
-  // value returned by DegreeOfParallelism to code using the pool.
+  // Returns the number of threads created in the pool, or the number of threads
+  // on the section's node when called inside a NUMA-node parallel section.  This
+  // may be different from the value returned by DegreeOfParallelism to code using
+  // the pool.
   int NumThreads() const;
 
   // Returns current thread id between 0 and NumThreads() - 1, if called from a
@@ -304,6 +304,7 @@ ORT_RUNTIME_CLASS(Op);
 ORT_RUNTIME_CLASS(OpAttr);
 ORT_RUNTIME_CLASS(Logger);
 ORT_RUNTIME_CLASS(ShapeInferContext);
+ORT_RUNTIME_CLASS(BatchingSession);
 
 #ifdef _WIN32
 typedef _Return_type_success_(return == 0) OrtStatus* OrtStatusPtr;
@@ -2804,6 +2805,10 @@ struct OrtApi {
    *  Use -1 to allow ORT to choose the default 1GB for max_power_of_two_extend_bytes.
    *  Ultimately, the allocation size is determined by the allocation memory request.
    *  Further allocation sizes are governed by the arena extend strategy.
+   * "max_thread_cache_bytes": Maximum bytes of freed small (<= 64KB) chunks each thread keeps in its own cache.
+   *  Allocations of a cached size made on the same thread are served from this cache without locking the arena,
+   *  and the cache is returned to the arena in batches once it exceeds this size.
+   *  Use 0 to disable the cache. Use -1 to allow ORT to choose the default, which is 0.
    *
    * \param[in] arena_config_keys Keys to configure the arena
    * \param[in] arena_config_values Values to configure the arena
@@ -4667,6 +4672,119 @@ struct OrtApi {
                   _In_reads_(num_external_initializer_files) char* const* external_initializer_file_buffer_array,
                   _In_reads_(num_external_initializer_files) const size_t* external_initializer_file_lengths,
                   size_t num_external_initializer_files);
+
+  /// \name OrtBatchingSession
+  /// @{
+
+  /** \brief Create a front end for a session that coalesces concurrent requests into batched runs
+   *
+   * Concurrent calls to OrtApi::BatchingSessionRun with compatible inputs are concatenated along the batch axis
+   * and run as one OrtApi::Run call on the session. Outputs whose batch axis dimension has the same symbolic name
+   * as the batch axis dimension of an input are split back to the callers, and their dimensions named after
+   * padded input dimensions are cropped to the extent of each caller; other outputs are returned unchanged to
+   * every caller.
+   * Requests that can not be batched (non-tensor, string or non-CPU inputs, or pre-allocated outputs) are run
+   * on their own.
+   *
+   * Supported options:
+   *   "max_batch_size": Maximum number of rows in a batch. Default 32.
+   *   "max_delay_us": Maximum time in microseconds a request waits for others to join its batch. Default 1000.
+   *   "batch_axis": Axis along which inputs are concatenated. Default 0.
+   *   "allow_padding": "1" to zero pad inputs that differ in non-batch dimensions, "0" to only batch inputs with
+   *                    equal non-batch dimensions. Default "1".
+   *   "num_workers": Number of threads dispatching batches. Default 1.
+   *
+   * \param[in] session The session to run batches on. Must outlive the batching session.
+   * \param[in] option_keys Array of null terminated UTF-8 encoded option names.
+   * \param[in] option_values Array of null terminated UTF-8 encoded option values.
+   * \param[in] num_options Number of options.
+   * \param[out] out Newly created ::OrtBatchingSession. Must be freed with OrtApi::ReleaseBatchingSession
+   *
+   * \snippet{doc} snippets.dox OrtStatus Return Value
+   *
+   * \since Version 1.20.
+   */
+  ORT_API2_STATUS(CreateBatchingSession, _In_ OrtSession* session,
+                  _In_reads_(num_options) const char* const* option_keys,
+                  _In_reads_(num_options) const char* const* option_values,
+                  _In_ size_t num_options, _Outptr_ OrtBatchingSession** out);
+
+  /** \brief Run a request as part of a batch
+   *
+   * Blocks until the batch containing the request has run. Safe to call from multiple threads.
+   * The arguments have the same meaning as for OrtApi::Run.
+   *
+   * \snippet{doc} snippets.dox OrtStatus Return Value
+   *
+   * \since Version 1.20.
+   */
+  ORT_API2_STATUS(BatchingSessionRun, _Inout_ OrtBatchingSession* batching_session,
+                  _In_reads_(input_len) const char* const* input_names,
+                  _In_reads_(input_len) const OrtValue* const* inputs, size_t input_len,
+                  _In_reads_(output_names_len) const char* const* output_names, size_t output_names_len,
+                  _Inout_updates_all_(output_names_len) OrtValue** outputs);
+
+  /** \brief Get the histogram of request latencies of a batching session
+   *
+   * Bucket 0 counts requests that completed in less than 1 microsecond, bucket i counts requests that took
+   * [2^(i-1), 2^i) microseconds, and the last bucket counts all longer requests.
+   *
+   * \param[in] batching_session
+   * \param[out] bucket_counts Array receiving the count of each bucket.
+   * \param[in] num_buckets Size of bucket_counts. Must be 32.
+   * \param[out] total_count Total number of completed requests.
+   *
+   * \snippet{doc} snippets.dox OrtStatus Return Value
+   *
+   * \since Version 1.20.
+   */
+  ORT_API2_STATUS(GetBatchingSessionLatencyHistogram, _In_ const OrtBatchingSession* batching_session,
+                  _Out_writes_(num_buckets) uint64_t* bucket_counts, _In_ size_t num_buckets,
+                  _Out_ uint64_t* total_count);
+
+  /** \brief Release an ::OrtBatchingSession
+   *
+   * Waits for queued requests to complete.
+   *
+   * \since Version 1.20.
+   */
+  ORT_CLASS_RELEASE(BatchingSession);
+
+  /// @}
+  /// \name OrtSession
+  /// @{
+
+  /** \brief Get the current metrics of a session as JSON
+   *
+   * Metrics are enabled by setting the session config entry "session.enable_metrics" to "1". They are collected
+   * for the lifetime of the session and can be read at any time, including while other threads run the session.
+   * All values are cumulative, so rates are obtained from the difference between two calls.
+   *
+   * The JSON object has the following members:
+   *   "runs": Latency histogram of the runs of the session.
+   *   "nodes": Array with the latency histogram, "name", "op_type" and "output_bytes" of each node. Nodes in
+   *            subgraphs are named after the node holding the subgraph, e.g. "loop/add".
+   *   "op_types": Array with the latency histogram, "op_type" and "output_bytes" of all the nodes of each op type.
+   *   "intra_op_thread_pool", "inter_op_thread_pool": Objects with the "caller_wait_ns" spent by threads running
+   *            parallel loops waiting for other threads, and the "worker_spin_ns" and "worker_blocked_ns" spent by
+   *            worker threads waiting for work. Thread pools shared between sessions report their total times.
+   *
+   * A latency histogram is made of the "count", "total_us" and "max_us" of the samples, and an array of 32
+   * "buckets". Bucket 0 counts samples below 1 microsecond, bucket i counts samples of [2^(i-1), 2^i) microseconds,
+   * and the last bucket counts all longer samples. "output_bytes" is the total size of the tensors produced.
+   *
+   * \param[in] session
+   * \param[in] allocator
+   * \param[out] out Null terminated JSON string, allocated using `allocator`. Must be freed using `allocator`
+   *
+   * \snippet{doc} snippets.dox OrtStatus Return Value
+   *
+   * \since Version 1.20.
+   */
+  ORT_API2_STATUS(SessionGetMetrics, _In_ const OrtSession* session, _Inout_ OrtAllocator* allocator,
+                  _Outptr_ char** out);
+
+  /// @}
 };
 
 /*
@@ -67,6 +67,12 @@ static const char* const kOrtSessionOptionsEnableQuantQDQCleanup = "session.enab
 // GeluApproximation has side effects which may change the inference results. It is disabled by default due to this.
 static const char* const kOrtSessionOptionsEnableGeluApproximation = "optimization.enable_gelu_approximation";
 
+// Enable or disable fusing the remaining groups of element-wise nodes into FusedElementwise in the Level3 graph
+// optimization. "0": disable; "1": enable. The default is "0".
+// The fused kernel evaluates transcendental operators with different approximations than the individual kernels, so
+// the results may differ slightly.
+static const char* const kOrtSessionOptionsEnableElementwiseChainFusion = "optimization.enable_elementwise_chain_fusion";
+
 // This setting controls whether to enable AheadOfTime function inlining.
 // AOT function inlining examines the graph and attempts to inline as many locally defined functions in the model
 // as possible with the help of enabled execution providers.
@@ -111,6 +117,22 @@ static const char* const kOrtSessionOptionsDisableSpecifiedOptimizers = "optimiz
 // Using device allocators means the memory allocation is made using malloc/new.
 static const char* const kOrtSessionOptionsUseDeviceAllocatorForInitializers = "session.use_device_allocator_for_initializers";
 
+// Maximum number of input shape combinations for which the memory pattern is cached.
+// When the limit is reached, the least recently used entry is evicted.
+// "0": unbounded.
+// The default is "128".
+// Only used when the memory pattern optimization is enabled.
+static const char* const kOrtSessionOptionsMemoryPatternCacheSize = "session.memory_pattern_cache_size";
+
+// Enable the collection of session metrics: per-node and per-op-type latency histograms, output bytes, and thread
+// pool wait times. They can be read while the session is in use with OrtApi::SessionGetMetrics.
+// Counting the wait times stays on for the lifetime of the thread pools, including global ones shared with other
+// sessions.
+// "0": disabled.
+// "1": enabled.
+// The default is "0".
+static const char* const kOrtSessionOptionsEnableMetrics = "session.enable_metrics";
+
 // Configure whether to allow the inter_op/intra_op threads spinning a number of times before blocking
 // "0": thread will block if found no job to run
 // "1": default, thread will spin a number of times before blocking
@@ -214,6 +236,14 @@ static const char* const kNodePartitionConfigFile = "session.node_partition_conf
 //    Hence 64-65 is an invalid configuration, because a windows thread cannot be attached to processors across group boundary.
 static const char* const kOrtSessionOptionsConfigIntraOpThreadAffinities = "session.intra_op_thread_affinities";
 
+// Make the intra op thread pool NUMA aware. On machines with more than one NUMA node the threads are spread across
+// the nodes, threads without an explicit affinity are bound to the processors of their node, and idle threads
+// steal work from threads on their own node before stealing from other nodes.
+// "0": disabled. [DEFAULT]
+// "1": enabled.
+// Has no effect on machines with a single NUMA node.
+static const char* const kOrtSessionOptionsConfigIntraOpNumaAware = "session.intra_op.numa_aware";
+
 // This option will dump out the model to assist debugging any issues with layout transformation,
 // and is primarily intended for developer usage. It is only relevant if an execution provider that requests
 // NHWC layout is enabled such as NNAPI, XNNPACK or QNN.
@@ -279,3 +309,40 @@ static const char* const kOrtSessionOptionsMlasGemmFastMathArm64Bfloat16 = "mlas
 // Refer to MatMulNBits op schema for more details.
 // If not provided, default is 4.
 static const char* const kOrtSessionOptionsQDQMatMulNBitsAccuracyLevel = "session.qdq_matmulnbits_accuracy_level";
+
+// Enable TunableOp for the CPU execution provider. MatMul and Conv then pick between several MLAS kernel and
+// threading variants using tuning results, either loaded with the session or produced by tuning.
+// Option values:
+// - "0": TunableOp is disabled. [DEFAULT]
+// - "1": TunableOp is enabled.
+static const char* const kOrtSessionOptionsCpuTunableOpEnable = "session.cpu.tunable_op_enable";
+
+// Enable tuning for the CPU execution provider when TunableOp is enabled. Every unique problem shape without
+// a tuning result is benchmarked on first use. The results are available through the session's tuning results.
+// Option values:
+// - "0": Tuning is disabled. [DEFAULT]
+// - "1": Tuning is enabled.
+static const char* const kOrtSessionOptionsCpuTunableOpTuningEnable = "session.cpu.tunable_op_tuning_enable";
+
+// Maximum time in milliseconds spent benchmarking each candidate for a problem shape. "0" means no limit.
+// The default is "0".
+static const char* const kOrtSessionOptionsCpuTunableOpMaxTuningDurationMs =
+    "session.cpu.tunable_op_max_tuning_duration_ms";
+
+// Path of a file that persists the weights pre-packed by CPU kernels, so that later sessions with the same model,
+// possibly in other processes, reuse them instead of pre-packing again. The file is created if it doesn't exist and
+// rewritten when new weights were pre-packed. It is ignored if it was written by a different onnxruntime version, on
+// a CPU with different features or with different settings. Constant inputs of the nodes are hashed to look up the
+// weights, and weights read from the file are used in place from a mapping of the file.
+// The file cache is not used for initializers that are shared through a PrepackedWeightsContainer.
+// The default is "", which means no file cache.
+static const char* const kOrtSessionOptionsPrepackedWeightsCacheFile = "session.prepacked_weights_cache_file";
+
+// Evaluate TreeEnsembleRegressor and TreeEnsembleClassifier on quantized thresholds when all nodes use the same
+// comparison, other than BRANCH_EQ and BRANCH_NEQ. The thresholds of every feature are replaced by their rank among
+// the distinct thresholds of that feature, the inputs are converted once per row to the same ranks, and the trees are
+// traversed on 16-bit integers. The results are identical to the evaluation on the original values.
+// Option values:
+// - "0": The thresholds are not quantized. [DEFAULT]
+// - "1": The thresholds are quantized when the model allows it.
+static const char* const kOrtSessionOptionsTreeEnsembleQuantizeThresholds = "session.tree_ensemble_quantize_thresholds";
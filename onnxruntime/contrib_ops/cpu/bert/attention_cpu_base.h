@@ -8,15 +8,25 @@
 #include "core/common/common.h"
 #include "core/common/safeint.h"
 #include "core/framework/op_kernel.h"
+#include "core/platform/env.h"
+#include "core/platform/env_var_utils.h"
 #include "contrib_ops/cpu/utils/dump_tensor.h"
 
+#include <type_traits>
+
 namespace onnxruntime {
 namespace contrib {
 
 class AttentionCPUBase : public AttentionBase {
  protected:
   AttentionCPUBase(const OpKernelInfo& info, bool require_same_hidden_size)
-      : AttentionBase(info, require_same_hidden_size) {}
+      : AttentionBase(info, require_same_hidden_size) {
+    l2_cache_size_ = Env::Default().GetL2CacheSize();
+    disable_flash_ = ParseEnvironmentVariableWithDefault<bool>(attention::kDisableFlashAttention, false);
+  }
+
+  bool disable_flash_;
+  int l2_cache_size_;
 
   template <typename T>
   Status ApplyAttention(const T* Q,                // Q data with shape BxNxSxH
@@ -53,6 +63,36 @@ class AttentionCPUBase : public AttentionBase {
     // Total sequence length including that of past state: T = P + L
     const int total_sequence_length = past_sequence_length + kv_sequence_length;
 
+    if constexpr (std::is_same_v<T, float>) {
+      // The causal mask of the flash attention kernel is aligned to the last token, like the one of PrepareMask
+      // only when K and V have as many new tokens as Q.
+      if (!disable_flash_ && l2_cache_size_ > 0 &&
+          mask_index == nullptr && attn_bias == nullptr &&
+          (!is_unidirectional_ || kv_sequence_length == sequence_length) &&
+          v_hidden_size == num_heads_ * v_head_size &&
+          (past_sequence_length == 0 || present != nullptr || present_key != nullptr)) {
+        const int head_size = qk_head_size == 0 ? v_head_size : qk_head_size;
+        const float* past_key_data = past != nullptr ? past->Data<float>() : nullptr;
+        const float* past_value_data =
+            past != nullptr ? past_key_data + SafeInt<ptrdiff_t>(batch_size) * num_heads_ * past_sequence_length * v_head_size
+                            : nullptr;
+        float* present_key_data = present != nullptr ? present->MutableData<float>() : nullptr;
+        float* present_value_data =
+            present != nullptr ? present_key_data + SafeInt<ptrdiff_t>(batch_size) * num_heads_ * total_sequence_length * v_head_size
+                               : nullptr;
+        if (present == nullptr && present_key != nullptr) {
+          past_key_data = past_key != nullptr ? past_key->Data<float>() : nullptr;
+          past_value_data = past_value != nullptr ? past_value->Data<float>() : nullptr;
+          present_key_data = present_key->MutableData<float>();
+          present_value_data = present_value->MutableData<float>();
+        }
+        ApplyFlashAttention(Q, K, V, past_key_data, past_value_data, present_key_data, present_value_data,
+                            output->MutableData<float>(), batch_size, sequence_length, kv_sequence_length,
+                            past_sequence_length, head_size, v_head_size, allocator, tp);
+        return Status::OK();
+      }
+    }
+
     // Merge causal mask with padding mask, and convert values from 0/1 to -inf/0, then broadcast to 3D (BxSxT).
     bool causal = (is_unidirectional_ && sequence_length > 1);
     void* mask_data = nullptr;
@@ -112,6 +152,64 @@ class AttentionCPUBase : public AttentionBase {
   }
 
  private:
+  // Computes the attention with the flash attention kernel of MLAS instead of materializing the BxNxSxT attention
+  // probs. The past and new K and V are first concatenated into the present state, if any, which the kernel reads.
+  void ApplyFlashAttention(const float* Q,           // Q data with shape BxNxSxH
+                           const float* K,           // K data with shape BxNxLxH
+                           const float* V,           // V value with size BxNxLxH_v
+                           const float* past_key,    // past K with shape BxNxPxH, or nullptr
+                           const float* past_value,  // past V with shape BxNxPxH_v, or nullptr
+                           float* present_key,       // present K with shape BxNxTxH, or nullptr
+                           float* present_value,     // present V with shape BxNxTxH_v, or nullptr
+                           float* output,            // output with shape BxSxNxH_v
+                           int batch_size,
+                           int sequence_length,
+                           int kv_sequence_length,
+                           int past_sequence_length,
+                           int qk_head_size,
+                           int v_head_size,
+                           AllocatorPtr allocator,
+                           ThreadPool* tp) const {
+    const int total_sequence_length = past_sequence_length + kv_sequence_length;
+    if (present_key != nullptr) {
+      const size_t past_k_chunk_length = static_cast<size_t>(past_sequence_length) * qk_head_size;
+      const size_t present_k_chunk_length = static_cast<size_t>(total_sequence_length) * qk_head_size;
+      const size_t past_v_chunk_length = static_cast<size_t>(past_sequence_length) * v_head_size;
+      const size_t present_v_chunk_length = static_cast<size_t>(total_sequence_length) * v_head_size;
+
+      TensorOpCost unit_cost;
+      unit_cost.compute_cycles = 0;
+      unit_cost.bytes_loaded = static_cast<double>((present_k_chunk_length + present_v_chunk_length) * sizeof(float));
+      unit_cost.bytes_stored = unit_cost.bytes_loaded;
+      ThreadPool::TryParallelFor(tp, SafeInt<ptrdiff_t>(batch_size) * num_heads_, unit_cost,
+                                 [&](std::ptrdiff_t begin, std::ptrdiff_t end) {
+                                   for (std::ptrdiff_t i = begin; i != end; ++i) {
+                                     ConcatStateChunk(past_key, K + (present_k_chunk_length - past_k_chunk_length) * i,
+                                                      present_key, past_k_chunk_length, present_k_chunk_length, i);
+                                     ConcatStateChunk(past_value, V + (present_v_chunk_length - past_v_chunk_length) * i,
+                                                      present_value, past_v_chunk_length, present_v_chunk_length, i);
+                                   }
+                                 });
+      K = present_key;
+      V = present_value;
+    }
+
+    MlasFlashAttentionThreadedArgs args;
+    args.batch_size = batch_size;
+    args.num_heads = num_heads_;
+    args.q_sequence_length = sequence_length;
+    args.kv_sequence_length = total_sequence_length;
+    args.qk_head_size = qk_head_size;
+    args.v_head_size = v_head_size;
+    args.scale = scale_ == 0.0f ? 1.0f / sqrt(static_cast<float>(qk_head_size)) : scale_;
+    args.is_causal = is_unidirectional_;
+    args.query = Q;
+    args.key = K;
+    args.value = V;
+    args.output = output;
+    RunFlashAttention(args, l2_cache_size_, std::move(allocator), tp);
+  }
+
   // Helper function to compute the attention probs. It does 2 things:
   //  attention_probs(B, N, S, T) = 1/sqrt(H) x Q(B, N, S, H) x K'(B, N, T, H -> B, N, H, T) +
   //                                1 x mask_data(B, N, S, T)
@@ -7,6 +7,7 @@
 #include "core/util/math.h"
 #include "core/util/math_cpuonly.h"
 #include "core/common/safeint.h"
+#include "core/framework/allocator.h"
 #include "core/platform/threadpool.h"
 #include "core/providers/common.h"
 #include "core/mlas/inc/mlas.h"
@@ -243,5 +244,68 @@ T* ConcatStateChunkGQA(const T* past,
   return start;
 }
 
+// Runs the flash attention kernel of MLAS, which does not materialize the attention probabilities.
+// The block sizes are chosen from the size of the L2 cache and the other arguments must be set by the caller.
+inline void RunFlashAttention(MlasFlashAttentionThreadedArgs& args, int l2_cache_size, AllocatorPtr allocator,
+                              ThreadPool* tp) {
+  /*
+    q_block_size, kv_block_size correspond to Br, Bc in the FlashAttention paper.
+    Let M = l2_cache_size / sizeof(float)
+    In the FlashAttention kernel, there are 5 big matrices that we need to keep in L2 cache:
+      slice of Q -- [Br, qk_head_size]
+      slice of K -- [Bc, qk_head_size]
+      slice of V -- [Bc, v_head_size]
+      result of QK -- [Br, Bc]
+      temporary output (same shape as QKV) -- [Br, v_head_size]
+    The total size of these matrices is (Br + Bc) * (qk_head_size + v_head_size) + Br * Bc
+    By taking Bc = M / (4 * (qk_head_size + v_head_size)), and Br = min(Bc, qk_head_size + v_head_size), we have
+      (Br + Bc) * (qk_head_size + v_head_size) + Br * Bc
+      <= 2 * Bc * (qk_head_size + v_head_size) + Br * Bc
+      <= 2 * Bc * (qk_head_size + v_head_size) + M/4
+      <= 2 * M/4 + M/4 = M * (3/4)
+
+    We leave 1/4 of the L2 cache for
+      1. storing small tensors l and m
+      2. instruction (code)
+  */
+  args.kv_block_size = l2_cache_size / (static_cast<int>(sizeof(float)) * 4 * (args.qk_head_size + args.v_head_size));
+  args.kv_block_size = std::max(args.kv_block_size, 1);  // avoid kv_block_size = 0
+  args.q_block_size = std::min(args.kv_block_size, args.qk_head_size + args.v_head_size);
+  args.kv_block_size = std::min(args.kv_block_size, args.kv_sequence_length);  // No point to have kv_block_size > kv_sequence_length
+  args.q_block_size = std::min(args.q_block_size, args.q_sequence_length);     // No point to have q_block_size > q_sequence_length
+
+  args.thread_count = concurrency::ThreadPool::DegreeOfParallelism(tp);
+  args.buffer_size_per_thread = (static_cast<size_t>(args.q_block_size) * 2 +
+                                 static_cast<size_t>(args.q_block_size) * static_cast<size_t>(args.kv_block_size) +
+                                 static_cast<size_t>(args.q_block_size) * static_cast<size_t>(args.v_head_size)) *
+                                sizeof(float);
+
+  // When there are fewer query blocks than threads, e.g. when decoding a token with a small batch, the kv sequence
+  // is split into chunks of at least kv_block_size tokens that are processed by different threads, and their
+  // partial results are merged with the log-sum-exp correction of the softmax.
+  const int64_t q_chunk_count = (args.q_sequence_length + args.q_block_size - 1) / args.q_block_size;
+  const int64_t task_count = static_cast<int64_t>(args.batch_size) * args.num_heads * q_chunk_count;
+  args.kv_split_count = 1;
+  if (task_count > 0 && task_count < args.thread_count) {
+    const int64_t max_split_count = args.kv_sequence_length / args.kv_block_size;
+    args.kv_split_count = static_cast<int>(
+        std::max<int64_t>(std::min((args.thread_count + task_count - 1) / task_count, max_split_count), 1));
+  }
+  const size_t split_buffer_size =
+      args.kv_split_count > 1 ? SafeInt<size_t>(args.batch_size) * args.num_heads * args.q_sequence_length *
+                                    args.kv_split_count * (args.v_head_size + 2) * sizeof(float)
+                              : 0;
+
+  size_t buffer_bytes = args.buffer_size_per_thread * args.thread_count + split_buffer_size;
+  IAllocatorUniquePtr<void> buffer = IAllocator::MakeUniquePtr<void>(std::move(allocator), buffer_bytes);
+  args.buffer = reinterpret_cast<float*>(buffer.get());
+  args.split_buffer = args.kv_split_count > 1
+                          ? reinterpret_cast<float*>(reinterpret_cast<char*>(buffer.get()) +
+                                                     args.buffer_size_per_thread * args.thread_count)
+                          : nullptr;
+
+  MlasFlashAttention(&args, tp);
+}
+
 }  // namespace contrib
 }  // namespace onnxruntime
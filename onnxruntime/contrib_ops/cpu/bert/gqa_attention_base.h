@@ -10,6 +10,11 @@
 #include "contrib_ops/cpu/bert/attention_common.h"
 #include "core/common/safeint.h"
 #include "core/framework/op_kernel.h"
+#include "core/platform/env.h"
+#include "core/platform/env_var_utils.h"
+
+#include <type_traits>
+#include <vector>
 
 namespace onnxruntime {
 namespace contrib {
@@ -33,6 +38,9 @@ class GQAAttentionBase {
     use_smooth_softmax_ = info.GetAttrOrDefault<int64_t>("smooth_softmax", 0) == 1;
 
     local_window_size_ = has_local ? static_cast<int>(info.GetAttrOrDefault<int64_t>("local_window_size", -1)) : -1;
+
+    l2_cache_size_ = Env::Default().GetL2CacheSize();
+    disable_flash_ = ParseEnvironmentVariableWithDefault<bool>(attention::kDisableFlashAttention, false);
   }
 
   int num_heads_;     // number of attention heads of Q
@@ -44,6 +52,9 @@ class GQAAttentionBase {
 
   bool use_smooth_softmax_;
 
+  bool disable_flash_;
+  int l2_cache_size_;
+
   template <typename T>
   Status ApplyAttention(const T* Q,                                 // Q data with shape BxNxSxH
                         const T* K,                                 // K data with shape BxN_kvxSxH
@@ -71,11 +82,6 @@ class GQAAttentionBase {
     }
     int seqlen_present_kv_cache = static_cast<int>(present_key->Shape().GetDims()[2]);
 
-    // Compute the attention score.
-    size_t bytes = SafeInt<size_t>(batch_size) * num_heads_ * sequence_length * seqlen_present_kv_cache * sizeof(T);
-    auto attention_probs = allocator->Alloc(bytes);
-    BufferUniquePtr scratch_buffer(attention_probs, BufferDeleter(allocator));
-
     const T* past_key_data = past_key != nullptr ? past_key->Data<T>() : nullptr;
     T* present_key_data = present_key != nullptr ? present_key->MutableData<T>() : nullptr;
     const T* past_value_data = past_value != nullptr ? past_value->Data<T>() : nullptr;
@@ -83,6 +89,21 @@ class GQAAttentionBase {
 
     bool past_present_share_buffer = past_key_data == present_key_data && past_value_data == present_value_data;
 
+    if constexpr (std::is_same_v<T, float>) {
+      if (!disable_flash_ && l2_cache_size_ > 0 && local_window_size_ <= 0 && !use_smooth_softmax_) {
+        ApplyFlashAttention(Q, K, V, seqlens_k->Data<int32_t>(), batch_size, sequence_length, seqlen_past_kv_cache,
+                            seqlen_present_kv_cache, head_size, past_key_data, past_value_data, present_key_data,
+                            present_value_data, past_present_share_buffer, packed_qkv, output->MutableData<T>(),
+                            allocator, tp);
+        return Status::OK();
+      }
+    }
+
+    // Compute the attention score.
+    size_t bytes = SafeInt<size_t>(batch_size) * num_heads_ * sequence_length * seqlen_present_kv_cache * sizeof(T);
+    auto attention_probs = allocator->Alloc(bytes);
+    BufferUniquePtr scratch_buffer(attention_probs, BufferDeleter(allocator));
+
     const T* k = packed_qkv ? Q + num_heads_ * sequence_length * head_size : K;
     ComputeAttentionProbs<T>(static_cast<T*>(attention_probs), Q, k, seqlens_k->Data<int32_t>(), batch_size,
                              sequence_length, seqlen_past_kv_cache, seqlen_present_kv_cache, head_size, past_key_data,
@@ -98,7 +119,572 @@ class GQAAttentionBase {
     return Status::OK();
   }
 
+  // Attention with a paged kv cache. past_key and past_value are pools of fixed-size blocks with shape
+  // (num_blocks, N_kv, block_size, H) that are shared by all sequences, and block_table maps the i-th block of
+  // each sequence to a block of the pools. The new K and V are written in place into the blocks of present_key and
+  // present_value, which must share their buffers with past_key and past_value.
+  template <typename T>
+  Status ApplyPagedAttention(const T* Q,                                 // Q data with shape BxNxSxH
+                             const T* K,                                 // K data with shape BxN_kvxSxH
+                             const T* V,                                 // V data with shape BxN_kvxSxH
+                             const Tensor* past_key,                     // past K block pool
+                             const Tensor* past_value,                   // past V block pool
+                             Tensor* output,                             // output tensor
+                             Tensor* present_key,                        // present K block pool
+                             Tensor* present_value,                      // present V block pool
+                             const Tensor* seqlens_k,                    // past sequence lengths tensor
+                             const Tensor* block_table,                  // block table with shape BxMB
+                             GroupQueryAttentionParameters& parameters,  // attention parameters
+                             AllocatorPtr allocator,                     // allocator for temporary tensors
+                             OpKernelContext* context) const {
+    const int batch_size = parameters.batch_size;
+    const int sequence_length = parameters.sequence_length;
+    const int head_size = parameters.head_size;
+    const bool packed_qkv = parameters.is_packed_qkv;
+    // the longest sequence in the batch, which is the row stride of the attention probs
+    const int total_sequence_length = parameters.seqlen_present_kv_cache;
+
+    auto* tp = context->GetOperatorThreadPool();
+
+    // Copying the pools would cost as much as the blocks of every sequence sharing them, on every run.
+    T* present_key_data = present_key->MutableData<T>();
+    T* present_value_data = present_value->MutableData<T>();
+    if (present_key_data != past_key->Data<T>() || present_value_data != past_value->Data<T>()) {
+      return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT,
+                             "present_key and present_value must share their buffers with past_key and past_value "
+                             "with a paged kv cache.");
+    }
+
+    PagedKVCache<T> key_cache{present_key_data, block_table->Data<int32_t>(), parameters.kv_cache_block_size,
+                              parameters.max_blocks_per_sequence, kv_num_heads_, head_size};
+    PagedKVCache<T> value_cache{present_value_data, block_table->Data<int32_t>(), parameters.kv_cache_block_size,
+                                parameters.max_blocks_per_sequence, kv_num_heads_, head_size};
+
+    const T* k = packed_qkv ? Q + num_heads_ * sequence_length * head_size : K;
+    const T* v = packed_qkv ? Q + (num_heads_ + kv_num_heads_) * sequence_length * head_size : V;
+    WriteToPagedKVCache(key_cache, value_cache, k, v, seqlens_k->Data<int32_t>(), batch_size, sequence_length,
+                        total_sequence_length, head_size, packed_qkv, tp);
+
+    size_t bytes = SafeInt<size_t>(batch_size) * num_heads_ * sequence_length * total_sequence_length * sizeof(T);
+    auto attention_probs = allocator->Alloc(bytes);
+    BufferUniquePtr scratch_buffer(attention_probs, BufferDeleter(allocator));
+
+    ComputePagedAttentionProbs(static_cast<T*>(attention_probs), Q, key_cache, seqlens_k->Data<int32_t>(),
+                               batch_size, sequence_length, total_sequence_length, head_size, packed_qkv, tp);
+
+    ComputePagedVxAttentionScore(output->MutableData<T>(), static_cast<const T*>(attention_probs), value_cache,
+                                 seqlens_k->Data<int32_t>(), batch_size, sequence_length, total_sequence_length,
+                                 head_size, parameters.hidden_size, tp);
+
+    return Status::OK();
+  }
+
+  // Attention with a float16 or int8 kv cache for float inputs. The new K and V are converted, or quantized with one
+  // scale per head of each token, as they are written to the present kv cache. The cache is then dequantized block
+  // by block just before the blocks are multiplied with Q and with the attention probs, so that each kv head is read
+  // once in its compact type for all the query heads of its group.
+  template <typename TCache>
+  Status ApplyQuantizedKVCacheAttention(const float* Q,                              // Q data with shape BxNxSxH
+                                        const float* K,                              // K data with shape BxN_kvxSxH
+                                        const float* V,                              // V data with shape BxN_kvxSxH
+                                        const Tensor* past_key,                      // past K input tensor
+                                        const Tensor* past_value,                    // past V input tensor
+                                        const Tensor* past_key_scale,                // scales of an int8 past K
+                                        const Tensor* past_value_scale,              // scales of an int8 past V
+                                        Tensor* output,                              // output tensor
+                                        Tensor* present_key,                         // present K output tensor
+                                        Tensor* present_value,                       // present V output tensor
+                                        Tensor* present_key_scale,                   // scales of an int8 present K
+                                        Tensor* present_value_scale,                 // scales of an int8 present V
+                                        const Tensor* seqlens_k,                     // past sequence lengths tensor
+                                        GroupQueryAttentionParameters& parameters,  // attention parameters
+                                        OpKernelContext* context) const {
+    constexpr bool has_scales = std::is_same_v<TCache, int8_t>;
+    const int batch_size = parameters.batch_size;
+    const int sequence_length = parameters.sequence_length;
+    const int head_size = parameters.head_size;
+    const int hidden_size = parameters.hidden_size;
+    const bool packed_qkv = parameters.is_packed_qkv;
+    const bool is_prompt = sequence_length != 1;
+    const int32_t* seqlens = seqlens_k->Data<int32_t>();
+
+    auto* tp = context->GetOperatorThreadPool();
+
+    const int past_buffer_sequence_length =
+        past_key != nullptr ? static_cast<int>(past_key->Shape().GetDims()[2]) : 0;
+    const int present_buffer_sequence_length = static_cast<int>(present_key->Shape().GetDims()[2]);
+
+    const TCache* past_key_data = past_key != nullptr ? past_key->Data<TCache>() : nullptr;
+    const TCache* past_value_data = past_value != nullptr ? past_value->Data<TCache>() : nullptr;
+    TCache* present_key_data = present_key->MutableData<TCache>();
+    TCache* present_value_data = present_value->MutableData<TCache>();
+    const float* past_key_scale_data = has_scales && past_key_scale != nullptr ? past_key_scale->Data<float>()
+                                                                               : nullptr;
+    const float* past_value_scale_data = has_scales && past_value_scale != nullptr ? past_value_scale->Data<float>()
+                                                                                   : nullptr;
+    float* present_key_scale_data = has_scales ? present_key_scale->MutableData<float>() : nullptr;
+    float* present_value_scale_data = has_scales ? present_value_scale->MutableData<float>() : nullptr;
+
+    // The scales may be bound to their own buffers independently of the kv cache, so each is copied unless shared.
+    const bool share_key_buffer = past_key_data == present_key_data;
+    const bool share_value_buffer = past_value_data == present_value_data;
+    const bool share_key_scale_buffer = past_key_scale_data == present_key_scale_data;
+    const bool share_value_scale_buffer = past_value_scale_data == present_value_scale_data;
+
+    const ptrdiff_t packed_batch_stride =
+        packed_qkv ? SafeInt<ptrdiff_t>(num_heads_ + 2 * kv_num_heads_) * sequence_length * head_size
+                   : SafeInt<ptrdiff_t>(0);
+    const int kv_num_heads_factor = num_heads_ / kv_num_heads_;
+    const int q_rows = kv_num_heads_factor * sequence_length;  // rows of the query heads of a group
+    const size_t q_input_chunk_length = static_cast<size_t>(sequence_length) * head_size;   // S x H
+    const size_t kv_input_chunk_length = static_cast<size_t>(sequence_length) * head_size;  // S x H
+    const size_t present_buff_chunk_length = static_cast<size_t>(present_buffer_sequence_length) * head_size;
+    const float alpha = scale_ == 0.0f ? 1.0f / sqrt(static_cast<float>(head_size)) : scale_;
+
+    const float* k_input = packed_qkv ? Q + num_heads_ * sequence_length * head_size : K;
+    const float* v_input = packed_qkv ? Q + (num_heads_ + kv_num_heads_) * sequence_length * head_size : V;
+    float* output_data = output->MutableData<float>();
+
+    TensorOpCost unit_cost;
+    unit_cost.compute_cycles =
+        static_cast<double>(SafeInt<ptrdiff_t>(4) * q_rows * head_size * present_buffer_sequence_length);
+    unit_cost.bytes_loaded = static_cast<double>(2 * present_buff_chunk_length * sizeof(TCache) +
+                                                 static_cast<size_t>(q_rows) * head_size * sizeof(float));
+    unit_cost.bytes_stored = static_cast<double>(static_cast<size_t>(q_rows) * head_size * sizeof(float) +
+                                                 2 * kv_input_chunk_length * sizeof(TCache));
+
+    ThreadPool::TryParallelFor(
+        tp, SafeInt<ptrdiff_t>(batch_size) * kv_num_heads_, unit_cost, [&](std::ptrdiff_t begin, std::ptrdiff_t end) {
+          std::vector<float> probs(static_cast<size_t>(q_rows) * present_buffer_sequence_length);
+          std::vector<float> dequantized(static_cast<size_t>(kDequantizedBlockLength) * head_size);
+          std::vector<float> output_rows(static_cast<size_t>(q_rows) * head_size);
+
+          for (std::ptrdiff_t i = begin; i != end; ++i) {
+            const int batch_index = static_cast<int>(i / kv_num_heads_);
+            const int kv_head_index = static_cast<int>(i % kv_num_heads_);
+            const int past_seqlen = is_prompt ? 0 : static_cast<int>(seqlens[batch_index]);
+            const int total_seqlen = seqlens[batch_index] + 1;
+
+            TCache* key_cache = present_key_data + present_buff_chunk_length * i;
+            TCache* value_cache = present_value_data + present_buff_chunk_length * i;
+            float* key_scales = has_scales ? present_key_scale_data + present_buffer_sequence_length * i : nullptr;
+            float* value_scales = has_scales ? present_value_scale_data + present_buffer_sequence_length * i : nullptr;
+
+            if (!share_key_buffer) {
+              CopyPastKVCache(past_key_data, key_cache, past_buffer_sequence_length, present_buffer_sequence_length,
+                              past_seqlen, head_size, i);
+            }
+            if (!share_value_buffer) {
+              CopyPastKVCache(past_value_data, value_cache, past_buffer_sequence_length,
+                              present_buffer_sequence_length, past_seqlen, head_size, i);
+            }
+            if (has_scales && !share_key_scale_buffer) {
+              CopyPastKVCache(past_key_scale_data, key_scales, past_buffer_sequence_length,
+                              present_buffer_sequence_length, past_seqlen, 1, i);
+            }
+            if (has_scales && !share_value_scale_buffer) {
+              CopyPastKVCache(past_value_scale_data, value_scales, past_buffer_sequence_length,
+                              present_buffer_sequence_length, past_seqlen, 1, i);
+            }
+
+            const ptrdiff_t input_offset = packed_qkv ? packed_batch_stride * batch_index +
+                                                            SafeInt<ptrdiff_t>(kv_input_chunk_length) * kv_head_index
+                                                      : SafeInt<ptrdiff_t>(kv_input_chunk_length) * i;
+            const size_t cache_offset = static_cast<size_t>(past_seqlen) * head_size;
+            StoreKVCacheRows(k_input + input_offset, key_cache + cache_offset,
+                             has_scales ? key_scales + past_seqlen : nullptr, sequence_length, head_size);
+            StoreKVCacheRows(v_input + input_offset, value_cache + cache_offset,
+                             has_scales ? value_scales + past_seqlen : nullptr, sequence_length, head_size);
+
+            // The query heads of a group are adjacent, so their rows form one matrix of q_rows x H.
+            const int first_head_index = kv_head_index * kv_num_heads_factor;
+            const float* q = packed_qkv ? Q + packed_batch_stride * batch_index + q_input_chunk_length * first_head_index
+                                        : Q + q_input_chunk_length * (batch_index * num_heads_ + first_head_index);
+
+            // Compute Q*K' for each block of the kv cache
+            //                     original                 each iteration
+            // A: Q                (B x N x) S x H          (N / N_kv x S) x H
+            // B: K'               (B x N_kv x) T x H       H x block length
+            // C: attention_probs  (B x N x) S x T          (N / N_kv x S) x block length
+            for (int block_start = 0; block_start < total_seqlen; block_start += kDequantizedBlockLength) {
+              const int block_length = std::min(kDequantizedBlockLength, total_seqlen - block_start);
+              LoadKVCacheRows(key_cache + static_cast<size_t>(block_start) * head_size,
+                              has_scales ? key_scales + block_start : nullptr, dequantized.data(), block_length,
+                              head_size);
+              math::GemmEx<float, ThreadPool>(CblasNoTrans, CblasTrans, q_rows, block_length, head_size, alpha, q,
+                                              head_size, dequantized.data(), head_size, 0.0f /*beta*/,
+                                              probs.data() + block_start, present_buffer_sequence_length, nullptr);
+            }
+
+            for (int row = 0; row < q_rows; row++) {
+              // padding tokens of the prompt attend to the last token of the sequence
+              const int seq = row % sequence_length;
+              const int seq_causal_length = is_prompt ? std::min(seq + 1, total_seqlen) : total_seqlen;
+              ComputeCausalSoftmaxInplace(probs.data() + static_cast<size_t>(row) * present_buffer_sequence_length,
+                                          seq_causal_length, total_seqlen);
+            }
+
+            for (int block_start = 0; block_start < total_seqlen; block_start += kDequantizedBlockLength) {
+              const int block_length = std::min(kDequantizedBlockLength, total_seqlen - block_start);
+              LoadKVCacheRows(value_cache + static_cast<size_t>(block_start) * head_size,
+                              has_scales ? value_scales + block_start : nullptr, dequantized.data(), block_length,
+                              head_size);
+              math::GemmEx<float, ThreadPool>(CblasNoTrans, CblasNoTrans, q_rows, head_size, block_length, 1.0f,
+                                              probs.data() + block_start, present_buffer_sequence_length,
+                                              dequantized.data(), head_size, block_start == 0 ? 0.0f : 1.0f /*beta*/,
+                                              output_rows.data(), head_size, nullptr);
+            }
+
+            // output has shape BxSxNxH
+            for (int row = 0; row < q_rows; row++) {
+              const int head_index = first_head_index + row / sequence_length;
+              const int seq = row % sequence_length;
+              memcpy(output_data + (static_cast<size_t>(batch_index) * sequence_length + seq) * hidden_size +
+                         static_cast<size_t>(head_index) * head_size,
+                     output_rows.data() + static_cast<size_t>(row) * head_size, head_size * sizeof(float));
+            }
+          }
+        });
+
+    return Status::OK();
+  }
+
  private:
+  // Number of tokens of a float16 or int8 kv cache that are dequantized at a time.
+  static constexpr int kDequantizedBlockLength = 128;
+
+  // Copies the past tokens of the kv head i to the present kv cache, or their scales with a head_size of 1, and
+  // zeros the rest of it.
+  template <typename TData>
+  static void CopyPastKVCache(const TData* past, TData* present, int past_buffer_sequence_length,
+                              int present_buffer_sequence_length, int past_seqlen, int head_size, std::ptrdiff_t i) {
+    const size_t present_buff_chunk_length = static_cast<size_t>(present_buffer_sequence_length) * head_size;
+    const size_t past_chunk_length = static_cast<size_t>(past_seqlen) * head_size;
+    memset(present, 0, present_buff_chunk_length * sizeof(TData));
+    if (past_seqlen > 0) {
+      memcpy(present, past + static_cast<size_t>(past_buffer_sequence_length) * head_size * i,
+             past_chunk_length * sizeof(TData));
+    }
+  }
+
+  // Converts rows of H values to the kv cache, or quantizes each of them with its own scale for int8.
+  static void StoreKVCacheRows(const float* input, MLFloat16* cache, float* /*scales*/, int rows, int head_size) {
+    const size_t count = static_cast<size_t>(rows) * head_size;
+    for (size_t j = 0; j < count; j++) {
+      cache[j] = MLFloat16(input[j]);
+    }
+  }
+
+  static void StoreKVCacheRows(const float* input, int8_t* cache, float* scales, int rows, int head_size) {
+    MlasQuantizeRowsS8(input, cache, scales, rows, head_size);
+  }
+
+  // Converts rows of H values of the kv cache back to float.
+  static void LoadKVCacheRows(const MLFloat16* cache, const float* /*scales*/, float* output, int rows,
+                              int head_size) {
+    MlasConvertHalfToFloatBuffer(&cache->val, output, static_cast<size_t>(rows) * head_size);
+  }
+
+  static void LoadKVCacheRows(const int8_t* cache, const float* scales, float* output, int rows, int head_size) {
+    MlasDequantizeRowsS8(cache, scales, output, rows, head_size);
+  }
+
+  // Computes the attention with the flash attention kernel of MLAS instead of materializing the BxNxSxT attention
+  // probs. The new K and V are first written to the present kv cache, from which the kernel reads all the tokens
+  // of each sequence, with the query heads of a group sharing their kv head.
+  void ApplyFlashAttention(const float* Q,                      // Q data with shape BxNxSxH
+                           const float* K,                      // K data with shape BxN_kvxSxH
+                           const float* V,                      // V data with shape BxN_kvxSxH
+                           const int32_t* seqlens_k,            // past sequence lengths tensor
+                           int batch_size,                      // batch size of self-attention
+                           int sequence_length,                 // sequence length of self-attention (S)
+                           int past_buffer_sequence_length,     // sequence length of past state
+                           int present_buffer_sequence_length,  // sequence length of present state
+                           int head_size,                       // head size of self-attention
+                           const float* past_key,               // past key only
+                           const float* past_value,             // past value only
+                           float* present_key,                  // present key only
+                           float* present_value,                // present value only
+                           bool past_present_share_buffer,      // whether present key and value share the same buffer
+                           bool packed_qkv,                     // whether Q, K, V are packed
+                           float* output,                       // output with shape BxSxNxH
+                           AllocatorPtr allocator,              // allocator for the buffers of the kernel
+                           ThreadPool* tp) const {
+    const bool is_prompt = sequence_length != 1;
+    const ptrdiff_t packed_batch_stride =
+        packed_qkv ? SafeInt<ptrdiff_t>(num_heads_ + 2 * kv_num_heads_) * sequence_length * head_size
+                   : SafeInt<ptrdiff_t>(0);
+    const size_t kv_input_chunk_length = static_cast<size_t>(sequence_length) * head_size;                     // L x H
+    const size_t past_buff_chunk_length = static_cast<size_t>(past_buffer_sequence_length) * head_size;        // L x H
+    const size_t present_buff_chunk_length = static_cast<size_t>(present_buffer_sequence_length) * head_size;  // T x H
+
+    if (!past_present_share_buffer) {
+      memset(present_key, 0, batch_size * kv_num_heads_ * present_buffer_sequence_length * head_size * sizeof(float));
+      memset(present_value, 0, batch_size * kv_num_heads_ * present_buffer_sequence_length * head_size * sizeof(float));
+    }
+
+    const float* k = packed_qkv ? Q + num_heads_ * sequence_length * head_size : K;
+    const float* v = packed_qkv ? Q + (num_heads_ + kv_num_heads_) * sequence_length * head_size : V;
+
+    TensorOpCost unit_cost;
+    unit_cost.compute_cycles = 0;
+    unit_cost.bytes_loaded = static_cast<double>(2 * present_buff_chunk_length * sizeof(float));
+    unit_cost.bytes_stored = unit_cost.bytes_loaded;
+    ThreadPool::TryParallelFor(
+        tp, SafeInt<ptrdiff_t>(batch_size) * kv_num_heads_, unit_cost, [&](std::ptrdiff_t begin, std::ptrdiff_t end) {
+          for (std::ptrdiff_t i = begin; i != end; ++i) {
+            const int batch_index = static_cast<int>(i / kv_num_heads_);
+            const int kv_head_index = static_cast<int>(i % kv_num_heads_);
+            const int past_seqlen =
+                sequence_length == 1 ? static_cast<int>(seqlens_k[batch_index]) : past_buffer_sequence_length;
+            const size_t past_chunk_length = static_cast<size_t>(past_seqlen) * head_size;
+
+            const ptrdiff_t input_offset = packed_qkv ? packed_batch_stride * batch_index +
+                                                            SafeInt<ptrdiff_t>(kv_input_chunk_length) * kv_head_index
+                                                      : SafeInt<ptrdiff_t>(kv_input_chunk_length) * i;
+            ConcatStateChunkGQA(past_key, k + input_offset, present_key, present_buff_chunk_length,
+                                past_buff_chunk_length, past_chunk_length, kv_input_chunk_length, is_prompt,
+                                past_present_share_buffer, i);
+            ConcatStateChunkGQA(past_value, v + input_offset, present_value, present_buff_chunk_length,
+                                past_buff_chunk_length, past_chunk_length, kv_input_chunk_length, is_prompt,
+                                past_present_share_buffer, i);
+          }
+        });
+
+    std::vector<int32_t> total_seqlens(batch_size);
+    for (int b = 0; b < batch_size; b++) {
+      total_seqlens[b] = seqlens_k[b] + 1;
+    }
+
+    MlasFlashAttentionThreadedArgs args;
+    args.batch_size = batch_size;
+    args.num_heads = num_heads_;
+    args.kv_num_heads = kv_num_heads_;
+    args.q_sequence_length = sequence_length;
+    args.kv_sequence_length = present_buffer_sequence_length;
+    args.kv_sequence_lengths = total_seqlens.data();
+    args.qk_head_size = head_size;
+    args.v_head_size = head_size;
+    args.scale = scale_ == 0.0f ? 1.0f / sqrt(static_cast<float>(head_size)) : scale_;
+    args.is_causal = true;
+    args.q_batch_stride = static_cast<size_t>(packed_qkv ? packed_batch_stride : 0);
+    args.query = Q;
+    args.key = present_key;
+    args.value = present_value;
+    args.output = output;
+    RunFlashAttention(args, l2_cache_size_, std::move(allocator), tp);
+  }
+
+  // A view of a block pool with shape (num_blocks, N_kv, block_size, H) and the block table of the batch.
+  template <typename T>
+  struct PagedKVCache {
+    T* pool;
+    const int32_t* block_table;
+    int block_size;
+    int max_blocks_per_sequence;
+    int kv_num_heads;
+    int head_size;
+
+    // Returns the first of the block_size tokens of the block_idx-th block of a sequence for a kv head.
+    T* Block(int batch_index, int block_idx, int kv_head_index) const {
+      const int32_t block = block_table[static_cast<ptrdiff_t>(batch_index) * max_blocks_per_sequence + block_idx];
+      return pool + ((static_cast<ptrdiff_t>(block) * kv_num_heads + kv_head_index) * block_size) * head_size;
+    }
+
+    T* Token(int batch_index, int position, int kv_head_index) const {
+      return Block(batch_index, position / block_size, kv_head_index) +
+             static_cast<ptrdiff_t>(position % block_size) * head_size;
+    }
+  };
+
+  // Returns the number of tokens of a sequence that are in the kv cache before this run. seqlens_k holds the number
+  // of tokens after this run - 1. When the new tokens are the whole sequence (S == T), this is the first prompt,
+  // the cache is empty and the shorter sequences are right-padded. Otherwise the S new tokens, without padding,
+  // follow the cached tokens, which covers both token generation and a prompt continuing a cached prefix.
+  static int PagedPastSequenceLength(const int32_t* seqlens_k, int batch_index, int sequence_length,
+                                     int total_sequence_length) {
+    return sequence_length == total_sequence_length
+               ? 0
+               : static_cast<int>(seqlens_k[batch_index]) + 1 - sequence_length;
+  }
+
+  // Writes the new tokens of K and V, excluding padding, to their blocks.
+  template <typename T>
+  void WriteToPagedKVCache(const PagedKVCache<T>& key_cache,
+                           const PagedKVCache<T>& value_cache,
+                           const T* K,                  // K data with shape BxN_kvxSxH
+                           const T* V,                  // V data with shape BxN_kvxSxH
+                           const int32_t* seqlens_k,    // past sequence lengths tensor
+                           int batch_size,              // batch size
+                           int sequence_length,         // sequence length of the new tokens (S)
+                           int total_sequence_length,   // longest sequence in the batch (T)
+                           int head_size,               // head size of K and V
+                           bool packed_qkv,             // whether Q, K, V are packed
+                           ThreadPool* tp) const {
+    const ptrdiff_t packed_batch_stride =
+        packed_qkv ? SafeInt<ptrdiff_t>(num_heads_ + 2 * kv_num_heads_) * sequence_length * head_size
+                   : SafeInt<ptrdiff_t>(0);
+    const size_t kv_input_chunk_length = static_cast<size_t>(sequence_length) * head_size;  // S x H
+    const size_t bytes_per_token = static_cast<size_t>(head_size) * sizeof(T);
+
+    TensorOpCost unit_cost;
+    unit_cost.compute_cycles = 0;
+    unit_cost.bytes_loaded = static_cast<double>(2 * kv_input_chunk_length * sizeof(T));
+    unit_cost.bytes_stored = unit_cost.bytes_loaded;
+
+    ThreadPool::TryParallelFor(
+        tp, SafeInt<ptrdiff_t>(batch_size) * kv_num_heads_, unit_cost, [&](std::ptrdiff_t begin, std::ptrdiff_t end) {
+          for (std::ptrdiff_t i = begin; i != end; ++i) {
+            const int batch_index = static_cast<int>(i / kv_num_heads_);
+            const int kv_head_index = static_cast<int>(i % kv_num_heads_);
+            const int past_seqlen =
+                PagedPastSequenceLength(seqlens_k, batch_index, sequence_length, total_sequence_length);
+            const int new_seqlen = std::min(sequence_length, static_cast<int>(seqlens_k[batch_index]) + 1 - past_seqlen);
+
+            const T* k;
+            const T* v;
+            if (packed_qkv) {
+              k = K + packed_batch_stride * batch_index + kv_input_chunk_length * kv_head_index;
+              v = V + packed_batch_stride * batch_index + kv_input_chunk_length * kv_head_index;
+            } else {
+              k = K + kv_input_chunk_length * i;
+              v = V + kv_input_chunk_length * i;
+            }
+            for (int seq = 0; seq < new_seqlen; seq++) {
+              memcpy(key_cache.Token(batch_index, past_seqlen + seq, kv_head_index), k + seq * head_size,
+                     bytes_per_token);
+              memcpy(value_cache.Token(batch_index, past_seqlen + seq, kv_head_index), v + seq * head_size,
+                     bytes_per_token);
+            }
+          }
+        });
+  }
+
+  // Same as ComputeAttentionProbs() except that Q x K' is computed block by block from the paged kv cache.
+  template <typename T>
+  void ComputePagedAttentionProbs(T* attention_probs,              // output buffer with size BxNxSxT
+                                  const T* Q,                      // Q data. Its size is BxNxSxH
+                                  const PagedKVCache<T>& key_cache,
+                                  const int32_t* seqlens_k,        // past sequence lengths tensor
+                                  int batch_size,                  // batch size of self-attention
+                                  int sequence_length,             // sequence length of self-attention (S)
+                                  int total_sequence_length,       // longest sequence in the batch (T)
+                                  int head_size,                   // head size of self-attention
+                                  bool packed_qkv,                 // whether Q, K, V are packed
+                                  ThreadPool* tp) const {
+    const ptrdiff_t packed_batch_stride =
+        packed_qkv ? SafeInt<ptrdiff_t>(num_heads_ + 2 * kv_num_heads_) * sequence_length * head_size
+                   : SafeInt<ptrdiff_t>(0);
+    const int kv_num_heads_factor = num_heads_ / kv_num_heads_;
+    const size_t q_input_chunk_length = static_cast<size_t>(sequence_length) * head_size;  // S x H
+    const int block_size = key_cache.block_size;
+
+    const int loop_len = batch_size * num_heads_;
+    const float alpha = scale_ == 0.0f ? 1.0f / sqrt(static_cast<float>(head_size)) : scale_;
+
+    TensorOpCost unit_cost;
+    const ptrdiff_t probs_matrix_bytes = SafeInt<ptrdiff_t>(sequence_length) * total_sequence_length * sizeof(T);
+    unit_cost.compute_cycles =
+        static_cast<double>(SafeInt<ptrdiff_t>(2) * sequence_length * head_size * total_sequence_length);
+    unit_cost.bytes_loaded = static_cast<double>((sequence_length + total_sequence_length) * head_size * sizeof(T));
+    unit_cost.bytes_stored = static_cast<double>(probs_matrix_bytes);
+
+    unit_cost.bytes_loaded += static_cast<double>(probs_matrix_bytes);
+    unit_cost.bytes_stored += static_cast<double>(probs_matrix_bytes);
+
+    ThreadPool::TryParallelFor(tp, loop_len, unit_cost, [&](std::ptrdiff_t begin, std::ptrdiff_t end) {
+      for (std::ptrdiff_t i = begin; i != end; ++i) {
+        const int batch_index = static_cast<int>(i) / num_heads_;
+        const int head_index = static_cast<int>(i) % num_heads_;
+        const int kv_head_index = head_index / kv_num_heads_factor;
+        const int past_seqlen =
+            PagedPastSequenceLength(seqlens_k, batch_index, sequence_length, total_sequence_length);
+        const int total_seqlen = seqlens_k[batch_index] + 1;
+
+        const ptrdiff_t output_offset = SafeInt<ptrdiff_t>(i) * sequence_length * total_sequence_length;
+        T* output = attention_probs + output_offset;
+
+        const T* q;
+        if (packed_qkv) {
+          q = Q + packed_batch_stride * batch_index + q_input_chunk_length * head_index;
+        } else {
+          q = Q + q_input_chunk_length * i;
+        }
+
+        // Compute Q*K' for the tokens of each block
+        //                     original                 transposed             each iteration
+        // A: Q                (B x N x) S x H          (B x N x) S x H        S x H
+        // B: K'               (B x N x) T x H          (B x N x) H x T        H x block_size
+        // C: attention_probs  (B x N x) S x T          (B x N x) S x T        S x block_size
+        for (int block_start = 0; block_start < total_seqlen; block_start += block_size) {
+          const int block_tokens = std::min(block_size, total_seqlen - block_start);
+          const T* k = key_cache.Block(batch_index, block_start / block_size, kv_head_index);
+          math::GemmEx<T, ThreadPool>(CblasNoTrans, CblasTrans, sequence_length, block_tokens, head_size, alpha, q,
+                                      head_size, k, head_size, 0.0f /*beta*/, output + block_start,
+                                      total_sequence_length, nullptr);
+        }
+
+        // compute Softmax
+        T* output_softmax = output;
+        for (int seq = 0; seq < sequence_length; seq++) {
+          // padding tokens of the prompt attend to the last token of the sequence
+          int seq_causal_length = std::min(past_seqlen + seq + 1, total_seqlen);
+          ComputeCausalSoftmaxInplace(output_softmax, seq_causal_length, total_seqlen);
+          output_softmax += total_sequence_length;
+        }
+      }
+    });
+  }
+
+  // Same as ComputeVxAttentionScore() except that the product with V is accumulated block by block from the
+  // paged kv cache.
+  template <typename T>
+  void ComputePagedVxAttentionScore(T* output,                          // buffer for the result with size BxSxNxH
+                                    const T* attention_probs,           // Attention probs with size BxNxSxT
+                                    const PagedKVCache<T>& value_cache,
+                                    const int32_t* seqlens_k,           // past sequence lengths tensor
+                                    int batch_size,                     // batch size
+                                    int sequence_length,                // sequence length
+                                    int total_sequence_length,          // longest sequence in the batch (T)
+                                    int head_size,                      // head size of Q, K, V
+                                    int hidden_size,                    // hidden size of Output
+                                    ThreadPool* tp) const {
+    const int kv_num_heads_factor = num_heads_ / kv_num_heads_;
+    const int block_size = value_cache.block_size;
+
+    // The cost of Gemm
+    TensorOpCost unit_cost;
+    unit_cost.compute_cycles =
+        static_cast<double>(SafeInt<ptrdiff_t>(2) * sequence_length * head_size * total_sequence_length);
+    unit_cost.bytes_loaded = static_cast<double>(SafeInt<ptrdiff_t>(sequence_length + head_size) *
+                                                 total_sequence_length * sizeof(T));
+    unit_cost.bytes_stored = static_cast<double>(sequence_length * head_size * sizeof(T));
+
+    ThreadPool::TryParallelFor(
+        tp, SafeInt<ptrdiff_t>(batch_size) * num_heads_, unit_cost, [&](std::ptrdiff_t begin, std::ptrdiff_t end) {
+          for (std::ptrdiff_t i = begin; i != end; ++i) {
+            const int batch_index = static_cast<int>(i / num_heads_);
+            const int head_index = static_cast<int>(i % num_heads_);
+            const int kv_head_index = head_index / kv_num_heads_factor;
+            const int total_seqlen = seqlens_k[batch_index] + 1;
+
+            T* output_current = output + (batch_index * sequence_length * num_heads_ + head_index) * head_size;
+            ptrdiff_t attention_probs_offset = SafeInt<ptrdiff_t>(sequence_length) * total_sequence_length * i;
+            const T* probs = attention_probs + attention_probs_offset;
+
+            for (int block_start = 0; block_start < total_seqlen; block_start += block_size) {
+              const int block_tokens = std::min(block_size, total_seqlen - block_start);
+              const T* v = value_cache.Block(batch_index, block_start / block_size, kv_head_index);
+              math::GemmEx<T, ThreadPool>(CblasNoTrans, CblasNoTrans, sequence_length, head_size, block_tokens,
+                                          1.f, /*alpha*/
+                                          probs + block_start, total_sequence_length, v, head_size,
+                                          block_start == 0 ? 0.0f : 1.0f /*beta*/, output_current, hidden_size,
+                                          nullptr);
+            }
+          }
+        });
+  }
+
   // Helper function to compute the attention probs. It does 2 things:
   //  attention_probs(B, N, S, T) = 1/sqrt(H) x Q(B, N, S, H) x K'(B, N, T, H -> B, N, H, T)
   //  attention_probs(B, N, S, T) = Softmax(attention_probs)
@@ -195,36 +781,42 @@ class GQAAttentionBase {
         T* output_softmax = output;
         for (int seq = 0; seq < sequence_length; seq++) {
           int seq_causal_length = sequence_length == 1 ? total_seqlen : seq + 1;
-          if (local_window_size_ > 0 && seq_causal_length > local_window_size_ + 1) {
-            for (int total_seq_id = 0; total_seq_id < seq_causal_length - local_window_size_ - 1; total_seq_id++) {
-              output_softmax[total_seq_id] = 0.f;
-            }
-            if (use_smooth_softmax_) {
-              ComputeSmoothSoftmaxInplace(output_softmax + seq_causal_length - local_window_size_ - 1, 1,
-                                          local_window_size_ + 1, nullptr);
-            } else {
-              ComputeAttentionSoftmaxInplace(output_softmax + seq_causal_length - local_window_size_ - 1, 1,
-                                             local_window_size_ + 1, nullptr);
-            }
-          } else {
-            if (use_smooth_softmax_) {
-              ComputeSmoothSoftmaxInplace(output_softmax, 1, seq_causal_length, nullptr);
-            } else {
-              ComputeAttentionSoftmaxInplace(output_softmax, 1, seq_causal_length, nullptr);
-            }
-          }
-
-          // set causal [seq_causal_length, total_seqlen) to 0.f
-          for (int total_seq_id = seq_causal_length; total_seq_id < total_seqlen; total_seq_id++) {
-            output_softmax[total_seq_id] = 0.f;
-          }
-
+          ComputeCausalSoftmaxInplace(output_softmax, seq_causal_length, total_seqlen);
           output_softmax += present_buffer_sequence_length;
         }
       }
     });
   }
 
+  // Applies softmax to the first seq_causal_length scores of a row, restricted to the local window if any,
+  // and sets the others up to total_seqlen to 0.
+  template <typename T>
+  void ComputeCausalSoftmaxInplace(T* output_softmax, int seq_causal_length, int total_seqlen) const {
+    if (local_window_size_ > 0 && seq_causal_length > local_window_size_ + 1) {
+      for (int total_seq_id = 0; total_seq_id < seq_causal_length - local_window_size_ - 1; total_seq_id++) {
+        output_softmax[total_seq_id] = 0.f;
+      }
+      if (use_smooth_softmax_) {
+        ComputeSmoothSoftmaxInplace(output_softmax + seq_causal_length - local_window_size_ - 1, 1,
+                                    local_window_size_ + 1, nullptr);
+      } else {
+        ComputeAttentionSoftmaxInplace(output_softmax + seq_causal_length - local_window_size_ - 1, 1,
+                                       local_window_size_ + 1, nullptr);
+      }
+    } else {
+      if (use_smooth_softmax_) {
+        ComputeSmoothSoftmaxInplace(output_softmax, 1, seq_causal_length, nullptr);
+      } else {
+        ComputeAttentionSoftmaxInplace(output_softmax, 1, seq_causal_length, nullptr);
+      }
+    }
+
+    // set causal [seq_causal_length, total_seqlen) to 0.f
+    for (int total_seq_id = seq_causal_length; total_seq_id < total_seqlen; total_seq_id++) {
+      output_softmax[total_seq_id] = 0.f;
+    }
+  }
+
   template <typename T>
   void ComputeVxAttentionScore(T* output,                           // buffer for the result with size BxSxNxH
                                const T* attention_probs,            // Attention probs with size BxNxSxT
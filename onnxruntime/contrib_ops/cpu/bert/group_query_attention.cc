@@ -30,6 +30,9 @@ ONNX_OPERATOR_TYPED_KERNEL_EX(
     kCpuExecutionProvider,
     KernelDefBuilder()
         .TypeConstraint("T", DataTypeImpl::GetTensorType<float>())
+        .TypeConstraint("T_CACHE", {DataTypeImpl::GetTensorType<float>(),
+                                    DataTypeImpl::GetTensorType<MLFloat16>(),
+                                    DataTypeImpl::GetTensorType<int8_t>()})
         .TypeConstraint("M", DataTypeImpl::GetTensorType<int32_t>()),
     GroupQueryAttention<float>);
 
@@ -48,6 +51,9 @@ Status GroupQueryAttention<T>::Compute(OpKernelContext* context) const {
   const Tensor* total_seqlen = context->Input<Tensor>(6);
   const Tensor* cos_cache = context->Input<Tensor>(7);
   const Tensor* sin_cache = context->Input<Tensor>(8);
+  const Tensor* block_table = context->Input<Tensor>(9);
+  const Tensor* past_key_scale = context->Input<Tensor>(10);
+  const Tensor* past_value_scale = context->Input<Tensor>(11);
 
   GroupQueryAttentionParameters parameters = {};
   constexpr float scale = 1.0f;
@@ -58,6 +64,7 @@ Status GroupQueryAttention<T>::Compute(OpKernelContext* context) const {
                                                                 past_value,
                                                                 cos_cache,
                                                                 sin_cache,
+                                                                block_table,
                                                                 &parameters,
                                                                 num_heads_,
                                                                 kv_num_heads_,
@@ -80,8 +87,42 @@ Status GroupQueryAttention<T>::Compute(OpKernelContext* context) const {
 
   std::vector<int64_t> present_k_shape({static_cast<int64_t>(batch_size), static_cast<int64_t>(kv_num_heads_), static_cast<int64_t>(present_kv_seqlen), static_cast<int64_t>(head_size)});
   std::vector<int64_t> present_v_shape({static_cast<int64_t>(batch_size), static_cast<int64_t>(kv_num_heads_), static_cast<int64_t>(present_kv_seqlen), static_cast<int64_t>(head_size)});
+  if (parameters.is_paged_kv_cache) {
+    // present key and value are the updated block pools
+    present_k_shape = past_key->Shape().AsShapeVector();
+    present_v_shape = past_value->Shape().AsShapeVector();
+  }
   Tensor* present_k = context->Output(1, present_k_shape);
   Tensor* present_v = context->Output(2, present_v_shape);
+  if (parameters.is_paged_kv_cache && (present_k == nullptr || present_v == nullptr)) {
+    return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT,
+                           "Output 'present_key' and 'present_value' are required with a paged kv cache.");
+  }
+
+  // A float16 or int8 kv cache has a different type than the inputs.
+  const bool is_quantized_kv_cache = present_k != nullptr && !present_k->IsDataType<T>();
+  Tensor* present_k_scale = nullptr;
+  Tensor* present_v_scale = nullptr;
+  if (is_quantized_kv_cache) {
+    if (parameters.is_paged_kv_cache) {
+      return ORT_MAKE_STATUS(ONNXRUNTIME, NOT_IMPLEMENTED,
+                             "A paged kv cache of a different type than the inputs is not supported.");
+    }
+    if (present_k->IsDataType<int8_t>()) {
+      ORT_RETURN_IF_ERROR(group_query_attention_helper::CheckKVCacheScaleInputs(past_key, past_value, past_key_scale,
+                                                                                past_value_scale));
+      std::vector<int64_t> present_scale_shape({static_cast<int64_t>(batch_size),
+                                                static_cast<int64_t>(kv_num_heads_),
+                                                static_cast<int64_t>(present_kv_seqlen)});
+      present_k_scale = context->Output(3, present_scale_shape);
+      present_v_scale = context->Output(4, present_scale_shape);
+      if (present_k_scale == nullptr || present_v_scale == nullptr) {
+        return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT,
+                               "Output 'present_key_scale' and 'present_value_scale' are required with an int8 kv "
+                               "cache.");
+      }
+    }
+  }
 
   AllocatorPtr allocator;
   ORT_RETURN_IF_ERROR(context->GetTempSpaceAllocator(&allocator));
@@ -114,13 +155,21 @@ Status GroupQueryAttention<T>::Compute(OpKernelContext* context) const {
     rotary_params.seq_stride = head_size;
     rotary_params.head_stride = sequence_length * rotary_params.seq_stride;
     rotary_params.batch_stride = (packed_qkv ? (num_heads_ + 2 * kv_num_heads_) : num_heads_) * rotary_params.head_stride;
-    rotary_params.position_ids_format = sequence_length == 1 ? 1 : 0;
+    // The new tokens start at position 0 for the first prompt, and follow the cached tokens otherwise, which with
+    // a paged kv cache may also be the case for a prompt.
+    const bool continues_past = sequence_length == 1 ||
+                                (parameters.is_paged_kv_cache &&
+                                 sequence_length != parameters.seqlen_present_kv_cache);
+    rotary_params.position_ids_format = continues_past ? 1 : 0;
     rotary_params.transposed = true;
     auto* tp = context->GetOperatorThreadPool();
-    std::vector<int64_t> pos_ids(sequence_length == 1 ? batch_size : 1);
-    if (sequence_length == 1) {
+    std::vector<int64_t> pos_ids(continues_past ? SafeInt<size_t>(batch_size) * sequence_length : 1);
+    if (continues_past) {
       for (int b = 0; b < batch_size; b++) {
-        pos_ids[b] = static_cast<int64_t>(seqlens_k->Data<int32_t>()[b]);
+        const int64_t past_seqlen = static_cast<int64_t>(seqlens_k->Data<int32_t>()[b]) + 1 - sequence_length;
+        for (int s = 0; s < sequence_length; s++) {
+          pos_ids[static_cast<size_t>(b) * sequence_length + s] = past_seqlen + s;
+        }
       }
     } else {
       pos_ids[0] = static_cast<int64_t>(0);
@@ -176,6 +225,26 @@ Status GroupQueryAttention<T>::Compute(OpKernelContext* context) const {
   }
 
   ORT_RETURN_IF_ERROR(context->GetTempSpaceAllocator(&allocator));
+  if (parameters.is_paged_kv_cache) {
+    return ApplyPagedAttention(Q.Get<Tensor>().Data<T>(), packed_qkv ? nullptr : K.Get<Tensor>().Data<T>(),
+                               packed_qkv ? nullptr : V.Get<Tensor>().Data<T>(), past_key, past_value, output,
+                               present_k, present_v, seqlens_k, block_table, parameters, allocator, context);
+  }
+
+  if (is_quantized_kv_cache) {
+    const T* q_data = Q.Get<Tensor>().Data<T>();
+    const T* k_data = packed_qkv ? nullptr : K.Get<Tensor>().Data<T>();
+    const T* v_data = packed_qkv ? nullptr : V.Get<Tensor>().Data<T>();
+    if (present_k->IsDataType<int8_t>()) {
+      return ApplyQuantizedKVCacheAttention<int8_t>(q_data, k_data, v_data, past_key, past_value, past_key_scale,
+                                                    past_value_scale, output, present_k, present_v, present_k_scale,
+                                                    present_v_scale, seqlens_k, parameters, context);
+    }
+    return ApplyQuantizedKVCacheAttention<MLFloat16>(q_data, k_data, v_data, past_key, past_value, nullptr, nullptr,
+                                                     output, present_k, present_v, nullptr, nullptr, seqlens_k,
+                                                     parameters, context);
+  }
+
   // Compute the attention score and apply the score to V
   return ApplyAttention(Q.Get<Tensor>().Data<T>(), packed_qkv ? nullptr : K.Get<Tensor>().Data<T>(),
                         packed_qkv ? nullptr : V.Get<Tensor>().Data<T>(), past_key, past_value, output, present_k, present_v,
@@ -11,6 +11,104 @@ namespace onnxruntime {
 namespace contrib {
 namespace group_query_attention_helper {
 
+// Checks the block pools and block table of a paged kv cache. The block indices in the table are validated
+// as well, since the kernel uses them to address the pools.
+Status CheckPagedKVCacheInputs(const Tensor* past_key,
+                               const Tensor* past_value,
+                               const Tensor* block_table,
+                               int batch_size,
+                               int kv_num_heads,
+                               int head_size,
+                               int& kv_cache_block_size,
+                               int& num_kv_cache_blocks,
+                               int& max_blocks_per_sequence) {
+  if (past_key == nullptr || past_value == nullptr) {
+    return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT,
+                           "Input 'past_key' and 'past_value' shall be present when 'block_table' is present.");
+  }
+
+  const auto& past_key_dims = past_key->Shape().GetDims();
+  if (past_key_dims.size() != 4) {
+    return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT,
+                           "Input 'past_key' is expected to have 4 dimensions with a paged kv cache, got ",
+                           past_key_dims.size());
+  }
+  if (past_value->Shape() != past_key->Shape()) {
+    return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT,
+                           "Input 'past_key' and 'past_value' shall have the same shape with a paged kv cache.");
+  }
+  if (past_key_dims[1] != kv_num_heads) {
+    return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT,
+                           "Input 'past_key' dimension 1 should be kv_num_heads, got ", past_key_dims[1]);
+  }
+  if (past_key_dims[2] <= 0) {
+    return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT,
+                           "Input 'past_key' dimension 2 (block size) should be positive, got ", past_key_dims[2]);
+  }
+  if (past_key_dims[3] != head_size) {
+    return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT,
+                           "Input 'past_key' dimension 3 should be same as head_size, got ", past_key_dims[3]);
+  }
+
+  const auto& block_table_dims = block_table->Shape().GetDims();
+  if (block_table_dims.size() != 2 || block_table_dims[0] != batch_size) {
+    return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT,
+                           "Input 'block_table' is expected to have shape (batch_size, max_blocks_per_sequence), got ",
+                           block_table->Shape());
+  }
+
+  num_kv_cache_blocks = static_cast<int>(past_key_dims[0]);
+  kv_cache_block_size = static_cast<int>(past_key_dims[2]);
+  max_blocks_per_sequence = static_cast<int>(block_table_dims[1]);
+
+  // Unused entries may hold any valid block index, e.g. 0.
+  for (int32_t block_index : block_table->DataAsSpan<int32_t>()) {
+    if (block_index < 0 || block_index >= num_kv_cache_blocks) {
+      return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT,
+                             "Input 'block_table' contains block index ", block_index, " which is out of range [0, ",
+                             num_kv_cache_blocks, ")");
+    }
+  }
+
+  return Status::OK();
+}
+
+// Checks the scales of an int8 kv cache, which have the shape of past_key and past_value without the head size.
+Status CheckKVCacheScaleInputs(const Tensor* past_key,
+                               const Tensor* past_value,
+                               const Tensor* past_key_scale,
+                               const Tensor* past_value_scale) {
+  if (past_key == nullptr || past_value == nullptr) {
+    if (past_key_scale != nullptr || past_value_scale != nullptr) {
+      return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT,
+                             "Input 'past_key_scale' and 'past_value_scale' shall not be present without 'past_key' "
+                             "and 'past_value'.");
+    }
+    return Status::OK();
+  }
+
+  if (past_key_scale == nullptr || past_value_scale == nullptr) {
+    return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT,
+                           "Input 'past_key_scale' and 'past_value_scale' shall be present with an int8 kv cache.");
+  }
+  const auto& past_key_dims = past_key->Shape().GetDims();
+  const auto& past_value_dims = past_value->Shape().GetDims();
+  if (past_key_scale->Shape() != TensorShape({past_key_dims[0], past_key_dims[1], past_key_dims[2]})) {
+    return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT,
+                           "Input 'past_key_scale' is expected to have shape (batch_size, kv_num_heads, "
+                           "past_sequence_length), got ",
+                           past_key_scale->Shape());
+  }
+  if (past_value_scale->Shape() != TensorShape({past_value_dims[0], past_value_dims[1], past_value_dims[2]})) {
+    return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT,
+                           "Input 'past_value_scale' is expected to have shape (batch_size, kv_num_heads, "
+                           "past_sequence_length), got ",
+                           past_value_scale->Shape());
+  }
+
+  return Status::OK();
+}
+
 Status CheckInputs(const Tensor* query,
                    const Tensor* key,
                    const Tensor* value,
@@ -18,6 +116,7 @@ Status CheckInputs(const Tensor* query,
                    const Tensor* past_value,
                    const Tensor* cos_cache,
                    const Tensor* sin_cache,
+                   const Tensor* block_table,
                    void* parameters,
                    int num_heads,
                    int kv_num_heads,
@@ -27,6 +126,10 @@ Status CheckInputs(const Tensor* query,
   // Note: Here S* is seqlen_past_kv_cache, S+ is seqlen_present_kv_cache
   //     past_key                   : (B, N_k, S*, H) or (B, N_k, S+, H) or nullptr
   //     past_value                 : (B, N_k, S*, H) or (B, N_k, S+, H) or nullptr
+  // paged kv cache, where NB is the number of blocks, BS the block size and MB the max blocks per sequence:
+  //     past_key                   : (NB, N_k, BS, H)
+  //     past_value                 : (NB, N_k, BS, H)
+  //     block_table                : (B, MB)
   // no packing for q/k/v:
   //     query            (Q)       : (B, S, D) or (B, S, (D_q + 2 D_kv))
   //     key              (K)       : (B, S, D_kv) or nullptr
@@ -109,7 +212,15 @@ Status CheckInputs(const Tensor* query,
 
   // Check past-present KV
   int32_t past_sequence_length = 0;
-  if (past_key != nullptr && past_value != nullptr) {
+  const bool is_paged_kv_cache = block_table != nullptr;
+  int kv_cache_block_size = 0;
+  int num_kv_cache_blocks = 0;
+  int max_blocks_per_sequence = 0;
+  if (is_paged_kv_cache) {
+    ORT_RETURN_IF_ERROR(CheckPagedKVCacheInputs(past_key, past_value, block_table, batch_size, kv_num_heads,
+                                                head_size, kv_cache_block_size, num_kv_cache_blocks,
+                                                max_blocks_per_sequence));
+  } else if (past_key != nullptr && past_value != nullptr) {
     const auto& past_key_dims = past_key->Shape().GetDims();
     const auto& past_value_dims = past_value->Shape().GetDims();
 
@@ -182,6 +293,28 @@ Status CheckInputs(const Tensor* query,
   int total_sequence_length = *((*total_seqlen).template Data<int32_t>());
   int present_sequence_length = std::max(total_sequence_length, past_sequence_length);
 
+  if (is_paged_kv_cache) {
+    // The block table must cover every token of every sequence, as the kernel reads and writes blocks through it.
+    const int64_t capacity = static_cast<int64_t>(max_blocks_per_sequence) * kv_cache_block_size;
+    const int32_t* seqlens_k_data = seqlens_k->Data<int32_t>();
+    for (int b = 0; b < batch_size; b++) {
+      const int64_t sequence_total_length = static_cast<int64_t>(seqlens_k_data[b]) + 1;
+      if (sequence_total_length < 1 || sequence_total_length > total_sequence_length ||
+          sequence_total_length > capacity) {
+        return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT,
+                               "seqlens_k[", b, "] + 1 must be in the range [1, min(total_sequence_length, "
+                               "max_blocks_per_sequence * block_size)] with a paged kv cache. Got ",
+                               sequence_total_length);
+      }
+      // Unless this is the first prompt, the new tokens follow the cached ones and cannot be padded.
+      if (sequence_length != total_sequence_length && sequence_total_length < sequence_length) {
+        return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT,
+                               "seqlens_k[", b, "] + 1 must not be less than sequence_length with a paged kv cache "
+                               "when sequence_length != total_sequence_length. Got ", sequence_total_length);
+      }
+    }
+  }
+
   int rotary_dim = 0;
   if (cos_cache != nullptr && sin_cache != nullptr) {
     const auto& cos_dims = cos_cache->Shape().GetDims();
@@ -238,6 +371,10 @@ Status CheckInputs(const Tensor* query,
     output_parameters->scale = scale;
     output_parameters->qkv_format = qkv_format;
     output_parameters->past_kv_format = past_kv_format;
+    output_parameters->is_paged_kv_cache = is_paged_kv_cache;
+    output_parameters->kv_cache_block_size = kv_cache_block_size;
+    output_parameters->num_kv_cache_blocks = num_kv_cache_blocks;
+    output_parameters->max_blocks_per_sequence = max_blocks_per_sequence;
   }
 
   return Status::OK();
@@ -250,6 +387,7 @@ Status CheckInputs(const Tensor* query,
                    const Tensor* past_value,
                    const Tensor* cos_cache,
                    const Tensor* sin_cache,
+                   const Tensor* block_table,
                    void* parameters,
                    int num_heads,
                    int kv_num_heads,
@@ -261,7 +399,8 @@ Status CheckInputs(const Tensor* query,
     return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT, "num_heads should be no larger than ", max_threads_per_block);
   }
 
-  return CheckInputs(query, key, value, past_key, past_value, cos_cache, sin_cache, parameters, num_heads, kv_num_heads, seqlens_k, total_seqlen, scale);
+  return CheckInputs(query, key, value, past_key, past_value, cos_cache, sin_cache, block_table, parameters, num_heads,
+                     kv_num_heads, seqlens_k, total_seqlen, scale);
 }
 }  // namespace group_query_attention_helper
 }  // namespace contrib
@@ -0,0 +1,271 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "core/framework/op_kernel.h"
+#include "core/mlas/inc/mlas.h"
+#include "core/platform/threadpool.h"
+#include "core/util/math_cpuonly.h"
+
+namespace onnxruntime {
+namespace contrib {
+
+namespace {
+
+enum class ElementwiseOp {
+  Add,
+  Sub,
+  Mul,
+  Div,
+  Sigmoid,
+  Tanh,
+  Exp,
+  Erf,
+  Relu,
+  Neg,
+  Abs,
+  Sqrt,
+};
+
+struct ElementwiseStep {
+  ElementwiseOp op;
+  int64_t first_operand;
+  int64_t second_operand;  // -1 for unary operators
+};
+
+bool ParseElementwiseOp(const std::string& op_type, ElementwiseOp& op, bool& is_binary) {
+  static const std::unordered_map<std::string, std::pair<ElementwiseOp, bool>> ops = {
+      {"Add", {ElementwiseOp::Add, true}},
+      {"Sub", {ElementwiseOp::Sub, true}},
+      {"Mul", {ElementwiseOp::Mul, true}},
+      {"Div", {ElementwiseOp::Div, true}},
+      {"Sigmoid", {ElementwiseOp::Sigmoid, false}},
+      {"Tanh", {ElementwiseOp::Tanh, false}},
+      {"Exp", {ElementwiseOp::Exp, false}},
+      {"Erf", {ElementwiseOp::Erf, false}},
+      {"Relu", {ElementwiseOp::Relu, false}},
+      {"Neg", {ElementwiseOp::Neg, false}},
+      {"Abs", {ElementwiseOp::Abs, false}},
+      {"Sqrt", {ElementwiseOp::Sqrt, false}},
+  };
+
+  auto it = ops.find(op_type);
+  if (it == ops.end()) {
+    return false;
+  }
+  op = it->second.first;
+  is_binary = it->second.second;
+  return true;
+}
+
+void ComputeStep(ElementwiseOp op, const float* a, const float* b, float* y, size_t count) {
+  const auto n = static_cast<Eigen::Index>(count);
+  EigenVectorArrayMap<float> out(y, n);
+  switch (op) {
+    case ElementwiseOp::Add:
+      out = ConstEigenVectorArrayMap<float>(a, n) + ConstEigenVectorArrayMap<float>(b, n);
+      break;
+    case ElementwiseOp::Sub:
+      out = ConstEigenVectorArrayMap<float>(a, n) - ConstEigenVectorArrayMap<float>(b, n);
+      break;
+    case ElementwiseOp::Mul:
+      out = ConstEigenVectorArrayMap<float>(a, n) * ConstEigenVectorArrayMap<float>(b, n);
+      break;
+    case ElementwiseOp::Div:
+      out = ConstEigenVectorArrayMap<float>(a, n) / ConstEigenVectorArrayMap<float>(b, n);
+      break;
+    case ElementwiseOp::Sigmoid:
+      MlasComputeLogistic(a, y, count);
+      break;
+    case ElementwiseOp::Tanh:
+      MlasComputeTanh(a, y, count);
+      break;
+    case ElementwiseOp::Exp:
+      MlasComputeExp(a, y, count);
+      break;
+    case ElementwiseOp::Erf:
+      MlasComputeErf(a, y, count);
+      break;
+    case ElementwiseOp::Relu:
+      out = ConstEigenVectorArrayMap<float>(a, n).cwiseMax(0.0f);
+      break;
+    case ElementwiseOp::Neg:
+      out = -ConstEigenVectorArrayMap<float>(a, n);
+      break;
+    case ElementwiseOp::Abs:
+      out = ConstEigenVectorArrayMap<float>(a, n).abs();
+      break;
+    case ElementwiseOp::Sqrt:
+      out = ConstEigenVectorArrayMap<float>(a, n).sqrt();
+      break;
+  }
+}
+
+// Elements processed per operator before moving on to the next one. The intermediate results of a block stay in the
+// L1/L2 cache, so the inputs are read and the output is written exactly once.
+constexpr size_t kFusedElementwiseBlockSize = 1024;
+
+}  // namespace
+
+class FusedElementwise final : public OpKernel {
+ public:
+  explicit FusedElementwise(const OpKernelInfo& info) : OpKernel(info) {
+    const auto ops = info.GetAttrsOrDefault<std::string>("ops");
+    const auto operands = info.GetAttrsOrDefault<int64_t>("operands");
+    const auto input_count = static_cast<int64_t>(info.GetInputCount());
+    ORT_ENFORCE(!ops.empty(), "FusedElementwise requires at least one operator.");
+    ORT_ENFORCE(operands.size() == ops.size() * 2,
+                "FusedElementwise expects two operands per operator. Got ", operands.size(), " operands for ",
+                ops.size(), " operators.");
+
+    steps_.reserve(ops.size());
+    for (size_t i = 0; i < ops.size(); ++i) {
+      ElementwiseStep step;
+      bool is_binary = false;
+      ORT_ENFORCE(ParseElementwiseOp(ops[i], step.op, is_binary), "FusedElementwise does not support ", ops[i]);
+      step.first_operand = operands[2 * i];
+      step.second_operand = operands[2 * i + 1];
+
+      // an operator may only read the inputs and the results of the operators before it
+      const int64_t operand_limit = input_count + static_cast<int64_t>(i);
+      ORT_ENFORCE(step.first_operand >= 0 && step.first_operand < operand_limit,
+                  "Invalid first operand ", step.first_operand, " for operator ", i, " (", ops[i], ").");
+      if (is_binary) {
+        ORT_ENFORCE(step.second_operand >= 0 && step.second_operand < operand_limit,
+                    "Invalid second operand ", step.second_operand, " for operator ", i, " (", ops[i], ").");
+      } else {
+        ORT_ENFORCE(step.second_operand == -1,
+                    "Unary operator ", i, " (", ops[i], ") must have -1 as its second operand.");
+      }
+      steps_.push_back(step);
+    }
+  }
+
+  Status Compute(OpKernelContext* context) const override;
+
+ private:
+  std::vector<ElementwiseStep> steps_;
+};
+
+Status FusedElementwise::Compute(OpKernelContext* context) const {
+  const int input_count = context->InputCount();
+
+  // Multidirectional broadcast of the input shapes.
+  size_t output_rank = 0;
+  for (int i = 0; i < input_count; ++i) {
+    output_rank = std::max(output_rank, context->Input<Tensor>(i)->Shape().NumDimensions());
+  }
+  TensorShapeVector output_dims(output_rank, 1);
+  for (int i = 0; i < input_count; ++i) {
+    const auto& shape = context->Input<Tensor>(i)->Shape();
+    const size_t offset = output_rank - shape.NumDimensions();
+    for (size_t d = 0; d < shape.NumDimensions(); ++d) {
+      const int64_t dim = shape[d];
+      int64_t& output_dim = output_dims[offset + d];
+      if (dim != 1) {
+        ORT_RETURN_IF_NOT(output_dim == 1 || output_dim == dim,
+                          "FusedElementwise: input ", i, " with shape ", shape, " can not be broadcast.");
+        output_dim = dim;
+      }
+    }
+  }
+  const TensorShape output_shape(output_dims);
+
+  // Each input is either the full output or repeats along the leading dimensions of the output, so element j of the
+  // output reads element j % size of the input.
+  InlinedVector<const float*> input_data(input_count);
+  InlinedVector<size_t> input_sizes(input_count);
+  for (int i = 0; i < input_count; ++i) {
+    const auto* input = context->Input<Tensor>(i);
+    const auto& shape = input->Shape();
+    size_t leading_ones = 0;
+    while (leading_ones < shape.NumDimensions() && shape[leading_ones] == 1) {
+      ++leading_ones;
+    }
+    const size_t trailing_rank = shape.NumDimensions() - leading_ones;
+    for (size_t d = 0; d < trailing_rank; ++d) {
+      ORT_RETURN_IF_NOT(shape[leading_ones + d] == output_shape[output_rank - trailing_rank + d],
+                        "FusedElementwise: input ", i, " with shape ", shape,
+                        " must be broadcast along the leading dimensions of ", output_shape, " only.");
+    }
+    input_data[i] = input->Data<float>();
+    input_sizes[i] = static_cast<size_t>(shape.Size());
+  }
+
+  Tensor* output = context->Output(0, output_shape);
+  const size_t total = static_cast<size_t>(output_shape.Size());
+  if (total == 0) {
+    return Status::OK();
+  }
+  float* output_data = output->MutableData<float>();
+
+  const size_t step_count = steps_.size();
+  const std::ptrdiff_t block_count =
+      static_cast<std::ptrdiff_t>((total + kFusedElementwiseBlockSize - 1) / kFusedElementwiseBlockSize);
+  const TensorOpCost cost{
+      static_cast<double>(input_count * kFusedElementwiseBlockSize * sizeof(float)),
+      static_cast<double>(kFusedElementwiseBlockSize * sizeof(float)),
+      static_cast<double>(step_count * kFusedElementwiseBlockSize) * 4.0};
+
+  concurrency::ThreadPool::TryParallelFor(
+      context->GetOperatorThreadPool(), block_count, cost,
+      [&](std::ptrdiff_t first, std::ptrdiff_t last) {
+        // One block sized row per input that needs to be broadcast and per intermediate result.
+        std::vector<float> scratch((input_count + step_count) * kFusedElementwiseBlockSize);
+        InlinedVector<const float*> operands(input_count + step_count);
+
+        for (std::ptrdiff_t block = first; block < last; ++block) {
+          const size_t start = static_cast<size_t>(block) * kFusedElementwiseBlockSize;
+          const size_t count = std::min(kFusedElementwiseBlockSize, total - start);
+
+          for (int i = 0; i < input_count; ++i) {
+            const size_t size = input_sizes[i];
+            if (size == total) {
+              operands[i] = input_data[i] + start;
+              continue;
+            }
+
+            float* row = scratch.data() + i * kFusedElementwiseBlockSize;
+            if (size == 1) {
+              std::fill_n(row, count, input_data[i][0]);
+            } else {
+              for (size_t filled = 0; filled < count;) {
+                const size_t offset = (start + filled) % size;
+                const size_t chunk = std::min(size - offset, count - filled);
+                std::copy_n(input_data[i] + offset, chunk, row + filled);
+                filled += chunk;
+              }
+            }
+            operands[i] = row;
+          }
+
+          for (size_t s = 0; s < step_count; ++s) {
+            const auto& step = steps_[s];
+            float* result = s + 1 == step_count
+                                ? output_data + start
+                                : scratch.data() + (input_count + s) * kFusedElementwiseBlockSize;
+            ComputeStep(step.op, operands[step.first_operand],
+                        step.second_operand >= 0 ? operands[step.second_operand] : nullptr, result, count);
+            operands[input_count + s] = result;
+          }
+        }
+      });
+
+  return Status::OK();
+}
+
+ONNX_OPERATOR_KERNEL_EX(
+    FusedElementwise,
+    kMSDomain,
+    1,
+    kCpuExecutionProvider,
+    KernelDefBuilder().TypeConstraint("T", DataTypeImpl::GetTensorType<float>()),
+    FusedElementwise);
+
+}  // namespace contrib
+}  // namespace onnxruntime
@@ -92,6 +92,7 @@ struct ISamplingState {
 
   gsl::span<T> sorted_scores;
   gsl::span<T> cumulative_probs;
+  gsl::span<int32_t> sorted_indices;
 };
 
 struct ISequences {
@@ -198,6 +199,18 @@ struct IGenerationParameters {
   int extra_decoding_ids_input_id = -1;
   int cross_qk_output_id = -1;
   int no_speech_probs_output_id = -1;
+
+  // Parameters for continuous batching. 0 means that all sequences are decoded in one batch until all are finished.
+  int max_active_batch_size = 0;
+
+  // Parameters for speculative decoding with a draft decoder.
+  int num_speculative_tokens = 0;
+
+  // Whether sampling on CPU applies temperature and presence penalty itself, in its first pass over the scores,
+  // instead of the logits processors. The timestamp processor of whisper has to see the scaled scores.
+  bool IsScalingFusedIntoSampling() const {
+    return !(model_type == kModelTypeWhisper && logits_processor == kLogitsProcessorTypeWhisper);
+  }
 };
 
 }  // namespace transformers
@@ -51,6 +51,7 @@ struct SamplingState : public ISamplingState<T> {
       // TODO: Some buffer can be reused for CPU
       this->sorted_scores = AllocateBuffer<T>(cpu_allocator, sorted_scores_buffer_, SafeInt<size_t>(total_count), stream);
       this->cumulative_probs = AllocateBuffer<T>(cpu_allocator, cumulative_probs_buffer_, SafeInt<size_t>(total_count), stream);
+      this->sorted_indices = AllocateBuffer<int32_t>(cpu_allocator, sorted_indices_buffer_, SafeInt<size_t>(total_count), stream);
     }
   }
 
@@ -68,6 +69,7 @@ struct SamplingState : public ISamplingState<T> {
   IAllocatorUniquePtr<void> d_presence_mask_buffer_;
   IAllocatorUniquePtr<void> sorted_scores_buffer_;
   IAllocatorUniquePtr<void> cumulative_probs_buffer_;
+  IAllocatorUniquePtr<void> sorted_indices_buffer_;
 };
 
 template <typename T>
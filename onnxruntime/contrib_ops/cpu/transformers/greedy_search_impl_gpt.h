@@ -3,6 +3,7 @@
 
 #pragma once
 #include <algorithm>
+#include <numeric>
 #include <vector>
 
 #include "core/common/span_utils.h"
@@ -79,12 +80,99 @@ class GreedySearchGpt : public GreedySearchBase<T, ParametersT> {
   }
 #endif
 
+  // Use a draft decoder to propose tokens, which are verified by the decoder in one run (speculative decoding).
+  void SetDraftDecoder(const SessionState* draft_decoder_session_state,
+                       GptSubgraph* draft_gpt_subgraph,
+                       const FeedsFetchesManager* draft_feeds_fetches_manager) {
+    draft_decoder_session_state_ = draft_decoder_session_state;
+    draft_gpt_subgraph_ = draft_gpt_subgraph;
+    draft_feeds_fetches_manager_ = draft_feeds_fetches_manager;
+  }
+
   // Execute beam search in iterations util stopping criteria is reached.
   // In each iteration, GPT subgraph is called, and next token for each sequence is generated.
   Status Execute(const FeedsFetchesManager* init_run_feeds_fetches_manager,
                  const FeedsFetchesManager& feeds_fetches_manager);
 
  private:
+  // A sequence that continues in the decoder batch of the next iteration, and where to find its state.
+  struct ContinuingSequence {
+    int batch_id;                           // index of the sequence in input_ids
+    const std::vector<OrtValue>* fetches;   // outputs of the subgraph run that generated its last token
+    const OrtValue* attention_mask;         // attention mask of that run
+    int64_t row;                            // index of the sequence in the batch of that run
+  };
+
+  // Return NOT_IMPLEMENTED for the settings that only the fixed batch decoding of Execute supports.
+  Status CheckDecodingOutsideFixedBatch(const char* mode) const;
+
+  // Select the next word ID of a sequence from the logits at the given row and index, after the logits processors.
+  int32_t SelectNextToken(const Tensor& logits,
+                          int64_t row,
+                          int64_t index,
+                          gsl::span<const int32_t> sequence,
+                          gsl::span<float> next_token_scores);
+
+  // Execute greedy search with at most max_active_batch_size sequences in the decoder batch. Finished sequences
+  // leave the batch, and the sequences waiting in input_ids join it after their prompt is run through the subgraph.
+  Status ExecuteContinuousBatching(const FeedsFetchesManager* init_run_feeds_fetches_manager,
+                                   const FeedsFetchesManager& feeds_fetches_manager);
+
+  // Run the prompts of sequences [first_batch_id, first_batch_id + count) through a subgraph.
+  // prompt_input_ids and prompt_attention_mask hold the data of the feeds, so they shall outlive them.
+  Status RunPrompts(const SessionState& session_state,
+                    GptSubgraph& subgraph,
+                    const FeedsFetchesManager& feeds_fetches_manager,
+                    int first_batch_id,
+                    int count,
+                    gsl::span<int32_t> prompt_lengths,
+                    OrtValue& prompt_input_ids,
+                    OrtValue& prompt_attention_mask,
+                    std::vector<OrtValue>& feeds,
+                    std::vector<OrtValue>& fetches);
+
+  // Execute greedy search with speculative decoding, with all the sequences in one batch. In each iteration the
+  // draft decoder proposes up to num_speculative_tokens tokens, then the decoder runs on all of them at once. The
+  // proposed tokens are kept up to the first one that differs from the token selected by the decoder, which is used
+  // instead. The output is the same as greedy search with the decoder only.
+  Status ExecuteSpeculativeDecoding(const FeedsFetchesManager* init_run_feeds_fetches_manager,
+                                    const FeedsFetchesManager& feeds_fetches_manager);
+
+  // The past state of a decoder in speculative decoding. The proposed tokens that are rejected stay in it but are
+  // masked out, so that the present state of a run is the past state of the next one as is, until more than half of
+  // its tokens are masked out and it is compacted.
+  struct SpeculativeState {
+    std::vector<OrtValue> fetches;                    // outputs of the last run, with the present state
+    std::vector<int32_t> attention_mask;              // (batch_size, num_columns)
+    int64_t num_columns = 0;                          // number of tokens in the past state, including masked ones
+    std::vector<std::vector<int64_t>> token_columns;  // column of each word ID of each sequence in the past state
+  };
+
+  // Run the word IDs of each sequence after the ones in the past state, up to ends[batch_id], through a subgraph.
+  // Sequences with fewer new word IDs are padded on the left with masked out tokens. num_tokens is set to the
+  // number of tokens of each sequence in the run.
+  Status RunSpeculativeStep(const SessionState& session_state,
+                            const GptSubgraph& subgraph,
+                            const FeedsFetchesManager& feeds_fetches_manager,
+                            gsl::span<const int32_t> sequences,
+                            gsl::span<const int> ends,
+                            gsl::span<const int32_t> prompt_lengths,
+                            SpeculativeState& state,
+                            std::vector<OrtValue>& feeds,
+                            int64_t& num_tokens);
+
+  // Move the word IDs of each sequence to the first columns of the past state, dropping the masked out tokens.
+  Status CompactSpeculativeState(const GptSubgraph& subgraph, SpeculativeState& state);
+
+  // Create the feeds of the next decoder run from the state of the sequences, aligning their past state to the right.
+  // When the sequences are all the rows of the same run, in order, its present state is the past state as is, so it
+  // is only copied when the batch changes.
+  Status CreateContinuousBatchFeeds(gsl::span<const ContinuingSequence> sequences,
+                                    gsl::span<const int32_t> next_tokens,
+                                    gsl::span<const int32_t> lengths,
+                                    gsl::span<const int32_t> prompt_lengths,
+                                    std::vector<OrtValue>& feeds);
+
   // Prepare the inputs for first inference of subgraph
   Status CreateInitialFeeds(gsl::span<int32_t>& sequence_lengths,
                             OrtValue& expanded_input_ids,
@@ -105,6 +193,10 @@ class GreedySearchGpt : public GreedySearchBase<T, ParametersT> {
   GptSubgraph* init_run_gpt_subgraph_ = nullptr;
   GptSubgraph& gpt_subgraph_;
 
+  const SessionState* draft_decoder_session_state_ = nullptr;
+  GptSubgraph* draft_gpt_subgraph_ = nullptr;
+  const FeedsFetchesManager* draft_feeds_fetches_manager_ = nullptr;
+
   // Device specific functions
   GenerationDeviceHelper::CreateGptInputsFunc create_inputs_func_;
   GenerationDeviceHelper::AddToFeedsFunc add_to_feeds_func_;
@@ -190,6 +282,14 @@ Status GreedySearchGpt<T, ParametersT>::UpdateFeeds(
 template <typename T, typename ParametersT>
 Status GreedySearchGpt<T, ParametersT>::Execute(const FeedsFetchesManager* init_run_feeds_fetches_manager,
                                                 const FeedsFetchesManager& feeds_fetches_manager) {
+  if (draft_gpt_subgraph_ != nullptr) {
+    return ExecuteSpeculativeDecoding(init_run_feeds_fetches_manager, feeds_fetches_manager);
+  }
+
+  if (this->parameters_->max_active_batch_size > 0) {
+    return ExecuteContinuousBatching(init_run_feeds_fetches_manager, feeds_fetches_manager);
+  }
+
   auto status = Status::OK();
   const ParametersT* parameters = this->parameters_;
 
@@ -410,6 +510,693 @@ Status GreedySearchGpt<T, ParametersT>::Execute(const FeedsFetchesManager* init_
   return status;
 }
 
+template <typename T, typename ParametersT>
+Status GreedySearchGpt<T, ParametersT>::CheckDecodingOutsideFixedBatch(const char* mode) const {
+  if (this->IsCuda() || gpt_subgraph_.past_present_share_buffer_ ||
+      std::is_same<ParametersT, SamplingParameters>::value) {
+    return ORT_MAKE_STATUS(ONNXRUNTIME, NOT_IMPLEMENTED, mode,
+                           " is only supported by GreedySearch on CPU without past_present_share_buffer");
+  }
+  if (!this->parameters_->prefix_vocab_mask.empty() || !this->parameters_->presence_mask.empty()) {
+    return ORT_MAKE_STATUS(ONNXRUNTIME, NOT_IMPLEMENTED, mode, " does not support prefix_vocab_mask or presence_mask");
+  }
+  return Status::OK();
+}
+
+template <typename T, typename ParametersT>
+int32_t GreedySearchGpt<T, ParametersT>::SelectNextToken(const Tensor& logits,
+                                                         int64_t row,
+                                                         int64_t index,
+                                                         gsl::span<const int32_t> sequence,
+                                                         gsl::span<float> next_token_scores) {
+  // Logits has shape (batch_size, input_length, vocab_size).
+  const int64_t input_length = logits.Shape()[1];
+  const int vocab_size = this->parameters_->vocab_size;
+  const T* current_logits = logits.Data<T>() + (row * input_length + index) * vocab_size;
+  for (int i = 0; i < vocab_size; i++) {
+    next_token_scores[i] = static_cast<float>(current_logits[i]);
+  }
+
+  SingleSequence current_sequence(sequence);
+  this->logits_processors_.ProcessSequence(&current_sequence, next_token_scores);
+
+  return static_cast<int32_t>(std::max_element(next_token_scores.begin(), next_token_scores.end()) -
+                              next_token_scores.begin());
+}
+
+template <typename T, typename ParametersT>
+Status GreedySearchGpt<T, ParametersT>::RunPrompts(const SessionState& session_state,
+                                                   GptSubgraph& subgraph,
+                                                   const FeedsFetchesManager& feeds_fetches_manager,
+                                                   int first_batch_id,
+                                                   int count,
+                                                   gsl::span<int32_t> prompt_lengths,
+                                                   OrtValue& prompt_input_ids,
+                                                   OrtValue& prompt_attention_mask,
+                                                   std::vector<OrtValue>& feeds,
+                                                   std::vector<OrtValue>& fetches) {
+  const ParametersT* parameters = this->parameters_;
+  feeds.clear();
+  fetches.clear();
+
+  const size_t offset = SafeInt<size_t>(first_batch_id) * parameters->sequence_length;
+  const size_t size = SafeInt<size_t>(count) * parameters->sequence_length;
+  int64_t dims[] = {count, parameters->sequence_length};
+  TensorShape shape(&dims[0], 2);
+  auto int32_type = DataTypeImpl::GetType<int32_t>();
+
+  const OrtValue* input_ids_value = this->context_.GetInputOrtValue(0);
+  const Tensor& input_ids = input_ids_value->Get<Tensor>();
+  Tensor::InitOrtValue(int32_type, shape, this->cpu_allocator_, prompt_input_ids);
+  gsl::copy(input_ids.DataAsSpan<int32_t>().subspan(offset, size),
+            prompt_input_ids.GetMutable<Tensor>()->MutableDataAsSpan<int32_t>());
+
+  const OrtValue* attn_mask_value = this->context_.GetInputOrtValue(6);
+  if (attn_mask_value != nullptr) {
+    Tensor::InitOrtValue(int32_type, shape, this->cpu_allocator_, prompt_attention_mask);
+    gsl::copy(attn_mask_value->Get<Tensor>().DataAsSpan<int32_t>().subspan(offset, size),
+              prompt_attention_mask.GetMutable<Tensor>()->MutableDataAsSpan<int32_t>());
+  }
+
+  OrtValue expanded_input_ids;
+  IAllocatorUniquePtr<char> buffer;
+  ORT_RETURN_IF_ERROR(subgraph.CreateInitialFeeds(prompt_input_ids.Get<Tensor>(),
+                                                  this->implicit_inputs_,
+                                                  1,
+                                                  parameters->pad_token_id,
+                                                  prompt_lengths,
+                                                  expanded_input_ids,
+                                                  attn_mask_value != nullptr ? &prompt_attention_mask : nullptr,
+                                                  feeds,
+                                                  this->create_inputs_func_,
+                                                  this->add_to_feeds_func_,
+                                                  buffer,
+                                                  this->ort_stream_,
+                                                  parameters->max_length));
+
+  return utils::ExecuteSubgraph(session_state,
+                                feeds_fetches_manager,
+                                feeds,
+                                fetches,
+                                {},
+                                ExecutionMode::ORT_SEQUENTIAL,
+                                this->context_.GetTerminateFlag(),
+                                this->context_.Logger(),
+                                this->ort_stream_);
+}
+
+template <typename T, typename ParametersT>
+Status GreedySearchGpt<T, ParametersT>::CreateContinuousBatchFeeds(gsl::span<const ContinuingSequence> sequences,
+                                                                   gsl::span<const int32_t> next_tokens,
+                                                                   gsl::span<const int32_t> lengths,
+                                                                   gsl::span<const int32_t> prompt_lengths,
+                                                                   std::vector<OrtValue>& feeds) {
+  const ParametersT* parameters = this->parameters_;
+  AllocatorPtr allocator = this->temp_space_allocator_;
+  const int64_t batch_size = static_cast<int64_t>(sequences.size());
+
+  // The past state of a sequence has all its tokens except the last one. The sequences have different lengths, so
+  // their past state is aligned to the right and the columns on the left are masked out.
+  int64_t past_length = 0;
+  for (const auto& sequence : sequences) {
+    past_length = std::max<int64_t>(past_length, lengths[sequence.batch_id] - 1);
+  }
+
+  auto int32_type = DataTypeImpl::GetType<int32_t>();
+  int64_t dims[] = {batch_size, 1};
+  TensorShape shape(&dims[0], 2);
+  OrtValue input_ids;
+  OrtValue position_ids;
+  Tensor::InitOrtValue(int32_type, shape, allocator, input_ids);
+  Tensor::InitOrtValue(int32_type, shape, allocator, position_ids);
+  int32_t* input_ids_data = input_ids.GetMutable<Tensor>()->MutableData<int32_t>();
+  int32_t* position_data = position_ids.GetMutable<Tensor>()->MutableData<int32_t>();
+
+  // Whether the batch is the one of the last run, whose present state has its past state as is.
+  const std::vector<OrtValue>* last_fetches = sequences[0].fetches;
+  const TensorShape& last_present_shape =
+      (*last_fetches)[gpt_subgraph_.GetFirstPresentOutputIndex()].Get<Tensor>().Shape();
+  bool reuse_present = last_present_shape[1] == batch_size && last_present_shape[3] == past_length;
+  for (int64_t i = 0; i < batch_size && reuse_present; i++) {
+    reuse_present = sequences[static_cast<size_t>(i)].fetches == last_fetches &&
+                    sequences[static_cast<size_t>(i)].row == i;
+  }
+
+  const int64_t total_length = past_length + 1;
+  int64_t mask_dims[] = {batch_size, total_length};
+  TensorShape mask_shape(&mask_dims[0], 2);
+  OrtValue attention_mask;
+  Tensor::InitOrtValue(int32_type, mask_shape, allocator, attention_mask);
+  int32_t* mask_data = attention_mask.GetMutable<Tensor>()->MutableData<int32_t>();
+
+  for (int64_t i = 0; i < batch_size; i++) {
+    const ContinuingSequence& sequence = sequences[static_cast<size_t>(i)];
+    const int batch_id = sequence.batch_id;
+    const int64_t valid_length = lengths[batch_id] - 1;
+    input_ids_data[i] = next_tokens[batch_id];
+    position_data[i] = prompt_lengths[batch_id] + lengths[batch_id] - 1 - parameters->sequence_length;
+
+    const Tensor& old_mask = sequence.attention_mask->Get<Tensor>();
+    const int64_t old_length = old_mask.Shape()[1];
+    const int32_t* old_mask_data = old_mask.Data<int32_t>() + sequence.row * old_length + old_length - valid_length;
+    int32_t* mask_row = mask_data + i * total_length;
+    std::fill_n(mask_row, past_length - valid_length, 0);
+    std::copy_n(old_mask_data, valid_length, mask_row + past_length - valid_length);
+    mask_row[past_length] = 1;
+  }
+
+  feeds.clear();
+  feeds.reserve(static_cast<size_t>(gpt_subgraph_.num_subgraph_inputs) + this->implicit_inputs_.size());
+  feeds.push_back(input_ids);
+  feeds.push_back(position_ids);
+  feeds.push_back(attention_mask);
+
+  // Past state shape is like (2, batch_size, num_heads, past_seq_len, head_size).
+  const int64_t num_heads = parameters->num_heads;
+  const int64_t head_size = parameters->head_size;
+  TensorShape past_shape{2, batch_size, num_heads, past_length, head_size};
+  for (int layer = 0; layer < gpt_subgraph_.num_layers; layer++) {
+    if (reuse_present) {
+      feeds.push_back((*last_fetches)[gpt_subgraph_.GetFirstPresentOutputIndex() + layer]);
+      continue;
+    }
+
+    OrtValue past;
+    Tensor::InitOrtValue(DataTypeImpl::GetType<T>(), past_shape, allocator, past);
+    T* past_data = past.GetMutable<Tensor>()->MutableData<T>();
+
+    for (int64_t i = 0; i < batch_size; i++) {
+      const ContinuingSequence& sequence = sequences[static_cast<size_t>(i)];
+      const Tensor& present = (*sequence.fetches)[gpt_subgraph_.GetFirstPresentOutputIndex() + layer].Get<Tensor>();
+      const int64_t present_batch_size = present.Shape()[1];
+      const int64_t present_length = present.Shape()[3];
+      const int64_t valid_length = lengths[sequence.batch_id] - 1;
+      const int64_t padding = past_length - valid_length;
+      const T* present_data = present.Data<T>();
+
+      for (int64_t kv = 0; kv < 2; kv++) {
+        for (int64_t head = 0; head < num_heads; head++) {
+          const T* source = present_data +
+                            (((kv * present_batch_size + sequence.row) * num_heads + head) * present_length +
+                             present_length - valid_length) *
+                                head_size;
+          T* target = past_data + ((kv * batch_size + i) * num_heads + head) * past_length * head_size;
+          std::fill_n(target, padding * head_size, T{});
+          std::copy_n(source, valid_length * head_size, target + padding * head_size);
+        }
+      }
+    }
+
+    feeds.push_back(past);
+  }
+
+  for (const auto* entry : this->implicit_inputs_) {
+    feeds.push_back(*entry);
+  }
+
+  return Status::OK();
+}
+
+template <typename T, typename ParametersT>
+Status GreedySearchGpt<T, ParametersT>::ExecuteContinuousBatching(
+    const FeedsFetchesManager* init_run_feeds_fetches_manager,
+    const FeedsFetchesManager& feeds_fetches_manager) {
+  const ParametersT* parameters = this->parameters_;
+  ORT_RETURN_IF_ERROR(CheckDecodingOutsideFixedBatch("max_active_batch_size"));
+
+  const int batch_size = parameters->batch_size;
+  const int sequence_length = parameters->sequence_length;
+  const int max_length = parameters->max_length;
+  const int vocab_size = parameters->vocab_size;
+  const int max_active_batch_size = std::min(parameters->max_active_batch_size, batch_size);
+
+  int64_t sequences_dims[] = {batch_size, max_length};
+  TensorShape sequences_shape(&sequences_dims[0], sizeof(sequences_dims) / sizeof(sequences_dims[0]));
+  Tensor* output_sequences = this->context_.Output(0, sequences_shape);
+  gsl::span<int32_t> sequences = output_sequences->MutableDataAsSpan<int32_t>();
+
+  const OrtValue* input_ids_value = this->context_.GetInputOrtValue(0);
+  gsl::span<const int32_t> input_ids = input_ids_value->Get<Tensor>().DataAsSpan<int32_t>();
+  for (int batch_id = 0; batch_id < batch_size; batch_id++) {
+    gsl::copy(input_ids.subspan(SafeInt<size_t>(batch_id) * sequence_length, sequence_length),
+              sequences.subspan(SafeInt<size_t>(batch_id) * max_length, sequence_length));
+  }
+
+  // Number of word IDs of each sequence, number of non-padding word IDs in its prompt, and its last word ID.
+  std::vector<int32_t> lengths(batch_size, sequence_length);
+  std::vector<int32_t> prompt_lengths(batch_size, 0);
+  std::vector<int32_t> next_tokens(batch_size, parameters->pad_token_id);
+  std::vector<float> next_token_scores(vocab_size);
+
+  // Append the next token of a sequence from the logits of a subgraph run. Returns false if the sequence is finished.
+  auto append_next_token = [&](const Tensor& logits, int64_t row, int batch_id) {
+    gsl::span<int32_t> sequence = sequences.subspan(SafeInt<size_t>(batch_id) * max_length, max_length);
+    int32_t next_token = SelectNextToken(logits, row, logits.Shape()[1] - 1, sequence.first(lengths[batch_id]),
+                                         next_token_scores);
+    const bool eos_meet = next_token == parameters->eos_token_id;
+    if (eos_meet) {
+      next_token = parameters->pad_token_id;
+    }
+
+    sequence[lengths[batch_id]++] = next_token;
+    next_tokens[batch_id] = next_token;
+    if (eos_meet || lengths[batch_id] == max_length) {
+      std::fill(sequence.begin() + lengths[batch_id], sequence.end(), parameters->pad_token_id);
+      return false;
+    }
+    return true;
+  };
+
+  // The prompts are run through the init decoder if there is one.
+  const bool use_init_run = init_run_gpt_subgraph_ != nullptr;
+
+  std::vector<int> active_batch_ids;
+  std::vector<ContinuingSequence> continuing_sequences;
+  std::vector<OrtValue> feeds;
+  std::vector<OrtValue> fetches;
+  std::vector<OrtValue> prompt_feeds;
+  std::vector<OrtValue> prompt_fetches;
+  OrtValue prompt_input_ids;
+  OrtValue prompt_attention_mask;
+  int next_batch_id = 0;
+  while (true) {
+    continuing_sequences.clear();
+
+    if (!active_batch_ids.empty()) {
+#ifdef DEBUG_NODE_INPUTS_OUTPUTS
+      const_cast<SessionState&>(this->decoder_session_state_).IncrementGraphExecutionCounter();
+#endif
+      fetches.clear();
+      ORT_RETURN_IF_ERROR(utils::ExecuteSubgraph(this->decoder_session_state_,
+                                                 feeds_fetches_manager,
+                                                 feeds,
+                                                 fetches,
+                                                 {},
+                                                 ExecutionMode::ORT_SEQUENTIAL,
+                                                 this->context_.GetTerminateFlag(),
+                                                 this->context_.Logger(),
+                                                 this->ort_stream_));
+
+      const Tensor& logits = fetches[0].Get<Tensor>();
+      for (size_t row = 0; row < active_batch_ids.size(); row++) {
+        if (append_next_token(logits, static_cast<int64_t>(row), active_batch_ids[row])) {
+          continuing_sequences.push_back({active_batch_ids[row], &fetches, &feeds[2], static_cast<int64_t>(row)});
+        }
+      }
+    }
+
+    // Waiting sequences take the places of the finished ones.
+    const int num_joining = std::min(max_active_batch_size - static_cast<int>(continuing_sequences.size()),
+                                     batch_size - next_batch_id);
+    if (num_joining > 0) {
+      ORT_RETURN_IF_ERROR(RunPrompts(use_init_run ? *init_run_decoder_session_state_ : this->decoder_session_state_,
+                                     use_init_run ? *init_run_gpt_subgraph_ : gpt_subgraph_,
+                                     use_init_run ? *init_run_feeds_fetches_manager : feeds_fetches_manager,
+                                     next_batch_id,
+                                     num_joining,
+                                     gsl::make_span(prompt_lengths).subspan(next_batch_id, num_joining),
+                                     prompt_input_ids,
+                                     prompt_attention_mask,
+                                     prompt_feeds,
+                                     prompt_fetches));
+
+      const Tensor& logits = prompt_fetches[0].Get<Tensor>();
+      for (int row = 0; row < num_joining; row++) {
+        if (append_next_token(logits, row, next_batch_id + row)) {
+          continuing_sequences.push_back({next_batch_id + row, &prompt_fetches, &prompt_feeds[2], row});
+        }
+      }
+      next_batch_id += num_joining;
+    }
+
+    if (continuing_sequences.empty()) {
+      if (next_batch_id == batch_size) {
+        break;
+      }
+      active_batch_ids.clear();
+      continue;
+    }
+
+    std::vector<OrtValue> next_feeds;
+    ORT_RETURN_IF_ERROR(CreateContinuousBatchFeeds(continuing_sequences, next_tokens, lengths, prompt_lengths,
+                                                   next_feeds));
+    feeds = std::move(next_feeds);
+
+    active_batch_ids.clear();
+    for (const auto& sequence : continuing_sequences) {
+      active_batch_ids.push_back(sequence.batch_id);
+    }
+  }
+
+  return Status::OK();
+}
+
+template <typename T, typename ParametersT>
+Status GreedySearchGpt<T, ParametersT>::RunSpeculativeStep(const SessionState& session_state,
+                                                           const GptSubgraph& subgraph,
+                                                           const FeedsFetchesManager& feeds_fetches_manager,
+                                                           gsl::span<const int32_t> sequences,
+                                                           gsl::span<const int> ends,
+                                                           gsl::span<const int32_t> prompt_lengths,
+                                                           SpeculativeState& state,
+                                                           std::vector<OrtValue>& feeds,
+                                                           int64_t& num_tokens) {
+  const ParametersT* parameters = this->parameters_;
+  const int64_t batch_size = parameters->batch_size;
+  const int sequence_length = parameters->sequence_length;
+  const int max_length = parameters->max_length;
+
+  int64_t max_past_length = 0;
+  num_tokens = 1;
+  for (int64_t batch_id = 0; batch_id < batch_size; batch_id++) {
+    const int64_t past_length = static_cast<int64_t>(state.token_columns[batch_id].size());
+    max_past_length = std::max(max_past_length, past_length);
+    num_tokens = std::max<int64_t>(num_tokens, ends[batch_id] - past_length);
+  }
+  if (state.num_columns - max_past_length > max_past_length) {
+    ORT_RETURN_IF_ERROR(CompactSpeculativeState(subgraph, state));
+  }
+
+  AllocatorPtr allocator = this->temp_space_allocator_;
+  auto int32_type = DataTypeImpl::GetType<int32_t>();
+  int64_t dims[] = {batch_size, num_tokens};
+  TensorShape shape(&dims[0], 2);
+  OrtValue input_ids;
+  OrtValue position_ids;
+  Tensor::InitOrtValue(int32_type, shape, allocator, input_ids);
+  Tensor::InitOrtValue(int32_type, shape, allocator, position_ids);
+  int32_t* input_ids_data = input_ids.GetMutable<Tensor>()->MutableData<int32_t>();
+  int32_t* position_data = position_ids.GetMutable<Tensor>()->MutableData<int32_t>();
+
+  const int64_t past_columns = state.num_columns;
+  const int64_t total_length = past_columns + num_tokens;
+  int64_t mask_dims[] = {batch_size, total_length};
+  TensorShape mask_shape(&mask_dims[0], 2);
+  OrtValue attention_mask;
+  Tensor::InitOrtValue(int32_type, mask_shape, allocator, attention_mask);
+  int32_t* mask_data = attention_mask.GetMutable<Tensor>()->MutableData<int32_t>();
+
+  for (int64_t batch_id = 0; batch_id < batch_size; batch_id++) {
+    std::vector<int64_t>& token_columns = state.token_columns[batch_id];
+    const int64_t past_length = static_cast<int64_t>(token_columns.size());
+    const int64_t padding = num_tokens - (ends[batch_id] - past_length);
+    int32_t* mask_row = mask_data + batch_id * total_length;
+    std::copy_n(state.attention_mask.data() + batch_id * past_columns, past_columns, mask_row);
+
+    for (int64_t i = 0; i < num_tokens; i++) {
+      const int64_t token = batch_id * num_tokens + i;
+      if (i < padding) {
+        input_ids_data[token] = parameters->pad_token_id;
+        position_data[token] = 0;
+        mask_row[past_columns + i] = 0;
+        continue;
+      }
+
+      // Only generated tokens are run on top of a past state, so the position follows the prompt.
+      const int64_t index = past_length + i - padding;
+      input_ids_data[token] = sequences[batch_id * max_length + index];
+      position_data[token] = static_cast<int32_t>(prompt_lengths[batch_id] + index - sequence_length);
+      mask_row[past_columns + i] = 1;
+      token_columns.push_back(past_columns + i);
+    }
+  }
+  state.attention_mask.assign(mask_data, mask_data + batch_size * total_length);
+  state.num_columns = total_length;
+
+  feeds.clear();
+  feeds.reserve(static_cast<size_t>(subgraph.num_subgraph_inputs) + this->implicit_inputs_.size());
+  feeds.push_back(input_ids);
+  feeds.push_back(position_ids);
+  feeds.push_back(attention_mask);
+  for (int layer = 0; layer < subgraph.num_layers; layer++) {
+    feeds.push_back(state.fetches[subgraph.GetFirstPresentOutputIndex() + layer]);
+  }
+  for (const auto* entry : this->implicit_inputs_) {
+    feeds.push_back(*entry);
+  }
+
+  state.fetches.clear();
+  return utils::ExecuteSubgraph(session_state,
+                                feeds_fetches_manager,
+                                feeds,
+                                state.fetches,
+                                {},
+                                ExecutionMode::ORT_SEQUENTIAL,
+                                this->context_.GetTerminateFlag(),
+                                this->context_.Logger(),
+                                this->ort_stream_);
+}
+
+template <typename T, typename ParametersT>
+Status GreedySearchGpt<T, ParametersT>::CompactSpeculativeState(const GptSubgraph& subgraph,
+                                                                SpeculativeState& state) {
+  AllocatorPtr allocator = this->temp_space_allocator_;
+  const int64_t batch_size = static_cast<int64_t>(state.token_columns.size());
+  int64_t num_columns = 0;
+  for (const auto& token_columns : state.token_columns) {
+    num_columns = std::max(num_columns, static_cast<int64_t>(token_columns.size()));
+  }
+
+  // Present state shape is like (2, batch_size, num_heads, num_columns, head_size).
+  for (int layer = 0; layer < subgraph.num_layers; layer++) {
+    OrtValue& present_value = state.fetches[subgraph.GetFirstPresentOutputIndex() + layer];
+    const Tensor& present = present_value.Get<Tensor>();
+    const TensorShape& present_shape = present.Shape();
+    ORT_RETURN_IF(present_shape[3] != state.num_columns, "Present state has ", present_shape[3],
+                  " tokens, expected ", state.num_columns);
+
+    const int64_t num_heads = present_shape[2];
+    OrtValue past;
+    Tensor::InitOrtValue(present.DataType(), TensorShape{2, batch_size, num_heads, num_columns, present_shape[4]},
+                         allocator, past);
+
+    const size_t token_size = SafeInt<size_t>(present_shape[4]) * present.DataType()->Size();
+    const auto* source = static_cast<const uint8_t*>(present.DataRaw());
+    auto* target = static_cast<uint8_t*>(past.GetMutable<Tensor>()->MutableDataRaw());
+    for (int64_t kv = 0; kv < 2; kv++) {
+      for (int64_t batch_id = 0; batch_id < batch_size; batch_id++) {
+        const auto& token_columns = state.token_columns[batch_id];
+        for (int64_t head = 0; head < num_heads; head++) {
+          const int64_t block = (kv * batch_size + batch_id) * num_heads + head;
+          const uint8_t* source_block = source + block * state.num_columns * token_size;
+          uint8_t* target_block = target + block * num_columns * token_size;
+          for (size_t i = 0; i < token_columns.size(); i++) {
+            memcpy(target_block + i * token_size, source_block + token_columns[i] * token_size, token_size);
+          }
+          // The columns after the tokens are masked out, but must not hold NaN.
+          memset(target_block + token_columns.size() * token_size, 0,
+                 (static_cast<size_t>(num_columns) - token_columns.size()) * token_size);
+        }
+      }
+    }
+
+    present_value = past;
+  }
+
+  std::vector<int32_t> attention_mask(SafeInt<size_t>(batch_size) * num_columns, 0);
+  for (int64_t batch_id = 0; batch_id < batch_size; batch_id++) {
+    auto& token_columns = state.token_columns[batch_id];
+    for (size_t i = 0; i < token_columns.size(); i++) {
+      attention_mask[batch_id * num_columns + i] = state.attention_mask[batch_id * state.num_columns +
+                                                                        token_columns[i]];
+      token_columns[i] = static_cast<int64_t>(i);
+    }
+  }
+  state.attention_mask = std::move(attention_mask);
+  state.num_columns = num_columns;
+  return Status::OK();
+}
+
+template <typename T, typename ParametersT>
+Status GreedySearchGpt<T, ParametersT>::ExecuteSpeculativeDecoding(
+    const FeedsFetchesManager* init_run_feeds_fetches_manager,
+    const FeedsFetchesManager& feeds_fetches_manager) {
+  const ParametersT* parameters = this->parameters_;
+  ORT_RETURN_IF_ERROR(CheckDecodingOutsideFixedBatch("draft_decoder"));
+  if (draft_gpt_subgraph_->past_present_share_buffer_ || parameters->max_active_batch_size > 0) {
+    return ORT_MAKE_STATUS(ONNXRUNTIME, NOT_IMPLEMENTED,
+                           "draft_decoder is not supported with past_present_share_buffer or max_active_batch_size");
+  }
+  ORT_RETURN_IF(draft_gpt_subgraph_->vocab_size != parameters->vocab_size ||
+                    draft_gpt_subgraph_->IsOutputFloat16() != gpt_subgraph_.IsOutputFloat16(),
+                "The draft decoder shall have the vocabulary size and logits type of the decoder");
+
+  const int batch_size = parameters->batch_size;
+  const int sequence_length = parameters->sequence_length;
+  const int max_length = parameters->max_length;
+  const int num_speculative_tokens = parameters->num_speculative_tokens;
+
+  int64_t sequences_dims[] = {batch_size, max_length};
+  TensorShape sequences_shape(&sequences_dims[0], sizeof(sequences_dims) / sizeof(sequences_dims[0]));
+  Tensor* output_sequences = this->context_.Output(0, sequences_shape);
+  gsl::span<int32_t> sequences = output_sequences->MutableDataAsSpan<int32_t>();
+
+  const OrtValue* input_ids_value = this->context_.GetInputOrtValue(0);
+  gsl::span<const int32_t> input_ids = input_ids_value->Get<Tensor>().DataAsSpan<int32_t>();
+  for (int batch_id = 0; batch_id < batch_size; batch_id++) {
+    gsl::copy(input_ids.subspan(SafeInt<size_t>(batch_id) * sequence_length, sequence_length),
+              sequences.subspan(SafeInt<size_t>(batch_id) * max_length, sequence_length));
+  }
+
+  // Number of word IDs of each sequence, and whether it is unfinished.
+  std::vector<int> lengths(batch_size, sequence_length);
+  std::vector<bool> running(batch_size, true);
+  std::vector<float> next_token_scores(parameters->vocab_size);
+
+  auto sequence_of = [&](int batch_id) {
+    return sequences.subspan(SafeInt<size_t>(batch_id) * max_length, max_length);
+  };
+
+  // Append a token selected by the decoder. Returns false if the sequence is finished.
+  auto append_token = [&](int batch_id, int32_t token) {
+    gsl::span<int32_t> sequence = sequence_of(batch_id);
+    int& length = lengths[batch_id];
+    const bool eos_meet = token == parameters->eos_token_id;
+    sequence[length++] = eos_meet ? parameters->pad_token_id : token;
+    if (eos_meet || length == max_length) {
+      std::fill(sequence.begin() + length, sequence.end(), parameters->pad_token_id);
+      return false;
+    }
+    return true;
+  };
+
+  // The past state of the prompts has all their tokens, including padding.
+  auto init_state = [&](const OrtValue& prompt_attention_mask, SpeculativeState& state) {
+    gsl::span<const int32_t> mask = prompt_attention_mask.Get<Tensor>().DataAsSpan<int32_t>();
+    state.attention_mask.assign(mask.begin(), mask.end());
+    state.num_columns = sequence_length;
+    state.token_columns.assign(batch_size, std::vector<int64_t>(sequence_length));
+    for (auto& token_columns : state.token_columns) {
+      std::iota(token_columns.begin(), token_columns.end(), int64_t{0});
+    }
+  };
+
+  // Mask out the word IDs of a sequence from the given length on.
+  auto roll_back = [](SpeculativeState& state, int batch_id, int length) {
+    auto& token_columns = state.token_columns[batch_id];
+    for (size_t i = static_cast<size_t>(length); i < token_columns.size(); i++) {
+      state.attention_mask[batch_id * state.num_columns + token_columns[i]] = 0;
+    }
+    if (token_columns.size() > static_cast<size_t>(length)) {
+      token_columns.resize(static_cast<size_t>(length));
+    }
+  };
+
+  const bool use_init_run = init_run_gpt_subgraph_ != nullptr;
+  std::vector<int32_t> prompt_lengths(batch_size, 0);
+  std::vector<int32_t> draft_prompt_lengths(batch_size, 0);
+  SpeculativeState state;
+  SpeculativeState draft_state;
+  std::vector<OrtValue> feeds;
+  std::vector<OrtValue> draft_feeds;
+  OrtValue prompt_input_ids;
+  OrtValue prompt_mask;
+  OrtValue draft_prompt_input_ids;
+  OrtValue draft_prompt_mask;
+
+  ORT_RETURN_IF_ERROR(RunPrompts(use_init_run ? *init_run_decoder_session_state_ : this->decoder_session_state_,
+                                 use_init_run ? *init_run_gpt_subgraph_ : gpt_subgraph_,
+                                 use_init_run ? *init_run_feeds_fetches_manager : feeds_fetches_manager,
+                                 0,
+                                 batch_size,
+                                 prompt_lengths,
+                                 prompt_input_ids,
+                                 prompt_mask,
+                                 feeds,
+                                 state.fetches));
+  init_state(feeds[2], state);
+
+  int num_running = 0;
+  for (int batch_id = 0; batch_id < batch_size; batch_id++) {
+    const int32_t token = SelectNextToken(state.fetches[0].Get<Tensor>(), batch_id, sequence_length - 1,
+                                          sequence_of(batch_id).first(lengths[batch_id]), next_token_scores);
+    running[batch_id] = append_token(batch_id, token);
+    num_running += running[batch_id] ? 1 : 0;
+  }
+  if (num_running == 0) {
+    return Status::OK();
+  }
+
+  ORT_RETURN_IF_ERROR(RunPrompts(*draft_decoder_session_state_,
+                                 *draft_gpt_subgraph_,
+                                 *draft_feeds_fetches_manager_,
+                                 0,
+                                 batch_size,
+                                 draft_prompt_lengths,
+                                 draft_prompt_input_ids,
+                                 draft_prompt_mask,
+                                 draft_feeds,
+                                 draft_state.fetches));
+  init_state(draft_feeds[2], draft_state);
+
+  // Last word ID of each sequence to run through a decoder. Finished sequences have no new word IDs.
+  std::vector<int> ends(batch_size);
+  int64_t num_tokens = 0;
+  while (num_running > 0) {
+    int max_running_length = 0;
+    for (int batch_id = 0; batch_id < batch_size; batch_id++) {
+      if (running[batch_id]) {
+        max_running_length = std::max(max_running_length, lengths[batch_id]);
+      }
+    }
+
+    // The decoder selects one token more than the number of proposed tokens.
+    const int num_draft_tokens = std::min(num_speculative_tokens, max_length - max_running_length - 1);
+    for (int i = 0; i < num_draft_tokens; i++) {
+      // The draft decoder first catches up with the tokens selected by the decoder.
+      for (int batch_id = 0; batch_id < batch_size; batch_id++) {
+        ends[batch_id] = running[batch_id] ? lengths[batch_id] + i
+                                           : static_cast<int>(draft_state.token_columns[batch_id].size());
+      }
+      ORT_RETURN_IF_ERROR(RunSpeculativeStep(*draft_decoder_session_state_, *draft_gpt_subgraph_,
+                                             *draft_feeds_fetches_manager_, sequences, ends, prompt_lengths,
+                                             draft_state, draft_feeds, num_tokens));
+
+      // Proposed tokens are written after the end of the sequence, so that the logits processors can see them.
+      // They are overwritten by the tokens selected by the decoder.
+      for (int batch_id = 0; batch_id < batch_size; batch_id++) {
+        if (running[batch_id]) {
+          gsl::span<int32_t> sequence = sequence_of(batch_id);
+          sequence[lengths[batch_id] + i] = SelectNextToken(draft_state.fetches[0].Get<Tensor>(), batch_id,
+                                                            num_tokens - 1, sequence.first(lengths[batch_id] + i),
+                                                            next_token_scores);
+        }
+      }
+    }
+
+    // The decoder runs the last selected token and the proposed ones.
+    for (int batch_id = 0; batch_id < batch_size; batch_id++) {
+      ends[batch_id] = running[batch_id] ? lengths[batch_id] + num_draft_tokens
+                                         : static_cast<int>(state.token_columns[batch_id].size());
+    }
+    ORT_RETURN_IF_ERROR(RunSpeculativeStep(this->decoder_session_state_, gpt_subgraph_, feeds_fetches_manager,
+                                           sequences, ends, prompt_lengths, state, feeds, num_tokens));
+
+    for (int batch_id = 0; batch_id < batch_size; batch_id++) {
+      if (!running[batch_id]) {
+        continue;
+      }
+      gsl::span<int32_t> sequence = sequence_of(batch_id);
+      for (int i = 0; i <= num_draft_tokens; i++) {
+        const int32_t token = SelectNextToken(state.fetches[0].Get<Tensor>(), batch_id, i,
+                                              sequence.first(lengths[batch_id]), next_token_scores);
+        const bool accepted = i < num_draft_tokens && token == sequence[lengths[batch_id]];
+        running[batch_id] = append_token(batch_id, token);
+        if (!running[batch_id] || !accepted) {
+          break;
+        }
+      }
+      num_running -= running[batch_id] ? 0 : 1;
+
+      // Mask out the past state of the tokens that were not accepted. The last selected token is run next time.
+      roll_back(state, batch_id, lengths[batch_id] - 1);
+      roll_back(draft_state, batch_id, lengths[batch_id] - 1);
+    }
+  }
+
+  return Status::OK();
+}
+
 }  // namespace transformers
 }  // namespace contrib
 }  // namespace onnxruntime
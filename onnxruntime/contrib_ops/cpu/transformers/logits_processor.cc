@@ -96,95 +96,74 @@ void NoRepeatNGramLogitsProcessor<T>::Process(const ISequences* sequences,
 }
 
 template <typename T>
-VocabMaskLogitsProcessor<T>::VocabMaskLogitsProcessor(const gsl::span<const int32_t>& vocab_mask)
-    : vocab_mask_(vocab_mask) {
+FusedLogitsProcessor<T>::FusedLogitsProcessor(const gsl::span<const int32_t>& vocab_mask,
+                                              const gsl::span<const int32_t>& prefix_vocab_mask,
+                                              int batch_size,
+                                              float temperature,
+                                              const gsl::span<const int32_t>& presence_mask,
+                                              float presence_penalty)
+    : vocab_mask_(vocab_mask),
+      prefix_vocab_mask_(prefix_vocab_mask),
+      batch_size_(batch_size),
+      temperature_(temperature),
+      presence_mask_(presence_mask),
+      presence_penalty_(presence_penalty) {
 }
 
 template <typename T>
-void VocabMaskLogitsProcessor<T>::Process(const ISequences* /*sequences*/,
-                                          NextTokenScores<T>& next_token_scores) {
-  assert(!vocab_mask_.empty());
-
-  // Process vocabulary mask and set tokens with mask value 0 to -inf.
-  T* p = next_token_scores.scores.data();
-  // next_token_scores shape (batch_size * num_beams, vocab_size)
-  // vocab_mask shape (vocab_size).
-  for (int i = 0; i < next_token_scores.batch_beam_size; i++) {
-    for (int j = 0; j < next_token_scores.vocab_size; j++, p++) {
-      if (vocab_mask_[j] == 0) {
-        *p = std::numeric_limits<T>::lowest();
-      }
-    }
-  }
-}
-
-template <typename T>
-PrefixVocabMaskLogitsProcessor<T>::PrefixVocabMaskLogitsProcessor(const gsl::span<const int32_t>& prefix_vocab_mask,
-                                                                  int batch_size)
-    : prefix_vocab_mask_(prefix_vocab_mask),
-      batch_size_(batch_size) {
+bool FusedLogitsProcessor<T>::IsEmpty() const {
+  return vocab_mask_.empty() && prefix_vocab_mask_.empty() && temperature_ == 1.0f && presence_mask_.empty();
 }
 
 template <typename T>
-void PrefixVocabMaskLogitsProcessor<T>::Process(const ISequences* /*sequences*/,
-                                                NextTokenScores<T>& next_token_scores) {
-  assert(!prefix_vocab_mask_.empty());
-
-  // next_token_scores shape (batch_size * num_beams, vocab_size)
-  int num_beams = next_token_scores.batch_beam_size / batch_size_;
-  assert(num_beams * batch_size_ == next_token_scores.batch_beam_size);
-
-  // Process prefix vocabulary mask and set tokens with mask value 0 to -inf.
-  // prefix_vocab_mask shape (batch_size, vocab_size).
-  T* p = next_token_scores.scores.data();
-  for (int i = 0; i < batch_size_; i++) {
-    size_t prefix_vocab_mask_offset = SafeInt<size_t>(i) * next_token_scores.vocab_size;
-    for (int j = 0; j < num_beams; j++) {
-      for (int k = 0; k < next_token_scores.vocab_size; k++, p++) {
-        if (prefix_vocab_mask_[prefix_vocab_mask_offset + static_cast<size_t>(k)] == 0) {
-          *p = std::numeric_limits<T>::lowest();
-        }
-      }
-    }
-  }
-}
+void FusedLogitsProcessor<T>::Process(NextTokenScores<T>& next_token_scores, bool apply_prefix_vocab_mask) {
+  // 4096 scores with the masks take 48KB, which is about the size of the L1 data cache.
+  constexpr int kBlockSize = 4096;
 
-template <typename T>
-TemperatureLogitsProcessor<T>::TemperatureLogitsProcessor(float temperature) : temperature_(temperature) {
-}
-
-template <typename T>
-void TemperatureLogitsProcessor<T>::Process(const ISequences* /*sequences*/,
-                                            NextTokenScores<T>& next_token_scores) {
-  if (temperature_ == 1.0f) {
-    return;
-  }
-
-  T* p = next_token_scores.scores.data();
-  for (size_t i = 0; i < next_token_scores.scores.size(); i++) {
-    *p /= temperature_;
-    ++p;
-  }
-}
+  const int batch_beam_size = next_token_scores.batch_beam_size;
+  const int vocab_size = next_token_scores.vocab_size;
+  const int num_beams = batch_beam_size / batch_size_;
+  apply_prefix_vocab_mask = apply_prefix_vocab_mask && !prefix_vocab_mask_.empty();
+  assert(!apply_prefix_vocab_mask || num_beams * batch_size_ == batch_beam_size);
+  assert(presence_mask_.empty() || presence_mask_.size() == static_cast<size_t>(batch_beam_size) * vocab_size);
 
-template <typename T>
-PresencePenaltyLogitsProcessor<T>::PresencePenaltyLogitsProcessor(const gsl::span<const int32_t>& presence_mask,
-                                                                  float presence_penalty)
-    : presence_mask_(presence_mask), presence_penalty_(presence_penalty) {
-}
+  const T lowest = std::numeric_limits<T>::lowest();
+  const float temperature = temperature_;
+  const float presence_penalty = presence_penalty_;
 
-template <typename T>
-void PresencePenaltyLogitsProcessor<T>::Process(const ISequences*,
-                                                NextTokenScores<T>& next_token_scores) {
-  if (presence_penalty_ == 0.0f) {
-    return;
-  }
-
-  assert(!presence_mask_.empty());
+  for (int i = 0; i < batch_beam_size; i++) {
+    T* scores = next_token_scores.GetScores(i).data();
+    const int32_t* vocab_mask = vocab_mask_.empty() ? nullptr : vocab_mask_.data();
+    const int32_t* prefix_vocab_mask =
+        apply_prefix_vocab_mask ? prefix_vocab_mask_.data() + SafeInt<size_t>(i / num_beams) * vocab_size : nullptr;
+    const int32_t* presence_mask =
+        presence_mask_.empty() ? nullptr : presence_mask_.data() + SafeInt<size_t>(i) * vocab_size;
+
+    for (int begin = 0; begin < vocab_size; begin += kBlockSize) {
+      const int end = std::min(begin + kBlockSize, vocab_size);
+
+      // Set tokens with mask value 0 to the lowest value.
+      if (vocab_mask != nullptr) {
+        for (int j = begin; j < end; j++) {
+          scores[j] = vocab_mask[j] == 0 ? lowest : scores[j];
+        }
+      }
+      if (prefix_vocab_mask != nullptr) {
+        for (int j = begin; j < end; j++) {
+          scores[j] = prefix_vocab_mask[j] == 0 ? lowest : scores[j];
+        }
+      }
 
-  T* p = next_token_scores.scores.data();
-  for (size_t i = 0; i < next_token_scores.scores.size(); i++) {
-    *p -= presence_mask_[i] * presence_penalty_;
+      if (presence_mask != nullptr) {
+        for (int j = begin; j < end; j++) {
+          scores[j] = scores[j] / temperature - presence_mask[j] * presence_penalty;
+        }
+      } else if (temperature != 1.0f) {
+        for (int j = begin; j < end; j++) {
+          scores[j] /= temperature;
+        }
+      }
+    }
   }
 }
 
@@ -197,7 +176,8 @@ void LogitsProcessorList::Init(const GreedySearchParameters& parameters) {
 }
 
 void LogitsProcessorList::Init(const SamplingParameters& parameters) {
-  LogitsProcessorInitImpl<SamplingParameters>(parameters);
+  // Temperature and presence penalty are applied by SamplingCpuHelper::Sample when possible.
+  LogitsProcessorInitImpl<SamplingParameters>(parameters, !parameters.IsScalingFusedIntoSampling());
 }
 
 void LogitsProcessorList::Process(const ISequences* sequences,
@@ -205,12 +185,36 @@ void LogitsProcessorList::Process(const ISequences* sequences,
                                   int step) {
   NextTokenScores<float> input_scores = {next_token_scores, batch_beam_size_, vocab_size_};
   for (size_t i = 0; i < processor_list_.size(); i++) {
-    // Prefix vocab mask is applied to first iteration only.
-    if (step > 1 && processor_list_[i] == prefix_vocab_mask_processor_.get()) {
-      continue;
-    }
     processor_list_[i]->Process(sequences, input_scores);
   }
+
+  if (fused_processor_) {
+    // Prefix vocab mask is applied to first iteration only.
+    fused_processor_->Process(input_scores, step <= 1);
+  }
+
+  if (timestamp_processor_) {
+    timestamp_processor_->Process(sequences, input_scores);
+  }
+}
+
+void LogitsProcessorList::ProcessSequence(const ISequences* sequence,
+                                          gsl::span<float>& next_token_scores) {
+  assert(fused_processor_ == nullptr ||
+         (!fused_processor_->HasPrefixVocabMask() && !fused_processor_->HasPresencePenalty()));
+
+  NextTokenScores<float> input_scores = {next_token_scores, 1, vocab_size_};
+  for (size_t i = 0; i < processor_list_.size(); i++) {
+    processor_list_[i]->Process(sequence, input_scores);
+  }
+
+  if (fused_processor_) {
+    fused_processor_->Process(input_scores, false);
+  }
+
+  if (timestamp_processor_) {
+    timestamp_processor_->Process(sequence, input_scores);
+  }
 }
 
 }  // namespace transformers
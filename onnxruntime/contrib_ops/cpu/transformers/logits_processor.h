@@ -90,69 +90,34 @@ class NoRepeatNGramLogitsProcessor : public ILogitsProcessor<T> {
   int ngram_size_;
 };
 
+// Applies the processors that update every score, i.e. vocabulary mask, prefix vocabulary mask, temperature and
+// presence penalty, in a single pass over each row of scores. Rows are processed in blocks that stay in the L1
+// cache, with one branch free loop per processor so that each of them is vectorized.
+// It shall run after the processors that update a few scores only, as these do not commute with temperature.
 template <typename T>
-class VocabMaskLogitsProcessor : public ILogitsProcessor<T> {
+class FusedLogitsProcessor {
  public:
-  VocabMaskLogitsProcessor(const gsl::span<const int32_t>& vocab_mask);
+  FusedLogitsProcessor(const gsl::span<const int32_t>& vocab_mask,
+                       const gsl::span<const int32_t>& prefix_vocab_mask,
+                       int batch_size,
+                       float temperature,
+                       const gsl::span<const int32_t>& presence_mask,
+                       float presence_penalty);
 
-  void Process(const ISequences* sequences,
-               NextTokenScores<T>& next_token_scores) override;
-
- private:
-  gsl::span<const int32_t> vocab_mask_;
-};
+  // Returns true when no score would be updated.
+  bool IsEmpty() const;
 
-template <typename T>
-class PrefixVocabMaskLogitsProcessor : public ILogitsProcessor<T> {
- public:
-  PrefixVocabMaskLogitsProcessor(const gsl::span<const int32_t>& vocab_mask, int batch_size);
+  bool HasPrefixVocabMask() const { return !prefix_vocab_mask_.empty(); }
+  bool HasPresencePenalty() const { return !presence_mask_.empty(); }
 
-  void Process(const ISequences* sequences,
-               NextTokenScores<T>& next_token_scores) override;
+  void Process(NextTokenScores<T>& next_token_scores, bool apply_prefix_vocab_mask);
 
  private:
-  gsl::span<const int32_t> prefix_vocab_mask_;
+  gsl::span<const int32_t> vocab_mask_;         // shape (vocab_size)
+  gsl::span<const int32_t> prefix_vocab_mask_;  // shape (batch_size, vocab_size)
   const int batch_size_;
-};
-
-template <typename T>
-class TemperatureLogitsProcessor : public ILogitsProcessor<T> {
- public:
-  TemperatureLogitsProcessor(float temperature);
-
-  void Process(const ISequences* sequences,
-               NextTokenScores<T>& next_token_scores) override;
-
- private:
-  float temperature_;
-};
-
-// template <typename T>
-// class TopPLogitsProcessor : public ILogitsProcessor<T> {
-//  public:
-//   TopPLogitsProcessor(float top_p, float filter_value,
-//                       onnxruntime::concurrency::ThreadPool* thread_pool);
-
-//   void Process(const ISequences* sequences,
-//                NextTokenScores<T>& next_token_scores) override;
-
-//  private:
-//   float top_p_;
-//   float filter_value_;
-//   onnxruntime::concurrency::ThreadPool* thread_pool_;
-// };
-
-template <typename T>
-class PresencePenaltyLogitsProcessor : public ILogitsProcessor<T> {
- public:
-  PresencePenaltyLogitsProcessor(const gsl::span<const int32_t>& presence_mask,
-                                 float presence_penalty);
-
-  void Process(const ISequences* sequences,
-               NextTokenScores<T>& next_token_scores) override;
-
- private:
-  gsl::span<const int32_t> presence_mask_;
+  float temperature_;                        // 1.0 when not applied
+  gsl::span<const int32_t> presence_mask_;  // shape (batch_size, vocab_size)
   float presence_penalty_;
 };
 
@@ -301,10 +266,17 @@ class LogitsProcessorList : public ILogitsProcessorList {
   void Init(const SamplingParameters& parameters);
   void Process(const ISequences* sequences, gsl::span<float>& next_token_scores, int step);
 
+  // Process the scores of one sequence, for sequences that are not decoded in a fixed batch.
+  // Processors that depend on the batch index, like the prefix vocab mask, shall not be used.
+  void ProcessSequence(const ISequences* sequence, gsl::span<float>& next_token_scores);
+
  private:
+  // When apply_scaling is false, temperature and presence penalty are left to the caller.
   template <typename GenerationParametersT>
-  void LogitsProcessorInitImpl(const GenerationParametersT& parameters) {
+  void LogitsProcessorInitImpl(const GenerationParametersT& parameters, bool apply_scaling = true) {
     processor_list_.clear();
+    fused_processor_.reset();
+    timestamp_processor_.reset();
 
     if (parameters.repetition_penalty != 1.0f) {  // 1.0 means no penalty
       repetition_penalty_processor_ = std::make_unique<RepetitionPenaltyLogitsProcessor<float>>(
@@ -318,34 +290,26 @@ class LogitsProcessorList : public ILogitsProcessorList {
       processor_list_.push_back(no_repeat_ngram_processor_.get());
     }
 
-    if (!parameters.vocab_mask.empty()) {
-      vocab_mask_processor_ = std::make_unique<VocabMaskLogitsProcessor<float>>(parameters.vocab_mask);
-      processor_list_.push_back(vocab_mask_processor_.get());
-    }
-
-    if (!parameters.prefix_vocab_mask.empty()) {
-      prefix_vocab_mask_processor_ = std::make_unique<
-          PrefixVocabMaskLogitsProcessor<float>>(parameters.prefix_vocab_mask,
-                                                 parameters.batch_size);
-      processor_list_.push_back(prefix_vocab_mask_processor_.get());
-    }
-
     if (parameters.min_length > 0) {
       min_length_processor_ = std::make_unique<MinLengthLogitsProcessor<float>>(parameters.min_length,
                                                                                 parameters.eos_token_id);
       processor_list_.push_back(min_length_processor_.get());
     }
 
-    if (parameters.temperature > 0) {
-      temperature_processor_ = std::make_unique<TemperatureLogitsProcessor<float>>(parameters.temperature);
-      processor_list_.push_back(temperature_processor_.get());
-    }
-
-    if (!parameters.presence_mask.empty()) {
-      presence_penalty_processor_ = std::make_unique<
-          PresencePenaltyLogitsProcessor<float>>(parameters.presence_mask,
-                                                 parameters.presence_penalty);
-      processor_list_.push_back(presence_penalty_processor_.get());
+    // Masks and scaling are applied after the processors above, which is equivalent to the order of the individual
+    // processors since masked scores are set to the lowest value either way.
+    const bool apply_temperature = apply_scaling && parameters.temperature > 0 && parameters.temperature != 1.0f;
+    const bool apply_presence_penalty = apply_scaling && !parameters.presence_mask.empty() &&
+                                        parameters.presence_penalty != 0.0f;
+    fused_processor_ = std::make_unique<FusedLogitsProcessor<float>>(
+        parameters.vocab_mask,
+        parameters.prefix_vocab_mask,
+        parameters.batch_size,
+        apply_temperature ? parameters.temperature : 1.0f,
+        apply_presence_penalty ? parameters.presence_mask : gsl::span<const int32_t>{},
+        parameters.presence_penalty);
+    if (fused_processor_->IsEmpty()) {
+      fused_processor_.reset();
     }
 
     // Add timestamp processor for whisper model
@@ -360,7 +324,6 @@ class LogitsProcessorList : public ILogitsProcessorList {
                                                                                parameters.no_timestamps_token_id,
                                                                                parameters.beginning_timestamp_token_id,
                                                                                max_initial_timestamp_index);
-      processor_list_.push_back(timestamp_processor_.get());
     }
 
     batch_beam_size_ = parameters.BatchBeamSize();
@@ -369,15 +332,14 @@ class LogitsProcessorList : public ILogitsProcessorList {
 
   int batch_beam_size_;
   int vocab_size_;
+  // Processors that update a few scores of each row. They run before fused_processor_, and timestamp_processor_
+  // runs last.
   InlinedVector<ILogitsProcessor<float>*> processor_list_;
 
   std::unique_ptr<RepetitionPenaltyLogitsProcessor<float>> repetition_penalty_processor_;
   std::unique_ptr<NoRepeatNGramLogitsProcessor<float>> no_repeat_ngram_processor_;
-  std::unique_ptr<VocabMaskLogitsProcessor<float>> vocab_mask_processor_;
-  std::unique_ptr<PrefixVocabMaskLogitsProcessor<float>> prefix_vocab_mask_processor_;
   std::unique_ptr<MinLengthLogitsProcessor<float>> min_length_processor_;
-  std::unique_ptr<TemperatureLogitsProcessor<float>> temperature_processor_;
-  std::unique_ptr<PresencePenaltyLogitsProcessor<float>> presence_penalty_processor_;
+  std::unique_ptr<FusedLogitsProcessor<float>> fused_processor_;
   std::unique_ptr<TimestampLogitsProcessor<float>> timestamp_processor_;
 };
 
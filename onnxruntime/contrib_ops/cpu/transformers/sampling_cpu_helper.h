@@ -6,52 +6,79 @@ namespace onnxruntime {
 namespace contrib {
 namespace SamplingCpuHelper {
 
+// Applies temperature and presence penalty to the scores of one row, like TemperatureLogitsProcessor and
+// PresencePenaltyLogitsProcessor do when they are the last logits processors.
 template <typename T>
-void filter_scores(std::vector<size_t>& sorted_indice,
-                   gsl::span<T>& next_token_score,
-                   const transformers::IGenerationParameters* parameters,
-                   size_t chunk_offset,
-                   size_t offset) {
-  size_t real_index = sorted_indice[chunk_offset + offset];
-  next_token_score[chunk_offset + real_index] = (T)parameters->filter_value;
-}
+void ApplyScaling(gsl::span<T> next_token_score,
+                  gsl::span<const int32_t> presence_mask,
+                  const transformers::IGenerationParameters* parameters) {
+  const bool apply_temperature = parameters->temperature > 0 && parameters->temperature != 1.0f;
+  const bool apply_presence_penalty = !presence_mask.empty() && parameters->presence_penalty != 0.0f;
+  if (!apply_temperature && !apply_presence_penalty) {
+    return;
+  }
 
-template <typename T>
-void cumulate_and_filter_custom(gsl::span<T>& next_token_scores,
-                                gsl::span<T>& cumulative_probs,
-                                const transformers::IGenerationParameters* parameters,
-                                std::vector<size_t>& sorted_indices) {
-  for (size_t i = 0; i < static_cast<size_t>(parameters->batch_size); i++) {
-    size_t offset = i * parameters->vocab_size;
-    if (cumulative_probs[offset] > parameters->top_p) {
-      filter_scores(sorted_indices, next_token_scores, parameters, offset, 1);
+  const float temperature = apply_temperature ? parameters->temperature : 1.0f;
+  const float presence_penalty = apply_presence_penalty ? parameters->presence_penalty : 0.0f;
+  T* p = next_token_score.data();
+  const size_t vocab_size = next_token_score.size();
+  if (apply_presence_penalty) {
+    for (size_t j = 0; j < vocab_size; j++) {
+      p[j] = p[j] / temperature - presence_mask[j] * presence_penalty;
     }
-    for (size_t j = 1; j < static_cast<size_t>(parameters->vocab_size) - 1; j++) {
-      cumulative_probs[j + offset] += cumulative_probs[j + offset - 1];
-      if (cumulative_probs[j + offset] > parameters->top_p) {
-        filter_scores(sorted_indices, next_token_scores, parameters, offset, j + 1);
-      }
+  } else {
+    for (size_t j = 0; j < vocab_size; j++) {
+      p[j] /= temperature;
     }
   }
 }
 
+// Finds the tokens of one row that survive top-p filtering. Returns their number and leaves their indices at the
+// front of sorted_indices, in descending order of probability.
+//
+// A token is filtered when the probabilities of the tokens ranked above it sum to at least top_p, or to more than
+// top_p for custom sampling, which is what filtering after sorting the whole row does. Since top-p usually keeps a
+// small fraction of the vocabulary, the row is partially sorted in growing chunks only as far as the scan needs.
 template <typename T>
-void cumulate_and_filter(gsl::span<T>& next_token_scores,
-                         gsl::span<T>& cumulative_probs,
-                         const transformers::IGenerationParameters* parameters,
-                         std::vector<size_t>& sorted_indices) {
-  for (size_t i = 0; i < static_cast<size_t>(parameters->batch_size); i++) {
-    size_t offset = i * parameters->vocab_size;
-    if (cumulative_probs[offset] <= 1 - parameters->top_p) {
-      filter_scores(sorted_indices, next_token_scores, parameters, offset, 0);
+size_t SelectTopP(gsl::span<const T> probs,
+                  gsl::span<int32_t> sorted_indices,
+                  const transformers::IGenerationParameters* parameters) {
+  constexpr size_t kInitialChunkSize = 64;
+
+  const size_t vocab_size = probs.size();
+  const float top_p = parameters->top_p;
+  const bool custom = parameters->custom_sampling;
+  const size_t min_tokens_to_keep = custom ? 1
+                                           : std::min(vocab_size,
+                                                      static_cast<size_t>(std::max(parameters->min_tokens_to_keep, 1)));
+
+  std::iota(sorted_indices.begin(), sorted_indices.end(), 0);
+  auto greater = [&probs](int32_t i1, int32_t i2) { return probs[i1] > probs[i2]; };
+
+  size_t num_sorted = 0;
+  size_t chunk_size = kInitialChunkSize;
+  size_t num_kept = 0;
+  float cumulative_prob = 0.0f;
+  while (num_kept < vocab_size) {
+    if (num_kept >= min_tokens_to_keep && (custom ? cumulative_prob > top_p : cumulative_prob >= top_p)) {
+      break;
     }
-    for (size_t j = 1; j < static_cast<size_t>(parameters->vocab_size) - static_cast<size_t>(parameters->min_tokens_to_keep); j++) {
-      cumulative_probs[j + offset] += cumulative_probs[j + offset - 1];
-      if (cumulative_probs[j + offset] <= 1 - parameters->top_p) {
-        filter_scores(sorted_indices, next_token_scores, parameters, offset, j);
+
+    if (num_kept == num_sorted) {
+      const size_t end = std::min(vocab_size, num_sorted + chunk_size);
+      if (end < vocab_size) {
+        std::nth_element(sorted_indices.begin() + num_sorted, sorted_indices.begin() + end, sorted_indices.end(),
+                         greater);
       }
+      std::sort(sorted_indices.begin() + num_sorted, sorted_indices.begin() + end, greater);
+      num_sorted = end;
+      chunk_size *= 4;
     }
+
+    cumulative_prob += static_cast<float>(probs[sorted_indices[num_kept++]]);
   }
+
+  return num_kept;
 }
 
 template <typename T>
@@ -64,55 +91,56 @@ Status Sample(AllocatorPtr& allocator,
               const IConsoleDumper* dumper) {
   ORT_UNUSED_PARAMETER(dumper);
 
-  gsl::span<T>& sorted_scores = sampling_state->sorted_scores;
-  memcpy(sorted_scores.data(), next_token_scores.data(), next_token_scores.size_bytes());
-  std::vector<size_t> sorted_indices(static_cast<size_t>(parameters->batch_size) * static_cast<size_t>(parameters->vocab_size));
-
-  std::function<bool(T, T)> predicator;
-  if (parameters->custom_sampling) {
-    predicator = std::greater<T>();
-  } else {
-    predicator = std::less<T>();
+  const size_t vocab_size = static_cast<size_t>(parameters->vocab_size);
+  const bool scaling_fused = parameters->IsScalingFusedIntoSampling();
+
+  if (scaling_fused) {
+    concurrency::ThreadPool::TrySimpleParallelFor(
+        thread_pool, parameters->batch_size,
+        [&](std::ptrdiff_t i) {
+          gsl::span<const int32_t> presence_mask;
+          if (!parameters->presence_mask.empty()) {
+            presence_mask = parameters->presence_mask.subspan(i * vocab_size, vocab_size);
+          }
+          ApplyScaling(next_token_scores.subspan(i * vocab_size, vocab_size), presence_mask, parameters);
+        });
   }
 
-  // TODO: This could be optimized with allocated buffer and handwritten sort algorithm
-  for (size_t i = 0; i < static_cast<size_t>(parameters->batch_size); i++) {
-    auto indices_begin = sorted_indices.begin() + i * parameters->vocab_size;
-    auto indices_end = sorted_indices.begin() + (i + 1) * parameters->vocab_size;
-    gsl::span<T> next_token_score = next_token_scores.subspan(i * parameters->vocab_size, parameters->vocab_size);
-    std::iota(indices_begin, indices_end, 0);
-    std::sort(indices_begin, indices_end,
-              [&next_token_score, &predicator](size_t i1, size_t i2) {
-                return predicator(next_token_score[i1], next_token_score[i2]);
-              });
-
-    std::sort(sorted_scores.begin() + i * parameters->vocab_size,
-              sorted_scores.begin() + (i + 1) * parameters->vocab_size,
-              predicator);
-  }
-
-#ifdef DEBUG_GENERATION
-  dumper->Print("sorted_scores", sorted_scores.data(), parameters->batch_size, parameters->vocab_size);
-  dumper->Print("sorted_indices", sorted_indices.data(), parameters->batch_size, parameters->vocab_size);
-#endif
-
-  gsl::span<T>& cumulative_probs = sampling_state->cumulative_probs;
-
+  gsl::span<T>& probs = sampling_state->cumulative_probs;
   ORT_RETURN_IF_ERROR(SoftmaxCPU<T>(parameters->batch_size,
-                                    parameters->vocab_size,
-                                    sorted_scores.data(),
-                                    cumulative_probs.data(),
+                                    vocab_size,
+                                    next_token_scores.data(),
+                                    probs.data(),
                                     false,
                                     thread_pool));
 
-  if (parameters->custom_sampling) {
-    cumulate_and_filter_custom(next_token_scores, cumulative_probs, parameters, sorted_indices);
-  } else {
-    cumulate_and_filter(next_token_scores, cumulative_probs, parameters, sorted_indices);
-  }
+#ifdef DEBUG_GENERATION
+  dumper->Print("probs", probs.data(), parameters->batch_size, parameters->vocab_size);
+#endif
+
+  // Set the scores of the filtered tokens to filter_value. The scores of the kept tokens are moved aside while the
+  // row is filled, as there are usually far fewer of them.
+  concurrency::ThreadPool::TrySimpleParallelFor(
+      thread_pool, parameters->batch_size,
+      [&](std::ptrdiff_t i) {
+        gsl::span<T> next_token_score = next_token_scores.subspan(i * vocab_size, vocab_size);
+        gsl::span<T> kept_scores = sampling_state->sorted_scores.subspan(i * vocab_size, vocab_size);
+        gsl::span<int32_t> sorted_indices = sampling_state->sorted_indices.subspan(i * vocab_size, vocab_size);
+        const size_t num_kept = SelectTopP<T>(probs.subspan(i * vocab_size, vocab_size), sorted_indices, parameters);
+        if (num_kept == vocab_size) {
+          return;
+        }
+
+        for (size_t j = 0; j < num_kept; j++) {
+          kept_scores[j] = next_token_score[sorted_indices[j]];
+        }
+        std::fill(next_token_score.begin(), next_token_score.end(), static_cast<T>(parameters->filter_value));
+        for (size_t j = 0; j < num_kept; j++) {
+          next_token_score[sorted_indices[j]] = kept_scores[j];
+        }
+      });
 
 #ifdef DEBUG_GENERATION
-  dumper->Print("cumulative_probs after filtering", cumulative_probs.data(), parameters->batch_size, parameters->vocab_size);
   dumper->Print("next_token_scores after filtering", next_token_scores.data(), parameters->batch_size, parameters->vocab_size);
 #endif
 
@@ -55,6 +55,20 @@ class Sequences : public ISequences {
   int current_length_;
 };
 
+// This class wraps the word IDs of one sequence that is generated outside of a fixed batch.
+class SingleSequence : public ISequences {
+ public:
+  explicit SingleSequence(gsl::span<const int32_t> sequence) : sequence_(sequence) {}
+
+  gsl::span<const int32_t> GetSequence(int /*beam_index*/) const override { return sequence_; }
+  gsl::span<const int32_t> GetCurrentDeviceSequences() const override { return sequence_; }
+  gsl::span<int32_t> GetNextDeviceSequences() override { ORT_NOT_IMPLEMENTED("SingleSequence is only used on CPU"); }
+  int GetSequenceLength() const override { return static_cast<int>(sequence_.size()); }
+
+ private:
+  gsl::span<const int32_t> sequence_;
+};
+
 }  // namespace transformers
 }  // namespace contrib
 }  // namespace onnxruntime
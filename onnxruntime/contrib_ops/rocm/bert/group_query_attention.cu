@@ -31,6 +31,7 @@ namespace rocm {
       kRocmExecutionProvider,                                          \
       (*KernelDefBuilder::Create())                                    \
           .TypeConstraint("T", DataTypeImpl::GetTensorType<T>())       \
+          .TypeConstraint("T_CACHE", DataTypeImpl::GetTensorType<T>()) \
           .TypeConstraint("M", DataTypeImpl::GetTensorType<int32_t>()) \
           .MayInplace(3, 1)                                            \
           .MayInplace(4, 2)                                            \
@@ -159,6 +160,9 @@ Status GroupQueryAttention<T>::ComputeInternal(OpKernelContext* ctx) const {
   const Tensor* total_seqlen = ctx->Input<Tensor>(6);
   const Tensor* cos_cache = ctx->Input<Tensor>(7);
   const Tensor* sin_cache = ctx->Input<Tensor>(8);
+  if (ctx->Input<Tensor>(9) != nullptr) {
+    return ORT_MAKE_STATUS(ONNXRUNTIME, NOT_IMPLEMENTED, "GroupQueryAttention with a paged kv cache is only supported on CPU.");
+  }
 
   auto& device_prop = GetDeviceProp();
   std::call_once(
@@ -131,10 +131,12 @@ void CPUIDInfo::X86Init() {
         // Add check for AVX512 Skylake since tensorization GEMM need intrinsics from avx512bw/avx512dq.
         // avx512_skylake = avx512f | avx512vl | avx512cd | avx512bw | avx512dq
         has_avx512_skylake_ = has_avx512 && (data[1] & ((1 << 16) | (1 << 17) | (1 << 28) | (1 << 30) | (1 << 31)));
+        has_avx512_vnni_ = has_avx512f_ && (data[2] & (1 << 11));
         is_hybrid_ = (data[3] & (1 << 15));
         if (max_SubLeaves >= 1) {
           GetCPUID(7, 1, data);
           has_avx512_bf16_ = has_avx512 && (data[0] & (1 << 5));
+          has_avx_vnni_ = has_avx2_ && (data[0] & (1 << 4));
         }
       }
     }
@@ -0,0 +1,101 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+namespace onnxruntime {
+
+// Lock-free histogram of durations in microseconds, using power-of-two buckets so that
+// recording is cheap enough to stay enabled on hot paths.
+//
+// Bucket 0 counts durations below 1us, bucket i (0 < i < kNumBuckets - 1) counts durations
+// in [2^(i-1), 2^i) us, and the last bucket counts everything longer.
+class LatencyHistogram {
+ public:
+  static constexpr size_t kNumBuckets = 32;
+
+  struct Snapshot {
+    std::array<uint64_t, kNumBuckets> bucket_counts{};
+    uint64_t count{0};
+    uint64_t total_us{0};
+    uint64_t max_us{0};
+
+    // Upper bound, in microseconds, of the bucket holding the given quantile (0 < quantile <= 1).
+    // Returns 0 if nothing was recorded.
+    uint64_t Percentile(double quantile) const {
+      if (count == 0) {
+        return 0;
+      }
+      const double target = quantile * static_cast<double>(count);
+      uint64_t seen = 0;
+      for (size_t i = 0; i < kNumBuckets; ++i) {
+        seen += bucket_counts[i];
+        if (static_cast<double>(seen) >= target) {
+          return i + 1 < kNumBuckets ? BucketUpperBound(i) : max_us;
+        }
+      }
+      return max_us;
+    }
+  };
+
+  LatencyHistogram() = default;
+
+  void Record(int64_t duration_us) {
+    const uint64_t us = duration_us > 0 ? static_cast<uint64_t>(duration_us) : 0;
+    buckets_[BucketIndex(us)].fetch_add(1, std::memory_order_relaxed);
+    count_.fetch_add(1, std::memory_order_relaxed);
+    total_us_.fetch_add(us, std::memory_order_relaxed);
+    uint64_t max = max_us_.load(std::memory_order_relaxed);
+    while (us > max && !max_us_.compare_exchange_weak(max, us, std::memory_order_relaxed)) {
+    }
+  }
+
+  // Counters are read individually, so a snapshot taken while other threads record
+  // may be off by the in-flight samples.
+  Snapshot GetSnapshot() const {
+    Snapshot snapshot;
+    for (size_t i = 0; i < kNumBuckets; ++i) {
+      snapshot.bucket_counts[i] = buckets_[i].load(std::memory_order_relaxed);
+    }
+    snapshot.count = count_.load(std::memory_order_relaxed);
+    snapshot.total_us = total_us_.load(std::memory_order_relaxed);
+    snapshot.max_us = max_us_.load(std::memory_order_relaxed);
+    return snapshot;
+  }
+
+  void Reset() {
+    for (auto& bucket : buckets_) {
+      bucket.store(0, std::memory_order_relaxed);
+    }
+    count_.store(0, std::memory_order_relaxed);
+    total_us_.store(0, std::memory_order_relaxed);
+    max_us_.store(0, std::memory_order_relaxed);
+  }
+
+  static size_t BucketIndex(uint64_t us) {
+    size_t index = 0;
+    while (us != 0 && index + 1 < kNumBuckets) {
+      us >>= 1;
+      ++index;
+    }
+    return index;
+  }
+
+  // Exclusive upper bound of bucket i in microseconds. Not meaningful for the last bucket.
+  static uint64_t BucketUpperBound(size_t i) {
+    return uint64_t{1} << i;
+  }
+
+ private:
+  std::array<std::atomic<uint64_t>, kNumBuckets> buckets_{};
+  std::atomic<uint64_t> count_{0};
+  std::atomic<uint64_t> total_us_{0};
+  std::atomic<uint64_t> max_us_{0};
+};
+
+}  // namespace onnxruntime
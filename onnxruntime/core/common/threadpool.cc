@@ -389,6 +389,12 @@ ThreadPool::ThreadPool(Env* env,
       assert(thread_options_.affinities.size() >= size_t(threads_to_create));
     }
 
+    if (!thread_options_.numa_node_ids.empty()) {
+      // Node ids are ordered like affinities, including the caller's entry
+      thread_options_.numa_node_ids.erase(thread_options_.numa_node_ids.begin());
+      assert(thread_options_.numa_node_ids.size() >= size_t(threads_to_create));
+    }
+
     extended_eigen_threadpool_ =
         std::make_unique<ThreadPoolTempl<Env> >(name,
                                                 threads_to_create,
@@ -497,13 +503,18 @@ namespace {
 thread_local std::optional<ThreadPoolParallelSection> current_parallel_section;
 }
 
-ThreadPool::ParallelSection::ParallelSection(ThreadPool* tp) {
+ThreadPool::ParallelSection::ParallelSection(ThreadPool* tp, int numa_node) {
   ORT_ENFORCE(!current_parallel_section.has_value(), "Nested parallelism not supported");
   ORT_ENFORCE(!ps_);
   tp_ = tp;
   if (tp && tp->underlying_threadpool_) {
     current_parallel_section.emplace();
     ps_ = &*current_parallel_section;
+    // Only restrict the section if the node has workers to run it
+    auto* underlying = tp_->underlying_threadpool_;
+    if (underlying->NumNumaNodes() > 1 && underlying->NumThreadsOnNumaNode(numa_node) > 0) {
+      ps_->numa_node = numa_node;
+    }
     tp_->underlying_threadpool_->StartParallelSection(*ps_);
   }
 }
@@ -663,6 +674,22 @@ std::string ThreadPool::StopProfiling(concurrency::ThreadPool* tp) {
   }
 }
 
+void ThreadPool::EnableWaitTimes(concurrency::ThreadPool* tp) {
+  if (tp && tp->underlying_threadpool_) {
+    tp->underlying_threadpool_->EnableWaitTimes();
+  }
+}
+
+ThreadPool::WaitTimes ThreadPool::GetWaitTimes(const concurrency::ThreadPool* tp) {
+  WaitTimes wait_times;
+  if (tp && tp->underlying_threadpool_) {
+    tp->underlying_threadpool_->GetWaitTimes(wait_times.caller_wait_ns,
+                                             wait_times.worker_spin_ns,
+                                             wait_times.worker_blocked_ns);
+  }
+  return wait_times;
+}
+
 void ThreadPool::EnableSpinning() {
   if (extended_eigen_threadpool_) {
     extended_eigen_threadpool_->EnableSpinning();
@@ -675,9 +702,20 @@ void ThreadPool::DisableSpinning() {
   }
 }
 
-// Return the number of threads created by the pool.
+int ThreadPool::NumNumaNodes(const concurrency::ThreadPool* tp) {
+  if (tp && tp->underlying_threadpool_) {
+    return tp->underlying_threadpool_->NumNumaNodes();
+  }
+  return 1;
+}
+
+// Return the number of threads created by the pool, restricted to the current
+// parallel section's NUMA node if it has one.
 int ThreadPool::NumThreads() const {
   if (underlying_threadpool_) {
+    if (current_parallel_section.has_value() && current_parallel_section->numa_node >= 0) {
+      return underlying_threadpool_->NumThreadsOnNumaNode(current_parallel_section->numa_node);
+    }
     return underlying_threadpool_->NumThreads();
   } else {
     return 0;
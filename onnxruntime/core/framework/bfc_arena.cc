@@ -3,16 +3,87 @@
 
 #include "core/framework/allocator.h"
 #include "core/framework/bfc_arena.h"
+#include <algorithm>
 #include <type_traits>
 
+#include "core/common/inlined_containers.h"
+
 namespace onnxruntime {
+
+namespace {
+std::atomic<uint64_t> next_arena_id{1};
+}  // namespace
+
+class BFCArena::ThreadCache : public std::enable_shared_from_this<BFCArena::ThreadCache> {
+ public:
+  explicit ThreadCache(BFCArena* arena) : arena_(arena), free_lists_(kNumThreadCacheClasses) {}
+
+  struct OwnedChunk {
+    size_t cache_class;
+    size_t size;  // size of the underlying Chunk, may be larger than the size class
+    bool is_free;
+  };
+
+  // Read by BFCArena::GetStats from any thread.
+  std::atomic<int64_t> hits_{0};
+  std::atomic<int64_t> misses_{0};
+  std::atomic<int64_t> cached_bytes_snapshot_{0};
+
+  // Set once the cache is detached from its arena, either because the owning thread exited or
+  // because the arena was destroyed.
+  std::atomic<bool> released_{false};
+
+  // Guards the state below. The owning thread takes it around each cache operation. Other threads
+  // only take it to free a chunk owned by the cache or to flush the cache in Shrink(), so it is
+  // almost never contended. Always acquired before BFCArena::lock_.
+  OrtMutex mutex_;
+  BFCArena* arena_;
+  InlinedHashMap<void*, OwnedChunk> owned_;
+  std::vector<std::vector<void*>> free_lists_;
+  int64_t cached_bytes_ = 0;
+
+  void PushFree(void* p, OwnedChunk& owned_chunk) {
+    ORT_ENFORCE(!owned_chunk.is_free, "Double free of ", p);
+    owned_chunk.is_free = true;
+    free_lists_[owned_chunk.cache_class].push_back(p);
+    UpdateCachedBytes(static_cast<int64_t>(owned_chunk.size));
+  }
+
+  void UpdateCachedBytes(int64_t delta) {
+    cached_bytes_ += delta;
+    cached_bytes_snapshot_.store(cached_bytes_, std::memory_order_relaxed);
+  }
+};
+
+// Holds the caches of the calling thread, one per arena it allocated small chunks from.
+// Caches are handed back to their arena when the thread exits.
+struct BFCArena::ThreadCacheSlots {
+  InlinedVector<std::pair<uint64_t, std::shared_ptr<ThreadCache>>> entries;
+
+  ~ThreadCacheSlots() {
+    for (auto& entry : entries) {
+      ThreadCache& cache = *entry.second;
+      std::lock_guard<OrtMutex> guard(cache.mutex_);
+      if (cache.arena_ != nullptr) {
+        cache.arena_->ReleaseThreadCache(cache);
+      }
+    }
+  }
+
+  static ThreadCacheSlots& Get() {
+    static thread_local ThreadCacheSlots slots;
+    return slots;
+  }
+};
+
 BFCArena::BFCArena(std::unique_ptr<IAllocator> resource_allocator,
                    size_t total_memory,
                    ArenaExtendStrategy arena_extend_strategy,
                    int initial_chunk_size_bytes,
                    int max_dead_bytes_per_chunk,
                    int initial_growth_chunk_size_bytes,
-                   int64_t max_power_of_two_extend_bytes)
+                   int64_t max_power_of_two_extend_bytes,
+                   int64_t max_thread_cache_bytes)
     : IAllocator(OrtMemoryInfo(resource_allocator->Info().name,
                                OrtAllocatorType::OrtArenaAllocator,
                                resource_allocator->Info().device,
@@ -25,12 +96,15 @@ BFCArena::BFCArena(std::unique_ptr<IAllocator> resource_allocator,
       initial_chunk_size_bytes_(initial_chunk_size_bytes),
       max_dead_bytes_per_chunk_(max_dead_bytes_per_chunk),
       initial_growth_chunk_size_bytes_(initial_growth_chunk_size_bytes),
-      max_power_of_two_extend_bytes_(max_power_of_two_extend_bytes) {
+      max_power_of_two_extend_bytes_(max_power_of_two_extend_bytes),
+      max_thread_cache_bytes_(max_thread_cache_bytes),
+      arena_id_(next_arena_id.fetch_add(1)) {
   LOGS_DEFAULT(INFO) << "Creating BFCArena for " << device_allocator_->Info().name
                      << " with following configs: initial_chunk_size_bytes: " << initial_chunk_size_bytes_
                      << " max_dead_bytes_per_chunk: " << max_dead_bytes_per_chunk_
                      << " initial_growth_chunk_size_bytes: " << initial_growth_chunk_size_bytes_
                      << " max_power_of_two_extend_bytes: " << max_power_of_two_extend_bytes_
+                     << " max_thread_cache_bytes: " << max_thread_cache_bytes_
                      << " memory limit: " << total_memory
                      << " arena_extend_strategy: " << static_cast<int32_t>(arena_extend_strategy);
 
@@ -78,6 +152,14 @@ BFCArena::BFCArena(std::unique_ptr<IAllocator> resource_allocator,
 }
 
 BFCArena::~BFCArena() {
+  // Detach the thread caches so exiting threads don't hand chunks back to a destroyed arena.
+  // Exiting threads erase their cache from thread_caches_ concurrently, so iterate over a copy.
+  for (const auto& cache : GetThreadCaches()) {
+    std::lock_guard<OrtMutex> guard(cache->mutex_);
+    cache->arena_ = nullptr;
+    cache->released_ = true;
+  }
+
   for (const auto& region : region_manager_.regions()) {
     device_allocator_->Free(region.ptr());
   }
@@ -255,6 +337,7 @@ void BFCArena::DeallocateChunk(ChunkHandle h) {
   // clean the stream / timestamp when deallocate chunk
   c->stream = nullptr;
   c->stream_timestamp = 0;
+  c->thread_cache = nullptr;
   c->next = free_chunks_list_;
   free_chunks_list_ = h;
 }
@@ -269,9 +352,180 @@ size_t BFCArena::RoundedBytes(size_t bytes) {
 }
 
 void* BFCArena::Alloc(size_t size) {
+  if (max_thread_cache_bytes_ > 0 && size > 0 && size <= kMaxThreadCacheChunkSize) {
+    return AllocateFromThreadCache(size);
+  }
   return AllocateRawInternal(size, false, nullptr, false, nullptr);
 }
 
+BFCArena::ThreadCache* BFCArena::FindThreadCache() {
+  for (auto& entry : ThreadCacheSlots::Get().entries) {
+    if (entry.first == arena_id_) {
+      return entry.second.get();
+    }
+  }
+  return nullptr;
+}
+
+BFCArena::ThreadCache& BFCArena::GetThreadCache() {
+  ThreadCache* existing = FindThreadCache();
+  if (existing != nullptr) {
+    return *existing;
+  }
+
+  auto& entries = ThreadCacheSlots::Get().entries;
+  // drop slots of arenas that have been destroyed since this thread last created a cache
+  entries.erase(std::remove_if(entries.begin(), entries.end(),
+                               [](const auto& entry) { return entry.second->released_.load(); }),
+                entries.end());
+
+  auto cache = std::make_shared<ThreadCache>(this);
+  {
+    std::lock_guard<OrtMutex> lock(lock_);
+    thread_caches_.push_back(cache);
+  }
+  entries.emplace_back(arena_id_, cache);
+  return *cache;
+}
+
+std::vector<std::shared_ptr<BFCArena::ThreadCache>> BFCArena::GetThreadCaches() {
+  std::lock_guard<OrtMutex> lock(lock_);
+  return thread_caches_;
+}
+
+void* BFCArena::AllocateFromThreadCache(size_t num_bytes) {
+  ThreadCache& cache = GetThreadCache();
+  const size_t rounded_bytes = RoundedBytes(num_bytes);
+  const size_t cache_class = rounded_bytes / kMinAllocationSize - 1;
+
+  std::lock_guard<OrtMutex> guard(cache.mutex_);
+  auto& free_list = cache.free_lists_[cache_class];
+  if (!free_list.empty()) {
+    void* p = free_list.back();
+    free_list.pop_back();
+    auto& owned_chunk = cache.owned_.at(p);
+    owned_chunk.is_free = false;
+    cache.UpdateCachedBytes(-static_cast<int64_t>(owned_chunk.size));
+    cache.hits_.fetch_add(1, std::memory_order_relaxed);
+    return p;
+  }
+
+  // the new chunk is added to owned_, so keep holding the cache's mutex
+  cache.misses_.fetch_add(1, std::memory_order_relaxed);
+  return AllocateRawInternal(num_bytes, false, nullptr, false, nullptr, &cache);
+}
+
+bool BFCArena::FreeToThreadCache(void* p) {
+  ThreadCache* cache = FindThreadCache();
+  if (cache == nullptr) {
+    return false;
+  }
+
+  std::lock_guard<OrtMutex> guard(cache->mutex_);
+  auto it = cache->owned_.find(p);
+  if (it == cache->owned_.end()) {
+    return false;
+  }
+
+  cache->PushFree(p, it->second);
+  if (cache->cached_bytes_ > max_thread_cache_bytes_) {
+    std::lock_guard<OrtMutex> lock(lock_);
+    FlushThreadCache(*cache, max_thread_cache_bytes_ / 2);
+  }
+
+  return true;
+}
+
+void BFCArena::FreeNotInThreadCache(void* p) {
+  std::shared_ptr<ThreadCache> owner;
+  {
+    std::lock_guard<OrtMutex> lock(lock_);
+    auto it = reserved_chunks_.find(p);
+    if (it != reserved_chunks_.end()) {
+      device_allocator_->Free(it->first);
+      stats_.bytes_in_use -= it->second;
+      stats_.total_allocated_bytes -= it->second;
+      reserved_chunks_.erase(it);
+      return;
+    }
+
+    BFCArena::ChunkHandle h = region_manager_.get_handle(p);
+    ORT_ENFORCE(h != kInvalidChunkHandle);
+    Chunk* c = ChunkFromHandle(h);
+    if (c->thread_cache == nullptr) {
+      FreeAndMaybeCoalesce(h);
+      return;
+    }
+
+    // the cache is in thread_caches_ while it owns chunks so it is alive here
+    owner = c->thread_cache->shared_from_this();
+  }
+
+  // The chunk belongs to another thread's cache. Put it on that cache's free list so the owner can
+  // reuse it, subject to the same budget as local frees, unless that thread has exited, in which
+  // case the chunk was disowned and goes straight back to the bins. The chunk is in use, so the
+  // owner can't have flushed it in the meantime.
+  {
+    std::lock_guard<OrtMutex> guard(owner->mutex_);
+    if (owner->arena_ != nullptr) {
+      owner->PushFree(p, owner->owned_.at(p));
+      if (owner->cached_bytes_ > max_thread_cache_bytes_) {
+        std::lock_guard<OrtMutex> lock(lock_);
+        FlushThreadCache(*owner, max_thread_cache_bytes_ / 2);
+      }
+      return;
+    }
+  }
+
+  std::lock_guard<OrtMutex> lock(lock_);
+  DeallocateRawInternal(p);
+}
+
+void BFCArena::FlushThreadCache(ThreadCache& cache, int64_t target_bytes) {
+  // Return the largest chunks first as they are the most useful to the bins.
+  for (size_t cache_class = kNumThreadCacheClasses; cache_class-- > 0 && cache.cached_bytes_ > target_bytes;) {
+    auto& free_list = cache.free_lists_[cache_class];
+    while (!free_list.empty() && cache.cached_bytes_ > target_bytes) {
+      void* p = free_list.back();
+      free_list.pop_back();
+      auto it = cache.owned_.find(p);
+      cache.UpdateCachedBytes(-static_cast<int64_t>(it->second.size));
+      cache.owned_.erase(it);
+
+      BFCArena::ChunkHandle h = region_manager_.get_handle(p);
+      ORT_ENFORCE(h != kInvalidChunkHandle);
+      ChunkFromHandle(h)->thread_cache = nullptr;
+      FreeAndMaybeCoalesce(h);
+    }
+  }
+}
+
+void BFCArena::ReleaseThreadCache(ThreadCache& cache) {
+  std::lock_guard<OrtMutex> lock(lock_);
+
+  for (const auto& entry : cache.owned_) {
+    BFCArena::ChunkHandle h = region_manager_.get_handle(entry.first);
+    ORT_ENFORCE(h != kInvalidChunkHandle);
+    ChunkFromHandle(h)->thread_cache = nullptr;
+    if (entry.second.is_free) {
+      FreeAndMaybeCoalesce(h);
+    }
+  }
+  cache.owned_.clear();
+  for (auto& free_list : cache.free_lists_) {
+    free_list.clear();
+  }
+  cache.UpdateCachedBytes(-cache.cached_bytes_);
+
+  released_thread_cache_hits_ += cache.hits_.load();
+  released_thread_cache_misses_ += cache.misses_.load();
+
+  cache.arena_ = nullptr;
+  cache.released_ = true;
+  thread_caches_.erase(std::find_if(thread_caches_.begin(), thread_caches_.end(),
+                                    [&cache](const auto& c) { return c.get() == &cache; }));
+}
+
 void* BFCArena::Reserve(size_t size) {
   if (size == 0)
     return nullptr;
@@ -312,7 +566,8 @@ void* BFCArena::AllocateRawInternal(size_t num_bytes,
                                     bool dump_log_on_failure,
                                     Stream* stream,
                                     bool enable_cross_stream_reusing,
-                                    WaitNotificationFn wait_fn) {
+                                    WaitNotificationFn wait_fn,
+                                    ThreadCache* thread_cache) {
   if (num_bytes == 0) {
     LOGS_DEFAULT(VERBOSE) << "tried to allocate 0 bytes";
     return nullptr;
@@ -325,6 +580,14 @@ void* BFCArena::AllocateRawInternal(size_t num_bytes,
   // The BFC allocator tries to find the best fit first.
   BinNum bin_num = BinNumForSize(rounded_bytes);
 
+  // check the chunk out to the thread cache so that it can be recycled without taking lock_
+  auto assign_to_thread_cache = [thread_cache, rounded_bytes](Chunk& chunk) {
+    if (thread_cache != nullptr) {
+      chunk.thread_cache = thread_cache;
+      thread_cache->owned_[chunk.ptr] = {rounded_bytes / kMinAllocationSize - 1, chunk.size, false};
+    }
+  };
+
   std::lock_guard<OrtMutex> lock(lock_);
   // search for a valid chunk
   auto* chunk = FindChunkPtr(bin_num,
@@ -341,6 +604,7 @@ void* BFCArena::AllocateRawInternal(size_t num_bytes,
       if (stream)
         chunk->stream_timestamp = stream->GetCurrentTimestamp();
     }
+    assign_to_thread_cache(*chunk);
     return chunk->ptr;
   }
 
@@ -356,6 +620,7 @@ void* BFCArena::AllocateRawInternal(size_t num_bytes,
       if (chunk->stream == nullptr && stream) {
         chunk->stream = stream;
       }
+      assign_to_thread_cache(*chunk);
       return chunk->ptr;
     } else {
       status = ORT_MAKE_STATUS(ONNXRUNTIME, FAIL,
@@ -379,6 +644,18 @@ void* BFCArena::AllocateRawInternal(size_t num_bytes,
 void BFCArena::GetStats(AllocatorStats* stats) {
   std::lock_guard<OrtMutex> lock(lock_);
   *stats = stats_;
+
+  // free chunks sitting in thread caches are in use as far as the bins are concerned
+  stats->num_thread_cache_hits = released_thread_cache_hits_;
+  stats->num_thread_cache_misses = released_thread_cache_misses_;
+  stats->num_allocs += released_thread_cache_hits_;
+  for (const auto& cache : thread_caches_) {
+    const int64_t hits = cache->hits_.load(std::memory_order_relaxed);
+    stats->num_thread_cache_hits += hits;
+    stats->num_thread_cache_misses += cache->misses_.load(std::memory_order_relaxed);
+    stats->num_allocs += hits;
+    stats->bytes_in_use -= cache->cached_bytes_snapshot_.load(std::memory_order_relaxed);
+  }
 }
 
 BFCArena::Chunk* BFCArena::SplitFreeChunkFromBin(BFCArena::Bin::FreeChunkSet* free_chunks,
@@ -496,6 +773,14 @@ void BFCArena::Free(void* p) {
   if (p == nullptr) {
     return;
   }
+
+  if (max_thread_cache_bytes_ > 0) {
+    if (!FreeToThreadCache(p)) {
+      FreeNotInThreadCache(p);
+    }
+    return;
+  }
+
   std::lock_guard<OrtMutex> lock(lock_);
   auto it = reserved_chunks_.find(p);
   if (it != reserved_chunks_.end()) {
@@ -509,7 +794,20 @@ void BFCArena::Free(void* p) {
 }
 
 Status BFCArena::Shrink() {
+  // Return the free chunks of all thread caches, including those of idle threads, so they don't keep
+  // their regions alive.
+  if (max_thread_cache_bytes_ > 0) {
+    for (const auto& cache : GetThreadCaches()) {
+      std::lock_guard<OrtMutex> guard(cache->mutex_);
+      if (cache->arena_ != nullptr) {
+        std::lock_guard<OrtMutex> lock(lock_);
+        FlushThreadCache(*cache, 0);
+      }
+    }
+  }
+
   std::lock_guard<OrtMutex> lock(lock_);
+
   auto num_regions = region_manager_.regions().size();
   std::vector<void*> region_ptrs;
   std::vector<size_t> region_sizes;
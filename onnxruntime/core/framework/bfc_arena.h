@@ -16,6 +16,7 @@ limitations under the License.
 
 #pragma once
 #include <array>
+#include <atomic>
 #include <memory>
 #include <mutex>
 #include <sstream>
@@ -61,6 +62,8 @@ class BFCArena : public IAllocator {
   static const int DEFAULT_INITIAL_GROWTH_CHUNK_SIZE_BYTES = 2 * 1024 * 1024;
   static const int64_t DEFAULT_MAX_POWER_OF_TWO_EXTEND_BYTES = 1024 * 1024 * 1024;  // 1GB
   static const size_t DEFAULT_MAX_MEM = std::numeric_limits<size_t>::max();
+  // 0 disables the per-thread chunk cache.
+  static const int64_t DEFAULT_MAX_THREAD_CACHE_BYTES = 0;
 
   enum ArenaType {
     BaseArena,
@@ -73,7 +76,8 @@ class BFCArena : public IAllocator {
            int initial_chunk_size_bytes = DEFAULT_INITIAL_CHUNK_SIZE_BYTES,
            int max_dead_bytes_per_chunk = DEFAULT_MAX_DEAD_BYTES_PER_CHUNK,
            int initial_growth_chunk_size_bytes = DEFAULT_INITIAL_GROWTH_CHUNK_SIZE_BYTES,
-           int64_t max_power_of_two_extend_bytes = DEFAULT_MAX_POWER_OF_TWO_EXTEND_BYTES);
+           int64_t max_power_of_two_extend_bytes = DEFAULT_MAX_POWER_OF_TWO_EXTEND_BYTES,
+           int64_t max_thread_cache_bytes = DEFAULT_MAX_THREAD_CACHE_BYTES);
 
   ~BFCArena() override;
 
@@ -87,6 +91,8 @@ class BFCArena : public IAllocator {
 
   // Frees all allocation regions in which no chunk is in use.
   // Does not free any reserved chunks.
+  // Chunks held by the calling thread's cache are returned to the bins first. Chunks cached by
+  // other threads stay checked out and keep their allocation regions alive.
   // Resets the size that the arena will grow by in the next allocation to
   // `initial_growth_chunk_size_bytes_` but ultimately all
   // future allocation sizes are determined by the arena growth strategy
@@ -108,11 +114,14 @@ class BFCArena : public IAllocator {
                               WaitNotificationFn /*wait_fn*/) const {}
 
  protected:
+  class ThreadCache;
+
   void* AllocateRawInternal(size_t num_bytes,
                             bool dump_log_on_failure,
                             Stream* stream,
                             bool enable_cross_stream_reusing,
-                            WaitNotificationFn wait_fn);
+                            WaitNotificationFn wait_fn,
+                            ThreadCache* thread_cache = nullptr);
 #ifdef ORT_ENABLE_STREAM
   // for any chunk that associated with target stream, reset it to default (nullptr in stream, timestamp 0)
   // perform coalesce if coalesce_flag is true
@@ -170,6 +179,10 @@ class BFCArena : public IAllocator {
 
     uint64_t stream_timestamp = 0;
 
+    // If not nullptr, the chunk is checked out of the bins by this thread cache.
+    // It stays in_use() from the arena's point of view until the cache flushes it.
+    ThreadCache* thread_cache = nullptr;
+
     bool in_use() const { return allocation_id != -1; }
 
     std::string DebugString(BFCArena* a, bool recurse) {
@@ -365,6 +378,46 @@ class BFCArena : public IAllocator {
   // Returns 'bytes' rounded up to the next highest kMinAllocationSize.
   size_t RoundedBytes(size_t bytes);
 
+  // Per-thread cache ("magazine") of small chunks.
+  //
+  // Chunks of up to kMaxThreadCacheChunkSize bytes allocated through Alloc() are checked out of
+  // the bins into the allocating thread's cache. Freeing such a chunk on the same thread puts it on
+  // the cache's free list for its size class without taking lock_, and the next Alloc() of the same
+  // rounded size on that thread reuses it. Once a thread caches more than max_thread_cache_bytes_
+  // of free chunks, half of them are returned to the bins under a single lock_ acquisition.
+  // Chunks freed by another thread go onto the owning cache's free list under the same budget, and
+  // Shrink() returns the free chunks of all caches to the bins.
+  static const size_t kMaxThreadCacheChunkSize = 64 * 1024;
+  static const size_t kNumThreadCacheClasses = kMaxThreadCacheChunkSize / kMinAllocationSize;
+
+  // Holds the calling thread's caches. Defined in the .cc.
+  struct ThreadCacheSlots;
+
+  // Returns the calling thread's cache for this arena, creating it if needed.
+  ThreadCache& GetThreadCache();
+
+  // Returns the calling thread's cache for this arena or nullptr if it has none.
+  ThreadCache* FindThreadCache();
+
+  void* AllocateFromThreadCache(size_t num_bytes);
+
+  // Returns false if 'p' is not owned by the calling thread's cache.
+  bool FreeToThreadCache(void* p);
+
+  // Frees 'p' when it is not owned by the calling thread's cache.
+  void FreeNotInThreadCache(void* p);
+
+  // Returns a copy of thread_caches_, so the caches can be locked without holding lock_.
+  std::vector<std::shared_ptr<ThreadCache>> GetThreadCaches();
+
+  // Returns free chunks of 'cache' to the bins until at most 'target_bytes' remain cached.
+  // Requires the cache's mutex and lock_ to be held.
+  void FlushThreadCache(ThreadCache& cache, int64_t target_bytes);
+
+  // Disowns all chunks of 'cache' and returns the free ones to the bins. Called when the owning
+  // thread exits. Requires the cache's mutex to be held.
+  void ReleaseThreadCache(ThreadCache& cache);
+
   // Try to add a new memory region that can satisfy an allocation of
   // 'rounded_bytes' bytes.
   Status Extend(size_t rounded_bytes);
@@ -508,6 +561,18 @@ class BFCArena : public IAllocator {
   const int max_dead_bytes_per_chunk_;
   const int initial_growth_chunk_size_bytes_;
   const int64_t max_power_of_two_extend_bytes_;
+  const int64_t max_thread_cache_bytes_;
+
+  // Unique id of this arena used to find its cache in a thread's ThreadCacheSlots.
+  // Ids are never reused so a slot left behind by a destroyed arena can't be mistaken for a live one.
+  const uint64_t arena_id_;
+
+  // All live thread caches of this arena. Guarded by lock_.
+  std::vector<std::shared_ptr<ThreadCache>> thread_caches_;
+
+  // Counters of thread caches released by exited threads. Guarded by lock_.
+  int64_t released_thread_cache_hits_ = 0;
+  int64_t released_thread_cache_misses_ = 0;
 
   // This flag is only relevant if Shrink() is invoked.
   // This is a boolean flag that controls whether the first allocation region
@@ -406,11 +406,13 @@ ExecutionFrame::ExecutionFrame(gsl::span<const int> feed_mlvalue_idxs, gsl::span
 
     // if there are some traditional ml value type in inputs disable the memory pattern optimization.
     if (all_tensors) {
-      mem_patterns_ = session_state.GetMemoryPatternGroup(feeds, feed_mlvalue_idxs, inferred_shapes_);
+      cached_entry_ = session_state.GetMemoryPatternGroup(feeds, feed_mlvalue_idxs);
       // if no existing patterns, generate one in this execution frame
-      if (!mem_patterns_) {
+      if (!cached_entry_) {
         planner_.emplace(*session_state.GetExecutionPlan());
       } else {
+        mem_patterns_ = &cached_entry_->mem_patterns;
+        inferred_shapes_ = &cached_entry_->resolved_shapes;
         // pre-allocate the big chunk requested in memory pattern.
         // all the internal kernel's input/output tensors will be allocated on these buffer.
         buffers_.reserve(mem_patterns_->locations.size());
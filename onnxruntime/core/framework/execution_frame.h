@@ -23,6 +23,7 @@ class DataTransferManager;
 class SessionState;
 class OrtValueNameIdxMap;
 struct MemoryPatternGroup;
+struct MemoryPatternCacheEntry;
 class NodeIndexInfo;
 class Stream;
 #ifdef ORT_ENABLE_STREAM
@@ -228,6 +229,10 @@ class ExecutionFrame final : public IExecutionFrame {
   // map of index to custom allocator
   InlinedHashMap<int, IExecutor::CustomAllocator> custom_allocators_;
 
+  // Cache entry for the input shapes of this run, if any. Holding it keeps
+  // mem_patterns_ and inferred_shapes_ valid if the entry is evicted meanwhile.
+  std::shared_ptr<const MemoryPatternCacheEntry> cached_entry_;
+
   // If we already have cached memory pattern on these input shapes
   // Use this mem pattern that create a big chunk for all the internal
   // kernel's input/output tensors.
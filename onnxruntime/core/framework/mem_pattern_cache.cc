@@ -0,0 +1,57 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "core/framework/mem_pattern_cache.h"
+
+#include "core/framework/tensor.h"
+
+namespace onnxruntime {
+
+MemoryPatternCache::Key MemoryPatternCache::MakeKey(gsl::span<const OrtValue> tensor_inputs) {
+  Key key;
+  for (const auto& input : tensor_inputs) {
+    auto dims = input.Get<Tensor>().Shape().GetDims();
+    // The rank keeps shapes such as {2, 3} + {4} and {2} + {3, 4} apart.
+    key.push_back(static_cast<int64_t>(dims.size()));
+    key.insert(key.end(), dims.begin(), dims.end());
+  }
+  return key;
+}
+
+std::shared_ptr<const MemoryPatternCacheEntry> MemoryPatternCache::Find(const Key& key) {
+  std::lock_guard<OrtMutex> lock(mutex_);
+  auto it = index_.find(key);
+  if (it == index_.end()) {
+    return nullptr;
+  }
+
+  lru_.splice(lru_.begin(), lru_, it->second);
+  return it->second->second;
+}
+
+std::shared_ptr<const MemoryPatternCacheEntry> MemoryPatternCache::Insert(const Key& key,
+                                                                          MemoryPatternCacheEntry entry) {
+  std::lock_guard<OrtMutex> lock(mutex_);
+  auto it = index_.find(key);
+  if (it != index_.end()) {
+    // Do not replace an existing entry, so that every caller for these shapes sees the same one.
+    lru_.splice(lru_.begin(), lru_, it->second);
+    return it->second->second;
+  }
+
+  if (capacity_ != 0 && lru_.size() >= capacity_) {
+    index_.erase(lru_.back().first);
+    lru_.pop_back();
+  }
+
+  lru_.emplace_front(key, std::make_shared<const MemoryPatternCacheEntry>(std::move(entry)));
+  index_.emplace(key, lru_.begin());
+  return lru_.front().second;
+}
+
+size_t MemoryPatternCache::Size() const {
+  std::lock_guard<OrtMutex> lock(mutex_);
+  return lru_.size();
+}
+
+}  // namespace onnxruntime
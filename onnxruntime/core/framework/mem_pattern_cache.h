@@ -0,0 +1,69 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+#include <list>
+#include <map>
+#include <memory>
+#include <utility>
+#include <gsl/gsl>
+#include "core/common/common.h"
+#include "core/common/inlined_containers.h"
+#include "core/framework/mem_pattern.h"
+#include "core/framework/ort_value.h"
+#include "core/framework/tensor_shape.h"
+#include "core/platform/ort_mutex.h"
+
+namespace onnxruntime {
+
+// Execution state that only depends on the shapes of the feeds: the memory pattern
+// used to pre-allocate activations.
+struct MemoryPatternCacheEntry {
+  MemoryPatternGroup mem_patterns;
+  // Value shapes resolved statically from the feed shapes, keyed by OrtValue index. Only generated
+  // in training builds, where they are read through TryGetInferredOutputShape.
+  InlinedHashMap<int, TensorShape> resolved_shapes;
+};
+
+// Bounded LRU cache of MemoryPatternCacheEntry keyed on the exact shapes of the feeds.
+// Entries are handed out as shared pointers so that an execution frame can keep using
+// an entry that is evicted while it runs.
+// Thread-safe.
+class MemoryPatternCache {
+ public:
+  using Key = InlinedVector<int64_t>;
+
+  // capacity is the maximum number of entries. 0 means unbounded.
+  explicit MemoryPatternCache(size_t capacity) : capacity_(capacity) {}
+
+  // Build the key for a set of feeds. All values must be tensors.
+  static Key MakeKey(gsl::span<const OrtValue> tensor_inputs);
+
+  // Return the entry for key, or nullptr. A hit makes the entry the most recently used.
+  std::shared_ptr<const MemoryPatternCacheEntry> Find(const Key& key);
+
+  // Insert an entry for key unless one is present, evicting the least recently used
+  // entry if the cache is full. Returns the entry cached for key.
+  std::shared_ptr<const MemoryPatternCacheEntry> Insert(const Key& key, MemoryPatternCacheEntry entry);
+
+  size_t Size() const;
+
+  size_t Capacity() const { return capacity_; }
+
+ private:
+  ORT_DISALLOW_COPY_ASSIGNMENT_AND_MOVE(MemoryPatternCache);
+
+  using LruList = std::list<std::pair<Key, std::shared_ptr<const MemoryPatternCacheEntry>>>;
+
+  const size_t capacity_;
+  mutable OrtMutex mutex_;
+  // Most recently used entry first.
+  LruList lru_;
+#ifndef DISABLE_ABSEIL
+  InlinedHashMap<Key, LruList::iterator> index_;
+#else
+  std::map<Key, LruList::iterator> index_;
+#endif
+};
+
+}  // namespace onnxruntime
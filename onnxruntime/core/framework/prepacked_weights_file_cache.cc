@@ -0,0 +1,316 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "core/framework/prepacked_weights_file_cache.h"
+
+#include <atomic>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <limits>
+#include <sstream>
+#include <vector>
+
+#include <gsl/gsl>
+
+#include "core/common/cpuid_info.h"
+#include "core/common/narrow.h"
+#include "core/common/safeint.h"
+#include "onnxruntime_config.h"
+
+namespace onnxruntime {
+
+// File layout. All integers are in native byte order, which the CPU features in the header pin down.
+//
+//   char[8]   magic
+//   uint32_t  format version
+//   uint32_t  header config size, followed by the header config
+//   uint64_t  number of entries
+//   for each entry:
+//     uint32_t  key size, followed by the key
+//     uint32_t  number of buffers
+//     for each buffer:
+//       uint64_t  offset of the buffer from the start of the file, or kNullBufferOffset for a null buffer
+//       uint64_t  size of the buffer in bytes
+//   buffer data, each buffer starting at a multiple of kBufferAlignment
+namespace {
+
+constexpr char kMagic[8] = {'O', 'R', 'T', 'P', 'P', 'W', 'C', '\0'};
+constexpr uint32_t kFormatVersion = 1;
+constexpr uint64_t kNullBufferOffset = std::numeric_limits<uint64_t>::max();
+// Matches the alignment of buffers from the CPU allocator, which pre-packed buffers are normally allocated with.
+constexpr uint64_t kBufferAlignment = 64;
+
+// Distinguishes the temporary files of concurrent saves in the same process.
+std::atomic<uint64_t> next_temp_file_id{0};
+
+std::string GetCpuFeatures() {
+  const auto& cpu_info = CPUIDInfo::GetCPUIDInfo();
+  std::ostringstream oss;
+  oss << "SSE3=" << cpu_info.HasSSE3() << "|"
+      << "SSE4_1=" << cpu_info.HasSSE4_1() << "|"
+      << "AVX=" << cpu_info.HasAVX() << "|"
+      << "AVX2=" << cpu_info.HasAVX2() << "|"
+      << "AVX_VNNI=" << cpu_info.HasAVX_VNNI() << "|"
+      << "F16C=" << cpu_info.HasF16C() << "|"
+      << "AVX512F=" << cpu_info.HasAVX512f() << "|"
+      << "AVX512_SKYLAKE=" << cpu_info.HasAVX512Skylake() << "|"
+      << "AVX512_VNNI=" << cpu_info.HasAVX512_VNNI() << "|"
+      << "AVX512_BF16=" << cpu_info.HasAVX512_BF16() << "|"
+      << "AMX_BF16=" << cpu_info.HasAMX_BF16() << "|"
+      << "NEON_DOT=" << cpu_info.HasArmNeonDot() << "|"
+      << "NEON_I8MM=" << cpu_info.HasArmNeon_I8MM() << "|"
+      << "SVE_I8MM=" << cpu_info.HasArmSVE_I8MM() << "|"
+      << "NEON_BF16=" << cpu_info.HasArmNeon_BF16() << "|"
+      << "FP16=" << cpu_info.HasFp16VectorAcceleration();
+  return oss.str();
+}
+
+uint64_t AlignBufferOffset(uint64_t offset) {
+  return (offset + kBufferAlignment - 1) / kBufferAlignment * kBufferAlignment;
+}
+
+// Reads values from the mapped file, checking that they are within its bounds.
+class Reader {
+ public:
+  Reader(const char* data, size_t size) : data_{data}, size_{size} {}
+
+  template <typename T>
+  Status Read(T& value) {
+    ORT_RETURN_IF(size_ - offset_ < sizeof(T), "Unexpected end of file");
+    std::memcpy(&value, data_ + offset_, sizeof(T));
+    offset_ += sizeof(T);
+    return Status::OK();
+  }
+
+  Status ReadString(std::string& value) {
+    uint32_t length = 0;
+    ORT_RETURN_IF_ERROR(Read(length));
+    ORT_RETURN_IF(size_ - offset_ < length, "Unexpected end of file");
+    value.assign(data_ + offset_, length);
+    offset_ += length;
+    return Status::OK();
+  }
+
+ private:
+  const char* const data_;
+  const size_t size_;
+  size_t offset_{0};
+};
+
+template <typename T>
+void Write(std::ostream& out, const T& value) {
+  out.write(reinterpret_cast<const char*>(&value), sizeof(T));
+}
+
+void WriteString(std::ostream& out, const std::string& value) {
+  Write(out, static_cast<uint32_t>(value.size()));
+  out.write(value.data(), value.size());
+}
+
+}  // namespace
+
+PrepackedWeightsFileCache::PrepackedWeightsFileCache(const Env& env, PathString file_path, const std::string& config,
+                                                     const logging::Logger& logger)
+    : file_path_{std::move(file_path)},
+      header_config_{MakeString("onnxruntime ", ORT_VERSION, "|", GetCpuFeatures(), "|", config)},
+      logger_{logger} {
+  std::error_code error_code;
+  if (!std::filesystem::exists(file_path_, error_code)) {
+    LOGS(logger_, INFO) << "Pre-packed weights cache file " << PathToUTF8String(file_path_)
+                        << " does not exist. It will be created.";
+    return;
+  }
+
+  Status status = Load(env);
+  if (!status.IsOK()) {
+    LOGS(logger_, WARNING) << "Ignoring pre-packed weights cache file " << PathToUTF8String(file_path_) << ": "
+                           << status.ErrorMessage();
+    entries_.clear();
+    mapped_file_.reset();
+    num_loaded_elements_ = 0;
+  }
+}
+
+Status PrepackedWeightsFileCache::Load(const Env& env) {
+  size_t file_size = 0;
+  ORT_RETURN_IF_ERROR(env.GetFileLength(file_path_.c_str(), file_size));
+  ORT_RETURN_IF(file_size == 0, "The file is empty");
+  ORT_RETURN_IF_ERROR(env.MapFileIntoMemory(file_path_.c_str(), 0, file_size, mapped_file_));
+
+  const char* data = mapped_file_.get();
+  Reader reader{data, file_size};
+
+  char magic[sizeof(kMagic)];
+  ORT_RETURN_IF_ERROR(reader.Read(magic));
+  ORT_RETURN_IF(std::memcmp(magic, kMagic, sizeof(kMagic)) != 0, "Not a pre-packed weights cache file");
+
+  uint32_t format_version = 0;
+  ORT_RETURN_IF_ERROR(reader.Read(format_version));
+  ORT_RETURN_IF(format_version != kFormatVersion, "Unsupported format version ", format_version);
+
+  std::string header_config;
+  ORT_RETURN_IF_ERROR(reader.ReadString(header_config));
+  ORT_RETURN_IF(header_config != header_config_, "It was written for \"", header_config,
+                "\" but the current configuration is \"", header_config_, "\"");
+
+  uint64_t num_entries = 0;
+  ORT_RETURN_IF_ERROR(reader.Read(num_entries));
+  for (uint64_t i = 0; i < num_entries; ++i) {
+    std::string key;
+    ORT_RETURN_IF_ERROR(reader.ReadString(key));
+
+    uint32_t num_buffers = 0;
+    ORT_RETURN_IF_ERROR(reader.Read(num_buffers));
+
+    PrePackedWeights weights;
+    for (uint32_t j = 0; j < num_buffers; ++j) {
+      uint64_t offset = 0;
+      uint64_t size = 0;
+      ORT_RETURN_IF_ERROR(reader.Read(offset));
+      ORT_RETURN_IF_ERROR(reader.Read(size));
+
+      void* buffer = nullptr;
+      if (offset != kNullBufferOffset) {
+        ORT_RETURN_IF(offset > file_size || size > file_size - offset, "Buffer ", j, " of entry ", key,
+                      " is out of bounds");
+        buffer = const_cast<char*>(data) + offset;
+      }
+
+      // The buffer is owned by the mapping, so there is nothing to free.
+      weights.buffers_.emplace_back(buffer, [](void*) {});
+      weights.buffer_sizes_.push_back(narrow<size_t>(size));
+    }
+
+    entries_.insert_or_assign(std::move(key), Entry{std::move(weights), /*persist*/ true});
+  }
+
+  num_loaded_elements_ = entries_.size();
+  LOGS(logger_, INFO) << "Loaded " << num_loaded_elements_ << " pre-packed weights from "
+                      << PathToUTF8String(file_path_);
+  return Status::OK();
+}
+
+const PrePackedWeights* PrepackedWeightsFileCache::GetWeight(const std::string& key) const {
+  auto it = entries_.find(key);
+  return it != entries_.end() ? &it->second.weights : nullptr;
+}
+
+bool PrepackedWeightsFileCache::WriteWeight(const std::string& key, PrePackedWeights&& packed_weight, bool persist) {
+  ORT_ENFORCE(packed_weight.buffers_.size() == packed_weight.buffer_sizes_.size());
+  auto ret = entries_.insert(std::make_pair(key, Entry{std::move(packed_weight), persist}));
+  has_new_elements_ = has_new_elements_ || (ret.second && persist);
+  return ret.second;
+}
+
+Status PrepackedWeightsFileCache::Save() const {
+  if (!has_new_elements_) {
+    return Status::OK();
+  }
+
+#ifdef _WIN32
+  // A file that is mapped can't be replaced on Windows, and the loaded entries, which may be in use by kernels,
+  // point into the mapping.
+  if (mapped_file_) {
+    LOGS(logger_, WARNING) << "Not saving the new pre-packed weights to " << PathToUTF8String(file_path_)
+                           << " as it is mapped by this cache.";
+    return Status::OK();
+  }
+#endif
+
+  std::vector<const std::pair<const std::string, Entry>*> entries_to_save;
+  entries_to_save.reserve(entries_.size());
+  SafeInt<uint64_t> index_size = sizeof(kMagic) + sizeof(uint32_t) + sizeof(uint32_t) + header_config_.size() +
+                                 sizeof(uint64_t);
+  for (const auto& entry : entries_) {
+    if (entry.second.persist) {
+      entries_to_save.push_back(&entry);
+      index_size += sizeof(uint32_t) + entry.first.size() + sizeof(uint32_t) +
+                    entry.second.weights.buffers_.size() * 2 * sizeof(uint64_t);
+    }
+  }
+
+  // Assign the buffer offsets.
+  std::vector<uint64_t> offsets;
+  uint64_t end_of_data = index_size;
+  for (const auto* entry : entries_to_save) {
+    const auto& weights = entry->second.weights;
+    for (size_t i = 0; i < weights.buffers_.size(); ++i) {
+      if (weights.buffers_[i] == nullptr) {
+        offsets.push_back(kNullBufferOffset);
+      } else {
+        const uint64_t offset = AlignBufferOffset(end_of_data);
+        offsets.push_back(offset);
+        end_of_data = SafeInt<uint64_t>(offset) + weights.buffer_sizes_[i];
+      }
+    }
+  }
+
+  const std::filesystem::path file_path{file_path_};
+  std::filesystem::path temp_file_path{file_path};
+  temp_file_path += MakeString(".", Env::Default().GetSelfPid(), ".",
+                               next_temp_file_id.fetch_add(1, std::memory_order_relaxed), ".tmp");
+
+  // Remove the temporary file on every error path, including exceptions, once the stream writing it is closed.
+  bool renamed = false;
+  auto remove_temp_file = gsl::finally([&temp_file_path, &renamed]() {
+    if (!renamed) {
+      std::error_code remove_error_code;
+      std::filesystem::remove(temp_file_path, remove_error_code);
+    }
+  });
+
+  {
+    std::ofstream out{temp_file_path, std::ios::binary | std::ios::trunc};
+    ORT_RETURN_IF(!out, "Failed to open ", PathToUTF8String(temp_file_path.native()), " for writing");
+
+    out.write(kMagic, sizeof(kMagic));
+    Write(out, kFormatVersion);
+    WriteString(out, header_config_);
+    Write(out, static_cast<uint64_t>(entries_to_save.size()));
+    size_t offset_idx = 0;
+    for (const auto* entry : entries_to_save) {
+      const auto& weights = entry->second.weights;
+      WriteString(out, entry->first);
+      Write(out, static_cast<uint32_t>(weights.buffers_.size()));
+      for (size_t i = 0; i < weights.buffers_.size(); ++i) {
+        Write(out, offsets[offset_idx++]);
+        Write(out, static_cast<uint64_t>(weights.buffer_sizes_[i]));
+      }
+    }
+
+    offset_idx = 0;
+    uint64_t position = index_size;
+    const char padding[kBufferAlignment] = {};
+    for (const auto* entry : entries_to_save) {
+      const auto& weights = entry->second.weights;
+      for (size_t i = 0; i < weights.buffers_.size(); ++i) {
+        const uint64_t offset = offsets[offset_idx++];
+        if (offset == kNullBufferOffset) {
+          continue;
+        }
+        out.write(padding, static_cast<std::streamsize>(offset - position));
+        out.write(static_cast<const char*>(weights.buffers_[i].get()),
+                  static_cast<std::streamsize>(weights.buffer_sizes_[i]));
+        position = offset + weights.buffer_sizes_[i];
+      }
+    }
+
+    out.flush();
+    ORT_RETURN_IF(!out, "Failed to write ", PathToUTF8String(temp_file_path.native()));
+  }
+
+  std::error_code error_code;
+  std::filesystem::rename(temp_file_path, file_path, error_code);
+  if (error_code) {
+    return ORT_MAKE_STATUS(ONNXRUNTIME, FAIL, "Failed to replace ", PathToUTF8String(file_path_), ": ",
+                           error_code.message());
+  }
+  renamed = true;
+
+  LOGS(logger_, INFO) << "Saved " << entries_to_save.size() << " pre-packed weights to "
+                      << PathToUTF8String(file_path_);
+  return Status::OK();
+}
+
+}  // namespace onnxruntime
@@ -0,0 +1,69 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <string>
+#include <unordered_map>
+
+#include "core/common/common.h"
+#include "core/common/logging/logging.h"
+#include "core/common/path_string.h"
+#include "core/framework/prepacked_weights.h"
+#include "core/platform/env.h"
+
+namespace onnxruntime {
+
+// A cache of pre-packed weights that persists in a file, so that weights pre-packed by an earlier session, possibly
+// in another process, can be handed to kernels without calling PrePack() again.
+//
+// The file is mapped into memory when the cache is opened and the buffers of the entries read from it point into
+// the mapping, so they must be treated as read-only. The file records the onnxruntime version, the CPU features and
+// a caller provided configuration string. It is ignored, and replaced by Save(), if any of them differ.
+class PrepackedWeightsFileCache final {
+ public:
+  // Opens the cache at file_path. A missing, unreadable or stale file results in an empty cache.
+  // config should contain the settings, other than the CPU features, that change how weights are pre-packed.
+  PrepackedWeightsFileCache(const Env& env, PathString file_path, const std::string& config,
+                            const logging::Logger& logger);
+
+  ~PrepackedWeightsFileCache() = default;
+
+  // Returns the PrePackedWeights instance pertaining to the provided key or nullptr if there is none.
+  const PrePackedWeights* GetWeight(const std::string& key) const;
+
+  // Writes the PrePackedWeights instance pertaining to the provided key.
+  // If persist is false the instance is only kept alive by the cache and not written to the file by Save().
+  // Returns a boolean indicating if the insertion took place.
+  bool WriteWeight(const std::string& key, PrePackedWeights&& packed_weight, bool persist);
+
+  // Writes all entries to be persisted to the file if any was added since the cache was opened.
+  // The file is written to a temporary file first and then renamed, so other processes never see a partial file.
+  // On Windows, where a mapped file can't be replaced, nothing is saved if entries were loaded from the file.
+  Status Save() const;
+
+  // Returns the number of entries read from the file.
+  size_t GetNumberOfLoadedElements() const { return num_loaded_elements_; }
+
+  ORT_DISALLOW_COPY_ASSIGNMENT_AND_MOVE(PrepackedWeightsFileCache);
+
+ private:
+  struct Entry {
+    PrePackedWeights weights;
+    bool persist;
+  };
+
+  Status Load(const Env& env);
+
+  const PathString file_path_;
+  const std::string header_config_;
+  const logging::Logger& logger_;
+
+  // Declared ahead of entries_ as the buffers of the loaded entries point into it.
+  Env::MappedMemoryPtr mapped_file_;
+  std::unordered_map<std::string, Entry> entries_;
+  size_t num_loaded_elements_{0};
+  bool has_new_elements_{false};
+};
+
+}  // namespace onnxruntime
@@ -56,6 +56,22 @@ LARGE_INTEGER perf_freq = OrtGetPerformanceFrequency();
 
 namespace onnxruntime {
 
+static int64_t ElapsedUs(std::chrono::steady_clock::time_point start) {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Bytes of the tensors produced by a node, recorded by SessionMetrics.
+static uint64_t OutputTensorBytes(OpKernelContextInternal& op_kernel_context) {
+  uint64_t total_bytes = 0;
+  for (int i = 0, end = op_kernel_context.OutputCount(); i < end; ++i) {
+    const OrtValue* p_output = op_kernel_context.GetOutputMLValue(i);
+    if (p_output != nullptr && p_output->IsTensor()) {
+      total_bytes += p_output->Get<Tensor>().SizeInBytes();
+    }
+  }
+  return total_bytes;
+}
+
 static void CalculateTotalOutputSizes(OpKernelContextInternal* op_kernel_context,
                                       size_t& total_output_sizes, const std::string& node_name,
                                       std::string& output_type_shape) {
@@ -179,6 +195,9 @@ class SessionScope {
     if (session_state_.Profiler().IsEnabled()) {
       session_start_ = session_state.Profiler().Start();
     }
+    if (session_state_.GetSessionMetrics() != nullptr) {
+      metrics_start_ = std::chrono::steady_clock::now();
+    }
 
     auto& logger = session_state_.Logger();
     VLOGS(logger, 0) << "Begin execution";
@@ -227,6 +246,11 @@ class SessionScope {
     if (session_state_.Profiler().IsEnabled()) {
       session_state_.Profiler().EndTimeAndRecordEvent(profiling::SESSION_EVENT, "SequentialExecutor::Execute", session_start_);
     }
+    // subgraph executions are part of the run of the main graph
+    if (auto* metrics = session_state_.GetSessionMetrics();
+        metrics != nullptr && !session_state_.GetGraphViewer().IsSubgraph()) {
+      metrics->RecordRun(ElapsedUs(metrics_start_));
+    }
 #if !defined(ORT_MINIMAL_BUILD) && defined(ORT_MEMORY_PROFILE)
     auto& logger = session_state_.Logger();
     for (auto i : frame_.GetStaticMemorySizeInfo()) {
@@ -250,6 +274,7 @@ class SessionScope {
  private:
   const SessionState& session_state_;
   TimePoint session_start_;
+  std::chrono::steady_clock::time_point metrics_start_;
 #if !defined(ORT_MINIMAL_BUILD) && defined(ORT_MEMORY_PROFILE)
   const ExecutionFrame& frame_;
   // Whether memory profiler need create events and flush to file.
@@ -336,6 +361,10 @@ class KernelScope {
     node_compute_range_.Begin();
 #endif
 
+    if (session_state_.GetSessionMetrics() != nullptr) {
+      metrics_begin_time_ = std::chrono::steady_clock::now();
+    }
+
     if (session_state_.Profiler().IsEnabled()) {
       auto& node = kernel.Node();
       node_name_ = node.Name().empty() ? MakeString(node.OpType(), "_", node.Index()) : node.Name();
@@ -361,6 +390,11 @@ class KernelScope {
     node_compute_range_.End();
 #endif
 
+    if (auto* metrics = session_state_.GetSessionMetrics(); metrics != nullptr) {
+      metrics->RecordNode(session_state_.GetSessionMetricsNodeOffset() + kernel_.Node().Index(),
+                          ElapsedUs(metrics_begin_time_), OutputTensorBytes(kernel_context_));
+    }
+
     if (session_state_.Profiler().IsEnabled()) {
       auto& profiler = session_state_.Profiler();
       std::string output_type_shape_;
@@ -409,6 +443,7 @@ class KernelScope {
 
  private:
   TimePoint kernel_begin_time_;
+  std::chrono::steady_clock::time_point metrics_begin_time_;
   SessionScope& session_scope_;
   const SessionState& session_state_;
   std::string node_name_;
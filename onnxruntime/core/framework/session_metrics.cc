@@ -0,0 +1,255 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "core/framework/session_metrics.h"
+
+#include <algorithm>
+#include <map>
+
+#include "core/graph/graph_viewer.h"
+#include "core/platform/ort_mutex.h"
+#include "nlohmann/json.hpp"
+
+using json = nlohmann::json;
+
+namespace onnxruntime {
+
+namespace {
+
+std::atomic<uint64_t> next_metrics_id{1};
+
+// Only the owning thread writes the counters, so no read-modify-write operation is needed.
+void Add(std::atomic<uint64_t>& counter, uint64_t value) {
+  counter.store(counter.load(std::memory_order_relaxed) + value, std::memory_order_relaxed);
+}
+
+void Merge(const SessionMetrics::Stats& from, SessionMetrics::Stats& to) {
+  for (size_t i = 0; i < SessionMetrics::kNumBuckets; ++i) {
+    to.latency.bucket_counts[i] += from.latency.bucket_counts[i];
+  }
+  to.latency.count += from.latency.count;
+  to.latency.total_us += from.latency.total_us;
+  to.latency.max_us = std::max(to.latency.max_us, from.latency.max_us);
+  to.output_bytes += from.output_bytes;
+}
+
+json LatencyToJson(const LatencyHistogram::Snapshot& latency) {
+  return {{"count", latency.count},
+          {"total_us", latency.total_us},
+          {"max_us", latency.max_us},
+          {"buckets", latency.bucket_counts}};
+}
+
+json WaitTimesToJson(const concurrency::ThreadPool::WaitTimes& wait_times) {
+  return {{"caller_wait_ns", wait_times.caller_wait_ns},
+          {"worker_spin_ns", wait_times.worker_spin_ns},
+          {"worker_blocked_ns", wait_times.worker_blocked_ns}};
+}
+
+}  // namespace
+
+void SessionMetrics::Counters::Record(int64_t duration_us, uint64_t bytes) {
+  const uint64_t us = duration_us > 0 ? static_cast<uint64_t>(duration_us) : 0;
+  Add(buckets[LatencyHistogram::BucketIndex(us)], 1);
+  Add(count, 1);
+  Add(total_us, us);
+  if (us > max_us.load(std::memory_order_relaxed)) {
+    max_us.store(us, std::memory_order_relaxed);
+  }
+  Add(output_bytes, bytes);
+}
+
+void SessionMetrics::Counters::AddTo(Stats& stats) const {
+  for (size_t i = 0; i < kNumBuckets; ++i) {
+    stats.latency.bucket_counts[i] += buckets[i].load(std::memory_order_relaxed);
+  }
+  stats.latency.count += count.load(std::memory_order_relaxed);
+  stats.latency.total_us += total_us.load(std::memory_order_relaxed);
+  stats.latency.max_us = std::max(stats.latency.max_us, max_us.load(std::memory_order_relaxed));
+  stats.output_bytes += output_bytes.load(std::memory_order_relaxed);
+}
+
+struct SessionMetrics::SharedState {
+  OrtMutex mutex;
+  // Set when the first buffer is created, after which no graph may be registered.
+  bool recording{false};
+  // Buffers of the threads that may still record.
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+  // Counts of the buffers released by exited threads.
+  Stats retired_run;
+  std::vector<Stats> retired_nodes;
+
+  void Retire(const std::shared_ptr<ThreadBuffer>& buffer) {
+    std::lock_guard<OrtMutex> lock(mutex);
+    buffer->run.AddTo(retired_run);
+    for (size_t i = 0; i < buffer->nodes.size(); ++i) {
+      buffer->nodes[i].AddTo(retired_nodes[i]);
+    }
+    buffers.erase(std::find(buffers.begin(), buffers.end(), buffer));
+  }
+};
+
+class SessionMetrics::ThreadCache {
+ public:
+  ThreadCache() = default;
+
+  ~ThreadCache() {
+    for (const auto& entry : entries_) {
+      if (auto shared_state = entry.shared_state.lock()) {
+        shared_state->Retire(entry.buffer);
+      }
+    }
+  }
+
+  ThreadBuffer& Get(const SessionMetrics& metrics) {
+    // A thread usually records into the same instance over and over.
+    if (last_ < entries_.size() && entries_[last_].metrics_id == metrics.id_) {
+      return *entries_[last_].buffer;
+    }
+    for (size_t i = 0; i < entries_.size(); ++i) {
+      if (entries_[i].metrics_id == metrics.id_) {
+        last_ = i;
+        return *entries_[i].buffer;
+      }
+    }
+
+    // Release the buffers of destroyed instances before adding a new one.
+    entries_.erase(std::remove_if(entries_.begin(), entries_.end(),
+                                  [](const Entry& entry) { return entry.shared_state.expired(); }),
+                   entries_.end());
+
+    auto buffer = std::make_shared<ThreadBuffer>(metrics.node_info_.size());
+    {
+      std::lock_guard<OrtMutex> lock(metrics.shared_state_->mutex);
+      metrics.shared_state_->recording = true;
+      metrics.shared_state_->buffers.push_back(buffer);
+    }
+    entries_.push_back({metrics.id_, metrics.shared_state_, buffer});
+    last_ = entries_.size() - 1;
+    return *buffer;
+  }
+
+  ORT_DISALLOW_COPY_ASSIGNMENT_AND_MOVE(ThreadCache);
+
+ private:
+  struct Entry {
+    uint64_t metrics_id;
+    std::weak_ptr<SharedState> shared_state;
+    std::shared_ptr<ThreadBuffer> buffer;
+  };
+
+  std::vector<Entry> entries_;
+  size_t last_{0};
+};
+
+SessionMetrics::SessionMetrics(concurrency::ThreadPool* intra_op_thread_pool,
+                               concurrency::ThreadPool* inter_op_thread_pool)
+    : id_(next_metrics_id.fetch_add(1, std::memory_order_relaxed)),
+      intra_op_thread_pool_(intra_op_thread_pool),
+      inter_op_thread_pool_(inter_op_thread_pool),
+      shared_state_(std::make_shared<SharedState>()) {
+  concurrency::ThreadPool::EnableWaitTimes(intra_op_thread_pool);
+  concurrency::ThreadPool::EnableWaitTimes(inter_op_thread_pool);
+}
+
+size_t SessionMetrics::RegisterGraph(const GraphViewer& graph_viewer, const std::string& name_prefix) {
+  std::lock_guard<OrtMutex> lock(shared_state_->mutex);
+  ORT_ENFORCE(!shared_state_->recording, "Graphs must be registered before nodes are recorded.");
+
+  const size_t offset = node_info_.size();
+  node_info_.resize(offset + static_cast<size_t>(graph_viewer.MaxNodeIndex()));
+  shared_state_->retired_nodes.resize(node_info_.size());
+  for (const auto& node : graph_viewer.Nodes()) {
+    auto& info = node_info_[offset + node.Index()];
+    info.name = name_prefix + (node.Name().empty() ? MakeString(node.OpType(), "_", node.Index()) : node.Name());
+    info.op_type = node.OpType();
+  }
+  return offset;
+}
+
+SessionMetrics::ThreadBuffer& SessionMetrics::GetThreadBuffer() {
+  // Only the first use by a thread of an instance takes the lock.
+  thread_local ThreadCache thread_cache;
+  return thread_cache.Get(*this);
+}
+
+void SessionMetrics::RecordRun(int64_t duration_us) {
+  GetThreadBuffer().run.Record(duration_us, 0);
+}
+
+void SessionMetrics::RecordNode(size_t slot, int64_t duration_us, uint64_t output_bytes) {
+  auto& buffer = GetThreadBuffer();
+  if (slot < buffer.nodes.size()) {
+    buffer.nodes[slot].Record(duration_us, output_bytes);
+  }
+}
+
+SessionMetrics::Snapshot SessionMetrics::GetSnapshot() const {
+  Snapshot snapshot;
+
+  // Only copy the state under the lock. The buffers stay alive while referenced, even if their threads exit.
+  Stats run_stats;
+  std::vector<Stats> node_stats;
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+  {
+    std::lock_guard<OrtMutex> lock(shared_state_->mutex);
+    run_stats = shared_state_->retired_run;
+    node_stats = shared_state_->retired_nodes;
+    buffers = shared_state_->buffers;
+  }
+
+  for (const auto& entry : buffers) {
+    const ThreadBuffer& buffer = *entry;
+    buffer.run.AddTo(run_stats);
+    for (size_t i = 0; i < buffer.nodes.size(); ++i) {
+      buffer.nodes[i].AddTo(node_stats[i]);
+    }
+  }
+  snapshot.runs = run_stats.latency;
+
+  std::map<std::string, Stats> op_type_stats;
+  for (size_t i = 0; i < node_info_.size(); ++i) {
+    const auto& info = node_info_[i];
+    if (info.op_type.empty()) {
+      continue;
+    }
+    Merge(node_stats[i], op_type_stats[info.op_type]);
+    snapshot.nodes.push_back({info.name, info.op_type, node_stats[i]});
+  }
+  for (auto& entry : op_type_stats) {
+    snapshot.op_types.push_back({entry.first, entry.second});
+  }
+
+  snapshot.intra_op_thread_pool = concurrency::ThreadPool::GetWaitTimes(intra_op_thread_pool_);
+  snapshot.inter_op_thread_pool = concurrency::ThreadPool::GetWaitTimes(inter_op_thread_pool_);
+  return snapshot;
+}
+
+std::string SessionMetrics::ToJson(const Snapshot& snapshot) {
+  json nodes = json::array();
+  for (const auto& node : snapshot.nodes) {
+    json node_json = LatencyToJson(node.stats.latency);
+    node_json["name"] = node.name;
+    node_json["op_type"] = node.op_type;
+    node_json["output_bytes"] = node.stats.output_bytes;
+    nodes.push_back(std::move(node_json));
+  }
+
+  json op_types = json::array();
+  for (const auto& op_type : snapshot.op_types) {
+    json op_type_json = LatencyToJson(op_type.stats.latency);
+    op_type_json["op_type"] = op_type.op_type;
+    op_type_json["output_bytes"] = op_type.stats.output_bytes;
+    op_types.push_back(std::move(op_type_json));
+  }
+
+  json metrics = {{"runs", LatencyToJson(snapshot.runs)},
+                  {"nodes", std::move(nodes)},
+                  {"op_types", std::move(op_types)},
+                  {"intra_op_thread_pool", WaitTimesToJson(snapshot.intra_op_thread_pool)},
+                  {"inter_op_thread_pool", WaitTimesToJson(snapshot.inter_op_thread_pool)}};
+  // node names come from the model and are not guaranteed to be valid UTF-8
+  return metrics.dump(-1, ' ', false, json::error_handler_t::replace);
+}
+
+}  // namespace onnxruntime
@@ -0,0 +1,135 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "core/common/common.h"
+#include "core/common/latency_histogram.h"
+#include "core/platform/threadpool.h"
+
+namespace onnxruntime {
+
+class GraphViewer;
+
+/**
+Execution statistics of a session: the latency of each run, the latency and the output bytes of each node, and the
+time the session's thread pools spent waiting. The session only creates an instance, and so only collects them, when
+the "session.enable_metrics" config entry is set, and then collects them for its whole lifetime.
+
+Unlike the profiler, which records every event to a trace that is only available after it ends, the statistics are
+aggregated into fixed-size counters and can be read at any time while the session keeps running.
+
+Each thread executing nodes records into its own buffer, so recording only needs relaxed loads and stores. The
+buffer is found through a per-thread cache and released when the thread exits, after its counts are added to the
+totals of the instance. Readers merge the buffers of all threads, so a snapshot taken while nodes run may miss the
+samples being recorded.
+
+The instance enables the wait times of the thread pools it reports, which then stay enabled for their lifetime.
+*/
+class SessionMetrics {
+ public:
+  static constexpr size_t kNumBuckets = LatencyHistogram::kNumBuckets;
+
+  struct Stats {
+    LatencyHistogram::Snapshot latency;
+    // Total size of the tensors produced.
+    uint64_t output_bytes{0};
+  };
+
+  struct NodeStats {
+    std::string name;
+    std::string op_type;
+    Stats stats;
+  };
+
+  struct OpTypeStats {
+    std::string op_type;
+    Stats stats;
+  };
+
+  struct Snapshot {
+    LatencyHistogram::Snapshot runs;
+    // Nodes of the main graph and of all subgraphs. Subgraph nodes are prefixed with the name of the node
+    // holding the subgraph.
+    std::vector<NodeStats> nodes;
+    // The stats of all nodes of each op type, sorted by op type.
+    std::vector<OpTypeStats> op_types;
+    // The thread pools may be shared with other sessions, in which case their times are not specific to this
+    // session.
+    concurrency::ThreadPool::WaitTimes intra_op_thread_pool;
+    concurrency::ThreadPool::WaitTimes inter_op_thread_pool;
+  };
+
+  SessionMetrics(concurrency::ThreadPool* intra_op_thread_pool,
+                 concurrency::ThreadPool* inter_op_thread_pool);
+
+  // Adds the nodes of a graph and returns the slot of the node with index 0. The slot of a node is that value plus
+  // its index. All graphs must be registered before nodes are recorded.
+  size_t RegisterGraph(const GraphViewer& graph_viewer, const std::string& name_prefix);
+
+  void RecordRun(int64_t duration_us);
+
+  void RecordNode(size_t slot, int64_t duration_us, uint64_t output_bytes);
+
+  Snapshot GetSnapshot() const;
+
+  // Serializes a snapshot to JSON. Histograms are written as arrays of kNumBuckets counts, where bucket 0 counts
+  // durations below 1us, bucket i counts durations in [2^(i-1), 2^i) us, and the last bucket all longer ones.
+  static std::string ToJson(const Snapshot& snapshot);
+
+  ORT_DISALLOW_COPY_ASSIGNMENT_AND_MOVE(SessionMetrics);
+
+ private:
+  // Counters written only by the thread owning the buffer, and read by GetSnapshot.
+  struct Counters {
+    std::array<std::atomic<uint64_t>, kNumBuckets> buckets{};
+    std::atomic<uint64_t> count{0};
+    std::atomic<uint64_t> total_us{0};
+    std::atomic<uint64_t> max_us{0};
+    std::atomic<uint64_t> output_bytes{0};
+
+    void Record(int64_t duration_us, uint64_t bytes);
+    void AddTo(Stats& stats) const;
+  };
+
+  struct ThreadBuffer {
+    explicit ThreadBuffer(size_t num_slots) : nodes(num_slots) {}
+
+    Counters run;
+    std::vector<Counters> nodes;
+  };
+
+  struct NodeInfo {
+    std::string name;
+    std::string op_type;  // empty for slots of removed nodes
+  };
+
+  // The buffers of the recording threads and the counts of the exited ones. Shared with the per-thread caches,
+  // which outlive the instance when their threads do.
+  struct SharedState;
+
+  // The buffers of a thread, one per instance it recorded into.
+  class ThreadCache;
+
+  ThreadBuffer& GetThreadBuffer();
+
+  // Distinguishes instances in the per-thread cache, as a new instance may be allocated at the address of a
+  // destroyed one.
+  const uint64_t id_;
+  const concurrency::ThreadPool* const intra_op_thread_pool_;
+  const concurrency::ThreadPool* const inter_op_thread_pool_;
+
+  // Only modified by RegisterGraph, before any buffer exists.
+  std::vector<NodeInfo> node_info_;
+  std::shared_ptr<SharedState> shared_state_;
+};
+
+}  // namespace onnxruntime
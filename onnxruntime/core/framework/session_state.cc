@@ -3,13 +3,18 @@
 
 #include "core/framework/session_state.h"
 
+#include <algorithm>
+#include <iomanip>
 #include <sstream>
 
 #include "core/platform/ort_mutex.h"
 #include "core/common/logging/logging.h"
+#include "core/common/narrow.h"
+#include "core/common/parse_string.h"
 #include "core/common/safeint.h"
 #include "core/flatbuffers/schema/ort.fbs.h"
 #include "core/framework/allocator.h"
+#include "core/framework/murmurhash3.h"
 #include "core/framework/node_index_info.h"
 #include "core/framework/op_kernel.h"
 #include "core/framework/ort_value_pattern_planner.h"
@@ -61,6 +66,15 @@ class StreamCommandHandleRegistryImpl : public IStreamCommandHandleRegistry {
 };
 #endif
 
+static size_t GetMemoryPatternCacheCapacity(const SessionOptions& sess_options) {
+  const std::string value = sess_options.config_options.GetConfigOrDefault(kOrtSessionOptionsMemoryPatternCacheSize,
+                                                                            "128");
+  int64_t capacity = 0;
+  ORT_ENFORCE(TryParseStringWithClassicLocale<int64_t>(value, capacity) && capacity >= 0,
+              "Invalid memory pattern cache size: ", value);
+  return static_cast<size_t>(capacity);
+}
+
 SessionState::SessionState(Graph& graph,
                            const ExecutionProviders& execution_providers,
                            concurrency::ThreadPool* thread_pool,
@@ -75,6 +89,7 @@ SessionState::SessionState(Graph& graph,
       execution_providers_(execution_providers),
       logger_(logger),
       profiler_(profiler),
+      mem_pattern_cache_(GetMemoryPatternCacheCapacity(sess_options)),
       thread_pool_(thread_pool),
       inter_op_thread_pool_(inter_op_thread_pool),
       data_transfer_mgr_(data_transfer_mgr),
@@ -384,6 +399,102 @@ static Status KernelUseSharedPrePackedBuffers(OpKernel& kernel, int input_idx,
   return Status::OK();
 }
 
+static Status KernelUseCachedPrePackedBuffers(OpKernel& kernel, const Tensor& tensor, int input_idx,
+                                              const PrePackedWeights& prepacked_weights,
+                                              bool& used_cached_buffers) {
+  std::vector<BufferUniquePtr> cached_prepacked_buffers;
+  cached_prepacked_buffers.reserve(prepacked_weights.buffers_.size());
+
+  for (const auto& prepacked_buffer : prepacked_weights.buffers_) {
+    // BufferDeleter is nullptr because the buffer is owned by the file cache
+    cached_prepacked_buffers.emplace_back(prepacked_buffer.get(), BufferDeleter(nullptr));
+  }
+
+  return kernel.UseCachedPrePackedBuffers(tensor, cached_prepacked_buffers, input_idx, used_cached_buffers);
+}
+
+const Tensor* SessionState::GetConstantInitializedTensorFromThisOrOuterScope(const std::string& input_name) {
+  SessionState* st = this;
+  do {
+    int ort_value_idx;
+    if (st->GetOrtValueNameIdxMap().GetIdx(input_name, ort_value_idx).IsOK()) {
+      auto it = st->constant_initialized_tensors_.find(ort_value_idx);
+      if (it != st->constant_initialized_tensors_.end()) {
+        return &it->second.Get<Tensor>();
+      }
+
+      if (st != this || !st->graph_.IsOuterScopeValue(input_name)) {
+        break;
+      }
+    }
+    st = st->Parent();
+  } while (st);
+
+  return nullptr;
+}
+
+std::string SessionState::ComputePrepackedWeightsFileCacheNodeKey(const Node& node) {
+  // MurmurHash3 takes the length as an int, so large tensors are hashed in chunks and the chunk hashes are
+  // hashed again together with the rest of the node description.
+  constexpr size_t kMaxChunkSize = size_t{1} << 30;
+  std::string description;
+  auto append_hash = [&description](const void* data, size_t size) {
+    const char* bytes = static_cast<const char*>(data);
+    do {
+      const size_t chunk_size = std::min(size, kMaxChunkSize);
+      uint64_t hash[2] = {0, 0};
+      MurmurHash3::x86_128(bytes, narrow<int>(chunk_size), 0, hash);
+      description.append(reinterpret_cast<const char*>(hash), sizeof(hash));
+      bytes += chunk_size;
+      size -= chunk_size;
+    } while (size > 0);
+  };
+
+  description.append(MakeString(node.Domain(), ":", node.OpType(), ":", node.SinceVersion(), "\n"));
+
+  std::vector<std::string> attribute_names;
+  attribute_names.reserve(node.GetAttributes().size());
+  for (const auto& attribute : node.GetAttributes()) {
+    attribute_names.push_back(attribute.first);
+  }
+  std::sort(attribute_names.begin(), attribute_names.end());
+  for (const auto& attribute_name : attribute_names) {
+    const std::string serialized_attribute = node.GetAttributes().at(attribute_name).SerializeAsString();
+    description.append(attribute_name).append("=");
+    append_hash(serialized_attribute.data(), serialized_attribute.size());
+  }
+
+  for (const auto* input_def : node.InputDefs()) {
+    if (!input_def->Exists()) {
+      description.append("missing\n");
+      continue;
+    }
+
+    const Tensor* tensor = GetConstantInitializedTensorFromThisOrOuterScope(input_def->Name());
+    if (tensor == nullptr) {
+      description.append("input\n");
+      continue;
+    }
+
+    description.append(MakeString("constant:", tensor->GetElementType(), ":", tensor->Shape().ToString(), ":"));
+    if (tensor->IsDataTypeString()) {
+      for (const auto& str : tensor->DataAsSpan<std::string>()) {
+        append_hash(str.data(), str.size());
+      }
+    } else {
+      append_hash(tensor->DataRaw(), tensor->SizeInBytes());
+    }
+    description.append("\n");
+  }
+
+  uint64_t hash[2] = {0, 0};
+  MurmurHash3::x86_128(description.data(), narrow<int>(description.size()), 0, hash);
+
+  std::ostringstream ss;
+  ss << node.OpType() << "+" << std::hex << std::setfill('0') << std::setw(16) << hash[0] << std::setw(16) << hash[1];
+  return ss.str();
+}
+
 static std::string GenerateKeyForPrepackedWeightsMap(const std::string& op_type,
                                                      const PrePackedWeights& pre_packed_weights) {
   std::ostringstream ss_1;
@@ -400,6 +511,8 @@ Status SessionState::PrepackConstantInitializedTensors(InlinedHashMap<std::strin
                                         bool should_cache_prepacked_weights_for_shared_initializers) -> Status {
     for (auto& node : GetGraphViewer().Nodes()) {
       auto kernel = GetMutableKernel(node.Index());
+      // computed when first needed, before any input of the node is pre-packed
+      std::string file_cache_node_key;
       int input_idx = 0;
       for (auto& input_def : node.InputDefs()) {
         if (input_def->Exists()) {
@@ -476,6 +589,53 @@ Status SessionState::PrepackConstantInitializedTensors(InlinedHashMap<std::strin
                     }
                   }
 
+                } else if (prepacked_weights_file_cache_ != nullptr &&
+                           node.GetExecutionProviderType() == kCpuExecutionProvider) {  // persisting of pre-packed weights' turned ON
+                  if (file_cache_node_key.empty()) {
+                    file_cache_node_key = ComputePrepackedWeightsFileCacheNodeKey(node);
+                  }
+
+                  const std::string file_cache_key = MakeString(file_cache_node_key, "+", input_idx);
+                  AllocatorPtr session_cpu_alloc = GetAllocator(kernel->Info().GetDevice(OrtMemType::OrtMemTypeDefault));
+                  const PrePackedWeights* cached_weights = prepacked_weights_file_cache_->GetWeight(file_cache_key);
+
+                  if (cached_weights != nullptr) {
+                    ORT_RETURN_IF_ERROR(KernelUseCachedPrePackedBuffers(*kernel, const_initialized_tensor, input_idx,
+                                                                        *cached_weights, is_packed));
+                    if (is_packed) {
+                      LOGS(logger_, INFO) << "Using pre-packed weight from the file cache for constant initializer: "
+                                          << input_name << " used in the node: " << node.Name();
+                      ++used_cached_pre_packed_weights_counter_;
+                    } else {
+                      ORT_RETURN_IF_ERROR(kernel->PrePack(const_initialized_tensor, input_idx, session_cpu_alloc,
+                                                          is_packed, nullptr));
+                    }
+                  } else {
+                    PrePackedWeights weights_to_be_filled_in;
+                    ORT_RETURN_IF_ERROR(kernel->PrePack(const_initialized_tensor, input_idx, session_cpu_alloc,
+                                                        is_packed, &weights_to_be_filled_in));
+
+                    // Kernels that can't hand out their pre-packed weights keep them and are not cached.
+                    if (is_packed && !weights_to_be_filled_in.buffers_.empty()) {
+                      // Hand the buffers back the way a later session would receive them from the file. Kernels that
+                      // can only consume shared buffers get them that way, but their weights are not persisted.
+                      bool used_cached_buffers = false;
+                      ORT_RETURN_IF_ERROR(KernelUseCachedPrePackedBuffers(*kernel, const_initialized_tensor, input_idx,
+                                                                          weights_to_be_filled_in, used_cached_buffers));
+                      if (!used_cached_buffers) {
+                        ORT_RETURN_IF_ERROR(KernelUseSharedPrePackedBuffers(*kernel, input_idx, weights_to_be_filled_in,
+                                                                            node.Name()));
+                      }
+
+                      // The buffers don't move, so the kernel keeps pointing at them once the cache owns them.
+                      if (!prepacked_weights_file_cache_->WriteWeight(file_cache_key, std::move(weights_to_be_filled_in),
+                                                                      used_cached_buffers)) {
+                        return ORT_MAKE_STATUS(ONNXRUNTIME, FAIL,
+                                               "Unable to write the provided PrePackedWeights instance into the file cache");
+                      }
+                    }
+                  }
+
                 } else {  // caching of pre-packed weights' turned OFF
                   AllocatorPtr session_cpu_alloc = GetAllocator(kernel->Info().GetDevice(OrtMemType::OrtMemTypeDefault));
                   ORT_RETURN_IF_ERROR(kernel->PrePack(const_initialized_tensor, input_idx,
@@ -523,14 +683,6 @@ Status SessionState::PrepackConstantInitializedTensors(InlinedHashMap<std::strin
   }
 }
 
-static int64_t CalculateMemoryPatternsKey(const gsl::span<const OrtValue>& tensor_inputs) {
-  int64_t key = 0;
-  for (const auto& input : tensor_inputs) {
-    for (auto dim : input.Get<Tensor>().Shape().GetDims()) key ^= dim;
-  }
-  return key;
-}
-
 #ifdef ENABLE_TRAINING
 namespace {
 Status ResolveDimParams(const GraphViewer& graph,
@@ -765,38 +917,26 @@ Status SessionState::GeneratePatternGroupCache(gsl::span<const OrtValue> tensor_
 
 #endif
 
-// MemoryPatternGroup pointer is cached. It only inserted upon creation
-// and is not updated if already present.
-const MemoryPatternGroup* SessionState::GetMemoryPatternGroup(
+// The cache entry is only inserted upon creation and is not updated if already present.
+std::shared_ptr<const MemoryPatternCacheEntry> SessionState::GetMemoryPatternGroup(
     gsl::span<const OrtValue> tensor_inputs,
-    gsl::span<const int> feed_mlvalue_idxs,
-    const InlinedHashMap<int, TensorShape>*& out_inferred_shapes) const {
-  out_inferred_shapes = nullptr;
-  int64_t key = CalculateMemoryPatternsKey(tensor_inputs);
-  std::lock_guard<OrtMutex> lock(mem_patterns_lock_);
-  auto it = mem_patterns_.find(key);
-  if (it == mem_patterns_.end()) {
+    gsl::span<const int> feed_mlvalue_idxs) const {
+  const auto key = MemoryPatternCache::MakeKey(tensor_inputs);
+  auto entry = mem_pattern_cache_.Find(key);
+  if (!entry) {
 #ifdef ENABLE_TRAINING
-    MemoryPatternGroup mem_patterns;
-    InlinedHashMap<int, TensorShape> inferred_shapes;
-    if (GeneratePatternGroupCache(tensor_inputs, feed_mlvalue_idxs, mem_patterns, inferred_shapes).IsOK()) {
-      auto patt_insert = mem_patterns_.insert_or_assign(key, std::move(mem_patterns));
-      auto ptr = &patt_insert.first->second;
-      auto shape_insert = shape_patterns_.insert_or_assign(key, std::move(inferred_shapes));
-      out_inferred_shapes = &shape_insert.first->second;
-      return ptr;
+    MemoryPatternCacheEntry new_entry;
+    if (GeneratePatternGroupCache(tensor_inputs, feed_mlvalue_idxs,
+                                  new_entry.mem_patterns, new_entry.resolved_shapes)
+            .IsOK()) {
+      entry = mem_pattern_cache_.Insert(key, std::move(new_entry));
     }
 #else
     ORT_UNUSED_PARAMETER(feed_mlvalue_idxs);
 #endif
-    return nullptr;
   }
 
-  auto patt_hit = shape_patterns_.find(key);
-  if (patt_hit != shape_patterns_.cend()) {
-    out_inferred_shapes = &patt_hit->second;
-  }
-  return &it->second;
+  return entry;
 }
 
 void SessionState::ResolveMemoryPatternFlag() {
@@ -847,11 +987,10 @@ void SessionState::ResolveMemoryPatternFlag() {
 
 Status SessionState::UpdateMemoryPatternGroupCache(gsl::span<const OrtValue> tensor_inputs,
                                                    MemoryPatternGroup mem_patterns) const {
-  int64_t key = CalculateMemoryPatternsKey(tensor_inputs);
-
-  std::lock_guard<OrtMutex> lock(mem_patterns_lock_);
-  // Do not update if present, as the pointer to the existing one is cached
-  mem_patterns_.emplace(key, std::move(mem_patterns));
+  MemoryPatternCacheEntry entry;
+  entry.mem_patterns = std::move(mem_patterns);
+  // Does not update if present, as execution frames may be using the existing entry
+  mem_pattern_cache_.Insert(MemoryPatternCache::MakeKey(tensor_inputs), std::move(entry));
   return Status::OK();
 }
 
@@ -1048,6 +1187,8 @@ Status SessionState::CreateSubgraphSessionState() {
                                          thread_pool_, inter_op_thread_pool_, data_transfer_mgr_,
                                          logger_, profiler_, sess_options_,
                                          prepacked_weights_container_, allocators_);
+      subgraph_session_state->prepacked_weights_file_cache_ = prepacked_weights_file_cache_;
+      subgraph_session_state->session_metrics_ = session_metrics_;
 
       // Pass fused function manager to subgraph
       subgraph_session_state->fused_funcs_mgr_.SetFusedFuncs(fused_funcs_mgr_);
@@ -1327,6 +1468,11 @@ Status SessionState::FinalizeSessionStateImpl(const std::basic_string<PATH_CHAR_
     CreateGraphInfo();
   }
 
+  if (session_metrics_ != nullptr) {
+    session_metrics_node_offset_ = session_metrics_->RegisterGraph(
+        *graph_viewer_, parent_node != nullptr ? parent_node->Name() + "/" : std::string{});
+  }
+
 #if defined(ORT_EXTENDED_MINIMAL_BUILD)
   // Remove any unused initializers.
   // Not needed in a full build because unused initializers should have been removed earlier by Graph::Resolve().
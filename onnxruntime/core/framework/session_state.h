@@ -25,9 +25,12 @@
 #include "core/framework/feeds_fetches_manager.h"
 #include "core/framework/framework_common.h"
 #include "core/framework/prepacked_weights_container.h"
+#include "core/framework/prepacked_weights_file_cache.h"
+#include "core/framework/session_metrics.h"
 #include "core/framework/fuse_nodes_funcs.h"
 #include "core/framework/kernel_registry_manager.h"
 #include "core/framework/mem_pattern.h"
+#include "core/framework/mem_pattern_cache.h"
 #include "core/framework/ort_value.h"
 #include "core/framework/node_index_info.h"
 #include "core/framework/op_kernel.h"
@@ -204,6 +207,18 @@ class SessionState {
   */
   profiling::Profiler& Profiler() const noexcept { return profiler_; }
 
+  /**
+  Get the metrics of the session, or nullptr if they are not enabled.
+  Nodes of this graph are recorded at GetSessionMetricsNodeOffset() + node index.
+  */
+  SessionMetrics* GetSessionMetrics() const noexcept { return session_metrics_; }
+  size_t GetSessionMetricsNodeOffset() const noexcept { return session_metrics_node_offset_; }
+
+  // Must be called before FinalizeSessionState so that it is passed on to the subgraph session states.
+  void SetSessionMetrics(SessionMetrics* session_metrics) noexcept {
+    session_metrics_ = session_metrics;
+  }
+
 #if !defined(ORT_MINIMAL_BUILD) && defined(ORT_MEMORY_PROFILE)
   MemoryProfiler* GetMemoryProfiler() const noexcept { return memory_profiler_; }
 
@@ -213,18 +228,14 @@ class SessionState {
 #endif
 
   /**
-  Get cached memory pattern based on input shapes
-  Must be called only when all values contain tensors
-  In training scenarios, the cache may be updated so
-  the callers would receive a copy of inferred shapes
-  made under mutex being held. In inference scenarios,
-  it is not mutable, we do not obtain a lock and simply get a pointer
-  w/o copying a hashtable
+  Get the cached memory pattern for the exact input shapes.
+  Must be called only when all values contain tensors.
+  Returns nullptr if nothing is cached for these shapes. The returned entry stays valid
+  for as long as the caller holds it, even if it is evicted from the cache meanwhile.
   */
-  const MemoryPatternGroup* GetMemoryPatternGroup(
+  std::shared_ptr<const MemoryPatternCacheEntry> GetMemoryPatternGroup(
       gsl::span<const OrtValue> tensor_inputs,
-      gsl::span<const int> feed_mlvalue_idxs,
-      const InlinedHashMap<int, TensorShape>*& inferred_shapes) const;
+      gsl::span<const int> feed_mlvalue_idxs) const;
 
   /**
   Set generated memory pattern with a given input shapes.
@@ -329,6 +340,16 @@ class SessionState {
     return used_shared_pre_packed_weights_counter_;
   }
 
+  size_t GetUsedCachedPrePackedWeightCounter() const {
+    return used_cached_pre_packed_weights_counter_;
+  }
+
+  // Set the file cache to read pre-packed weights from and write them to. Must be called before
+  // FinalizeSessionState() so that it is passed on to the subgraph session states.
+  void SetPrepackedWeightsFileCache(PrepackedWeightsFileCache* prepacked_weights_file_cache) {
+    prepacked_weights_file_cache_ = prepacked_weights_file_cache;
+  }
+
   const KernelCreateInfoMap& GetKernelCreateInfoMap() const {
     return kernel_create_info_map_;
   }
@@ -380,6 +401,14 @@ class SessionState {
   Status PrepackConstantInitializedTensors(InlinedHashMap<std::string, size_t>& constant_initializers_use_count,
                                            const std::unordered_map<std::string, const OrtValue*>& initializers_to_share_map);
 
+  // Returns the constant initialized tensor named input_name from this or an outer scope, or nullptr if there is none.
+  const Tensor* GetConstantInitializedTensorFromThisOrOuterScope(const std::string& input_name);
+
+  // Computes the part of the pre-packed weights file cache key that identifies a node. It covers everything
+  // PrePack() can depend on: the op, its attributes and the constant inputs. Must be called before any input of
+  // the node is pre-packed as the constant initialized tensors may be released afterwards.
+  std::string ComputePrepackedWeightsFileCacheNodeKey(const Node& node);
+
   SessionState* GetMutableSubgraphSessionState(onnxruntime::NodeIndex index, const std::string& attribute_name);
 
   Status CreateSubgraphSessionState();
@@ -482,6 +511,10 @@ class SessionState {
   const logging::Logger& logger_;
   profiling::Profiler& profiler_;
 
+  // Owned by the InferenceSession. nullptr unless enabled with kOrtSessionOptionsEnableMetrics.
+  SessionMetrics* session_metrics_{nullptr};
+  size_t session_metrics_node_offset_{0};
+
 #if !defined(ORT_MINIMAL_BUILD) && defined(ORT_MEMORY_PROFILE)
   MemoryProfiler* memory_profiler_;
 #endif
@@ -489,18 +522,9 @@ class SessionState {
   // switch for enable memory pattern optimization or not.
   bool enable_mem_pattern_;
 
-  // lock for the mem_patterns_
-  mutable OrtMutex mem_patterns_lock_;
-  // cache for the generated mem_patterns. key is calculated based on input shapes.
-  // must be a node based container as a pointer is cached.
-  mutable NodeHashMap<int64_t, MemoryPatternGroup> mem_patterns_;
-  // This is mutable under mutex in training scenarios so execution frame would make a copy
-  // of the value when created.
-#ifdef ENABLE_TRAINING
-  mutable NodeHashMap<int64_t, InlinedHashMap<int, TensorShape>> shape_patterns_;
-#else
-  NodeHashMap<int64_t, InlinedHashMap<int, TensorShape>> shape_patterns_;
-#endif
+  // LRU cache of the generated memory patterns, keyed on the input shapes.
+  // The capacity is set by kOrtSessionOptionsMemoryPatternCacheSize.
+  mutable MemoryPatternCache mem_pattern_cache_;
 
   NameNodeInfoMapType input_names_to_nodeinfo_mapping_;
   NameNodeInfoMapType output_names_to_nodeinfo_mapping_;
@@ -523,6 +547,10 @@ class SessionState {
   // prepacked_weights_container_ can be nullptr if no caching is required for prepacked weights
   PrepackedWeightsContainer* const prepacked_weights_container_{};
 
+  // File cache to persist pre-packed weights across sessions and processes. Owned by the InferenceSession.
+  // prepacked_weights_file_cache_ can be nullptr if pre-packed weights are not persisted
+  PrepackedWeightsFileCache* prepacked_weights_file_cache_{};
+
 #ifdef ENABLE_TRAINING
 // Needed for ORTTrainer. Should be removed along with ORTTrainer code
 #ifndef DISABLE_ABSEIL
@@ -553,6 +581,9 @@ class SessionState {
   // a constant initialized weight was used by the session state
   size_t used_shared_pre_packed_weights_counter_ = 0;
 
+  // Counter for number of times a pre-packed weight read from the file cache was used by the session state
+  size_t used_cached_pre_packed_weights_counter_ = 0;
+
 #ifdef DEBUG_NODE_INPUTS_OUTPUTS
   // Counter for number of times the session graph has been executed
   size_t graph_executions_counter_ = 0;
@@ -299,6 +299,12 @@ common::Status SaveInitializedTensors(
     return retval;
   };
 
+  // DeserializeTensorProto uses the external data of initializers used on CPU in place in the mapping of the data
+  // file, and never writes it to a planned buffer, so such initializers are not traced and don't get one.
+  auto is_mapped = [&exec_plan](int ort_value_index, const ONNX_NAMESPACE::TensorProto& tensor_proto) {
+    return utils::HasExternalData(tensor_proto) && exec_plan.GetLocation(ort_value_index).Type() == OrtDevice::CPU;
+  };
+
   // 1. first plan the memory
   const InitializedTensorSet& initialized_tensor_set = graph.GetAllInitializedTensors();
   InlinedHashMap<int, const ONNX_NAMESPACE::TensorProto*> id_to_initialized_tensor;
@@ -338,6 +344,10 @@ common::Status SaveInitializedTensors(
     if (user_supplied_initializer_ids.find(entry.first) != user_supplied_initializer_ids.end()) {
       continue;
     }
+    // Nor initializers that stay in the mapped external data file
+    if (is_mapped(entry.first, *entry.second)) {
+      continue;
+    }
     if (entry.second->data_type() == ONNX_NAMESPACE::TensorProto_DataType_STRING) {
       // do not trace string tensor
       continue;
@@ -381,8 +391,13 @@ common::Status SaveInitializedTensors(
 
       std::optional<MemBuffer> m;
       AllocatorPtr alloc;
-      // TODO: if the tensor need be copied, does it have enough room?
-      ORT_RETURN_IF_ERROR(planner.GetPreallocatedBuffer(ort_value_index, name, m, alloc));
+      if (is_mapped(ort_value_index, tensor_proto)) {
+        // only used to create the empty tensor that is pointed at the mapped data
+        alloc = default_cpu_alloc;
+      } else {
+        // TODO: if the tensor need be copied, does it have enough room?
+        ORT_RETURN_IF_ERROR(planner.GetPreallocatedBuffer(ort_value_index, name, m, alloc));
+      }
       bool use_device_allocator_for_initializers =
           session_options.config_options.GetConfigOrDefault(kOrtSessionOptionsUseDeviceAllocatorForInitializers, "0") == "1";
 
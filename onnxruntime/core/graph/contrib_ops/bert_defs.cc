@@ -277,11 +277,16 @@ void BaseGroupQueryAttentionTypeAndShapeInference(ONNX_NAMESPACE::InferenceConte
   }
 
   if (ctx.getNumOutputs() > 1) {  // has present output
-    // copy the type from query to present key
-    ONNX_NAMESPACE::propagateElemTypeFromInputToOutput(ctx, 0, 1);
-
-    // copy the type from query to present value
-    ONNX_NAMESPACE::propagateElemTypeFromInputToOutput(ctx, 0, 2);
+    // copy the type from past key and value to present key and value, since a quantized kv cache has a different
+    // type than query, or else from query
+    if (past_key_index >= 0 && static_cast<size_t>(past_key_index) + 1 < ctx.getNumInputs() &&
+        ctx.getInputType(past_key_index) != nullptr && ctx.getInputType(past_key_index + 1) != nullptr) {
+      ONNX_NAMESPACE::propagateElemTypeFromInputToOutput(ctx, past_key_index, 1);
+      ONNX_NAMESPACE::propagateElemTypeFromInputToOutput(ctx, static_cast<size_t>(past_key_index) + 1, 2);
+    } else {
+      ONNX_NAMESPACE::propagateElemTypeFromInputToOutput(ctx, 0, 1);
+      ONNX_NAMESPACE::propagateElemTypeFromInputToOutput(ctx, 0, 2);
+    }
 
     if (past_key_index >= 0 && hasInputShape(ctx, past_key_index)) {
       auto& past_shape = getInputShape(ctx, past_key_index);
@@ -320,6 +325,11 @@ void GroupQueryAttentionTypeAndShapeInference(ONNX_NAMESPACE::InferenceContext&
   // TODO(aciddelgado): propagate output shapes depending if kv-share buffer is on or not
   constexpr int use_max_past_present_buffer = -1;
   BaseGroupQueryAttentionTypeAndShapeInference(ctx, past_key_index, use_max_past_present_buffer);
+
+  // present_key_scale and present_value_scale of an int8 kv cache
+  for (size_t output_index = 3; output_index < ctx.getNumOutputs(); output_index++) {
+    updateOutputElemType(ctx, output_index, ONNX_NAMESPACE::TensorProto::FLOAT);
+  }
 }
 
 void SparseAttentionTypeAndShapeInference(ONNX_NAMESPACE::InferenceContext& ctx, int past_key_index) {
@@ -1049,6 +1059,15 @@ Supports different number of heads for q and kv for CPU and CUDA.
 Only supports causal and local attention.
 Supports rotary position embedding for CPU and CUDA.
 Supports packed input for CPU and CUDA.
+Supports a paged k-v cache for CPU: when block_table is given, past_key and past_value are pools of fixed-size blocks
+shared by all sequences of the batch, and block_table maps the blocks of each sequence to blocks of the pools.
+The new keys and values are written to their blocks in present_key and present_value, which have the shape of the
+pools and must share their buffers through IOBinding. seqlens_k holds the total sequence length - 1 of each sequence.
+When sequence_length is less than total_sequence_length, the new tokens follow the cached tokens of each sequence,
+so a prompt may continue a cached prefix; only the first prompt of a sequence may be right-padded.
+Supports a float16 or int8 k-v cache with float inputs for CPU. An int8 k-v cache holds each head of each token
+quantized with its own scale, which is kept in past_key_scale and past_value_scale and written for the new tokens to
+present_key_scale and present_value_scale. past_key and past_value are needed to infer the type of the cache.
 )DOC";
 
 ONNX_MS_OPERATOR_SET_SCHEMA(
@@ -1096,13 +1115,13 @@ ONNX_MS_OPERATOR_SET_SCHEMA(
                "past_key",
                "past state key with support for format BNSH. When past_key uses same tensor as present_key"
                "(k-v cache), it is of length max_sequence_length... otherwise of length past_sequence_length.",
-               "T",
+               "T_CACHE",
                OpSchema::Optional)
         .Input(4,
                "past_value",
                "past state value with support for format BNSH. When past_value uses same tensor as present_value"
                "(k-v cache), it is of length max_sequence_length... otherwise of length past_sequence_length.",
-               "T",
+               "T_CACHE",
                OpSchema::Optional)
         .Input(5,
                "seqlens_k",
@@ -1123,6 +1142,25 @@ ONNX_MS_OPERATOR_SET_SCHEMA(
                "2D tensor with shape (max_sequence_length, head_size / 2).",
                "T",
                OpSchema::Optional)
+        .Input(9,
+               "block_table",
+               "2D tensor with shape (batch_size, max_blocks_per_sequence) holding the indices of the blocks of each "
+               "sequence in the paged k-v cache. past_key and past_value then have shape "
+               "(num_blocks, kv_num_heads, block_size, head_size).",
+               "M",
+               OpSchema::Optional)
+        .Input(10,
+               "past_key_scale",
+               "Scales of an int8 past_key with shape (batch_size, kv_num_heads, past_key.shape[2]), one for each "
+               "head of each token.",
+               "tensor(float)",
+               OpSchema::Optional)
+        .Input(11,
+               "past_value_scale",
+               "Scales of an int8 past_value with shape (batch_size, kv_num_heads, past_value.shape[2]), one for "
+               "each head of each token.",
+               "tensor(float)",
+               OpSchema::Optional)
         .Output(0,
                 "output",
                 "3D output tensor with shape (batch_size, sequence_length, hidden_size)",
@@ -1132,14 +1170,27 @@ ONNX_MS_OPERATOR_SET_SCHEMA(
                 "present state key with support for format BNSH. When past_key uses same tensor as present_key"
                 "(k-v buffer), it is of length max_sequence_length... otherwise of length past_sequence_length +"
                 "kv_sequence_length.",
-                "T")
+                "T_CACHE")
         .Output(2,
                 "present_value",
                 "present state value with support for format BNSH. When past_value uses same tensor as present_value"
                 "(k-v buffer), it is of length max_sequence_length... otherwise of length past_sequence_length +"
                 "kv_sequence_length.",
-                "T")
+                "T_CACHE")
+        .Output(3,
+                "present_key_scale",
+                "Scales of an int8 present_key with shape (batch_size, kv_num_heads, present_key.shape[2]).",
+                "tensor(float)",
+                OpSchema::Optional)
+        .Output(4,
+                "present_value_scale",
+                "Scales of an int8 present_value with shape (batch_size, kv_num_heads, present_value.shape[2]).",
+                "tensor(float)",
+                OpSchema::Optional)
         .TypeConstraint("T", {"tensor(float16)", "tensor(bfloat16)", "tensor(float)"}, "Constrain input and output to float tensors.")
+        .TypeConstraint("T_CACHE", {"tensor(float16)", "tensor(bfloat16)", "tensor(float)", "tensor(int8)"},
+                        "Constrain the k-v cache to float or int8 tensors. It is the same type as T unless the k-v "
+                        "cache is quantized.")
         .TypeConstraint("M", {"tensor(int32)"}, "Constrain mask to int tensor.")
         .TypeAndShapeInferenceFunction([](ONNX_NAMESPACE::InferenceContext& ctx) {
           GroupQueryAttentionTypeAndShapeInference(ctx, 3);
@@ -631,6 +631,42 @@ ONNX_MS_OPERATOR_SET_SCHEMA(
           return true;
         }));
 
+constexpr const char* FusedElementwise_ver1_doc = R"DOC(
+Evaluates a group of element-wise operators in a single pass over memory. It is created by the ElementwiseChainFusion
+graph transformer, enabled by the session config entry optimization.enable_elementwise_chain_fusion, from
+nodes such as Add->Mul->Sigmoid->Mul, and is not meant to be used in a model directly.
+
+The attribute `ops` lists the operators in evaluation order. The attribute `operands` holds two operand indices per
+operator. An index below the number of inputs refers to that input, index `input_count + i` refers to the result of
+the i-th operator, and -1 marks the missing second operand of a unary operator. The output is the result of the last
+operator.
+
+The supported operators are Add, Sub, Mul, Div, Sigmoid, Tanh, Exp, Erf, Relu, Neg, Abs and Sqrt. Every input must
+either have the shape of the output or be broadcast to it along leading dimensions only, which includes scalars.
+)DOC";
+
+ONNX_MS_OPERATOR_SET_SCHEMA(
+    FusedElementwise, 1,
+    OpSchema()
+        .SetDoc(FusedElementwise_ver1_doc)
+        .Attr("ops", "The element-wise operators in evaluation order.", AttributeProto::STRINGS)
+        .Attr("operands", "Two operand indices per operator, see the operator description.", AttributeProto::INTS)
+        .Input(0, "inputs", "The operands read by the operators.", "T", OpSchema::Variadic)
+        .Output(0, "Y", "The result of the last operator.", "T")
+        .TypeConstraint("T", {"tensor(float)"}, "Constrain input and output types to float tensors.")
+        .TypeAndShapeInferenceFunction([](ONNX_NAMESPACE::InferenceContext& ctx) {
+          propagateElemTypeFromInputToOutput(ctx, 0, 0);
+          const size_t input_count = ctx.getNumInputs();
+          if (hasNInputShapes(ctx, static_cast<int>(input_count))) {
+            std::vector<const TensorShapeProto*> shapes;
+            for (size_t i = 0; i < input_count; ++i) {
+              shapes.push_back(&ctx.getInputType(i)->tensor_type().shape());
+            }
+            multidirectionalBroadcastShapeInference(
+                shapes, *ctx.getOutputType(0)->mutable_tensor_type()->mutable_shape());
+          }
+        }));
+
 // Used to be ONNX 1.7 Inverse(12)
 // Comment out docs not to increase the binary size
 //
@@ -1321,10 +1357,25 @@ ONNX_MS_OPERATOR_SET_SCHEMA(GreedySearch, 1,
                                       "This is relevant only for the GPT2 model. If this attribute is missing, the `decoder` subgraph will be used for all decoding runs",
                                       AttributeProto::GRAPH, OPTIONAL_VALUE)
                                 .Attr("decoder", "Decoder subgraph to execute in a loop.", AttributeProto::GRAPH)
+                                .Attr("draft_decoder",
+                                      "A smaller decoder subgraph with the inputs and outputs of `decoder`, used for speculative decoding. "
+                                      "In each step it proposes up to `num_speculative_tokens` tokens, which `decoder` verifies in one run. "
+                                      "The generated sequences are the same as without it. Only supported for GPT2 on CPU.",
+                                      AttributeProto::GRAPH, OPTIONAL_VALUE)
+                                .Attr("num_speculative_tokens",
+                                      "The maximum number of tokens proposed by `draft_decoder` in each step.",
+                                      AttributeProto::INT, static_cast<int64_t>(4))
                                 .Attr("vocab_size",
                                       "Size of the vocabulary. "
                                       "If not provided, it will be inferred from the decoder subgraph's output shape",
                                       AttributeProto::INT, static_cast<int64_t>(-1))
+                                .Attr("max_active_batch_size",
+                                      "Maximum number of sequences decoded together in one decoder run. "
+                                      "When it is positive, finished sequences leave the batch and sequences waiting in input_ids join it "
+                                      "after their prompt is processed, so each run only computes the unfinished sequences. "
+                                      "Only supported on CPU, without past_present_share_buffer, prefix_vocab_mask or presence_mask. "
+                                      "Default value 0 means that all sequences are decoded together until all are finished.",
+                                      AttributeProto::INT, static_cast<int64_t>(0))
                                 .Input(0, "input_ids", "The sequence used as a prompt for the generation. Shape is (batch_size, sequence_length)", "I")
                                 .Input(1, "max_length", "The maximum length of the sequence to be generated. Shape is (1)", "I")
                                 .Input(2, "min_length", "The minimum length below which the score of eos_token_id is set to -Inf. Shape is (1)", "I", OpSchema::Optional)
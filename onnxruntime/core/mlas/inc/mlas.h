@@ -1243,6 +1243,45 @@ MlasQuantizeLinearS4(
     int8_t ZeroPoint
     );
 
+/**
+ * @brief Quantizes each row of the input to int8 with a symmetric scale of
+ *        max(abs(row)) / 127, as used for an int8 key/value cache.
+ *
+ * @param Input         Input rows with shape Rows x RowLength
+ * @param Output        Quantized rows with shape Rows x RowLength
+ * @param Scales        Returns the scale of each row
+ * @param Rows          Number of rows
+ * @param RowLength     Number of elements of each row
+*/
+void
+MLASCALL
+MlasQuantizeRowsS8(
+    const float* Input,
+    int8_t* Output,
+    float* Scales,
+    size_t Rows,
+    size_t RowLength
+    );
+
+/**
+ * @brief Dequantizes int8 rows quantized by MlasQuantizeRowsS8.
+ *
+ * @param Input         Quantized rows with shape Rows x RowLength
+ * @param Scales        Scale of each row
+ * @param Output        Output rows with shape Rows x RowLength
+ * @param Rows          Number of rows
+ * @param RowLength     Number of elements of each row
+*/
+void
+MLASCALL
+MlasDequantizeRowsS8(
+    const int8_t* Input,
+    const float* Scales,
+    float* Output,
+    size_t Rows,
+    size_t RowLength
+    );
+
 /**
  * @brief Requantize a block of the intermediate buffer to the output buffer,
  *        optionally adding the supplied bias
@@ -1846,10 +1885,34 @@ struct MlasFlashAttentionThreadedArgs {
     const float* key;
     const float* value;
     float* output;
+    //
+    // Optional arguments for attention over a kv cache. key and value have kv_sequence_length tokens per head,
+    // of which only the first kv_sequence_lengths[batch] are attended to.
+    //
+    int kv_num_heads = 0;                          // number of heads of key and value, 0 means num_heads
+    const int32_t* kv_sequence_lengths = nullptr;  // valid tokens of key and value per batch, nullptr means all
+    bool is_causal = false;                        // causal masking aligned to the last valid token, see below
+    size_t q_batch_stride = 0;                     // elements between batches of query, 0 means packed
+    //
+    // Optional split of the kv sequence of each query block into kv_split_count chunks that are processed by
+    // different threads, for when there are fewer query blocks than threads, e.g. when decoding a single token.
+    // split_buffer holds the partial results: (batch_size * num_heads * q_sequence_length * kv_split_count *
+    // (v_head_size + 2)) floats.
+    //
+    int kv_split_count = 1;
+    float* split_buffer = nullptr;
 };
 
 /**
  * @brief Per-thread worker function for fp32 Flash Attention
+ *
+ * query is (batch_size, num_heads, q_sequence_length, qk_head_size), key and value are
+ * (batch_size, kv_num_heads, kv_sequence_length, qk_head_size or v_head_size) and output is
+ * (batch_size, q_sequence_length, num_heads, v_head_size). Query head h attends to key and value head
+ * h / (num_heads / kv_num_heads). With is_causal, query token i of a batch with L valid key and value tokens
+ * attends to the tokens j <= i + max(L - q_sequence_length, 0), i.e. the last query token is aligned with the
+ * last valid token, or the first query token with the first token when there are fewer valid tokens than queries.
+ *
  * @param thread_id    Thread index
  * @param args         Arguments
  * @return
@@ -1,7 +1,26 @@
+#include <algorithm>
 #include <numeric>
 
 #include "mlasi.h"
 
+//
+// With a split kv sequence, each task writes the partial result of its chunk for each query row as m, l and the
+// unnormalized output, which MlasFlashAttentionMergeThreaded combines into the output.
+//
+
+static
+inline
+float*
+MlasFlashAttentionPartial(
+    const MlasFlashAttentionThreadedArgs* args,
+    ptrdiff_t row_index,
+    ptrdiff_t split_idx
+)
+{
+    return args->split_buffer +
+           (row_index * args->kv_split_count + split_idx) * (static_cast<ptrdiff_t>(args->v_head_size) + 2);
+}
+
 void
 MlasFlashAttentionThreaded(
     void* argptr,
@@ -24,6 +43,12 @@ MlasFlashAttentionThreaded(
     const float* key = args->key;
     const float* value = args->value;
     float* output = args->output;
+    ptrdiff_t kv_num_heads = args->kv_num_heads > 0 ? static_cast<ptrdiff_t>(args->kv_num_heads) : num_heads;
+    ptrdiff_t kv_num_heads_factor = num_heads / kv_num_heads;
+    ptrdiff_t q_batch_stride = args->q_batch_stride > 0 ? static_cast<ptrdiff_t>(args->q_batch_stride)
+                                                        : num_heads * q_sequence_length * qk_head_size;
+    const bool is_causal = args->is_causal;
+    ptrdiff_t kv_split_count = std::max(static_cast<ptrdiff_t>(args->kv_split_count), ptrdiff_t{1});
 
 #if defined(MLAS_TARGET_AMD64) || defined(MLAS_TARGET_LARCH64)
     auto&& mlas_platform = GetMlasPlatform();
@@ -33,7 +58,7 @@ MlasFlashAttentionThreaded(
 
     ptrdiff_t task_start = 0;
     ptrdiff_t task_end = 0;
-    ptrdiff_t total_task_count = batch_size * num_heads * q_chunk_count;
+    ptrdiff_t total_task_count = batch_size * num_heads * q_chunk_count * kv_split_count;
     ptrdiff_t quotient = total_task_count / thread_count;
     ptrdiff_t remainder = total_task_count % thread_count;
     if (thread_id < remainder) {
@@ -46,6 +71,8 @@ MlasFlashAttentionThreaded(
 
     for (ptrdiff_t task_index = task_start; task_index < task_end; ++task_index) {
         ptrdiff_t batch_idx = task_index;
+        ptrdiff_t split_idx = batch_idx % kv_split_count;
+        batch_idx /= kv_split_count;
         ptrdiff_t q_idx = (batch_idx % q_chunk_count) * q_block_size;
         batch_idx /= q_chunk_count;
         ptrdiff_t head_idx = batch_idx % num_heads;
@@ -55,13 +82,52 @@ MlasFlashAttentionThreaded(
         float* l = reinterpret_cast<float*>(buffer_current_thread);
         float* m = l + q_block_size;
         for (ptrdiff_t t = 0; t < q_block_size; ++t) {
+            l[t] = 0.0f;
             m[t] = std::numeric_limits<float>::lowest();
         }
         float* intermediate = m + q_block_size;
         float* temp_output = intermediate + q_block_size * kv_block_size;
         float negmax = 0;
 
-        for (ptrdiff_t ir = 0; ir < kv_sequence_length; ir += kv_block_size) {
+        ptrdiff_t row_size_q_valid = std::min(q_block_size, q_sequence_length - q_idx);
+        float* output_row = output + ((batch_idx * q_sequence_length + q_idx) * num_heads + head_idx) * v_head_size;
+
+        // The valid tokens of key and value for this batch, and for causal masking, the offset between the
+        // positions of the query tokens and the positions of the last key and value tokens they attend to.
+        ptrdiff_t kv_valid_length = args->kv_sequence_lengths != nullptr
+                                        ? std::min(static_cast<ptrdiff_t>(args->kv_sequence_lengths[batch_idx]), kv_sequence_length)
+                                        : kv_sequence_length;
+        ptrdiff_t causal_offset = std::max(kv_valid_length - q_sequence_length, ptrdiff_t{0});
+        ptrdiff_t kv_end = is_causal ? std::min(kv_valid_length, causal_offset + q_idx + row_size_q_valid)
+                                     : kv_valid_length;
+
+        // With a split kv sequence, the task attends to its chunk of the tokens.
+        ptrdiff_t kv_start = 0;
+        if (kv_split_count > 1) {
+            ptrdiff_t chunk_size = std::max((kv_end + kv_split_count - 1) / kv_split_count, ptrdiff_t{0});
+            kv_start = std::min(split_idx * chunk_size, kv_end);
+            kv_end = std::min(kv_start + chunk_size, kv_end);
+        }
+        ptrdiff_t row_index = (batch_idx * num_heads + head_idx) * q_sequence_length + q_idx;
+
+        if (kv_end <= kv_start) {
+            for (ptrdiff_t irow = 0; irow < row_size_q_valid; ++irow) {
+                if (kv_split_count > 1) {
+                    float* partial = MlasFlashAttentionPartial(args, row_index + irow, split_idx);
+                    partial[0] = std::numeric_limits<float>::lowest();
+                    std::fill_n(partial + 1, v_head_size + 1, 0.0f);
+                } else {
+                    std::fill_n(output_row, v_head_size, 0.0f);
+                    output_row += num_heads * v_head_size;
+                }
+            }
+            continue;
+        }
+
+        const float* inputQ = query + batch_idx * q_batch_stride + (head_idx * q_sequence_length + q_idx) * qk_head_size;
+        ptrdiff_t h_kv = batch_idx * kv_num_heads + head_idx / kv_num_heads_factor;
+
+        for (ptrdiff_t ir = kv_start; ir < kv_end; ir += kv_block_size) {
             /*
                 S = Q[batch_idx, head_idx, q_idx:q_idx+q_block_size, :] * (K[batch_idx, head_idx, ir:ir+kv_block_size, :]).T
                 old_m = m
@@ -71,13 +137,11 @@ MlasFlashAttentionThreaded(
                 l = exp(diff) * l + rowsum(S)
                 O = diag(exp(diff)) * O + S * V[batch_idx, head_idx, ir:ir+kv_block_size, :]
             */
-            ptrdiff_t h = batch_idx * num_heads + head_idx;
-            const float* inputQ = query + (h * q_sequence_length + q_idx) * qk_head_size;
-            const float* inputK = key + (h * kv_sequence_length + ir) * qk_head_size;
-            const float* inputV = value + (h * kv_sequence_length + ir) * v_head_size;
+            const float* inputK = key + (h_kv * kv_sequence_length + ir) * qk_head_size;
+            const float* inputV = value + (h_kv * kv_sequence_length + ir) * v_head_size;
 
-            size_t row_size_q_capped = static_cast<size_t>(std::min(q_block_size, q_sequence_length - q_idx));
-            size_t row_size_kv_capped = static_cast<size_t>(std::min(kv_block_size, kv_sequence_length - ir));
+            size_t row_size_q_capped = static_cast<size_t>(row_size_q_valid);
+            size_t row_size_kv_capped = static_cast<size_t>(std::min(kv_block_size, kv_end - ir));
 
             MlasSgemmOperation(CBLAS_TRANSPOSE::CblasNoTrans,
                      CBLAS_TRANSPOSE::CblasTrans,
@@ -96,10 +160,22 @@ MlasFlashAttentionThreaded(
             for (ptrdiff_t irow = 0; irow < static_cast<ptrdiff_t>(row_size_q_capped); ++irow) {
                 float* p = intermediate + irow * row_size_kv_capped;
 
+                // The causal mask hides a suffix of the row. A row without valid scores keeps l = 0, and its
+                // output stays 0 since the masked scores are 0.
+                size_t row_size_kv_valid = row_size_kv_capped;
+                if (is_causal) {
+                    ptrdiff_t visible = causal_offset + q_idx + irow + 1 - ir;
+                    row_size_kv_valid = static_cast<size_t>(std::clamp(visible, ptrdiff_t{0}, static_cast<ptrdiff_t>(row_size_kv_capped)));
+                    std::fill(p + row_size_kv_valid, p + row_size_kv_capped, 0.0f);
+                    if (row_size_kv_valid == 0) {
+                        continue;
+                    }
+                }
+
 #if defined(MLAS_TARGET_AMD64) || defined(MLAS_TARGET_LARCH64)
-                float rowmax = mlas_platform.ReduceMaximumF32Kernel(p, row_size_kv_capped);
+                float rowmax = mlas_platform.ReduceMaximumF32Kernel(p, row_size_kv_valid);
 #else
-                float rowmax = MlasReduceMaximumF32Kernel(p, row_size_kv_capped);
+                float rowmax = MlasReduceMaximumF32Kernel(p, row_size_kv_valid);
 #endif
                 float m_diff = m[irow];
                 m[irow] = std::max(m[irow], rowmax);  // new m
@@ -107,13 +183,13 @@ MlasFlashAttentionThreaded(
                 m_diff -= m[irow];  // old - new (less than 0)
 
 #if defined(MLAS_TARGET_AMD64)
-                float rowsum = mlas_platform.ComputeSumExpF32Kernel(p, p, row_size_kv_capped, &negmax);
+                float rowsum = mlas_platform.ComputeSumExpF32Kernel(p, p, row_size_kv_valid, &negmax);
 #else
-                float rowsum = MlasComputeSumExpF32Kernel(p, p, row_size_kv_capped, &negmax);
+                float rowsum = MlasComputeSumExpF32Kernel(p, p, row_size_kv_valid, &negmax);
 #endif
 
-                // Note: for ir == 0, there is actually no need to calculate exp_diff
-                if (ir != 0) {
+                // Note: for ir == kv_start, there is actually no need to calculate exp_diff
+                if (ir != kv_start) {
                     float exp_diff = std::exp(m_diff);
                     l[irow] = exp_diff * l[irow] + rowsum;
 
@@ -122,7 +198,7 @@ MlasFlashAttentionThreaded(
                     }
                 } else {
                     l[irow] = rowsum;
-                    // When ir == 0, there is no need to scale the old result because it is zero.
+                    // When ir == kv_start, there is no need to scale the old result because it is zero.
                 }
             }
             MlasSgemmOperation(CBLAS_TRANSPOSE::CblasNoTrans,
@@ -135,13 +211,21 @@ MlasFlashAttentionThreaded(
                      row_size_kv_capped,
                      inputV,
                      static_cast<size_t>(v_head_size),
-                     ir == 0 ? 0.0f : 1.0f,
+                     ir == kv_start ? 0.0f : 1.0f,
                      temp_output,
                      static_cast<size_t>(v_head_size));
         }
 
-        float* output_row = output + ((batch_idx * q_sequence_length + q_idx) * num_heads + head_idx) * v_head_size;
-        ptrdiff_t row_size_q_valid = std::min(q_block_size, q_sequence_length - q_idx);
+        if (kv_split_count > 1) {
+            for (ptrdiff_t irow = 0; irow < row_size_q_valid; ++irow) {
+                float* partial = MlasFlashAttentionPartial(args, row_index + irow, split_idx);
+                partial[0] = m[irow];
+                partial[1] = l[irow];
+                std::copy_n(temp_output + irow * v_head_size, v_head_size, partial + 2);
+            }
+            continue;
+        }
+
         // TODO: leverage advanced instruction sets
         for (ptrdiff_t irow = 0; irow < row_size_q_valid; ++irow) {
             for (ptrdiff_t icol = 0; icol < v_head_size; ++icol) {
@@ -152,6 +236,59 @@ MlasFlashAttentionThreaded(
     }
 }
 
+void
+MlasFlashAttentionMergeThreaded(
+    void* argptr,
+    std::ptrdiff_t thread_id
+)
+{
+    const MlasFlashAttentionThreadedArgs* args = reinterpret_cast<MlasFlashAttentionThreadedArgs*>(argptr);
+    ptrdiff_t num_heads = static_cast<ptrdiff_t>(args->num_heads);
+    ptrdiff_t q_sequence_length = static_cast<ptrdiff_t>(args->q_sequence_length);
+    ptrdiff_t v_head_size = static_cast<ptrdiff_t>(args->v_head_size);
+    ptrdiff_t kv_split_count = static_cast<ptrdiff_t>(args->kv_split_count);
+    ptrdiff_t thread_count = static_cast<ptrdiff_t>(args->thread_count);
+
+    size_t row_count = static_cast<size_t>(args->batch_size) * num_heads * q_sequence_length;
+    size_t row_start;
+    size_t row_remaining;
+    MlasPartitionWork(thread_id, thread_count, row_count, &row_start, &row_remaining);
+
+    for (ptrdiff_t row_index = static_cast<ptrdiff_t>(row_start);
+         row_index < static_cast<ptrdiff_t>(row_start + row_remaining); ++row_index) {
+        ptrdiff_t q_idx = row_index % q_sequence_length;
+        ptrdiff_t head_idx = (row_index / q_sequence_length) % num_heads;
+        ptrdiff_t batch_idx = row_index / (q_sequence_length * num_heads);
+        float* output_row = args->output + ((batch_idx * q_sequence_length + q_idx) * num_heads + head_idx) * v_head_size;
+
+        // Rescale the partial results to the largest m of the chunks: O = sum(exp(m_i - m) * O_i) / sum(exp(m_i - m) * l_i)
+        float m = std::numeric_limits<float>::lowest();
+        for (ptrdiff_t split_idx = 0; split_idx < kv_split_count; ++split_idx) {
+            m = std::max(m, MlasFlashAttentionPartial(args, row_index, split_idx)[0]);
+        }
+
+        float l = 0.0f;
+        std::fill_n(output_row, v_head_size, 0.0f);
+        for (ptrdiff_t split_idx = 0; split_idx < kv_split_count; ++split_idx) {
+            const float* partial = MlasFlashAttentionPartial(args, row_index, split_idx);
+            if (partial[1] == 0.0f) {
+                continue;
+            }
+            float factor = std::exp(partial[0] - m);
+            l += factor * partial[1];
+            for (ptrdiff_t icol = 0; icol < v_head_size; ++icol) {
+                output_row[icol] += factor * partial[2 + icol];
+            }
+        }
+
+        if (l > 0.0f) {
+            for (ptrdiff_t icol = 0; icol < v_head_size; ++icol) {
+                output_row[icol] /= l;
+            }
+        }
+    }
+}
+
 void
 MLASCALL
 MlasFlashAttention(
@@ -164,4 +301,12 @@ MlasFlashAttention(
         static_cast<void *>(args),
         static_cast<std::ptrdiff_t>(args->thread_count),
         ThreadPool);
+
+    if (args->kv_split_count > 1) {
+        MlasExecuteThreaded(
+            MlasFlashAttentionMergeThreaded,
+            static_cast<void *>(args),
+            static_cast<std::ptrdiff_t>(args->thread_count),
+            ThreadPool);
+    }
 }
@@ -2119,3 +2119,103 @@ Return Value:
     MlasReduceMinimumMaximumF32Kernel(Input, Min, Max, N);
 #endif
 }
+
+void
+MLASCALL
+MlasQuantizeRowsS8(
+    const float* Input,
+    int8_t* Output,
+    float* Scales,
+    size_t Rows,
+    size_t RowLength
+    )
+/*++
+
+Routine Description:
+
+    This routine quantizes each row of the input buffer to int8 with a
+    symmetric scale computed from the largest magnitude of the row.
+
+Arguments:
+
+    Input - Supplies the input buffer with Rows rows of RowLength elements.
+
+    Output - Supplies the output buffer.
+
+    Scales - Returns the scale of each row.
+
+    Rows - Supplies the number of rows to process.
+
+    RowLength - Supplies the number of elements of each row.
+
+Return Value:
+
+    None.
+
+--*/
+{
+    for (size_t r = 0; r < Rows; r++) {
+
+        const float* InputRow = Input + r * RowLength;
+        int8_t* OutputRow = Output + r * RowLength;
+
+        float Minimum;
+        float Maximum;
+        MlasFindMinMaxElement(InputRow, &Minimum, &Maximum, RowLength);
+        const float MaximumMagnitude = std::max(-Minimum, Maximum);
+
+        if (MaximumMagnitude > 0.0f) {
+            Scales[r] = MaximumMagnitude / 127.0f;
+            MlasQuantizeLinear<int8_t>(InputRow, OutputRow, RowLength, Scales[r], 0);
+        } else {
+            Scales[r] = 0.0f;
+            std::fill_n(OutputRow, RowLength, int8_t(0));
+        }
+    }
+}
+
+void
+MLASCALL
+MlasDequantizeRowsS8(
+    const int8_t* Input,
+    const float* Scales,
+    float* Output,
+    size_t Rows,
+    size_t RowLength
+    )
+/*++
+
+Routine Description:
+
+    This routine dequantizes int8 rows that were quantized with one scale per
+    row by MlasQuantizeRowsS8.
+
+Arguments:
+
+    Input - Supplies the input buffer with Rows rows of RowLength elements.
+
+    Scales - Supplies the scale of each row.
+
+    Output - Supplies the output buffer.
+
+    Rows - Supplies the number of rows to process.
+
+    RowLength - Supplies the number of elements of each row.
+
+Return Value:
+
+    None.
+
+--*/
+{
+    for (size_t r = 0; r < Rows; r++) {
+
+        const int8_t* InputRow = Input + r * RowLength;
+        float* OutputRow = Output + r * RowLength;
+        const float Scale = Scales[r];
+
+        for (size_t n = 0; n < RowLength; n++) {
+            OutputRow[n] = Scale * float(InputRow[n]);
+        }
+    }
+}
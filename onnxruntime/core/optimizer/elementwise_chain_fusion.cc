@@ -0,0 +1,275 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "core/optimizer/elementwise_chain_fusion.h"
+
+#include <array>
+#include <string>
+#include <vector>
+
+#include "core/framework/tensorprotoutils.h"
+#include "core/graph/graph_utils.h"
+
+using namespace ONNX_NAMESPACE;
+using namespace onnxruntime::common;
+
+namespace onnxruntime {
+
+namespace {
+
+struct FusibleOp {
+  std::string_view op_type;
+  InlinedVector<ONNX_NAMESPACE::OperatorSetVersion> versions;
+  size_t input_count;
+};
+
+// Keep in sync with the operators supported by the FusedElementwise CPU kernel.
+const std::vector<FusibleOp>& FusibleOps() {
+  static const std::vector<FusibleOp> ops = {
+      {"Add", {7, 13, 14}, 2},
+      {"Sub", {7, 13, 14}, 2},
+      {"Mul", {7, 13, 14}, 2},
+      {"Div", {7, 13, 14}, 2},
+      {"Sigmoid", {6, 13}, 1},
+      {"Tanh", {6, 13}, 1},
+      {"Exp", {6, 13}, 1},
+      {"Erf", {9, 13}, 1},
+      {"Relu", {6, 13, 14}, 1},
+      {"Neg", {6, 13}, 1},
+      {"Abs", {6, 13}, 1},
+      {"Sqrt", {6, 13}, 1},
+  };
+  return ops;
+}
+
+bool IsFloatTensor(const NodeArg& node_arg) {
+  const auto* type = node_arg.TypeAsProto();
+  return type != nullptr && type->has_tensor_type() &&
+         type->tensor_type().elem_type() == TensorProto_DataType_FLOAT;
+}
+
+bool IsFusibleNode(const Node& node, const InlinedHashSet<std::string_view>& compatible_providers) {
+  if (!graph_utils::IsSupportedProvider(node, compatible_providers) || node.OutputDefs().size() != 1 ||
+      !IsFloatTensor(*node.OutputDefs()[0])) {
+    return false;
+  }
+
+  for (const auto& op : FusibleOps()) {
+    if (graph_utils::IsSupportedOptypeVersionAndDomain(node, op.op_type, op.versions)) {
+      if (node.InputDefs().size() != op.input_count) {
+        return false;
+      }
+      for (const auto* input_def : node.InputDefs()) {
+        if (!IsFloatTensor(*input_def)) {
+          return false;
+        }
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+// Returns true if both shapes are known to be equal, treating symbolic dimensions with the same name as equal.
+bool IsSameShape(const TensorShapeProto& shape, const TensorShapeProto& other_shape) {
+  if (shape.dim_size() != other_shape.dim_size()) {
+    return false;
+  }
+  for (int i = 0; i < shape.dim_size(); ++i) {
+    const auto& dim = shape.dim(i);
+    const auto& other_dim = other_shape.dim(i);
+    if (utils::HasDimValue(dim) && utils::HasDimValue(other_dim)) {
+      if (dim.dim_value() != other_dim.dim_value()) {
+        return false;
+      }
+    } else if (!utils::HasDimParam(dim) || !utils::HasDimParam(other_dim) || dim.dim_param() != other_dim.dim_param()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns true if the operand has the output shape, or is broadcast to it along leading dimensions only. The
+// FusedElementwise kernel can then read the operand by taking the output offset modulo the operand size.
+bool IsSupportedOperand(const NodeArg& operand, const TensorShapeProto& output_shape) {
+  const auto* shape = operand.Shape();
+  if (shape == nullptr) {
+    return false;
+  }
+  if (IsSameShape(*shape, output_shape)) {
+    return true;
+  }
+
+  int leading_ones = 0;
+  while (leading_ones < shape->dim_size() && utils::HasDimValue(shape->dim(leading_ones)) &&
+         shape->dim(leading_ones).dim_value() == 1) {
+    ++leading_ones;
+  }
+  const int trailing_rank = shape->dim_size() - leading_ones;
+  if (trailing_rank > output_shape.dim_size()) {
+    return false;
+  }
+  for (int i = 0; i < trailing_rank; ++i) {
+    const auto& dim = shape->dim(leading_ones + i);
+    const auto& output_dim = output_shape.dim(output_shape.dim_size() - trailing_rank + i);
+    if (!utils::HasDimValue(dim) || !utils::HasDimValue(output_dim) || dim.dim_value() != output_dim.dim_value()) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// Returns true if nothing outside of the group consumes the outputs of the group other than its last node.
+bool HasSingleGroupOutput(const Graph& graph, gsl::span<const std::reference_wrapper<Node>> group) {
+  InlinedHashSet<NodeIndex> group_nodes;
+  for (const Node& node : group) {
+    group_nodes.insert(node.Index());
+  }
+  for (size_t i = 0; i + 1 < group.size(); ++i) {
+    const Node& node = group[i];
+    if (graph.NodeProducesGraphOutput(node)) {
+      return false;
+    }
+    for (auto it = node.OutputNodesBegin(); it != node.OutputNodesEnd(); ++it) {
+      if (group_nodes.count(it->Index()) == 0) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+}  // namespace
+
+Status ElementwiseChainFusion::ApplyImpl(Graph& graph, bool& modified, int graph_level,
+                                         const logging::Logger& logger) const {
+  GraphViewer graph_viewer(graph);
+  const auto& node_topology_list = graph_viewer.GetNodesInTopologicalOrder();
+
+  InlinedHashMap<NodeIndex, size_t> topological_position;
+  for (size_t i = 0; i < node_topology_list.size(); ++i) {
+    topological_position[node_topology_list[i]] = i;
+  }
+
+  for (auto node_index : node_topology_list) {
+    auto* p_node = graph.GetNode(node_index);
+    if (p_node == nullptr) continue;  // node was removed by an earlier fusion
+
+    Node& node = *p_node;
+    ORT_RETURN_IF_ERROR(Recurse(node, modified, graph_level, logger));
+
+    if (!IsFusibleNode(node, GetCompatibleExecutionProviders())) {
+      continue;
+    }
+    const TensorShapeProto* output_shape = node.OutputDefs()[0]->Shape();
+    if (output_shape == nullptr) {
+      continue;
+    }
+
+    const size_t seed_position = topological_position[node_index];
+    InlinedHashSet<const NodeArg*> group_values;
+
+    // A node can join the group if it computes a value of the output shape from values of the group and from
+    // supported operands. Those must be produced before the first node of the group, so that the fused node does
+    // not create a cycle.
+    auto can_join = [&](const Node& candidate) {
+      if (!IsFusibleNode(candidate, GetCompatibleExecutionProviders())) {
+        return false;
+      }
+      const auto* candidate_shape = candidate.OutputDefs()[0]->Shape();
+      if (candidate_shape == nullptr || !IsSameShape(*candidate_shape, *output_shape)) {
+        return false;
+      }
+      for (const auto* input_def : candidate.InputDefs()) {
+        if (group_values.count(input_def) != 0) {
+          continue;
+        }
+        if (!IsSupportedOperand(*input_def, *output_shape)) {
+          return false;
+        }
+        const Node* producer = graph.GetProducerNode(input_def->Name());
+        if (producer != nullptr && topological_position[producer->Index()] >= seed_position) {
+          return false;
+        }
+      }
+      return true;
+    };
+
+    if (!can_join(node)) {
+      continue;
+    }
+
+    // Grow the group from its last node, taking the earliest consumer that can join. Every node added consumes the
+    // previous one, so the group stays in topological order.
+    InlinedVector<std::reference_wrapper<Node>> group{node};
+    group_values.insert(node.OutputDefs()[0]);
+    for (;;) {
+      const Node& last = group.back();
+      Node* next = nullptr;
+      size_t next_position = 0;
+      for (auto it = last.OutputNodesBegin(); it != last.OutputNodesEnd(); ++it) {
+        const size_t position = topological_position[it->Index()];
+        if ((next == nullptr || position < next_position) && can_join(*it)) {
+          next = graph.GetNode(it->Index());
+          next_position = position;
+        }
+      }
+      if (next == nullptr) {
+        break;
+      }
+      group.push_back(*next);
+      group_values.insert(next->OutputDefs()[0]);
+    }
+
+    while (group.size() > 1 && !HasSingleGroupOutput(graph, group)) {
+      group.pop_back();
+    }
+    if (group.size() < 2) {
+      continue;
+    }
+
+    // Operand indices as expected by FusedElementwise: the inputs of the fused node come first, followed by the
+    // results of the nodes of the group.
+    InlinedHashSet<const NodeArg*> group_outputs;
+    for (const Node& group_node : group) {
+      group_outputs.insert(group_node.OutputDefs()[0]);
+    }
+    InlinedVector<NodeArg*> fused_inputs;
+    InlinedHashMap<const NodeArg*, int64_t> operand_indices;
+    for (Node& group_node : group) {
+      for (auto* input_def : group_node.MutableInputDefs()) {
+        if (group_outputs.count(input_def) == 0 && operand_indices.count(input_def) == 0) {
+          operand_indices[input_def] = static_cast<int64_t>(fused_inputs.size());
+          fused_inputs.push_back(input_def);
+        }
+      }
+    }
+
+    std::vector<std::string> ops;
+    std::vector<int64_t> operands;
+    for (const Node& group_node : group) {
+      const auto& input_defs = group_node.InputDefs();
+      ops.push_back(group_node.OpType());
+      operands.push_back(operand_indices[input_defs[0]]);
+      operands.push_back(input_defs.size() > 1 ? operand_indices[input_defs[1]] : -1);
+      operand_indices[group_node.OutputDefs()[0]] = static_cast<int64_t>(fused_inputs.size() + ops.size() - 1);
+    }
+
+    Node& last_node = group.back();
+    Node& fused_node = graph.AddNode(graph.GenerateNodeName(last_node.Name() + "/ElementwiseChainFusion/"),
+                                     "FusedElementwise", "fused element-wise operators", fused_inputs,
+                                     std::array{last_node.MutableOutputDefs()[0]}, nullptr, kMSDomain);
+    fused_node.AddAttribute("ops", ops);
+    fused_node.AddAttribute("operands", operands);
+    fused_node.SetExecutionProviderType(node.GetExecutionProviderType());
+    // the fused node produces the value of the last node, so later groups see it at the same position
+    topological_position[fused_node.Index()] = topological_position[last_node.Index()];
+
+    graph_utils::FinalizeNodeFusion(graph, group, fused_node);
+    modified = true;
+  }
+
+  return Status::OK();
+}
+
+}  // namespace onnxruntime
@@ -0,0 +1,28 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include "core/optimizer/graph_transformer.h"
+
+namespace onnxruntime {
+
+/**
+@Class ElementwiseChainFusion
+
+Rewrite a connected group of float element-wise nodes such as Add->Mul->Sigmoid->Mul into a single
+com.microsoft.FusedElementwise node, which evaluates the group in one pass over memory instead of one pass per node.
+
+Only the output of the last node may be consumed outside of the group, and every intermediate value must have the
+shape of that output. Other operands must have the output shape or be broadcast along leading dimensions only, e.g.
+a bias over the last axis or a scalar.
+*/
+class ElementwiseChainFusion : public GraphTransformer {
+ public:
+  ElementwiseChainFusion(const InlinedHashSet<std::string_view>& compatible_execution_providers = {}) noexcept
+      : GraphTransformer("ElementwiseChainFusion", compatible_execution_providers) {}
+
+  Status ApplyImpl(Graph& graph, bool& modified, int graph_level, const logging::Logger& logger) const override;
+};
+
+}  // namespace onnxruntime
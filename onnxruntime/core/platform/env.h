@@ -84,6 +84,10 @@ struct ThreadOptions {
   // The process that owns the thread may consider setting its affinity.
   std::vector<LogicalProcessors> affinities;
 
+  // NUMA node of each thread, in the same order as affinities. If the vector is not empty, the thread pool
+  // prefers stealing work from threads on the same node and can run parallel sections on a single node.
+  std::vector<int> numa_node_ids;
+
   // Set or unset denormal as zero.
   bool set_denormal_as_zero = false;
 
@@ -147,6 +151,12 @@ class Env {
 
   virtual std::vector<LogicalProcessors> GetDefaultThreadAffinities() const = 0;
 
+  /// <summary>
+  /// Returns the logical processors of each NUMA node, indexed by node.
+  /// Returns an empty vector if the topology is unknown.
+  /// </summary>
+  virtual std::vector<LogicalProcessors> GetNumaNodeAffinities() const = 0;
+
   virtual int GetL2CacheSize() const = 0;
 
   /// \brief Returns the number of micro-seconds since the Unix epoch.
@@ -17,6 +17,7 @@ limitations under the License.
 #include "core/platform/env.h"
 
 #include <assert.h>
+#include <dirent.h>
 #include <dlfcn.h>
 #include <fcntl.h>
 #include <ftw.h>
@@ -31,8 +32,11 @@ limitations under the License.
 #endif
 #include <unistd.h>
 
+#include <algorithm>
+#include <fstream>
 #include <iostream>
 #include <optional>
+#include <sstream>
 #include <thread>
 #include <utility>  // for std::forward
 #include <vector>
@@ -308,6 +312,61 @@ class PosixEnv : public Env {
     return ret;
   }
 
+  std::vector<LogicalProcessors> GetNumaNodeAffinities() const override {
+    std::vector<LogicalProcessors> ret;
+#if defined(__linux__)
+    cpu_set_t allowed_cpus;
+    CPU_ZERO(&allowed_cpus);
+    const bool has_allowed_cpus = sched_getaffinity(0, sizeof(allowed_cpus), &allowed_cpus) == 0;
+
+    // node ids are not necessarily contiguous, e.g. when memory-only nodes exist
+    std::vector<int> node_ids;
+    if (DIR* dir = opendir("/sys/devices/system/node")) {
+      while (const dirent* entry = readdir(dir)) {
+        int node_id = 0;
+        if (sscanf(entry->d_name, "node%d", &node_id) == 1) {
+          node_ids.push_back(node_id);
+        }
+      }
+      closedir(dir);
+    }
+    std::sort(node_ids.begin(), node_ids.end());
+
+    for (int node_id : node_ids) {
+      std::ifstream cpulist_file("/sys/devices/system/node/node" + std::to_string(node_id) + "/cpulist");
+      std::string cpulist;
+      if (!std::getline(cpulist_file, cpulist)) {
+        continue;
+      }
+
+      // cpulist is a comma separated list of ids and id ranges, e.g. "0-15,32-47"
+      LogicalProcessors node_processors;
+      std::istringstream cpulist_stream(cpulist);
+      std::string range;
+      while (std::getline(cpulist_stream, range, ',')) {
+        int first = 0, last = 0;
+        const int num_read = sscanf(range.c_str(), "%d-%d", &first, &last);
+        if (num_read < 1) {
+          continue;
+        }
+        if (num_read == 1) {
+          last = first;
+        }
+        for (int cpu = first; cpu <= last; ++cpu) {
+          if (!has_allowed_cpus || (cpu < CPU_SETSIZE && CPU_ISSET(cpu, &allowed_cpus))) {
+            node_processors.push_back(cpu);
+          }
+        }
+      }
+
+      if (!node_processors.empty()) {
+        ret.push_back(std::move(node_processors));
+      }
+    }
+#endif
+    return ret;
+  }
+
   int GetL2CacheSize() const override {
 #ifdef _SC_LEVEL2_CACHE_SIZE
     return static_cast<int>(sysconf(_SC_LEVEL2_CACHE_SIZE));
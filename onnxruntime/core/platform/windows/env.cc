@@ -16,6 +16,7 @@ limitations under the License.
 
 #include "core/platform/windows/env.h"
 
+#include <algorithm>
 #include <iostream>
 #include <fstream>
 #include <optional>
@@ -303,6 +304,51 @@ std::vector<LogicalProcessors> WindowsEnv::GetDefaultThreadAffinities() const {
   return cores_.empty() ? std::vector<LogicalProcessors>(DefaultNumCores(), LogicalProcessors{}) : cores_;
 }
 
+std::vector<LogicalProcessors> WindowsEnv::GetNumaNodeAffinities() const {
+  std::vector<LogicalProcessors> ret;
+  DWORD returnLength = 0;
+  GetLogicalProcessorInformationEx(RelationNumaNode, nullptr, &returnLength);
+  if (GetLastError() != ERROR_INSUFFICIENT_BUFFER) {
+    return ret;
+  }
+
+  std::unique_ptr<char[]> allocation = std::make_unique<char[]>(returnLength);
+  SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX* numaInfos = reinterpret_cast<SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(allocation.get());
+  if (!GetLogicalProcessorInformationEx(RelationNumaNode, numaInfos, &returnLength)) {
+    return ret;
+  }
+
+  const BYTE* iter = reinterpret_cast<const BYTE*>(numaInfos);
+  const BYTE* end = iter + returnLength;
+  while (iter < end) {
+    auto numa_info = reinterpret_cast<const SYSTEM_LOGICAL_PROCESSOR_INFORMATION_EX*>(iter);
+    if (numa_info->Relationship == RelationNumaNode) {
+      // map the node's group-local processor ids back to the global ids used for affinities
+      const auto& group_mask = numa_info->NumaNode.GroupMask;
+      constexpr KAFFINITY bit = 1;
+      LogicalProcessors node_global_proc_ids;
+      for (const auto& [global_processor_id, processor_info] : global_processor_info_map_) {
+        if (processor_info.group_id == static_cast<int>(group_mask.Group) &&
+            (group_mask.Mask & (bit << processor_info.local_processor_id))) {
+          node_global_proc_ids.push_back(global_processor_id);
+        }
+      }
+      std::sort(node_global_proc_ids.begin(), node_global_proc_ids.end());
+      const size_t node_number = numa_info->NumaNode.NodeNumber;
+      if (ret.size() <= node_number) {
+        ret.resize(node_number + 1);
+      }
+      ret[node_number] = std::move(node_global_proc_ids);
+    }
+    iter += numa_info->Size;
+  }
+
+  // nodes without processors can't host threads
+  ret.erase(std::remove_if(ret.begin(), ret.end(), [](const LogicalProcessors& node) { return node.empty(); }),
+            ret.end());
+  return ret;
+}
+
 int WindowsEnv::GetL2CacheSize() const {
   return l2_cache_size_;
 }
@@ -219,6 +219,21 @@ Status MatMul<float>::UseSharedPrePackedBuffers(std::vector<BufferUniquePtr>& pr
   return Status::OK();
 }
 
+Status MatMul<float>::UseCachedPrePackedBuffers(const Tensor& tensor,
+                                                std::vector<BufferUniquePtr>& prepacked_buffers,
+                                                int input_idx,
+                                                /*out*/ bool& used_cached_buffers) {
+  used_cached_buffers = false;
+
+  if (input_idx == 1) {
+    used_cached_buffers = true;
+    b_shape_ = tensor.Shape();
+    packed_b_ = std::move(prepacked_buffers[0]);
+  }
+
+  return Status::OK();
+}
+
 Status MatMul<float>::Compute(OpKernelContext* ctx) const {
   concurrency::ThreadPool* thread_pool = ctx->GetOperatorThreadPool();
 
@@ -287,8 +302,21 @@ Status MatMul<float>::Compute(OpKernelContext* ctx) const {
       data[i].alpha = alpha_attr_;
       data[i].beta = 0.0f;
     }
-    MlasGemmBatch(trans_a ? CblasTrans : CblasNoTrans, trans_b ? CblasTrans : CblasNoTrans,
-                  M, N, K, data.data(), max_len, thread_pool);
+
+    cpu::tunable::GemmParams params;
+    params.tuning_ctx = tuning_ctx_;
+    params.trans_a = trans_a ? CblasTrans : CblasNoTrans;
+    params.trans_b = trans_b ? CblasTrans : CblasNoTrans;
+    params.m = M;
+    params.n = N;
+    params.k = K;
+    params.data = data.data();
+    params.batch = max_len;
+    params.thread_pool = thread_pool;
+    if (tuning_ctx_ != nullptr && tuning_ctx_->IsTunableOpEnabled()) {
+      ORT_RETURN_IF_ERROR(ctx->GetTempSpaceAllocator(&params.allocator));
+    }
+    ORT_RETURN_IF_ERROR(cpu::tunable::Gemm(params));
   }
   return Status::OK();
 }
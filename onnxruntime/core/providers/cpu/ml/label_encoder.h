@@ -6,6 +6,7 @@
 #include "core/common/common.h"
 #include "core/framework/op_kernel.h"
 #include "core/providers/cpu/ml/ml_common.h"
+#include "core/providers/cpu/ml/string_lookup_table.h"
 #include "core/framework/tensorprotoutils.h"
 #include "core/common/safeint.h"
 
@@ -24,21 +25,22 @@ class LabelEncoder final : public OpKernel {
 
     auto num_entries = string_classes.size();
 
-    string_to_int_map_.reserve(num_entries);
+    string_to_int_map_.Reserve(num_entries);
     int_to_string_map_.reserve(num_entries);
 
     for (size_t i = 0; i < num_entries; ++i) {
-      const std::string& str = string_classes[i];
-
-      string_to_int_map_[str] = i;
-      int_to_string_map_[i] = str;
+      int_to_string_map_[i] = string_classes[i];
+    }
+    // the last occurrence of a repeated class wins, and Insert keeps the first one it sees.
+    for (size_t i = num_entries; i > 0; --i) {
+      string_to_int_map_.Insert(string_classes[i - 1], i - 1);
     }
   }
 
   Status Compute(OpKernelContext* context) const override;
 
  private:
-  std::unordered_map<std::string, int64_t> string_to_int_map_;
+  StringLookupTable<int64_t> string_to_int_map_;
   std::unordered_map<int64_t, std::string> int_to_string_map_;
 
   std::string default_string_;
@@ -63,8 +65,13 @@ class LabelEncoder_2 final : public OpKernel {
     ORT_ENFORCE(num_keys == num_values, "The ", key_field_name_, " and ", value_field_name_,
                 " attributes in LabelEncoder ", "(name: ", info.node().Name(), ") must have the same length. ",
                 "However, the number of key is ", num_keys, " and the number of ", "values is ", num_values, ".");
-    map_.reserve(num_keys);
-    for (size_t i = 0; i < num_keys; ++i) map_.emplace(keys[i], values[i]);
+    if constexpr (std::is_same_v<TKey, std::string>) {
+      map_.Reserve(num_keys);
+      for (size_t i = 0; i < num_keys; ++i) map_.Insert(keys[i], values[i]);
+    } else {
+      map_.reserve(num_keys);
+      for (size_t i = 0; i < num_keys; ++i) map_.emplace(keys[i], values[i]);
+    }
   }
 
   Status Compute(OpKernelContext* context) const override {
@@ -74,13 +81,17 @@ class LabelEncoder_2 final : public OpKernel {
 
     auto input = X->template DataAsSpan<TKey>();
     auto output = Y->template MutableDataAsSpan<TValue>();
-    auto input_iter = input.begin();
-    auto output_iter = output.begin();
-    while (input_iter != input.end()) {
-      const auto found = map_.find(*input_iter);
-      *output_iter = found == map_.end() ? default_value_ : found->second;
-      ++output_iter;
-      ++input_iter;
+    if constexpr (std::is_same_v<TKey, std::string>) {
+      map_.FindAll(input, output, default_value_);
+    } else {
+      auto input_iter = input.begin();
+      auto output_iter = output.begin();
+      while (input_iter != input.end()) {
+        const auto found = map_.find(*input_iter);
+        *output_iter = found == map_.end() ? default_value_ : found->second;
+        ++output_iter;
+        ++input_iter;
+      }
     }
     return Status::OK();
   }
@@ -94,7 +105,7 @@ class LabelEncoder_2 final : public OpKernel {
   // A collection of key-value pairs. Each (a_key, a_value) pair
   // means that the "a_key" in the input would be mapped to "a_value".
   // If map_ doesn't contain "a_key", we use default_value_ as its output.
-  InlinedHashMap<TKey, TValue> map_;
+  std::conditional_t<std::is_same_v<TKey, std::string>, StringLookupTable<TValue>, InlinedHashMap<TKey, TValue>> map_;
   TValue default_value_;
   // ONNX attribute name to load keys.
   std::string key_field_name_;
@@ -203,7 +214,11 @@ class LabelEncoder_4 final : public OpKernel {
     auto values = GetAttribute<TValue>(kernel_info, value_field_name_, "values_tensor");
     ORT_ENFORCE(keys.size() == values.size(), "Keys and values must have the same length.");
     for (size_t i = 0; i < keys.size(); ++i) {
-      map_.emplace(keys[i], values[i]);
+      if constexpr (std::is_same_v<TKey, std::string>) {
+        map_.Insert(keys[i], values[i]);
+      } else {
+        map_.emplace(keys[i], values[i]);
+      }
     }
   }
   Status Compute(OpKernelContext* context) const override {
@@ -213,20 +228,26 @@ class LabelEncoder_4 final : public OpKernel {
 
     auto input = X->template DataAsSpan<TKey>();
     auto output = Y->template MutableDataAsSpan<TValue>();
-    auto input_iter = input.begin();
-    auto output_iter = output.begin();
-    while (input_iter != input.end()) {
-      const auto found = map_.find(*input_iter);
-      *output_iter = found == map_.end() ? default_value_ : found->second;
-      ++output_iter;
-      ++input_iter;
+    if constexpr (std::is_same_v<TKey, std::string>) {
+      map_.FindAll(input, output, default_value_);
+    } else {
+      auto input_iter = input.begin();
+      auto output_iter = output.begin();
+      while (input_iter != input.end()) {
+        const auto found = map_.find(*input_iter);
+        *output_iter = found == map_.end() ? default_value_ : found->second;
+        ++output_iter;
+        ++input_iter;
+      }
     }
     return Status::OK();
   }
 
  private:
   void InitializeAttrFields(const OpKernelInfo& kernel_info);
-  HashMap<TKey, TValue, NaNHash<TKey>, NaNEqual<TKey>> map_;
+  std::conditional_t<std::is_same_v<TKey, std::string>, StringLookupTable<TValue>,
+                     HashMap<TKey, TValue, NaNHash<TKey>, NaNEqual<TKey>>>
+      map_;
   TValue default_value_;
   std::string key_field_name_;
   std::string value_field_name_;
@@ -0,0 +1,166 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <algorithm>
+#include <cstring>
+#include <functional>
+#include <limits>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include <gsl/gsl>
+#include "core/common/common.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <xmmintrin.h>
+#endif
+
+namespace onnxruntime {
+namespace ml {
+
+// A read-mostly map from strings to values for the kernels that look up string categories.
+//
+// The keys are copied into one contiguous arena and the table is open addressed with linear probing. Each slot
+// packs the upper half of the hash of its key with the index of the entry, so that a probe only compares keys whose
+// hashes match and a lookup touches the slot array, one entry and the key bytes instead of the nodes of a
+// std::unordered_map. FindAll hashes a block of keys and prefetches their slots before probing any of them.
+template <typename TValue>
+class StringLookupTable {
+ public:
+  StringLookupTable() = default;
+
+  void Reserve(size_t num_keys) {
+    entries_.reserve(num_keys);
+    values_.reserve(num_keys);
+    if (num_keys * 2 > slots_.size()) {
+      Rehash(num_keys * 2);
+    }
+  }
+
+  // Adds key with value unless key is already present, in which case the table is unchanged.
+  // Returns true if the key was added.
+  bool Insert(std::string_view key, const TValue& value) {
+    const uint64_t hash = Hash(key);
+    if (Find(key, hash) != nullptr) {
+      return false;
+    }
+
+    ORT_ENFORCE(arena_.size() + key.size() <= std::numeric_limits<uint32_t>::max() &&
+                    entries_.size() < std::numeric_limits<uint32_t>::max() - 1,
+                "Too many string keys in the lookup table.");
+    if ((entries_.size() + 1) * 2 > slots_.size()) {
+      Rehash(std::max<size_t>(slots_.size() * 2, kMinSlots));
+    }
+
+    entries_.push_back({static_cast<uint32_t>(arena_.size()), static_cast<uint32_t>(key.size()), hash});
+    arena_.append(key);
+    values_.push_back(value);
+    PlaceEntry(entries_.size() - 1);
+    return true;
+  }
+
+  // Returns the value of key or nullptr if key is not in the table.
+  const TValue* Find(std::string_view key) const { return Find(key, Hash(key)); }
+
+  // Writes the value of each key to values, or default_value for the keys not in the table.
+  void FindAll(gsl::span<const std::string> keys, gsl::span<TValue> values, const TValue& default_value) const {
+    ORT_ENFORCE(keys.size() == values.size());
+    uint64_t hashes[kBatchSize];
+    for (size_t begin = 0; begin < keys.size(); begin += kBatchSize) {
+      const size_t n = std::min(kBatchSize, keys.size() - begin);
+      for (size_t i = 0; i < n; ++i) {
+        hashes[i] = Hash(keys[begin + i]);
+        if (!slots_.empty()) {
+          Prefetch(&slots_[hashes[i] & (slots_.size() - 1)]);
+        }
+      }
+      for (size_t i = 0; i < n; ++i) {
+        const TValue* value = Find(keys[begin + i], hashes[i]);
+        values[begin + i] = value == nullptr ? default_value : *value;
+      }
+    }
+  }
+
+  size_t Size() const { return entries_.size(); }
+
+ private:
+  struct Entry {
+    uint32_t offset;  // of the key in arena_
+    uint32_t length;
+    uint64_t hash;
+  };
+
+  static constexpr size_t kMinSlots = 16;
+  static constexpr size_t kBatchSize = 16;
+  static constexpr uint64_t kIndexMask = 0xFFFFFFFF;
+
+  static uint64_t Hash(std::string_view key) { return std::hash<std::string_view>{}(key); }
+
+  static void Prefetch(const void* address) {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_prefetch(address);
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+    _mm_prefetch(static_cast<const char*>(address), _MM_HINT_T0);
+#else
+    ORT_UNUSED_PARAMETER(address);
+#endif
+  }
+
+  // An empty slot is 0, so the index of an entry is stored plus one.
+  static uint64_t MakeSlot(uint64_t hash, size_t entry_index) {
+    return (hash & ~kIndexMask) | static_cast<uint64_t>(entry_index + 1);
+  }
+
+  const TValue* Find(std::string_view key, uint64_t hash) const {
+    if (slots_.empty()) {
+      return nullptr;
+    }
+    const size_t mask = slots_.size() - 1;
+    for (size_t i = hash & mask;; i = (i + 1) & mask) {
+      const uint64_t slot = slots_[i];
+      if (slot == 0) {
+        return nullptr;
+      }
+      if (((slot ^ hash) & ~kIndexMask) == 0) {
+        const size_t entry_index = static_cast<size_t>((slot & kIndexMask) - 1);
+        const Entry& entry = entries_[entry_index];
+        if (entry.length == key.size() && std::memcmp(arena_.data() + entry.offset, key.data(), key.size()) == 0) {
+          return &values_[entry_index];
+        }
+      }
+    }
+  }
+
+  void PlaceEntry(size_t entry_index) {
+    const uint64_t hash = entries_[entry_index].hash;
+    const size_t mask = slots_.size() - 1;
+    size_t i = hash & mask;
+    while (slots_[i] != 0) {
+      i = (i + 1) & mask;
+    }
+    slots_[i] = MakeSlot(hash, entry_index);
+  }
+
+  // Sets the number of slots to the smallest power of 2 that is at least min_slots and re-inserts the entries.
+  void Rehash(size_t min_slots) {
+    size_t num_slots = kMinSlots;
+    while (num_slots < min_slots) {
+      num_slots *= 2;
+    }
+    slots_.assign(num_slots, 0);
+    for (size_t i = 0; i < entries_.size(); ++i) {
+      PlaceEntry(i);
+    }
+  }
+
+  std::string arena_;
+  std::vector<Entry> entries_;
+  std::vector<TValue> values_;
+  std::vector<uint64_t> slots_;
+};
+
+}  // namespace ml
+}  // namespace onnxruntime
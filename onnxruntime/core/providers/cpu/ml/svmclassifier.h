@@ -5,6 +5,7 @@
 
 #include "core/common/common.h"
 #include "core/framework/op_kernel.h"
+#include "core/platform/threadpool.h"
 #include "core/util/math_cpuonly.h"
 #include "ml_common.h"
 #include "core/providers/cpu/math/gemm.h"
@@ -39,28 +40,20 @@ class SVMCommon {
     assert(a.size() == size_t(m * k) && b.size() == size_t(k * n) && out.size() == size_t(m * n));
 
     if (kernel_type_ == KERNEL::RBF) {
-      T* cur_out = out.data();
-      const T* cur_batch = a.data();
-
-      // each batch has 'k' features
-      for (int64_t batch = 0; batch < m; ++batch) {
-        const T* cur_support_vector = b.data();
-
-        // broadcast the support vectors against the k features in each batch. output is one value per support vector
-        for (int64_t support_vector = 0; support_vector < n; ++support_vector) {
-          T sum = 0.f;
-          const T* cur_input = cur_batch;
-
-          for (int64_t feature = 0; feature < k; ++feature) {
-            T val = *cur_input++ - *cur_support_vector++;
-            sum += val * val;
-          }
-
-          *cur_out++ = std::exp(-gamma_ * sum);
-        }
-
-        cur_batch += k;  // move to start of next batch
-      }
+      // The distances are computed directly rather than expanded as ||x||^2 + ||s||^2 - 2 x.s to use a GEMM, as
+      // the cancellation in the expansion loses most of the precision of the distance between nearby vectors with
+      // large norms, which are the ones that matter for the kernel.
+      TransformRows(out.data(), m, n, static_cast<double>(n) * (k * 3 + 20), threadpool,
+                    [this, &a, &b, n, k](ptrdiff_t row, T* cur_out) {
+                      const auto cur_batch = ConstEigenVectorArrayMap<T>(a.data() + row * k, k);
+                      const T* cur_support_vector = b.data();
+                      for (ptrdiff_t support_vector = 0; support_vector < n; ++support_vector) {
+                        const auto support = ConstEigenVectorArrayMap<T>(cur_support_vector, k);
+                        cur_out[support_vector] = -gamma_ * (cur_batch - support).square().sum();
+                        cur_support_vector += k;
+                      }
+                      MlasComputeExp(cur_out, cur_out, onnxruntime::narrow<size_t>(n));
+                    });
     } else {
       float alpha = 1.f;
       float beta = 1.f;
@@ -81,21 +74,41 @@ class SVMCommon {
                                         threadpool);
 
       if (kernel_type_ == KERNEL::POLY) {
-        auto map_out = EigenVectorArrayMap<T>(out.data(), out.size());
-        if (degree_ == 2)
-          map_out = map_out.square();
-        else if (degree_ == 3)
-          map_out = map_out.cube();
-        else
-          map_out = map_out.pow(degree_);
-
+        TransformRows(out.data(), m, n, static_cast<double>(n) * (degree_ == 2 || degree_ == 3 ? 2 : 20), threadpool,
+                      [this, n](ptrdiff_t, T* cur_out) {
+                        auto map_out = EigenVectorArrayMap<T>(cur_out, n);
+                        if (degree_ == 2)
+                          map_out = map_out.square();
+                        else if (degree_ == 3)
+                          map_out = map_out.cube();
+                        else
+                          map_out = map_out.pow(degree_);
+                      });
       } else if (kernel_type_ == KERNEL::SIGMOID) {
-        MlasComputeTanh(out.data(), out.data(), out.size());
+        TransformRows(out.data(), m, n, static_cast<double>(n) * 20, threadpool,
+                      [n](ptrdiff_t, T* cur_out) {
+                        MlasComputeTanh(cur_out, cur_out, onnxruntime::narrow<size_t>(n));
+                      });
       }
     }
   }
 
  private:
+  // Applies fn(row_index, row) to each row of the m x n matrix data, splitting the rows across the thread pool.
+  // compute_cycles_per_row is a rough estimate of the cost of fn used to decide how many threads to use.
+  template <typename T, typename Fn>
+  static void TransformRows(T* data, ptrdiff_t m, ptrdiff_t n, double compute_cycles_per_row,
+                            concurrency::ThreadPool* threadpool, const Fn& fn) {
+    const double bytes_per_row = static_cast<double>(n) * sizeof(T);
+    concurrency::ThreadPool::TryParallelFor(
+        threadpool, m, TensorOpCost{bytes_per_row, bytes_per_row, compute_cycles_per_row},
+        [data, n, &fn](ptrdiff_t first, ptrdiff_t last) {
+          for (ptrdiff_t row = first; row < last; ++row) {
+            fn(row, data + row * n);
+          }
+        });
+  }
+
   KERNEL kernel_type_;
   float gamma_{0.f};
   float coef0_{0.f};
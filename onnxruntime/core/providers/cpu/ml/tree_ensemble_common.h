@@ -3,9 +3,12 @@
 
 #pragma once
 
+#include <functional>
+
 #include "tree_ensemble_aggregator.h"
 #include "core/platform/ort_mutex.h"
 #include "core/platform/threadpool.h"
+#include "core/session/onnxruntime_session_options_config_keys.h"
 #include "tree_ensemble_helper.h"
 
 namespace onnxruntime {
@@ -47,6 +50,17 @@ class TreeEnsembleCommon : public TreeEnsembleCommonAttributes {
   // `ThresholdType` is used as well for output type (double as well for lightgbm) and not `OutputType`.
   std::vector<SparseValue<ThresholdType>> weights_;
   std::vector<TreeNodeElement<ThresholdType>*> roots_;
+  // Compact copy of nodes_, only built when all nodes have the same mode.
+  std::vector<TreeNodeCompactElement<ThresholdType>> compact_nodes_;
+  NODE_MODE compact_mode_;
+  // Quantized copy of compact_nodes_ and the sorted distinct thresholds of every feature, only built when
+  // quantize_thresholds_ is true and the model allows it.
+  bool quantize_thresholds_ = false;
+  std::vector<TreeNodeQuantizedElement> quantized_nodes_;
+  std::vector<std::vector<ThresholdType>> quantized_thresholds_;
+
+  // Number of rows whose traversals of a tree are interleaved by ProcessTreeNodeLeaves.
+  static constexpr int64_t kRowBlockSize = 8;
 
  public:
   TreeEnsembleCommon() {}
@@ -83,6 +97,18 @@ class TreeEnsembleCommon : public TreeEnsembleCommonAttributes {
   TreeNodeElement<ThresholdType>* ProcessTreeNodeLeave(TreeNodeElement<ThresholdType>* root,
                                                        const InputType* x_data) const;
 
+  // Finds the leaves of tree tree_index reached by n_rows rows starting at x_data, stride elements apart.
+  // When compact_nodes_ is available, the traversals of blocks of kRowBlockSize rows are interleaved and do not
+  // branch on the comparisons, so that the loads of the nodes and features of different rows overlap.
+  // x_ranks, if not null, holds the ranks of the same rows computed by ComputeRanks, which are used instead of x_data.
+  void ProcessTreeNodeLeaves(size_t tree_index, const InputType* x_data, int64_t stride, int64_t n_rows,
+                             const TreeNodeElement<ThresholdType>** leaves, const uint16_t* x_ranks) const;
+
+  // Converts the features of the N rows of x_data to ranks among the thresholds of each feature if the thresholds are
+  // quantized. Returns an empty vector otherwise. The ranks of a row are max_feature_id_ + 1 elements apart.
+  std::vector<uint16_t> ComputeRanks(concurrency::ThreadPool* ttp, const InputType* x_data, int64_t N,
+                                     int64_t stride) const;
+
   template <typename AGG>
   void ComputeAgg(concurrency::ThreadPool* ttp, const Tensor* X, Tensor* Y, Tensor* label, const AGG& agg) const;
 
@@ -92,6 +118,17 @@ class TreeEnsembleCommon : public TreeEnsembleCommonAttributes {
                   const std::vector<ThresholdType>& nodes_values_as_tensor, const std::vector<float>& node_values,
                   const std::vector<int64_t>& nodes_missing_value_tracks_true, std::vector<size_t>& updated_mapping,
                   int64_t tree_id, const InlinedVector<TreeNodeElementId>& node_tree_ids);
+
+  void BuildCompactNodes();
+  void BuildQuantizedNodes();
+
+  template <typename CMP>
+  void ProcessTreeNodeLeavesCompact(size_t tree_index, const InputType* x_data, int64_t stride, int64_t n_rows,
+                                    const TreeNodeElement<ThresholdType>** leaves) const;
+
+  template <bool kGreater>
+  void ProcessTreeNodeLeavesQuantized(size_t tree_index, const uint16_t* x_ranks, int64_t n_rows,
+                                      const TreeNodeElement<ThresholdType>** leaves) const;
 };
 
 template <typename InputType, typename ThresholdType, typename OutputType>
@@ -104,6 +141,8 @@ Status TreeEnsembleCommon<InputType, ThresholdType, OutputType>::Init(const OpKe
   ORT_THROW_IF_ERROR(GetVectorAttrsOrDefault(info, "nodes_values_as_tensor", nodes_values_as_tensor));
   ORT_THROW_IF_ERROR(GetVectorAttrsOrDefault(info, "target_weights_as_tensor", target_weights_as_tensor));
 #endif
+  quantize_thresholds_ =
+      info.GetConfigOptions().GetConfigOrDefault(kOrtSessionOptionsTreeEnsembleQuantizeThresholds, "0") == "1";
 
   return Init(
       80,
@@ -338,9 +377,87 @@ Status TreeEnsembleCommon<InputType, ThresholdType, OutputType>::Init(
     }
   }
 
+  BuildCompactNodes();
+  BuildQuantizedNodes();
   return Status::OK();
 }
 
+template <typename InputType, typename ThresholdType, typename OutputType>
+void TreeEnsembleCommon<InputType, ThresholdType, OutputType>::BuildCompactNodes() {
+  using CompactElement = TreeNodeCompactElement<ThresholdType>;
+  compact_nodes_.clear();
+  if (!same_mode_ || nodes_.size() > CompactElement::kPositionMask) {
+    return;
+  }
+
+  // Trees made of leaves only can be evaluated with any comparison.
+  compact_mode_ = NODE_MODE::BRANCH_LEQ;
+  compact_nodes_.reserve(nodes_.size());
+  for (size_t pos = 0; pos < nodes_.size(); ++pos) {
+    const TreeNodeElement<ThresholdType>& node = nodes_[pos];
+    CompactElement compact;
+    compact.threshold = node.value_or_unique_weight;
+    if (node.is_not_leaf()) {
+      compact_mode_ = node.mode();
+      compact.feature_id = node.feature_id;
+      compact.truenode_and_flags = static_cast<uint32_t>(node.truenode_or_weight.ptr - nodes_.data());
+      if (node.is_missing_track_true()) {
+        compact.truenode_and_flags |= CompactElement::kMissingTrackTrue;
+      }
+    } else {
+      compact.feature_id = 0;
+      compact.truenode_and_flags = static_cast<uint32_t>(pos) | CompactElement::kLeaf;
+    }
+    compact_nodes_.push_back(compact);
+  }
+}
+
+template <typename InputType, typename ThresholdType, typename OutputType>
+void TreeEnsembleCommon<InputType, ThresholdType, OutputType>::BuildQuantizedNodes() {
+  quantized_nodes_.clear();
+  quantized_thresholds_.clear();
+  // Equality does not map to ranks, and the ranks and feature ids must fit in 16 bits.
+  if (!quantize_thresholds_ || compact_nodes_.empty() || compact_mode_ == NODE_MODE::BRANCH_EQ ||
+      compact_mode_ == NODE_MODE::BRANCH_NEQ || max_feature_id_ >= TreeNodeQuantizedElement::kMissingRank) {
+    return;
+  }
+
+  using CompactElement = TreeNodeCompactElement<ThresholdType>;
+  std::vector<std::vector<ThresholdType>> thresholds(onnxruntime::narrow<size_t>(max_feature_id_ + 1));
+  for (const CompactElement& node : compact_nodes_) {
+    if ((node.truenode_and_flags & CompactElement::kLeaf) == 0) {
+      if (std::isnan(node.threshold)) {
+        return;
+      }
+      thresholds[node.feature_id].push_back(node.threshold);
+    }
+  }
+  for (auto& feature_thresholds : thresholds) {
+    std::sort(feature_thresholds.begin(), feature_thresholds.end());
+    feature_thresholds.erase(std::unique(feature_thresholds.begin(), feature_thresholds.end()),
+                             feature_thresholds.end());
+    if (feature_thresholds.size() >= TreeNodeQuantizedElement::kMissingRank) {
+      return;
+    }
+  }
+
+  quantized_nodes_.reserve(compact_nodes_.size());
+  for (const CompactElement& node : compact_nodes_) {
+    TreeNodeQuantizedElement quantized;
+    const auto& feature_thresholds = thresholds[node.feature_id];
+    quantized.threshold_rank =
+        (node.truenode_and_flags & CompactElement::kLeaf) != 0
+            ? 0
+            : static_cast<uint16_t>(std::lower_bound(feature_thresholds.begin(), feature_thresholds.end(),
+                                                     node.threshold) -
+                                    feature_thresholds.begin());
+    quantized.feature_id = static_cast<uint16_t>(node.feature_id);
+    quantized.truenode_and_flags = node.truenode_and_flags;
+    quantized_nodes_.push_back(quantized);
+  }
+  quantized_thresholds_ = std::move(thresholds);
+}
+
 template <typename InputType, typename ThresholdType, typename OutputType>
 size_t TreeEnsembleCommon<InputType, ThresholdType, OutputType>::AddNodes(
     const size_t i, const InlinedVector<NODE_MODE>& cmodes, const InlinedVector<size_t>& truenode_ids,
@@ -489,6 +606,8 @@ void TreeEnsembleCommon<InputType, ThresholdType, OutputType>::ComputeAgg(concur
       // split into batch so that every batch holds on caches, then loop on trees and finally loop
       // on the batch rows.
       std::vector<ScoreValue<ThresholdType>> scores(parallel_tree_N_);
+      std::vector<const TreeNodeElement<ThresholdType>*> leaves(parallel_tree_N_);
+      const std::vector<uint16_t> x_ranks = ComputeRanks(ttp, x_data, N, stride);
       size_t j;
       int64_t i, batch, batch_end;
 
@@ -498,8 +617,10 @@ void TreeEnsembleCommon<InputType, ThresholdType, OutputType>::ComputeAgg(concur
           scores[SafeInt<ptrdiff_t>(i - batch)] = {0, 0};
         }
         for (j = 0; j < static_cast<size_t>(n_trees_); ++j) {
+          ProcessTreeNodeLeaves(j, x_data + batch * stride, stride, batch_end - batch, leaves.data(),
+                                x_ranks.empty() ? nullptr : x_ranks.data() + batch * (max_feature_id_ + 1));
           for (i = batch; i < batch_end; ++i) {
-            agg.ProcessTreeNodePrediction1(scores[SafeInt<ptrdiff_t>(i - batch)], *ProcessTreeNodeLeave(roots_[j], x_data + i * stride));
+            agg.ProcessTreeNodePrediction1(scores[SafeInt<ptrdiff_t>(i - batch)], *leaves[SafeInt<ptrdiff_t>(i - batch)]);
           }
         }
         for (i = batch; i < batch_end; ++i) {
@@ -510,21 +631,25 @@ void TreeEnsembleCommon<InputType, ThresholdType, OutputType>::ComputeAgg(concur
     } else if (n_trees_ > max_num_threads) { /* section D: 1 output, 2+ rows and enough trees to parallelize */
       auto num_threads = std::min<int32_t>(max_num_threads, SafeInt<int32_t>(n_trees_));
       std::vector<ScoreValue<ThresholdType>> scores(SafeInt<size_t>(num_threads) * N);
+      std::vector<const TreeNodeElement<ThresholdType>*> leaves(SafeInt<size_t>(num_threads) * parallel_tree_N_);
+      const std::vector<uint16_t> x_ranks = ComputeRanks(ttp, x_data, N, stride);
       int64_t end_n, begin_n = 0;
       while (begin_n < N) {
         end_n = std::min(N, begin_n + parallel_tree_N_);
         concurrency::ThreadPool::TrySimpleParallelFor(
             ttp,
             num_threads,
-            [this, &agg, &scores, num_threads, x_data, N, begin_n, end_n, stride](ptrdiff_t batch_num) {
+            [this, &agg, &scores, &leaves, &x_ranks, num_threads, x_data, N, begin_n, end_n, stride](ptrdiff_t batch_num) {
               auto work = concurrency::ThreadPool::PartitionWork(batch_num, num_threads, onnxruntime::narrow<size_t>(this->n_trees_));
+              const TreeNodeElement<ThresholdType>** batch_leaves = leaves.data() + batch_num * SafeInt<ptrdiff_t>(parallel_tree_N_);
               for (int64_t i = begin_n; i < end_n; ++i) {
                 scores[batch_num * SafeInt<ptrdiff_t>(N) + i] = {0, 0};
               }
               for (auto j = work.start; j < work.end; ++j) {
+                ProcessTreeNodeLeaves(j, x_data + begin_n * stride, stride, end_n - begin_n, batch_leaves,
+                                      x_ranks.empty() ? nullptr : x_ranks.data() + begin_n * (max_feature_id_ + 1));
                 for (int64_t i = begin_n; i < end_n; ++i) {
-                  agg.ProcessTreeNodePrediction1(scores[batch_num * SafeInt<ptrdiff_t>(N) + i],
-                                                 *ProcessTreeNodeLeave(roots_[j], x_data + i * stride));
+                  agg.ProcessTreeNodePrediction1(scores[batch_num * SafeInt<ptrdiff_t>(N) + i], *batch_leaves[i - begin_n]);
                 }
               }
             });
@@ -586,6 +711,8 @@ void TreeEnsembleCommon<InputType, ThresholdType, OutputType>::ComputeAgg(concur
       }
     } else if (N <= parallel_N_ || max_num_threads == 1) { /* section C2: 2+ outputs, 2+ rows, not enough rows to parallelize */
       std::vector<InlinedVector<ScoreValue<ThresholdType>>> scores(parallel_tree_N_);
+      std::vector<const TreeNodeElement<ThresholdType>*> leaves(parallel_tree_N_);
+      const std::vector<uint16_t> x_ranks = ComputeRanks(ttp, x_data, N, stride);
       size_t j, limit;
       int64_t i, batch, batch_end;
       batch_end = std::min(N, static_cast<int64_t>(parallel_tree_N_));
@@ -598,8 +725,10 @@ void TreeEnsembleCommon<InputType, ThresholdType, OutputType>::ComputeAgg(concur
           std::fill(scores[SafeInt<ptrdiff_t>(i - batch)].begin(), scores[SafeInt<ptrdiff_t>(i - batch)].end(), ScoreValue<ThresholdType>({0, 0}));
         }
         for (j = 0, limit = roots_.size(); j < limit; ++j) {
+          ProcessTreeNodeLeaves(j, x_data + batch * stride, stride, batch_end - batch, leaves.data(),
+                                x_ranks.empty() ? nullptr : x_ranks.data() + batch * (max_feature_id_ + 1));
           for (i = batch; i < batch_end; ++i) {
-            agg.ProcessTreeNodePrediction(scores[SafeInt<ptrdiff_t>(i - batch)], *ProcessTreeNodeLeave(roots_[j], x_data + i * stride), weights_);
+            agg.ProcessTreeNodePrediction(scores[SafeInt<ptrdiff_t>(i - batch)], *leaves[SafeInt<ptrdiff_t>(i - batch)], weights_);
           }
         }
         for (i = batch; i < batch_end; ++i) {
@@ -611,21 +740,26 @@ void TreeEnsembleCommon<InputType, ThresholdType, OutputType>::ComputeAgg(concur
     } else if (n_trees_ >= max_num_threads) { /* section: D2: 2+ outputs, 2+ rows, enough trees to parallelize*/
       auto num_threads = std::min<int32_t>(max_num_threads, SafeInt<int32_t>(n_trees_));
       std::vector<InlinedVector<ScoreValue<ThresholdType>>> scores(SafeInt<size_t>(num_threads) * N);
+      std::vector<const TreeNodeElement<ThresholdType>*> leaves(SafeInt<size_t>(num_threads) * parallel_tree_N_);
+      const std::vector<uint16_t> x_ranks = ComputeRanks(ttp, x_data, N, stride);
       int64_t end_n, begin_n = 0;
       while (begin_n < N) {
         end_n = std::min(N, begin_n + parallel_tree_N_);
         concurrency::ThreadPool::TrySimpleParallelFor(
             ttp,
             num_threads,
-            [this, &agg, &scores, num_threads, x_data, N, stride, begin_n, end_n](ptrdiff_t batch_num) {
+            [this, &agg, &scores, &leaves, &x_ranks, num_threads, x_data, N, stride, begin_n, end_n](ptrdiff_t batch_num) {
               auto work = concurrency::ThreadPool::PartitionWork(batch_num, num_threads, onnxruntime::narrow<size_t>(this->n_trees_));
+              const TreeNodeElement<ThresholdType>** batch_leaves = leaves.data() + batch_num * SafeInt<ptrdiff_t>(parallel_tree_N_);
               for (int64_t i = begin_n; i < end_n; ++i) {
                 scores[batch_num * SafeInt<ptrdiff_t>(N) + i].resize(onnxruntime::narrow<size_t>(n_targets_or_classes_), {0, 0});
               }
               for (auto j = work.start; j < work.end; ++j) {
+                ProcessTreeNodeLeaves(j, x_data + begin_n * stride, stride, end_n - begin_n, batch_leaves,
+                                      x_ranks.empty() ? nullptr : x_ranks.data() + begin_n * (max_feature_id_ + 1));
                 for (int64_t i = begin_n; i < end_n; ++i) {
                   agg.ProcessTreeNodePrediction(scores[batch_num * SafeInt<ptrdiff_t>(N) + i],
-                                                *ProcessTreeNodeLeave(roots_[j], x_data + i * stride), weights_);
+                                                *batch_leaves[i - begin_n], weights_);
                 }
               }
             });
@@ -767,6 +901,168 @@ TreeEnsembleCommon<InputType, ThresholdType, OutputType>::ProcessTreeNodeLeave(
   return root;
 }
 
+template <typename InputType, typename ThresholdType, typename OutputType>
+void TreeEnsembleCommon<InputType, ThresholdType, OutputType>::ProcessTreeNodeLeaves(
+    size_t tree_index, const InputType* x_data, int64_t stride, int64_t n_rows,
+    const TreeNodeElement<ThresholdType>** leaves, const uint16_t* x_ranks) const {
+  if (x_ranks != nullptr) {
+    if (compact_mode_ == NODE_MODE::BRANCH_GTE || compact_mode_ == NODE_MODE::BRANCH_GT) {
+      ProcessTreeNodeLeavesQuantized<true>(tree_index, x_ranks, n_rows, leaves);
+    } else {
+      ProcessTreeNodeLeavesQuantized<false>(tree_index, x_ranks, n_rows, leaves);
+    }
+    return;
+  }
+
+  if (compact_nodes_.empty()) {
+    for (int64_t i = 0; i < n_rows; ++i) {
+      leaves[i] = ProcessTreeNodeLeave(roots_[tree_index], x_data + i * stride);
+    }
+    return;
+  }
+
+  switch (compact_mode_) {
+    case NODE_MODE::BRANCH_LEQ:
+      ProcessTreeNodeLeavesCompact<std::less_equal<>>(tree_index, x_data, stride, n_rows, leaves);
+      break;
+    case NODE_MODE::BRANCH_LT:
+      ProcessTreeNodeLeavesCompact<std::less<>>(tree_index, x_data, stride, n_rows, leaves);
+      break;
+    case NODE_MODE::BRANCH_GTE:
+      ProcessTreeNodeLeavesCompact<std::greater_equal<>>(tree_index, x_data, stride, n_rows, leaves);
+      break;
+    case NODE_MODE::BRANCH_GT:
+      ProcessTreeNodeLeavesCompact<std::greater<>>(tree_index, x_data, stride, n_rows, leaves);
+      break;
+    case NODE_MODE::BRANCH_EQ:
+      ProcessTreeNodeLeavesCompact<std::equal_to<>>(tree_index, x_data, stride, n_rows, leaves);
+      break;
+    case NODE_MODE::BRANCH_NEQ:
+      ProcessTreeNodeLeavesCompact<std::not_equal_to<>>(tree_index, x_data, stride, n_rows, leaves);
+      break;
+    case NODE_MODE::LEAF:
+      ORT_THROW("Unexpected mode for the compact nodes of TreeEnsemble.");
+  }
+}
+
+template <typename InputType, typename ThresholdType, typename OutputType>
+template <typename CMP>
+void TreeEnsembleCommon<InputType, ThresholdType, OutputType>::ProcessTreeNodeLeavesCompact(
+    size_t tree_index, const InputType* x_data, int64_t stride, int64_t n_rows,
+    const TreeNodeElement<ThresholdType>** leaves) const {
+  using CompactElement = TreeNodeCompactElement<ThresholdType>;
+  const CompactElement* nodes = compact_nodes_.data();
+  const uint32_t root = static_cast<uint32_t>(roots_[tree_index] - nodes_.data());
+  const CMP cmp;
+  uint32_t positions[kRowBlockSize];
+
+  for (int64_t begin = 0; begin < n_rows; begin += kRowBlockSize) {
+    const int64_t n = std::min(kRowBlockSize, n_rows - begin);
+    const InputType* x = x_data + begin * stride;
+    for (int64_t r = 0; r < n; ++r) {
+      positions[r] = root;
+    }
+
+    // Every row moves down by one node per iteration, until all of them reach a leaf. A leaf points to itself.
+    bool any_moved = true;
+    while (any_moved) {
+      any_moved = false;
+      for (int64_t r = 0; r < n; ++r) {
+        const CompactElement& node = nodes[positions[r]];
+        const InputType val = x[r * stride + node.feature_id];
+        const uint32_t flags = node.truenode_and_flags;
+        const bool is_leaf = (flags & CompactElement::kLeaf) != 0;
+        const bool go_true = is_leaf | cmp(val, node.threshold) |
+                             (((flags & CompactElement::kMissingTrackTrue) != 0) & _isnan_(val));
+        positions[r] = go_true ? (flags & CompactElement::kPositionMask) : positions[r] + 1;
+        any_moved |= !is_leaf;
+      }
+    }
+
+    for (int64_t r = 0; r < n; ++r) {
+      leaves[begin + r] = &nodes_[positions[r]];
+    }
+  }
+}
+
+template <typename InputType, typename ThresholdType, typename OutputType>
+template <bool kGreater>
+void TreeEnsembleCommon<InputType, ThresholdType, OutputType>::ProcessTreeNodeLeavesQuantized(
+    size_t tree_index, const uint16_t* x_ranks, int64_t n_rows, const TreeNodeElement<ThresholdType>** leaves) const {
+  using CompactElement = TreeNodeCompactElement<ThresholdType>;
+  const TreeNodeQuantizedElement* nodes = quantized_nodes_.data();
+  const uint32_t root = static_cast<uint32_t>(roots_[tree_index] - nodes_.data());
+  const int64_t rank_stride = max_feature_id_ + 1;
+  uint32_t positions[kRowBlockSize];
+
+  for (int64_t begin = 0; begin < n_rows; begin += kRowBlockSize) {
+    const int64_t n = std::min(kRowBlockSize, n_rows - begin);
+    const uint16_t* x = x_ranks + begin * rank_stride;
+    for (int64_t r = 0; r < n; ++r) {
+      positions[r] = root;
+    }
+
+    // Same traversal as ProcessTreeNodeLeavesCompact.
+    bool any_moved = true;
+    while (any_moved) {
+      any_moved = false;
+      for (int64_t r = 0; r < n; ++r) {
+        const TreeNodeQuantizedElement& node = nodes[positions[r]];
+        const uint16_t rank = x[r * rank_stride + node.feature_id];
+        const uint32_t flags = node.truenode_and_flags;
+        const bool is_leaf = (flags & CompactElement::kLeaf) != 0;
+        const bool is_missing = rank == TreeNodeQuantizedElement::kMissingRank;
+        const bool cmp = kGreater ? rank > node.threshold_rank : rank <= node.threshold_rank;
+        const bool go_true = is_leaf | (!is_missing & cmp) |
+                             (is_missing & ((flags & CompactElement::kMissingTrackTrue) != 0));
+        positions[r] = go_true ? (flags & CompactElement::kPositionMask) : positions[r] + 1;
+        any_moved |= !is_leaf;
+      }
+    }
+
+    for (int64_t r = 0; r < n; ++r) {
+      leaves[begin + r] = &nodes_[positions[r]];
+    }
+  }
+}
+
+template <typename InputType, typename ThresholdType, typename OutputType>
+std::vector<uint16_t> TreeEnsembleCommon<InputType, ThresholdType, OutputType>::ComputeRanks(
+    concurrency::ThreadPool* ttp, const InputType* x_data, int64_t N, int64_t stride) const {
+  std::vector<uint16_t> ranks;
+  if (quantized_nodes_.empty()) {
+    return ranks;
+  }
+
+  // For BRANCH_LEQ and BRANCH_GT, x <= t[k] if and only if the number of thresholds lower than x is at most k.
+  // For BRANCH_LT and BRANCH_GTE, x < t[k] if and only if the number of thresholds lower or equal to x is at most k.
+  const bool count_equal = compact_mode_ == NODE_MODE::BRANCH_LT || compact_mode_ == NODE_MODE::BRANCH_GTE;
+  const int64_t rank_stride = max_feature_id_ + 1;
+  ranks.resize(SafeInt<size_t>(N) * rank_stride);
+  concurrency::ThreadPool::TryBatchParallelFor(
+      ttp,
+      SafeInt<ptrdiff_t>(N),
+      [this, &ranks, x_data, stride, rank_stride, count_equal](ptrdiff_t i) {
+        const InputType* x = x_data + i * stride;
+        uint16_t* row_ranks = ranks.data() + i * rank_stride;
+        for (int64_t f = 0; f < rank_stride; ++f) {
+          const InputType val = x[f];
+          const auto& thresholds = quantized_thresholds_[onnxruntime::narrow<size_t>(f)];
+          if (_isnan_(val)) {
+            row_ranks[f] = TreeNodeQuantizedElement::kMissingRank;
+          } else if (count_equal) {
+            row_ranks[f] = static_cast<uint16_t>(std::upper_bound(thresholds.begin(), thresholds.end(), val) -
+                                                 thresholds.begin());
+          } else {
+            row_ranks[f] = static_cast<uint16_t>(std::lower_bound(thresholds.begin(), thresholds.end(), val) -
+                                                 thresholds.begin());
+          }
+        }
+      },
+      0);
+  return ranks;
+}
+
 // TI: input type
 // TH: threshold type, double if T==double, float otherwise
 // TO: output type
@@ -820,6 +1116,8 @@ Status TreeEnsembleCommonClassifier<InputType, ThresholdType, OutputType>::Init(
   ORT_THROW_IF_ERROR(GetVectorAttrsOrDefault(info, "nodes_values_as_tensor", nodes_values_as_tensor));
   ORT_THROW_IF_ERROR(GetVectorAttrsOrDefault(info, "class_weights_as_tensor", class_weights_as_tensor));
 #endif
+  this->quantize_thresholds_ =
+      info.GetConfigOptions().GetConfigOrDefault(kOrtSessionOptionsTreeEnsembleQuantizeThresholds, "0") == "1";
 
   return Init(
       80,
@@ -19,6 +19,7 @@
 
 #include "core/common/narrow.h"
 #include "core/common/safeint.h"
+#include "core/providers/cpu/tunable/conv.h"
 #include "core/util/math_cpuonly.h"
 
 namespace onnxruntime {
@@ -210,88 +211,28 @@ Status Conv<float>::Compute(OpKernelContext* context) const {
     }
     Beta = 1.0f;
   }
-  const size_t kernel_rank = kernel_shape.size();
-  concurrency::ThreadPool* thread_pool = context->GetOperatorThreadPool();
-
-  if (kernel_rank >= 1 && kernel_rank <= 3) {
-    MLAS_CONV_PARAMETERS Parameters;
-    size_t WorkingBufferSize;
-    MlasConvPrepare(&Parameters,
-                    kernel_rank,
-                    narrow<size_t>(N),
-                    narrow<size_t>(conv_attrs_.group),
-                    narrow<size_t>(C / conv_attrs_.group),
-                    input_shape.GetDims().data(),
-                    kernel_shape.data(),
-                    dilations.data(),
-                    pads.data(),
-                    strides.data(),
-                    output_shape.GetDims().data(),
-                    narrow<size_t>(M / conv_attrs_.group),
-                    &activation_,
-                    &WorkingBufferSize,
-                    Beta,
-                    thread_pool);
-
-    auto* working_data = WorkingBufferSize > 0 ? alloc->Alloc(sizeof(float) * SafeInt<size_t>(WorkingBufferSize))
-                                               : nullptr;
-    BufferUniquePtr working_buffer(working_data, BufferDeleter(std::move(alloc)));
-
-    MlasConv(&Parameters,
-             Xdata.data(),
-             W->Data<float>(),
-             Bdata,
-             static_cast<float*>(working_buffer.get()),
-             Ydata.data(),
-             thread_pool);
-  } else {
-    const int64_t input_image_size = input_shape.Size();
-    const int64_t output_image_size = output_shape.Size();
-    const int64_t kernel_size = TensorShape(kernel_shape).Size();
-    const SafeInt<int64_t> X_offset = SafeInt<int64_t>(C) / conv_attrs_.group * input_image_size;
-    const SafeInt<int64_t> Y_offset = SafeInt<int64_t>(Y->Shape().Size()) / Y->Shape()[0] / conv_attrs_.group;
-    const SafeInt<int64_t> W_offset = SafeInt<int64_t>(W->Shape().Size()) / conv_attrs_.group;
-    const SafeInt<int64_t> kernel_dim = SafeInt<int64_t>(C) / conv_attrs_.group * kernel_size;
-    const int64_t col_buffer_size = kernel_dim * output_image_size;
-
-    auto col_data = IAllocator::MakeUniquePtr<float>(alloc, narrow<size_t>(col_buffer_size));
-    auto w_data = W->DataAsSpan<float>();
-    for (int image_id = 0; image_id < N; ++image_id) {
-      for (int group_id = 0; group_id < conv_attrs_.group; ++group_id) {
-        math::Im2col<float, StorageOrder::NCHW>()(
-            &Xdata[group_id * X_offset],
-            input_shape.GetDims().data(),
-            output_shape.GetDims().data(),
-            kernel_dim,
-            kernel_shape.data(),
-            strides.data(),
-            dilations.data(),
-            pads.data(),
-            narrow<int>(kernel_shape.size()),
-            col_data.get());
-
-        math::Gemm<float>(
-            CblasNoTrans,
-            CblasNoTrans,
-            narrow<ptrdiff_t>(M / conv_attrs_.group),
-            narrow<ptrdiff_t>(output_image_size),
-            narrow<ptrdiff_t>(kernel_dim),
-            1,
-            &w_data[group_id * W_offset],
-            col_data.get(),
-            Beta,
-            &Ydata[group_id * Y_offset],
-            thread_pool);
-      }
-
-      MlasActivation(&activation_, Ydata.data(), Bdata, narrow<size_t>(M), narrow<size_t>(output_image_size), narrow<size_t>(output_image_size));
 
-      Xdata = Xdata.subspan(X_offset * conv_attrs_.group);
-      Ydata = Ydata.subspan(Y_offset * conv_attrs_.group);
-    }
-  }
-
-  return Status::OK();
+  cpu::tunable::ConvParams params;
+  params.tuning_ctx = tuning_ctx_;
+  params.n = N;
+  params.c = C;
+  params.m = M;
+  params.group = conv_attrs_.group;
+  params.input_shape = input_shape.GetDims();
+  params.output_shape = output_shape.GetDims();
+  params.kernel_shape = kernel_shape;
+  params.pads = pads;
+  params.dilations = dilations;
+  params.strides = strides;
+  params.activation = &activation_;
+  params.beta = Beta;
+  params.x = Xdata.data();
+  params.w = W->Data<float>();
+  params.b = Bdata;
+  params.y = Ydata.data();
+  params.thread_pool = context->GetOperatorThreadPool();
+  params.allocator = std::move(alloc);
+  return cpu::tunable::Conv(params);
 }
 
 ONNX_CPU_OPERATOR_VERSIONED_KERNEL(
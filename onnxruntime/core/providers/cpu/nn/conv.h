@@ -6,6 +6,7 @@
 #include "core/framework/op_kernel.h"
 #include "core/providers/cpu/nn/conv_attributes.h"
 #include "core/mlas/inc/mlas.h"
+#include "core/providers/cpu/tunable/cpu_tunable.h"
 
 namespace onnxruntime {
 
@@ -26,6 +27,7 @@ class Conv<float> : public OpKernel {
  public:
   Conv(const OpKernelInfo& info) : OpKernel(info), conv_attrs_(info) {
     activation_.ActivationKind = MlasIdentityActivation;
+    tuning_ctx_ = cpu::tunable::GetTuningContext(info.GetExecutionProvider());
   }
 
   Status Compute(OpKernelContext* context) const override;
@@ -34,6 +36,9 @@ class Conv<float> : public OpKernel {
   MLAS_ACTIVATION activation_;
 
   ConvAttributes conv_attrs_;
+
+ private:
+  cpu::tunable::CpuTuningContext* tuning_ctx_;
 };
 
 }  // namespace onnxruntime
@@ -8,8 +8,10 @@
 #include "core/framework/tensor.h"
 #include "core/platform/threadpool.h"
 
-#include <functional>
+#include <algorithm>
+#include <limits>
 #include <string_view>
+#include <vector>
 
 namespace onnxruntime {
 
@@ -25,66 +27,165 @@ ONNX_CPU_OPERATOR_KERNEL(
 
 namespace ngram_details {
 
-// NgrampPart implements a Trie like structure
-// for a unigram (1) it would insert into a root map with a valid id.
-// for (1,2,3) node 2 would be a child of 1 but have id == 0
-// because (1,2) does not exists. Node 3 would have a valid id.
-template <class T>
-struct NgramPart;
-
-template <>
-struct NgramPart<int64_t>;
-
-template <>
-struct NgramPart<std::string>;
-
-using NgramPartInt = NgramPart<int64_t>;
-using NgramPartString = NgramPart<std::string>;
-
-// Avoid recursive class definitions using unique_ptr + forward declaration
-using IntMap = InlinedHashMap<int64_t, std::unique_ptr<NgramPartInt>>;
-
-#ifndef DISABLE_ABSEIL
-using StrMap = absl::flat_hash_map<std::reference_wrapper<const std::string>, std::unique_ptr<NgramPartString>,
-                                   std::hash<std::string>, std::equal_to<std::string>>;
-#else
-using StrMap = std::unordered_map<std::reference_wrapper<const std::string>, std::unique_ptr<NgramPartString>,
-                                  std::hash<std::string>, std::equal_to<std::string>>;
-#endif
-
-template <>
-struct NgramPart<int64_t> {
-  size_t id_;  // 0 - means no entry, search for a bigger N
-  IntMap leafs_;
-  explicit NgramPart(size_t id) : id_(id) {}
-};
+// NgramAutomaton is an Aho-Corasick automaton over the n-grams of the pool.
+//
+// The pool items are first mapped to dense token ids, so int64 and string pools share the same automaton and a row
+// is hashed only once whatever the number of skip distances. The trie nodes live in one vector, the transitions
+// out of the root are a table indexed by token id and all the other transitions are in a single hash map keyed by
+// (node, token). Each node has a failure link to the node of its longest proper suffix that is also in the trie and
+// an output link to the node of its longest proper suffix that is an n-gram of the pool. A scan over a sequence of
+// tokens therefore reports every n-gram that ends at every position, of all the lengths, in a single pass.
+class NgramAutomaton {
+ public:
+  static constexpr uint32_t kUnknownToken = std::numeric_limits<uint32_t>::max();
+
+  NgramAutomaton() : nodes_(1) {}
+
+  // Returns the token id of item, assigning the next one if item has not been seen yet.
+  uint32_t AddToken(int64_t item) { return AddToken(int64_tokens_, item); }
+  uint32_t AddToken(const std::string& item) { return AddToken(string_tokens_, std::string_view(item)); }
+
+  uint32_t Token(int64_t item) const { return Token(int64_tokens_, item); }
+  uint32_t Token(std::string_view item) const { return Token(string_tokens_, item); }
+
+  // Adds the n-gram made of tokens with ngram_id, which must not be 0.
+  void AddNgram(gsl::span<const uint32_t> tokens, size_t ngram_id) {
+    assert(ngram_id != 0 && !tokens.empty());
+    uint32_t node = kRoot;
+    for (const uint32_t token : tokens) {
+      uint32_t next = Child(node, token);
+      if (next == kRoot) {
+        ORT_ENFORCE(nodes_.size() < std::numeric_limits<uint32_t>::max(), "Too many n-grams in the pool");
+        next = static_cast<uint32_t>(nodes_.size());
+        nodes_.emplace_back();
+        nodes_.back().depth = nodes_[node].depth + 1;
+        if (node == kRoot) {
+          root_next_[token] = next;
+        } else {
+          next_.emplace(Key(node, token), next);
+        }
+        edges_.push_back({node, token, next});
+      }
+      node = next;
+    }
+    ORT_ENFORCE(nodes_[node].ngram_id == 0, "Duplicate ngram detected, size: ", tokens.size(), " id: ", ngram_id);
+    nodes_[node].ngram_id = ngram_id;
+  }
+
+  // Computes the failure and output links once all the n-grams are added.
+  void Build() {
+    // The links of a node depend on the links of the nodes closer to the root.
+    std::stable_sort(edges_.begin(), edges_.end(), [this](const Edge& a, const Edge& b) {
+      return nodes_[a.child].depth < nodes_[b.child].depth;
+    });
+    for (const Edge& edge : edges_) {
+      Node& child = nodes_[edge.child];
+      if (edge.parent != kRoot) {
+        child.fail = Next(nodes_[edge.parent].fail, edge.token);
+      }
+      const Node& fail = nodes_[child.fail];
+      child.output = fail.ngram_id != 0 ? child.fail : fail.output;
+    }
+    edges_.clear();
+    edges_.shrink_to_fit();
+  }
+
+  bool Empty() const { return nodes_.size() == 1; }
+
+  // Scans tokens[start], tokens[start + stride], ... and calls fn with the id of every n-gram of at least
+  // min_length tokens that ends at each of these positions.
+  template <typename Fn>
+  void Scan(gsl::span<const uint32_t> tokens, size_t start, size_t stride, size_t min_length, Fn&& fn) const {
+    uint32_t state = kRoot;
+    for (size_t i = start; i < tokens.size(); i += stride) {
+      state = Next(state, tokens[i]);
+      uint32_t match = nodes_[state].ngram_id != 0 ? state : nodes_[state].output;
+      // The output links go to shorter and shorter n-grams.
+      while (match != kRoot && nodes_[match].depth >= min_length) {
+        fn(nodes_[match].ngram_id);
+        match = nodes_[match].output;
+      }
+    }
+  }
+
+ private:
+  static constexpr uint32_t kRoot = 0;
+
+  struct Node {
+    size_t ngram_id = 0;  // 0 - the node is only a prefix of longer n-grams
+    uint32_t fail = kRoot;
+    uint32_t output = kRoot;  // kRoot - no n-gram is a proper suffix of this node
+    uint32_t depth = 0;
+  };
+
+  struct Edge {
+    uint32_t parent;
+    uint32_t token;
+    uint32_t child;
+  };
+
+  static uint64_t Key(uint32_t node, uint32_t token) {
+    return (static_cast<uint64_t>(node) << 32) | token;
+  }
+
+  template <typename Map, typename Item>
+  uint32_t AddToken(Map& tokens, const Item& item) {
+    auto p = tokens.emplace(item, static_cast<uint32_t>(root_next_.size()));
+    if (p.second) {
+      ORT_ENFORCE(root_next_.size() < kUnknownToken, "Too many distinct items in the pool");
+      root_next_.push_back(kRoot);
+    }
+    return p.first->second;
+  }
+
+  template <typename Map, typename Item>
+  static uint32_t Token(const Map& tokens, const Item& item) {
+    auto hit = tokens.find(item);
+    return hit == tokens.end() ? kUnknownToken : hit->second;
+  }
+
+  // Returns the child of node for token or kRoot if there is none.
+  uint32_t Child(uint32_t node, uint32_t token) const {
+    if (node == kRoot) {
+      return root_next_[token];
+    }
+    auto hit = next_.find(Key(node, token));
+    return hit == next_.end() ? kRoot : hit->second;
+  }
+
+  uint32_t Next(uint32_t state, uint32_t token) const {
+    if (token == kUnknownToken) {
+      return kRoot;
+    }
+    while (true) {
+      const uint32_t next = Child(state, token);
+      if (next != kRoot || state == kRoot) {
+        return next;
+      }
+      state = nodes_[state].fail;
+    }
+  }
 
-template <>
-struct NgramPart<std::string> {
-  size_t id_;  // 0 - means no entry, search for a bigger N
-  StrMap leafs_;
-  explicit NgramPart(size_t id) : id_(id) {}
+  InlinedHashMap<int64_t, uint32_t> int64_tokens_;
+  // The keys refer to the pool_strings attribute.
+  InlinedHashMap<std::string_view, uint32_t> string_tokens_;
+  std::vector<Node> nodes_;
+  std::vector<uint32_t> root_next_;
+  InlinedHashMap<uint64_t, uint32_t> next_;
+  std::vector<Edge> edges_;  // only used while adding the n-grams
 };
 
-// Returns next ngram_id
-template <class K, class ForwardIter, class Map>
+// Adds ngrams n-grams of ngram_size items starting at first. Returns next ngram_id
+template <class ForwardIter>
 inline size_t PopulateGrams(ForwardIter first, size_t ngrams, size_t ngram_size, size_t ngram_id,
-                            Map& c) {
+                            NgramAutomaton& automaton) {
+  InlinedVector<uint32_t> tokens(ngram_size);
   for (; ngrams > 0; --ngrams) {
-    size_t n = 1;
-    Map* m = &c;
-    while (true) {
-      auto p = m->emplace(*first, std::make_unique<NgramPart<K>>(0));
-      ++first;
-      if (n == ngram_size) {
-        ORT_ENFORCE(p.first->second->id_ == 0, "Duplicate ngram detected, size: ", ngram_size, " id: ", ngram_id);
-        p.first->second->id_ = ngram_id;
-        ++ngram_id;
-        break;
-      }
-      ++n;
-      m = &p.first->second->leafs_;
+    for (size_t n = 0; n < ngram_size; ++n, ++first) {
+      tokens[n] = automaton.AddToken(*first);
     }
+    automaton.AddNgram(tokens, ngram_id);
+    ++ngram_id;
   }
   return ngram_id;
 }
@@ -134,11 +235,9 @@ struct TfIdfVectorizer::Impl {
   gsl::span<const int64_t> ngram_indexes_;
   gsl::span<const float> weights_;
 
-  // This map contains references to pool_string_ entries
-  // of pool_strings attribute
-  StrMap str_map_;
-  // This map contains pool_int64s entries
-  IntMap int64_map_;
+  // Matches the n-grams of pool_strings or pool_int64s
+  NgramAutomaton automaton_;
+  bool is_pool_string_ = false;
 
   size_t output_size_ = 0;
 
@@ -241,9 +340,9 @@ TfIdfVectorizer::TfIdfVectorizer(const OpKernelInfo& info) : OpKernel(info), imp
       // Skip loading into hash_set ngrams that are not in the range of [min_gram_length-max_gram_length]
       if (ngram_size >= min_gram_length && ngram_size <= max_gram_length) {
         if (pool_strings.empty()) {
-          ngram_id = PopulateGrams<int64_t>(pool_int64s.begin() + start_idx, ngrams, ngram_size, ngram_id, impl_->int64_map_);
+          ngram_id = PopulateGrams(pool_int64s.begin() + start_idx, ngrams, ngram_size, ngram_id, impl_->automaton_);
         } else {
-          ngram_id = PopulateGrams<std::string>(pool_strings.begin() + start_idx, ngrams, ngram_size, ngram_id, impl_->str_map_);
+          ngram_id = PopulateGrams(pool_strings.begin() + start_idx, ngrams, ngram_size, ngram_id, impl_->automaton_);
         }
       } else {
         ngram_id += ngrams;
@@ -251,73 +350,55 @@ TfIdfVectorizer::TfIdfVectorizer(const OpKernelInfo& info) : OpKernel(info), imp
     }
     ++ngram_size;
   }
+  impl_->automaton_.Build();
+  impl_->is_pool_string_ = !pool_strings.empty();
 }
 
 TfIdfVectorizer::~TfIdfVectorizer() = default;
 
 void TfIdfVectorizer::ComputeImpl(const void* x_data_raw, size_t elem_size, ptrdiff_t row_num, size_t row_size,
-                                  bool is_input_string, gsl::span<float> output_data,
-                                  std::function<void(size_t, gsl::span<float>&)>& fn_weight) const {
+                                  bool is_input_string, std::vector<uint32_t>& tokens,
+                                  gsl::span<float> output_data) const {
   const void* const row_begin = AdvanceElementPtr(x_data_raw, row_num * row_size, elem_size);
-  const void* const row_end = AdvanceElementPtr(row_begin, row_size, elem_size);
 
   const auto& impl = *impl_;
-  const auto max_gram_length = impl.max_gram_length_;
-  const auto max_skip_distance = impl.max_skip_count_ + 1;  // Convert to distance
-  auto start_ngram_size = impl.min_gram_length_;
-  size_t output_idx;
-
-  for (auto skip_distance = 1; skip_distance <= max_skip_distance; ++skip_distance) {
-    auto ngram_start = row_begin;
-    auto const ngram_row_end = row_end;
-
-    while (ngram_start < ngram_row_end) {
-      // We went far enough so no n-grams of any size can be gathered
-      auto at_least_this = AdvanceElementPtr(ngram_start, SafeInt<size_t>(skip_distance) * (start_ngram_size - 1), elem_size);
-      if (at_least_this >= ngram_row_end) {
-        break;
-      }
+  const auto& automaton = impl.automaton_;
+
+  // Look up the row items once for all the skip distances
+  tokens.resize(row_size);
+  if (is_input_string) {
+    const std::string* str_items = reinterpret_cast<const std::string*>(row_begin);
+    for (size_t i = 0; i < row_size; ++i) {
+      tokens[i] = automaton.Token(str_items[i]);
+    }
+  } else if (elem_size == 4) {
+    const int32_t* int_items = reinterpret_cast<const int32_t*>(row_begin);
+    for (size_t i = 0; i < row_size; ++i) {
+      tokens[i] = automaton.Token(int64_t{int_items[i]});
+    }
+  } else {
+    const int64_t* int_items = reinterpret_cast<const int64_t*>(row_begin);
+    for (size_t i = 0; i < row_size; ++i) {
+      tokens[i] = automaton.Token(int_items[i]);
+    }
+  }
 
-      auto ngram_item = ngram_start;
-      if (is_input_string) {
-        const std::string* str_item = reinterpret_cast<const std::string*>(ngram_item);
-        const StrMap* str_map = &impl.str_map_;
-        for (auto ngram_size = 1;
-             !str_map->empty() &&
-             ngram_size <= max_gram_length &&
-             str_item < ngram_row_end;
-             ++ngram_size, str_item += skip_distance) {
-          auto hit = str_map->find(*str_item);
-          if (hit == str_map->end()) {
-            break;
-          }
-          if (ngram_size >= start_ngram_size && hit->second->id_ != 0) {
-            output_idx = impl.OutputIdToIncrement(hit->second->id_);
-            fn_weight(output_idx, output_data);
-          }
-          str_map = &hit->second->leafs_;
-        }
-      } else {
-        const IntMap* int_map = &impl.int64_map_;
-        for (auto ngram_size = 1;
-             !int_map->empty() &&
-             ngram_size <= max_gram_length &&
-             ngram_item < ngram_row_end;
-             ++ngram_size, ngram_item = AdvanceElementPtr(ngram_item, skip_distance, elem_size)) {
-          int64_t val = (elem_size == 4) ? int64_t{*reinterpret_cast<const int32_t*>(ngram_item)} : *reinterpret_cast<const int64_t*>(ngram_item);
-          auto hit = int_map->find(val);
-          if (hit == int_map->end()) {
-            break;
-          }
-          if (ngram_size >= start_ngram_size && hit->second->id_ != 0) {
-            output_idx = impl.OutputIdToIncrement(hit->second->id_);
-            fn_weight(output_idx, output_data);
-          }
-          int_map = &hit->second->leafs_;
-        }
-      }
-      // Sliding window shift
-      ngram_start = AdvanceElementPtr(ngram_start, 1, elem_size);
+  const size_t max_gram_length = onnxruntime::narrow<size_t>(impl.max_gram_length_);
+  const size_t max_skip_distance = onnxruntime::narrow<size_t>(impl.max_skip_count_) + 1;  // Convert to distance
+  size_t start_ngram_size = onnxruntime::narrow<size_t>(impl.min_gram_length_);
+  auto count_ngram = [&impl, output_data](size_t ngram_id) {
+    output_data[impl.OutputIdToIncrement(ngram_id)] += 1.0f;
+  };
+
+  for (size_t skip_distance = 1; skip_distance <= max_skip_distance; ++skip_distance) {
+    // We went far enough so no n-grams of any size can be gathered
+    if (skip_distance * (start_ngram_size - 1) >= row_size) {
+      break;
+    }
+    // The n-grams with skip_distance are the contiguous n-grams of the items at every
+    // skip_distance-th position, so each of these interleaved sequences is scanned once.
+    for (size_t start = 0; start < skip_distance; ++start) {
+      automaton.Scan(tokens, start, skip_distance, start_ngram_size, count_ngram);
     }
     // We count UniGrams only once since they are not affected
     // by skip distance
@@ -373,8 +454,8 @@ Status TfIdfVectorizer::Compute(OpKernelContext* ctx) const {
   const bool is_input_string = X->IsDataTypeString();
 
   if (total_items == 0 ||
-      (is_input_string && impl_->str_map_.empty()) ||
-      ((X->IsDataType<int32_t>() || X->IsDataType<int64_t>()) && impl_->int64_map_.empty())) {
+      is_input_string != impl.is_pool_string_ ||
+      impl.automaton_.Empty()) {
     // TfidfVectorizer may receive an empty input when it follows a Tokenizer
     // (for example for a string containing only stopwords).
     // TfidfVectorizer returns a zero tensor of shape
@@ -386,46 +467,53 @@ Status TfIdfVectorizer::Compute(OpKernelContext* ctx) const {
 
   auto x_data_raw = ctx->Input<Tensor>(0)->DataRaw();
   const auto elem_size = X->DataType()->Size();
-  int32_t num_batches = std::min<int32_t>(concurrency::ThreadPool::DegreeOfParallelism(ctx->GetOperatorThreadPool()) * 2, num_rows);
-
+  const size_t output_size = impl.output_size_;
+  const auto weighting_criteria = impl.weighting_criteria_;
   const auto& w = impl.weights_;
-  std::function<void(size_t, gsl::span<float>&)> fn_weight;
 
-  switch (impl.weighting_criteria_) {
-    case kTF:
-      fn_weight = [](size_t i, gsl::span<float>& out) { out[i] += 1.0f; };
-      break;
-    case kIDF:
-      if (!w.empty()) {
-        fn_weight = [&w](size_t i, gsl::span<float>& out) { out[i] = w[i]; };
-      } else {
-        fn_weight = [](size_t i, gsl::span<float>& out) { out[i] = 1.0f; };
-      }
-      break;
-    case kTFIDF:
-      if (!w.empty()) {
-        fn_weight = [&w](size_t i, gsl::span<float>& out) { out[i] += w[i]; };
-      } else {
-        fn_weight = [](size_t i, gsl::span<float>& out) { out[i] += 1.0f; };
-      }
-      break;
-    case kNone:  // fall-through
-    default:
-      assert(false);
-  }
-
-  std::function<void(ptrdiff_t)> fn = [this, C, output_data, x_data_raw, elem_size,
-                                       is_input_string, num_batches, num_rows, &fn_weight](ptrdiff_t batch_num) {
-    // Frequency holder allocate [B..output_size_] and init all to zero.
-    auto work = concurrency::ThreadPool::PartitionWork(batch_num, num_batches, static_cast<size_t>(num_rows));
-    for (auto row_num = work.start; row_num < work.end; ++row_num) {
-      auto out = gsl::span<float>(output_data + row_num * this->impl_->output_size_, this->impl_->output_size_);
+  // The rows are matched independently, ComputeImpl writes the n-gram counts
+  // and the weighting criteria is applied to the counts of each row.
+  auto fn = [this, C, output_data, output_size, x_data_raw, elem_size, is_input_string, weighting_criteria,
+             &w](std::ptrdiff_t first, std::ptrdiff_t last) {
+    std::vector<uint32_t> tokens;
+    for (auto row_num = first; row_num < last; ++row_num) {
+      auto out = gsl::span<float>(output_data + static_cast<size_t>(row_num) * output_size, output_size);
       std::fill(out.begin(), out.end(), 0.0f);
-      ComputeImpl(x_data_raw, elem_size, row_num, C, is_input_string, out, fn_weight);
+      ComputeImpl(x_data_raw, elem_size, row_num, C, is_input_string, tokens, out);
+
+      switch (weighting_criteria) {
+        case kTF:
+          break;
+        case kIDF:
+          for (size_t i = 0; i < output_size; ++i) {
+            if (out[i] > 0.0f) {
+              out[i] = w.empty() ? 1.0f : w[i];
+            }
+          }
+          break;
+        case kTFIDF:
+          if (!w.empty()) {
+            for (size_t i = 0; i < output_size; ++i) {
+              if (out[i] > 0.0f) {
+                out[i] *= w[i];
+              }
+            }
+          }
+          break;
+        case kNone:  // fall-through
+        default:
+          assert(false);
+      }
     }
   };
 
-  concurrency::ThreadPool::TrySimpleParallelFor(ctx->GetOperatorThreadPool(), num_batches, std::move(fn));
+  // Each row is looked up once and scanned once per skip distance.
+  const double cost_per_row = static_cast<double>(C) * static_cast<double>(impl.max_skip_count_ + 2) * 8.0;
+  concurrency::ThreadPool::TryParallelFor(ctx->GetOperatorThreadPool(), num_rows,
+                                          TensorOpCost{static_cast<double>(C * elem_size),
+                                                       static_cast<double>(output_size * sizeof(float)),
+                                                       cost_per_row},
+                                          fn);
   return Status::OK();
 }
 
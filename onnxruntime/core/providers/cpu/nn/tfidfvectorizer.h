@@ -19,8 +19,9 @@ class TfIdfVectorizer final : public OpKernel {
   Status Compute(OpKernelContext* ctx) const override;
 
  private:
+  // Adds the counts of the n-grams of the row to output_data. tokens is a scratch buffer.
   void ComputeImpl(const void* x_data_raw, size_t elem_size, ptrdiff_t row_num, size_t row_size, bool is_input_string,
-                   gsl::span<float> output_data, std::function<void(size_t, gsl::span<float>&)>& fn_weight) const;
+                   std::vector<uint32_t>& tokens, gsl::span<float> output_data) const;
 
   struct Impl;
   std::unique_ptr<Impl> impl_;
@@ -13,10 +13,12 @@ limitations under the License.
 
 #include "non_max_suppression.h"
 
-#include <queue>
+#include <algorithm>
 #include <utility>
+#include <vector>
 
 #include "core/common/narrow.h"
+#include "core/platform/threadpool.h"
 #include "non_max_suppression_helper.h"
 
 // TODO:fix the warnings
@@ -43,6 +45,117 @@ ONNX_OPERATOR_KERNEL_EX(
 
 using namespace nms_helpers;
 
+namespace {
+
+// Boxes as corners with their areas, in structure of arrays layout.
+struct BoxCorners {
+  std::vector<float> x_min;
+  std::vector<float> y_min;
+  std::vector<float> x_max;
+  std::vector<float> y_max;
+  std::vector<float> area;
+
+  size_t Size() const { return area.size(); }
+
+  void Clear() {
+    x_min.clear();
+    y_min.clear();
+    x_max.clear();
+    y_max.clear();
+    area.clear();
+  }
+
+  void Reserve(size_t size) {
+    x_min.reserve(size);
+    y_min.reserve(size);
+    x_max.reserve(size);
+    y_max.reserve(size);
+    area.reserve(size);
+  }
+
+  void PushBack(float box_x_min, float box_y_min, float box_x_max, float box_y_max) {
+    x_min.push_back(box_x_min);
+    y_min.push_back(box_y_min);
+    x_max.push_back(box_x_max);
+    y_max.push_back(box_y_max);
+    area.push_back((box_x_max - box_x_min) * (box_y_max - box_y_min));
+  }
+
+  void PushBack(const BoxCorners& other, size_t i) {
+    x_min.push_back(other.x_min[i]);
+    y_min.push_back(other.y_min[i]);
+    x_max.push_back(other.x_max[i]);
+    y_max.push_back(other.y_max[i]);
+    area.push_back(other.area[i]);
+  }
+};
+
+// Converts the boxes to corners the same way as SuppressByIOU does.
+void ToBoxCorners(const float* boxes_data, size_t num_boxes, int64_t center_point_box, BoxCorners& corners) {
+  corners.Reserve(corners.Size() + num_boxes);
+  for (size_t i = 0; i < num_boxes; ++i, boxes_data += 4) {
+    float x_min{};
+    float y_min{};
+    float x_max{};
+    float y_max{};
+    if (0 == center_point_box) {
+      // boxes data format [y1, x1, y2, x2],
+      MaxMin(boxes_data[1], boxes_data[3], x_min, x_max);
+      MaxMin(boxes_data[0], boxes_data[2], y_min, y_max);
+    } else {
+      // 1 == center_point_box_ => boxes data format [x_center, y_center, width, height]
+      const float width_half = boxes_data[2] / 2;
+      const float height_half = boxes_data[3] / 2;
+      x_min = boxes_data[0] - width_half;
+      x_max = boxes_data[0] + width_half;
+      y_min = boxes_data[1] - height_half;
+      y_max = boxes_data[1] + height_half;
+    }
+    corners.PushBack(x_min, y_min, x_max, y_max);
+  }
+}
+
+// Returns true if box i of boxes is suppressed by any of the selected boxes, with the same result as SuppressByIOU.
+// The selected boxes are compared in blocks without branches so that the compiler vectorizes the IOU computation,
+// and the search stops at the end of the first block that contains a suppressing box.
+bool SuppressedBySelected(const BoxCorners& boxes, size_t i, const BoxCorners& selected, float iou_threshold) {
+  const float x_min = boxes.x_min[i];
+  const float y_min = boxes.y_min[i];
+  const float x_max = boxes.x_max[i];
+  const float y_max = boxes.y_max[i];
+  const float area = boxes.area[i];
+  if (!(area > .0f)) {
+    return false;
+  }
+
+  constexpr size_t kBlockSize = 16;
+  const size_t num_selected = selected.Size();
+  const float* selected_x_min = selected.x_min.data();
+  const float* selected_y_min = selected.y_min.data();
+  const float* selected_x_max = selected.x_max.data();
+  const float* selected_y_max = selected.y_max.data();
+  const float* selected_area = selected.area.data();
+  for (size_t begin = 0; begin < num_selected; begin += kBlockSize) {
+    const size_t end = std::min(begin + kBlockSize, num_selected);
+    int suppressed = 0;
+    for (size_t j = begin; j < end; ++j) {
+      const float intersection_width = std::min(x_max, selected_x_max[j]) - std::max(x_min, selected_x_min[j]);
+      const float intersection_height = std::min(y_max, selected_y_max[j]) - std::max(y_min, selected_y_min[j]);
+      const float intersection_area = intersection_width * intersection_height;
+      const float union_area = area + selected_area[j] - intersection_area;
+      suppressed |= (intersection_width > .0f) & (intersection_height > .0f) & (intersection_area > .0f) &
+                    (selected_area[j] > .0f) & (union_area > .0f) &
+                    (intersection_area / union_area > iou_threshold);
+    }
+    if (suppressed) {
+      return true;
+    }
+  }
+  return false;
+}
+
+}  // namespace
+
 // This works for both CPU and GPU.
 // CUDA kernel declare OrtMemTypeCPUInput for max_output_boxes_per_class(2), iou_threshold(3) and score_threshold(4)
 Status NonMaxSuppressionBase::PrepareCompute(OpKernelContext* ctx, PrepareContext& pc) {
@@ -148,20 +261,31 @@ Status NonMaxSuppression::Compute(OpKernelContext* ctx) const {
   };
 
   const auto center_point_box = GetCenterPointBox();
+  const int64_t num_batches = pc.num_batches_;
+  const int64_t num_classes = pc.num_classes_;
+  const size_t num_boxes = static_cast<size_t>(pc.num_boxes_);
+  const size_t max_selected = std::min<size_t>(static_cast<size_t>(max_output_boxes_per_class), num_boxes);
 
-  std::vector<SelectedIndex> selected_indices;
-  std::vector<BoxInfoPtr> selected_boxes_inside_class;
-  selected_boxes_inside_class.reserve(std::min<size_t>(static_cast<size_t>(max_output_boxes_per_class), pc.num_boxes_));
+  // The corners of the boxes of every batch are computed once for all the classes.
+  BoxCorners boxes;
+  ToBoxCorners(boxes_data, static_cast<size_t>(num_batches) * num_boxes, center_point_box, boxes);
+
+  // Every (batch, class) pair is processed independently and collects its selected box indices.
+  std::vector<std::vector<int64_t>> selected_boxes_per_class(static_cast<size_t>(num_batches * num_classes));
 
-  for (int64_t batch_index = 0; batch_index < pc.num_batches_; ++batch_index) {
-    for (int64_t class_index = 0; class_index < pc.num_classes_; ++class_index) {
-      int64_t box_score_offset = (batch_index * pc.num_classes_ + class_index) * pc.num_boxes_;
-      const float* batch_boxes = boxes_data + (batch_index * pc.num_boxes_ * 4);
-      std::vector<BoxInfoPtr> candidate_boxes;
-      candidate_boxes.reserve(pc.num_boxes_);
+  auto select_boxes = [&](std::ptrdiff_t first, std::ptrdiff_t last) {
+    std::vector<BoxInfoPtr> candidate_boxes;
+    candidate_boxes.reserve(num_boxes);
+    BoxCorners selected_boxes_inside_class;
+    selected_boxes_inside_class.Reserve(max_selected);
+
+    for (std::ptrdiff_t batch_class = first; batch_class < last; ++batch_class) {
+      const int64_t batch_index = batch_class / num_classes;
+      const size_t batch_box_offset = static_cast<size_t>(batch_index) * num_boxes;
+      candidate_boxes.clear();
 
       // Filter by score_threshold_
-      const auto* class_scores = scores_data + box_score_offset;
+      const auto* class_scores = scores_data + batch_class * pc.num_boxes_;
       if (pc.score_threshold_ != nullptr) {
         for (int64_t box_index = 0; box_index < pc.num_boxes_; ++box_index, ++class_scores) {
           if (*class_scores > score_threshold) {
@@ -173,30 +297,49 @@ Status NonMaxSuppression::Compute(OpKernelContext* ctx) const {
           candidate_boxes.emplace_back(*class_scores, box_index);
         }
       }
-      std::priority_queue<BoxInfoPtr, std::vector<BoxInfoPtr>> sorted_boxes(std::less<BoxInfoPtr>(), std::move(candidate_boxes));
+      // The candidates are popped from a max-heap since usually far fewer boxes are selected than scored.
+      std::make_heap(candidate_boxes.begin(), candidate_boxes.end());
+      auto heap_end = candidate_boxes.end();
 
-      selected_boxes_inside_class.clear();
+      auto& selected_indices_inside_class = selected_boxes_per_class[batch_class];
+      selected_boxes_inside_class.Clear();
       // Get the next box with top score, filter by iou_threshold
-      while (!sorted_boxes.empty() && static_cast<int64_t>(selected_boxes_inside_class.size()) < max_output_boxes_per_class) {
-        const BoxInfoPtr& next_top_score = sorted_boxes.top();
+      while (heap_end != candidate_boxes.begin() && selected_indices_inside_class.size() < max_selected) {
+        std::pop_heap(candidate_boxes.begin(), heap_end);
+        --heap_end;
+        const BoxInfoPtr& next_top_score = *heap_end;
+        const size_t box = batch_box_offset + static_cast<size_t>(next_top_score.index_);
 
-        bool selected = true;
         // Check with existing selected boxes for this class, suppress if exceed the IOU (Intersection Over Union) threshold
-        for (const auto& selected_index : selected_boxes_inside_class) {
-          if (SuppressByIOU(batch_boxes, next_top_score.index_, selected_index.index_, center_point_box, iou_threshold)) {
-            selected = false;
-            break;
-          }
-        }
-
-        if (selected) {
-          selected_boxes_inside_class.push_back(next_top_score);
-          selected_indices.emplace_back(batch_index, class_index, next_top_score.index_);
+        if (!SuppressedBySelected(boxes, box, selected_boxes_inside_class, iou_threshold)) {
+          selected_boxes_inside_class.PushBack(boxes, box);
+          selected_indices_inside_class.push_back(next_top_score.index_);
         }
-        sorted_boxes.pop();
       }  // while
-    }  // for class_index
-  }  // for batch_index
+    }
+  };
+
+  // Sorting the candidates and comparing them with the selected boxes dominates the cost of a pair.
+  const double cost_per_class = static_cast<double>(num_boxes) * 32.0;
+  concurrency::ThreadPool::TryParallelFor(ctx->GetOperatorThreadPool(), num_batches * num_classes,
+                                          TensorOpCost{static_cast<double>(num_boxes * sizeof(float)),
+                                                       0.0,
+                                                       cost_per_class},
+                                          select_boxes);
+
+  std::vector<SelectedIndex> selected_indices;
+  size_t total_selected = 0;
+  for (const auto& selected_indices_inside_class : selected_boxes_per_class) {
+    total_selected += selected_indices_inside_class.size();
+  }
+  selected_indices.reserve(total_selected);
+  for (int64_t batch_index = 0; batch_index < num_batches; ++batch_index) {
+    for (int64_t class_index = 0; class_index < num_classes; ++class_index) {
+      for (const int64_t box_index : selected_boxes_per_class[batch_index * num_classes + class_index]) {
+        selected_indices.emplace_back(batch_index, class_index, box_index);
+      }
+    }
+  }
 
   constexpr auto last_dim = 3;
   const auto num_selected = selected_indices.size();
@@ -12,8 +12,10 @@
 #endif  // _MSC_VER
 
 #include <codecvt>
+#include <cstring>
 #include <locale>
 #include <functional>
+#include <string_view>
 
 #if defined(__GNUC__)
 // Allow deprecated-declarations warning - std::codecvt_utf8 is deprecatedd
@@ -33,6 +35,60 @@ ONNX_CPU_OPERATOR_KERNEL(
 
 namespace string_normalizer {
 
+// The ASCII fast path below works on 8 bytes at a time. As every byte of an ASCII string is below 0x80, adding a
+// constant below 0x80 to each byte never carries into the next one, and the high bit of each sum tells whether the
+// byte was at least a given value.
+constexpr uint64_t kHighBits = 0x8080808080808080ULL;
+
+constexpr uint64_t Broadcast(uint8_t byte) {
+  return 0x0101010101010101ULL * byte;
+}
+
+bool IsAscii(std::string_view str) {
+  const char* data = str.data();
+  const size_t size = str.size();
+  size_t i = 0;
+  uint64_t bits = 0;
+  for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, data + i, sizeof(word));
+    bits |= word;
+  }
+  for (; i < size; ++i) {
+    bits |= static_cast<unsigned char>(data[i]);
+  }
+  return (bits & kHighBits) == 0;
+}
+
+// Flips the case bit of the bytes of word in [first, last]. All the bytes of word must be ASCII.
+inline uint64_t FlipCaseInRange(uint64_t word, char first, char last) {
+  const uint64_t at_least_first = word + Broadcast(static_cast<uint8_t>(0x80 - first));
+  const uint64_t above_last = word + Broadcast(static_cast<uint8_t>(0x80 - last - 1));
+  const uint64_t in_range = at_least_first & ~above_last & kHighBits;
+  return word ^ (in_range >> 2);  // 0x80 >> 2 is the case bit 0x20
+}
+
+// Changes the case of the ASCII string src into dest.
+void ChangeCaseAscii(StringNormalizer::CaseAction caseaction, std::string_view src, std::string& dest) {
+  assert(caseaction != StringNormalizer::NONE);
+  const char first = caseaction == StringNormalizer::LOWER ? 'A' : 'a';
+  const char last = caseaction == StringNormalizer::LOWER ? 'Z' : 'z';
+  const size_t size = src.size();
+  dest.resize(size);
+  char* out = dest.data();
+  size_t i = 0;
+  for (; i + sizeof(uint64_t) <= size; i += sizeof(uint64_t)) {
+    uint64_t word;
+    std::memcpy(&word, src.data() + i, sizeof(word));
+    word = FlipCaseInRange(word, first, last);
+    std::memcpy(out + i, &word, sizeof(word));
+  }
+  for (; i < size; ++i) {
+    const char ch = src[i];
+    out[i] = ch >= first && ch <= last ? static_cast<char>(ch ^ 0x20) : ch;
+  }
+}
+
 // codecvt_utf8 is deprecated, we will want to replace it with our class
 class Utf8ConverterGeneric {
  public:
@@ -459,6 +515,9 @@ StringNormalizer::StringNormalizer(const OpKernelInfo& info) : OpKernel(info) {
   }
 
   locale_name_ = info.GetAttrOrDefault("locale", default_locale);
+  // Turkish and Azerbaijani map 'I' to the dotless U+0131 and 'i' to the dotted U+0130.
+  const auto language = locale_name_.substr(0, 2);
+  ascii_case_mapping_ = language != "tr" && language != "TR" && language != "az" && language != "AZ";
 
   std::vector<std::string> stop_words = info.GetAttrsOrDefault<std::string>("stopwords");
   if (is_case_sensitive_) {
@@ -473,6 +532,9 @@ StringNormalizer::StringNormalizer(const OpKernelInfo& info) : OpKernel(info) {
     for (std::string& s : stop_words) {
       std::wstring wstr = converter.from_bytes(s);
       locale.ChangeCase(compare_caseaction_, wstr);
+      std::string folded(converter.ComputeRequiredSizeToUtf8(wstr), '\0');
+      ORT_THROW_IF_ERROR(converter.ConvertToUtf8(wstr, folded));
+      folded_stopwords_.insert(std::move(folded));
       wstopwords_.insert(std::move(wstr));
     }
   }
@@ -525,9 +587,12 @@ Status StringNormalizer::Compute(OpKernelContext* ctx) const {
   Locale locale(locale_name_);
   Utf8Converter converter;
 
-  // Compute the largest widestring buffer needed.
+  // Compute the largest widestring buffer needed. ASCII strings do not need one if their case can be changed directly.
   size_t max_wide_buffer_len = 0;
   for (const auto& s : input_span) {
+    if (ascii_case_mapping_ && IsAscii(s)) {
+      continue;
+    }
     size_t wchars = 0;
     // Checks for invalid UTF-8 characters on Windows
     ORT_RETURN_IF_ERROR(converter.ComputeRequiredSizeToWideChar(s, wchars));
@@ -538,20 +603,24 @@ Status StringNormalizer::Compute(OpKernelContext* ctx) const {
   std::wstring wchar_buffer;
   wchar_buffer.reserve(max_wide_buffer_len);
 
+  auto change_case = [&](CaseAction caseaction, const std::string& s, std::string& dest) {
+    if (ascii_case_mapping_ && IsAscii(s)) {
+      ChangeCaseAscii(caseaction, s, dest);
+      return Status::OK();
+    }
+    wchar_buffer.resize(max_wide_buffer_len);
+    ORT_RETURN_IF_ERROR(converter.ConvertToWideChar(s, wchar_buffer));
+    locale.ChangeCase(caseaction, wchar_buffer);
+    dest.resize(converter.ComputeRequiredSizeToUtf8(wchar_buffer));
+    return converter.ConvertToUtf8(wchar_buffer, dest);
+  };
+
   // Output everything and change case as required
   auto output_no_filtering = [&](const TensorShape& output_shape) {
     auto output_tensor = ctx->Output(0, output_shape);
     auto const output_data = output_tensor->MutableData<std::string>();
     for (size_t i = 0, lim = input_span.size(); i < lim; ++i) {
-      const std::string& s = input_span[i];
-      wchar_buffer.resize(max_wide_buffer_len);
-      ORT_RETURN_IF_ERROR(converter.ConvertToWideChar(s, wchar_buffer));
-      locale.ChangeCase(case_change_action_, wchar_buffer);
-
-      auto& dest = output_data[i];
-      size_t utf8_buffer_len = converter.ComputeRequiredSizeToUtf8(wchar_buffer);
-      dest.resize(utf8_buffer_len);
-      ORT_RETURN_IF_ERROR(converter.ConvertToUtf8(wchar_buffer, dest));
+      ORT_RETURN_IF_ERROR(change_case(case_change_action_, input_span[i], output_data[i]));
     }
     return Status::OK();
   };
@@ -562,14 +631,7 @@ Status StringNormalizer::Compute(OpKernelContext* ctx) const {
     for (size_t i : filtered_indices) {
       const std::string& s = input_span[i];
       if (case_change_action_ != NONE) {
-        wchar_buffer.resize(max_wide_buffer_len);
-        ORT_RETURN_IF_ERROR(converter.ConvertToWideChar(s, wchar_buffer));
-        locale.ChangeCase(case_change_action_, wchar_buffer);
-
-        auto& dest = *output_data++;
-        size_t utf8_buffer_len = converter.ComputeRequiredSizeToUtf8(wchar_buffer);
-        dest.resize(utf8_buffer_len);
-        ORT_RETURN_IF_ERROR(converter.ConvertToUtf8(wchar_buffer, dest));
+        ORT_RETURN_IF_ERROR(change_case(case_change_action_, s, *output_data++));
       } else {
         *output_data++ = s;
       }
@@ -613,8 +675,16 @@ Status StringNormalizer::Compute(OpKernelContext* ctx) const {
       // Otherwise, we need to pull ICU library on all platforms.
       InlinedVector<size_t> filtered_strings_indices;
       filtered_strings_indices.reserve(input_span.size());
+      std::string folded_buffer;
       for (size_t i = 0, lim = input_span.size(); i < lim; ++i) {
         const std::string& s = input_span[i];
+        if (ascii_case_mapping_ && IsAscii(s)) {
+          ChangeCaseAscii(compare_caseaction_, s, folded_buffer);
+          if (folded_stopwords_.count(folded_buffer) == 0) {
+            filtered_strings_indices.push_back(i);
+          }
+          continue;
+        }
         wchar_buffer.resize(max_wide_buffer_len);
         ORT_RETURN_IF_ERROR(converter.ConvertToWideChar(s, wchar_buffer));
         locale.ChangeCase(compare_caseaction_, wchar_buffer);
@@ -31,9 +31,14 @@ class StringNormalizer : public OpKernel {
   // used for case-insensitive compare
   CaseAction compare_caseaction_{LOWER};
   std::string locale_name_;
+  // Whether the case of ASCII strings can be changed without going through the locale. This is not the case for
+  // the locales that map the ASCII 'I' and 'i' to non-ASCII characters.
+  bool ascii_case_mapping_{true};
   // Either if these are populated but not both
   InlinedHashSet<std::string> stopwords_;
   InlinedHashSet<std::wstring> wstopwords_;
+  // wstopwords_ converted back to UTF-8, used to filter the ASCII strings without converting them to wchar_t.
+  InlinedHashSet<std::string> folded_stopwords_;
 };
 
 }  // namespace onnxruntime
@@ -0,0 +1,196 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "core/providers/cpu/tunable/conv.h"
+
+#include <cstring>
+#include <sstream>
+
+#include "core/common/narrow.h"
+#include "core/common/safeint.h"
+#include "core/framework/tensor_shape.h"
+#include "core/platform/threadpool.h"
+#include "core/util/math_cpuonly.h"
+
+namespace onnxruntime {
+namespace cpu {
+namespace tunable {
+
+namespace {
+
+size_t OutputSize(const ConvParams& params) {
+  return SafeInt<size_t>(params.n) * params.m * TensorShape(params.output_shape).Size();
+}
+
+// Params for tuning that write Y to a scratch buffer, so that repeated runs do not accumulate into Y when beta != 0.
+struct ConvProxyParams : ConvParams {
+  explicit ConvProxyParams(const ConvParams& params) : ConvParams(params) {}
+
+  IAllocatorUniquePtr<float> proxy_y;
+};
+
+Status MlasConvImpl(const ConvParams* params, concurrency::ThreadPool* thread_pool) {
+  const size_t kernel_rank = params->kernel_shape.size();
+  TUNABLE_OP_RETURN_UNSUPPORTED_ARGUMENT_IF(kernel_rank < 1 || kernel_rank > 3,
+                                            "MLAS does not support ", kernel_rank, "D convolution");
+
+  MLAS_CONV_PARAMETERS parameters;
+  size_t working_buffer_size;
+  MlasConvPrepare(&parameters,
+                  kernel_rank,
+                  narrow<size_t>(params->n),
+                  narrow<size_t>(params->group),
+                  narrow<size_t>(params->c / params->group),
+                  params->input_shape.data(),
+                  params->kernel_shape.data(),
+                  params->dilations.data(),
+                  params->pads.data(),
+                  params->strides.data(),
+                  params->output_shape.data(),
+                  narrow<size_t>(params->m / params->group),
+                  params->activation,
+                  &working_buffer_size,
+                  params->beta,
+                  thread_pool);
+
+  auto working_buffer = working_buffer_size > 0
+                            ? IAllocator::MakeUniquePtr<float>(params->allocator, working_buffer_size)
+                            : IAllocatorUniquePtr<float>{};
+
+  MlasConv(&parameters,
+           params->x,
+           params->w,
+           params->b,
+           working_buffer.get(),
+           params->y,
+           thread_pool);
+  return Status::OK();
+}
+
+Status MlasConvOp(const ConvParams* params) {
+  return MlasConvImpl(params, params->thread_pool);
+}
+
+Status MlasConvSingleThreadedOp(const ConvParams* params) {
+  TUNABLE_OP_RETURN_UNSUPPORTED_ARGUMENT_IF(
+      concurrency::ThreadPool::DegreeOfParallelism(params->thread_pool) <= 1,
+      "Same as the default kernel without a thread pool");
+  return MlasConvImpl(params, nullptr);
+}
+
+void AppendDims(std::ostringstream& oss, gsl::span<const int64_t> dims) {
+  oss << "_";
+  for (size_t i = 0; i < dims.size(); ++i) {
+    oss << (i == 0 ? "" : "x") << dims[i];
+  }
+}
+
+}  // namespace
+
+std::string ConvParams::Signature() const {
+  std::ostringstream oss;
+  oss << n << "_" << c << "_" << m << "_" << group;
+  AppendDims(oss, input_shape);
+  AppendDims(oss, kernel_shape);
+  AppendDims(oss, pads);
+  AppendDims(oss, dilations);
+  AppendDims(oss, strides);
+  oss << "_" << static_cast<int>(activation->ActivationKind) << "_" << (b != nullptr ? "B" : "NB")
+      << "_" << beta << "_" << concurrency::ThreadPool::DegreeOfParallelism(thread_pool);
+  return oss.str();
+}
+
+Status ConvIm2Col(const ConvParams* params) {
+  const int64_t input_image_size = TensorShape(params->input_shape).Size();
+  const int64_t output_image_size = TensorShape(params->output_shape).Size();
+  const int64_t kernel_size = TensorShape(params->kernel_shape).Size();
+  const int64_t group = params->group;
+  const SafeInt<int64_t> X_offset = SafeInt<int64_t>(params->c) / group * input_image_size;
+  const SafeInt<int64_t> Y_offset = SafeInt<int64_t>(params->m) * output_image_size / group;
+  const SafeInt<int64_t> W_offset = SafeInt<int64_t>(params->m) / group * params->c / group * kernel_size;
+  const SafeInt<int64_t> kernel_dim = SafeInt<int64_t>(params->c) / group * kernel_size;
+  const int64_t col_buffer_size = kernel_dim * output_image_size;
+
+  auto col_data = IAllocator::MakeUniquePtr<float>(params->allocator, narrow<size_t>(col_buffer_size));
+  const float* Xdata = params->x;
+  float* Ydata = params->y;
+  for (int64_t image_id = 0; image_id < params->n; ++image_id) {
+    for (int64_t group_id = 0; group_id < group; ++group_id) {
+      math::Im2col<float, StorageOrder::NCHW>()(
+          Xdata + group_id * X_offset,
+          params->input_shape.data(),
+          params->output_shape.data(),
+          kernel_dim,
+          params->kernel_shape.data(),
+          params->strides.data(),
+          params->dilations.data(),
+          params->pads.data(),
+          narrow<int>(params->kernel_shape.size()),
+          col_data.get());
+
+      math::Gemm<float>(
+          CblasNoTrans,
+          CblasNoTrans,
+          narrow<ptrdiff_t>(params->m / group),
+          narrow<ptrdiff_t>(output_image_size),
+          narrow<ptrdiff_t>(kernel_dim),
+          1,
+          params->w + group_id * W_offset,
+          col_data.get(),
+          params->beta,
+          Ydata + group_id * Y_offset,
+          params->thread_pool);
+    }
+
+    MlasActivation(params->activation, Ydata, params->b, narrow<size_t>(params->m),
+                   narrow<size_t>(output_image_size), narrow<size_t>(output_image_size));
+
+    Xdata += X_offset * group;
+    Ydata += Y_offset * group;
+  }
+  return Status::OK();
+}
+
+ConvTunableOp::ConvTunableOp() {
+  this->RegisterOp(MlasConvOp);
+  this->RegisterOp(MlasConvSingleThreadedOp);
+  this->RegisterOp(ConvIm2Col);
+}
+
+const ConvParams* ConvTunableOp::PreTuning(const ConvParams* params) {
+  if (params->beta == 0.0f) {
+    return params;
+  }
+
+  auto* proxy = new ConvProxyParams(*params);
+  const size_t output_size = OutputSize(*params);
+  proxy->proxy_y = IAllocator::MakeUniquePtr<float>(params->allocator, output_size);
+  std::memcpy(proxy->proxy_y.get(), params->y, output_size * sizeof(float));
+  proxy->y = proxy->proxy_y.get();
+  return proxy;
+}
+
+void ConvTunableOp::PostTuning(const ConvParams* params) {
+  if (params->beta != 0.0f) {
+    delete static_cast<const ConvProxyParams*>(params);
+  }
+}
+
+Status Conv(const ConvParams& params) {
+  const size_t kernel_rank = params.kernel_shape.size();
+  if (params.tuning_ctx != nullptr && params.tuning_ctx->IsTunableOpEnabled()) {
+    static ConvTunableOp conv{};
+    // The default kernel of the tunable op only supports what MLAS supports.
+    if (kernel_rank >= 1 && kernel_rank <= 3) {
+      return conv(&params);
+    }
+  }
+  if (kernel_rank >= 1 && kernel_rank <= 3) {
+    return MlasConvOp(&params);
+  }
+  return ConvIm2Col(&params);
+}
+
+}  // namespace tunable
+}  // namespace cpu
+}  // namespace onnxruntime
@@ -0,0 +1,63 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <string>
+
+#include <gsl/gsl>
+
+#include "core/framework/allocator.h"
+#include "core/mlas/inc/mlas.h"
+#include "core/providers/cpu/tunable/cpu_tunable.h"
+
+namespace onnxruntime {
+namespace cpu {
+namespace tunable {
+
+// A float NCHW convolution with optional bias, activation and accumulation into the output (beta = 1).
+struct ConvParams : OpParams {
+  std::string Signature() const override;
+
+  int64_t n;                                // batch
+  int64_t c;                                // input channels
+  int64_t m;                                // output channels
+  int64_t group;
+  gsl::span<const int64_t> input_shape;     // spatial dimensions of X
+  gsl::span<const int64_t> output_shape;    // spatial dimensions of Y
+  gsl::span<const int64_t> kernel_shape;
+  gsl::span<const int64_t> pads;
+  gsl::span<const int64_t> dilations;
+  gsl::span<const int64_t> strides;
+  const MLAS_ACTIVATION* activation;
+  float beta;
+
+  const float* x;
+  const float* w;
+  const float* b;  // optional
+  float* y;
+
+  concurrency::ThreadPool* thread_pool;
+  AllocatorPtr allocator;
+};
+
+// Chooses between the MLAS convolution, which picks its own algorithm and thread partitioning, MLAS without
+// the thread pool, and explicit im2col followed by a GEMM.
+class ConvTunableOp : public TunableOp<ConvParams> {
+ public:
+  ConvTunableOp();
+
+  const ConvParams* PreTuning(const ConvParams* params) override;
+  void PostTuning(const ConvParams* params) override;
+};
+
+// im2col + GEMM convolution. Supports any number of spatial dimensions.
+Status ConvIm2Col(const ConvParams* params);
+
+// Runs the convolution with the kernel selected by tuning if TunableOp is enabled in params.tuning_ctx,
+// otherwise with MLAS for 1 to 3 spatial dimensions and with im2col for more.
+Status Conv(const ConvParams& params);
+
+}  // namespace tunable
+}  // namespace cpu
+}  // namespace onnxruntime
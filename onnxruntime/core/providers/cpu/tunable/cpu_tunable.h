@@ -0,0 +1,54 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <chrono>
+
+#include "core/framework/tunable.h"
+#include "core/providers/cpu/tunable/cpu_tuning_context.h"
+
+namespace onnxruntime {
+
+namespace concurrency {
+class ThreadPool;
+}
+
+namespace cpu {
+namespace tunable {
+
+// CPU kernels run synchronously on the calling thread, so there is no stream to time on.
+using NativeStream = void*;
+
+class Timer : public ITimer<NativeStream> {
+ public:
+  using TimerBase = ITimer<NativeStream>;
+
+  explicit Timer(NativeStream stream) : TimerBase{stream} {}
+
+  void Start() override { start_ = std::chrono::steady_clock::now(); }
+  void End() override { end_ = std::chrono::steady_clock::now(); }
+  float Duration() override {
+    return std::chrono::duration_cast<std::chrono::duration<float, std::milli>>(end_ - start_).count();
+  }
+
+ private:
+  std::chrono::steady_clock::time_point start_;
+  std::chrono::steady_clock::time_point end_;
+};
+
+using OpParams = OpParams<CpuTuningContext, NativeStream>;
+
+template <typename ParamsT>
+using Op = Op<ParamsT>;
+
+template <typename ParamsT>
+using TunableOp = TunableOp<ParamsT, Timer>;
+
+// Returns the tuning context of ep if it is the CPU execution provider, otherwise nullptr.
+// Kernels should check IsTunableOpEnabled() on every run, as it may be enabled after they are created.
+CpuTuningContext* GetTuningContext(const IExecutionProvider* ep);
+
+}  // namespace tunable
+}  // namespace cpu
+}  // namespace onnxruntime
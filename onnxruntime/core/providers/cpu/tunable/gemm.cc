@@ -0,0 +1,148 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "core/providers/cpu/tunable/gemm.h"
+
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#include "core/common/safeint.h"
+#include "core/platform/threadpool.h"
+
+namespace onnxruntime {
+namespace cpu {
+namespace tunable {
+
+namespace {
+
+// Number of elements of C written by one GEMM of the batch.
+size_t OutputExtent(const GemmParams& params, size_t ldc) {
+  return SafeInt<size_t>(params.m - 1) * ldc + params.n;
+}
+
+bool HasBeta(const GemmParams& params) {
+  return std::any_of(params.data, params.data + params.batch,
+                     [](const MLAS_SGEMM_DATA_PARAMS& data) { return data.beta != 0.0f; });
+}
+
+// Params for tuning that write C to scratch buffers, so that repeated runs do not accumulate into C when beta != 0.
+struct GemmProxyParams : GemmParams {
+  explicit GemmProxyParams(const GemmParams& params) : GemmParams(params) {}
+
+  std::vector<MLAS_SGEMM_DATA_PARAMS> proxy_data;
+  IAllocatorUniquePtr<float> proxy_c;
+};
+
+Status MlasGemmOp(const GemmParams* params) {
+  MlasGemmBatch(params->trans_a, params->trans_b, params->m, params->n, params->k,
+                params->data, params->batch, params->thread_pool);
+  return Status::OK();
+}
+
+Status MlasGemmSingleThreadedOp(const GemmParams* params) {
+  TUNABLE_OP_RETURN_UNSUPPORTED_ARGUMENT_IF(
+      concurrency::ThreadPool::DegreeOfParallelism(params->thread_pool) <= 1,
+      "Same as the default kernel without a thread pool");
+  MlasGemmBatch(params->trans_a, params->trans_b, params->m, params->n, params->k,
+                params->data, params->batch, nullptr);
+  return Status::OK();
+}
+
+// One whole GEMM per task, instead of MLAS partitioning every GEMM across the threads.
+Status MlasGemmPerBatchOp(const GemmParams* params) {
+  TUNABLE_OP_RETURN_UNSUPPORTED_ARGUMENT_IF(params->batch < 2, "Batch size ", params->batch, " is too small");
+  TUNABLE_OP_RETURN_UNSUPPORTED_ARGUMENT_IF(
+      concurrency::ThreadPool::DegreeOfParallelism(params->thread_pool) <= 1,
+      "Same as the single threaded kernel without a thread pool");
+  concurrency::ThreadPool::TrySimpleParallelFor(
+      params->thread_pool, static_cast<std::ptrdiff_t>(params->batch), [params](std::ptrdiff_t i) {
+        MlasGemmBatch(params->trans_a, params->trans_b, params->m, params->n, params->k,
+                      params->data + i, 1, nullptr);
+      });
+  return Status::OK();
+}
+
+// Packs a B shared by the whole batch once, instead of MLAS packing panels of B for every GEMM.
+Status MlasGemmPackedBOp(const GemmParams* params) {
+  const MLAS_SGEMM_DATA_PARAMS& first = params->data[0];
+  TUNABLE_OP_RETURN_UNSUPPORTED_ARGUMENT_IF(first.BIsPacked, "B is already packed");
+  TUNABLE_OP_RETURN_UNSUPPORTED_ARGUMENT_IF(params->allocator == nullptr, "No allocator for the packed buffer");
+  const bool shared_b = std::all_of(params->data, params->data + params->batch,
+                                    [&first](const MLAS_SGEMM_DATA_PARAMS& data) {
+                                      return !data.BIsPacked && data.B == first.B && data.ldb == first.ldb;
+                                    });
+  TUNABLE_OP_RETURN_UNSUPPORTED_ARGUMENT_IF(!shared_b, "B is not shared by the batch");
+
+  const size_t packed_b_size = MlasGemmPackBSize(params->n, params->k);
+  TUNABLE_OP_RETURN_UNSUPPORTED_ARGUMENT_IF(packed_b_size == 0, "Packing is not supported on this platform");
+
+  auto packed_b = IAllocator::MakeUniquePtr<void>(params->allocator, packed_b_size, true);
+  MlasGemmPackB(params->trans_b, params->n, params->k, first.B, first.ldb, packed_b.get());
+
+  std::vector<MLAS_SGEMM_DATA_PARAMS> data(params->data, params->data + params->batch);
+  for (auto& d : data) {
+    d.B = static_cast<const float*>(packed_b.get());
+    d.BIsPacked = true;
+  }
+  MlasGemmBatch(params->trans_a, params->trans_b, params->m, params->n, params->k,
+                data.data(), data.size(), params->thread_pool);
+  return Status::OK();
+}
+
+}  // namespace
+
+std::string GemmParams::Signature() const {
+  return MakeString(trans_a == CblasTrans ? "T" : "N", trans_b == CblasTrans ? "T" : "N", "_",
+                    m, "_", n, "_", k, "_", batch, "_", data[0].BIsPacked ? "P" : "U", "_",
+                    concurrency::ThreadPool::DegreeOfParallelism(thread_pool));
+}
+
+GemmTunableOp::GemmTunableOp() {
+  this->RegisterOp(MlasGemmOp);
+  this->RegisterOp(MlasGemmSingleThreadedOp);
+  this->RegisterOp(MlasGemmPerBatchOp);
+  this->RegisterOp(MlasGemmPackedBOp);
+}
+
+const GemmParams* GemmTunableOp::PreTuning(const GemmParams* params) {
+  if (!HasBeta(*params)) {
+    return params;
+  }
+
+  ORT_ENFORCE(params->allocator != nullptr, "An allocator is required to tune GEMM with beta != 0");
+  auto* proxy = new GemmProxyParams(*params);
+  proxy->proxy_data.assign(params->data, params->data + params->batch);
+  size_t total = 0;
+  for (const auto& data : proxy->proxy_data) {
+    total += OutputExtent(*params, data.ldc);
+  }
+  proxy->proxy_c = IAllocator::MakeUniquePtr<float>(params->allocator, total);
+  float* c = proxy->proxy_c.get();
+  for (auto& data : proxy->proxy_data) {
+    const size_t extent = OutputExtent(*params, data.ldc);
+    std::memcpy(c, data.C, extent * sizeof(float));
+    data.C = c;
+    c += extent;
+  }
+  proxy->data = proxy->proxy_data.data();
+  return proxy;
+}
+
+void GemmTunableOp::PostTuning(const GemmParams* params) {
+  if (HasBeta(*params)) {
+    delete static_cast<const GemmProxyParams*>(params);
+  }
+}
+
+Status Gemm(const GemmParams& params) {
+  if (params.tuning_ctx != nullptr && params.tuning_ctx->IsTunableOpEnabled()) {
+    static GemmTunableOp gemm{};
+    return gemm(&params);
+  }
+  return MlasGemmOp(&params);
+}
+
+}  // namespace tunable
+}  // namespace cpu
+}  // namespace onnxruntime
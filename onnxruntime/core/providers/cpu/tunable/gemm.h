@@ -0,0 +1,48 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <string>
+
+#include "core/framework/allocator.h"
+#include "core/mlas/inc/mlas.h"
+#include "core/providers/cpu/tunable/cpu_tunable.h"
+
+namespace onnxruntime {
+namespace cpu {
+namespace tunable {
+
+// A batch of single precision GEMMs of the same shape, as accepted by MlasGemmBatch.
+struct GemmParams : OpParams {
+  std::string Signature() const override;
+
+  CBLAS_TRANSPOSE trans_a;
+  CBLAS_TRANSPOSE trans_b;
+  size_t m;
+  size_t n;
+  size_t k;
+  const MLAS_SGEMM_DATA_PARAMS* data;
+  size_t batch;
+  concurrency::ThreadPool* thread_pool;
+  // Used for scratch buffers, e.g. to pack B at run time.
+  AllocatorPtr allocator;
+};
+
+// Chooses between the MLAS partitioning across the thread pool, a single threaded run, one GEMM per thread,
+// and packing a shared B once per call.
+class GemmTunableOp : public TunableOp<GemmParams> {
+ public:
+  GemmTunableOp();
+
+  const GemmParams* PreTuning(const GemmParams* params) override;
+  void PostTuning(const GemmParams* params) override;
+};
+
+// Runs the GEMMs with the kernel selected by tuning if TunableOp is enabled in params.tuning_ctx,
+// otherwise with MlasGemmBatch.
+Status Gemm(const GemmParams& params);
+
+}  // namespace tunable
+}  // namespace cpu
+}  // namespace onnxruntime
@@ -314,5 +314,38 @@ public:
     }
 };
 
+void CALLBACK QueryGroupQueryAttention(IMLOperatorSupportQueryContextPrivate* context, /*out*/ bool* isSupported)
+{
+    *isSupported = false;
+
+    // A KV cache of another type than the inputs (T_CACHE != T) is not supported yet
+    MLOperatorEdgeDescription queryEdgeDescription = {};
+    if (FAILED(context->GetInputEdgeDescription(0, &queryEdgeDescription)))
+    {
+        return;
+    }
+    for (uint32_t i = 3; i <= 4; ++i)
+    {
+        if (!context->IsInputValid(i))
+        {
+            continue;
+        }
+        MLOperatorEdgeDescription pastEdgeDescription = {};
+        if (FAILED(context->GetInputEdgeDescription(i, &pastEdgeDescription)) ||
+            pastEdgeDescription.tensorDataType != queryEdgeDescription.tensorDataType)
+        {
+            return;
+        }
+    }
+
+    // The `past_key_scale` and `past_value_scale` inputs of an int8 KV cache are not supported yet
+    if (context->IsInputValid(10) || context->IsInputValid(11))
+    {
+        return;
+    }
+
+    *isSupported = true;
+}
+
 DML_OP_DEFINE_CREATION_FUNCTION(GroupQueryAttention, DmlOperatorGroupQueryAttention);
 } // namespace Dml
@@ -0,0 +1,511 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "core/session/batching_session.h"
+
+#include <algorithm>
+#include <cstring>
+#include <memory>
+
+#include "core/common/inlined_containers.h"
+#include "core/common/safeint.h"
+#include "core/framework/tensor.h"
+#include "core/graph/node_arg.h"
+#include "core/session/inference_session.h"
+
+namespace onnxruntime {
+
+namespace {
+
+InlinedVector<int64_t> RowMajorStrides(gsl::span<const int64_t> dims) {
+  InlinedVector<int64_t> strides(dims.size(), 1);
+  for (size_t i = dims.size(); i > 1; --i) {
+    strides[i - 2] = strides[i - 1] * dims[i - 1];
+  }
+  return strides;
+}
+
+// Copy a block of shape block_dims between two tensors of the same rank. The block starts at
+// src_offset along axis in src and at dst_offset along axis in dst, and at 0 in every other dimension.
+void CopyBlock(const void* src, gsl::span<const int64_t> src_dims, int64_t src_offset,
+               void* dst, gsl::span<const int64_t> dst_dims, int64_t dst_offset,
+               gsl::span<const int64_t> block_dims, size_t axis, size_t element_size) {
+  const size_t rank = block_dims.size();
+  for (auto dim : block_dims) {
+    if (dim == 0) {
+      return;
+    }
+  }
+
+  const auto src_strides = RowMajorStrides(src_dims);
+  const auto dst_strides = RowMajorStrides(dst_dims);
+
+  // Fold the trailing dimensions that are complete in src, dst and the block into one contiguous run.
+  size_t outer_rank = rank;
+  int64_t run = 1;
+  while (outer_rank > 0) {
+    const size_t d = --outer_rank;
+    run *= block_dims[d];
+    if (block_dims[d] != src_dims[d] || block_dims[d] != dst_dims[d]) {
+      break;
+    }
+  }
+  const size_t run_bytes = SafeInt<size_t>(run) * element_size;
+
+  const auto* src_base = static_cast<const uint8_t*>(src) + src_offset * src_strides[axis] * element_size;
+  auto* dst_base = static_cast<uint8_t*>(dst) + dst_offset * dst_strides[axis] * element_size;
+
+  InlinedVector<int64_t> index(outer_rank, 0);
+  for (;;) {
+    int64_t src_elem = 0;
+    int64_t dst_elem = 0;
+    for (size_t d = 0; d < outer_rank; ++d) {
+      src_elem += index[d] * src_strides[d];
+      dst_elem += index[d] * dst_strides[d];
+    }
+    std::memcpy(dst_base + dst_elem * element_size, src_base + src_elem * element_size, run_bytes);
+
+    size_t d = outer_rank;
+    for (; d > 0; --d) {
+      if (++index[d - 1] < block_dims[d - 1]) {
+        break;
+      }
+      index[d - 1] = 0;
+    }
+    if (d == 0) {
+      break;
+    }
+  }
+}
+
+}  // namespace
+
+BatchingSession::BatchingSession(InferenceSession& session, const BatchingOptions& options)
+    : session_(session), options_(options) {
+  ORT_ENFORCE(options_.max_batch_size > 0, "max_batch_size must be positive. Got ", options_.max_batch_size);
+  ORT_ENFORCE(options_.max_delay_us >= 0, "max_delay_us must not be negative. Got ", options_.max_delay_us);
+  ORT_ENFORCE(options_.batch_axis >= 0, "batch_axis must not be negative. Got ", options_.batch_axis);
+  ORT_ENFORCE(options_.num_workers > 0, "num_workers must be positive. Got ", options_.num_workers);
+  InitOutputInfo();
+
+  workers_.reserve(options_.num_workers);
+  for (int i = 0; i < options_.num_workers; ++i) {
+    workers_.emplace_back([this]() { WorkerLoop(); });
+  }
+}
+
+BatchingSession::~BatchingSession() {
+  {
+    std::lock_guard<OrtMutex> lock(mutex_);
+    shutdown_ = true;
+  }
+  queue_cv_.notify_all();
+  // Workers drain the queue before they exit.
+  for (auto& worker : workers_) {
+    worker.join();
+  }
+}
+
+common::Status BatchingSession::Run(gsl::span<const std::string> feed_names, gsl::span<const OrtValue> feeds,
+                                    gsl::span<const std::string> output_names, std::vector<OrtValue>& fetches) {
+  ORT_RETURN_IF_NOT(feed_names.size() == feeds.size(), "Number of feed names (", feed_names.size(),
+                    ") does not match the number of feeds (", feeds.size(), ").");
+
+  Request request;
+  request.feed_names = feed_names;
+  request.feeds = feeds;
+  request.output_names = output_names;
+  request.fetches = &fetches;
+  // Pre-allocated fetches must be written in place, which a batched Run can not do.
+  const bool preallocated_fetches = std::any_of(fetches.begin(), fetches.end(),
+                                                [](const OrtValue& fetch) { return fetch.IsAllocated(); });
+  request.rows = preallocated_fetches ? -1 : BatchRows(feeds);
+  request.enqueue_time = Clock::now();
+
+  {
+    std::unique_lock<OrtMutex> lock(mutex_);
+    ORT_RETURN_IF(shutdown_, "BatchingSession is shutting down.");
+    queue_.push_back(&request);
+  }
+  queue_cv_.notify_all();
+
+  {
+    std::unique_lock<OrtMutex> lock(mutex_);
+    while (!request.done) {
+      done_cv_.wait(lock);
+    }
+  }
+
+  num_requests_.fetch_add(1, std::memory_order_relaxed);
+  request_latency_.Record(
+      std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - request.enqueue_time).count());
+  return request.status;
+}
+
+common::Status BatchingSession::Run(gsl::span<const char* const> feed_names, gsl::span<const OrtValue* const> feeds,
+                                    gsl::span<const char* const> fetch_names, gsl::span<OrtValue*> fetches) {
+  ORT_RETURN_IF_NOT(feed_names.size() == feeds.size() && fetch_names.size() == fetches.size(),
+                    "Mismatched number of names and values.");
+  std::vector<std::string> feed_name_vec;
+  feed_name_vec.reserve(feed_names.size());
+  std::vector<OrtValue> feed_vec;
+  feed_vec.reserve(feeds.size());
+  for (size_t i = 0; i != feed_names.size(); ++i) {
+    if (feed_names[i] == nullptr || feed_names[i][0] == '\0') {
+      return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT, "input name cannot be empty");
+    }
+    if (!feeds[i]) {
+      return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT, "NULL input supplied for input ", feed_names[i]);
+    }
+    feed_name_vec.emplace_back(feed_names[i]);
+    feed_vec.emplace_back(*feeds[i]);
+  }
+
+  std::vector<std::string> fetch_name_vec;
+  fetch_name_vec.reserve(fetch_names.size());
+  std::vector<OrtValue> fetch_vec;
+  fetch_vec.reserve(fetch_names.size());
+  for (size_t i = 0; i != fetch_names.size(); ++i) {
+    if (fetch_names[i] == nullptr || fetch_names[i][0] == '\0') {
+      return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT, "output name cannot be empty");
+    }
+    fetch_name_vec.emplace_back(fetch_names[i]);
+    fetch_vec.emplace_back(fetches[i] != nullptr ? *fetches[i] : OrtValue());
+  }
+
+  ORT_RETURN_IF_ERROR(Run(feed_name_vec, feed_vec, fetch_name_vec, fetch_vec));
+
+  // We do it in two loops to make sure copy __ctors does not throw
+  InlinedVector<std::unique_ptr<OrtValue>> fetch_unique_ptrs;
+  fetch_unique_ptrs.reserve(fetch_names.size());
+  for (size_t i = 0; i != fetch_names.size(); ++i) {
+    fetch_unique_ptrs.emplace_back(fetches[i] == nullptr ? std::make_unique<OrtValue>(fetch_vec[i]) : nullptr);
+  }
+  for (size_t i = 0; i != fetch_names.size(); ++i) {
+    if (fetches[i] == nullptr) {
+      fetches[i] = fetch_unique_ptrs[i].release();
+    }
+  }
+  return common::Status::OK();
+}
+
+BatchingSession::Stats BatchingSession::GetStats() const {
+  Stats stats;
+  stats.request_latency = request_latency_.GetSnapshot();
+  stats.queue_latency = queue_latency_.GetSnapshot();
+  stats.num_requests = num_requests_.load(std::memory_order_relaxed);
+  stats.num_batches = num_batches_.load(std::memory_order_relaxed);
+  return stats;
+}
+
+void BatchingSession::InitOutputInfo() {
+  const auto inputs = session_.GetModelInputs();
+  ORT_THROW_IF_ERROR(inputs.first);
+  const auto outputs = session_.GetModelOutputs();
+  ORT_THROW_IF_ERROR(outputs.first);
+
+  // The first input dimension with each symbolic name.
+  std::unordered_map<std::string, std::pair<std::string, size_t>> named_dims;
+  for (const NodeArg* input : *inputs.second) {
+    const auto* shape = input->Shape();
+    if (shape == nullptr) {
+      continue;
+    }
+    for (int d = 0; d < shape->dim_size(); ++d) {
+      if (shape->dim(d).has_dim_param()) {
+        named_dims.emplace(shape->dim(d).dim_param(), std::make_pair(input->Name(), static_cast<size_t>(d)));
+      }
+    }
+  }
+
+  const auto axis = gsl::narrow<size_t>(options_.batch_axis);
+  for (const NodeArg* output : *outputs.second) {
+    OutputInfo& info = output_info_[output->Name()];
+    const auto* shape = output->Shape();
+    if (shape == nullptr) {
+      continue;
+    }
+    for (int d = 0; d < shape->dim_size(); ++d) {
+      if (!shape->dim(d).has_dim_param()) {
+        continue;
+      }
+      auto it = named_dims.find(shape->dim(d).dim_param());
+      if (it == named_dims.end()) {
+        continue;
+      }
+      const auto& [input_name, input_dim] = it->second;
+      if (static_cast<size_t>(d) == axis) {
+        info.batched = input_dim == axis;
+      } else if (input_dim != axis) {
+        info.input_dims.push_back({static_cast<size_t>(d), input_name, input_dim});
+      }
+    }
+  }
+}
+
+int64_t BatchingSession::BatchRows(gsl::span<const OrtValue> feeds) const {
+  const auto axis = gsl::narrow<size_t>(options_.batch_axis);
+  int64_t rows = -1;
+  for (const auto& feed : feeds) {
+    if (!feed.IsTensor()) {
+      return -1;
+    }
+    const auto& tensor = feed.Get<Tensor>();
+    if (tensor.IsDataTypeString() || tensor.Location().device.Type() != OrtDevice::CPU ||
+        tensor.Shape().NumDimensions() <= axis) {
+      return -1;
+    }
+    const int64_t feed_rows = tensor.Shape()[axis];
+    if (rows != -1 && feed_rows != rows) {
+      return -1;
+    }
+    rows = feed_rows;
+  }
+  return rows;
+}
+
+bool BatchingSession::Compatible(const Request& a, const Request& b) const {
+  if (a.rows < 0 || b.rows < 0 ||
+      !std::equal(a.feed_names.begin(), a.feed_names.end(), b.feed_names.begin(), b.feed_names.end()) ||
+      !std::equal(a.output_names.begin(), a.output_names.end(), b.output_names.begin(), b.output_names.end())) {
+    return false;
+  }
+
+  const auto axis = gsl::narrow<size_t>(options_.batch_axis);
+  for (size_t i = 0; i < a.feeds.size(); ++i) {
+    const auto& ta = a.feeds[i].Get<Tensor>();
+    const auto& tb = b.feeds[i].Get<Tensor>();
+    if (ta.DataType() != tb.DataType()) {
+      return false;
+    }
+    auto dims_a = ta.Shape().GetDims();
+    auto dims_b = tb.Shape().GetDims();
+    if (dims_a.size() != dims_b.size()) {
+      return false;
+    }
+    if (!options_.allow_padding) {
+      for (size_t d = 0; d < dims_a.size(); ++d) {
+        if (d != axis && dims_a[d] != dims_b[d]) {
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+void BatchingSession::WorkerLoop() {
+  std::unique_lock<OrtMutex> lock(mutex_);
+  for (;;) {
+    while (queue_.empty() && !shutdown_) {
+      queue_cv_.wait(lock);
+    }
+    if (queue_.empty()) {
+      return;
+    }
+
+    Request* front = queue_.front();
+    if (front->rows >= 0) {
+      // Wait for more rows until the batch is full or the oldest request has waited long enough.
+      const auto deadline = front->enqueue_time + std::chrono::microseconds(options_.max_delay_us);
+      while (!shutdown_) {
+        int64_t rows = 0;
+        for (const Request* request : queue_) {
+          if (Compatible(*front, *request)) {
+            rows += request->rows;
+          }
+        }
+        const auto now = Clock::now();
+        if (rows >= options_.max_batch_size || now >= deadline) {
+          break;
+        }
+        queue_cv_.wait_for(lock, deadline - now);
+        if (queue_.empty() || queue_.front() != front) {
+          break;
+        }
+      }
+      if (queue_.empty() || queue_.front() != front) {
+        // Another worker took the request.
+        continue;
+      }
+    }
+
+    auto batch = TakeBatch();
+    lock.unlock();
+    RunBatch(batch);
+    lock.lock();
+  }
+}
+
+std::vector<BatchingSession::Request*> BatchingSession::TakeBatch() {
+  std::vector<Request*> batch{queue_.front()};
+  queue_.pop_front();
+
+  const Request& front = *batch.front();
+  if (front.rows < 0) {
+    return batch;
+  }
+
+  // Requests are taken in FIFO order. A request that would overflow the batch is left for the next one.
+  int64_t rows = front.rows;
+  for (auto it = queue_.begin(); it != queue_.end() && rows < options_.max_batch_size;) {
+    Request* request = *it;
+    if (Compatible(front, *request) && rows + request->rows <= options_.max_batch_size) {
+      rows += request->rows;
+      batch.push_back(request);
+      it = queue_.erase(it);
+    } else {
+      ++it;
+    }
+  }
+  return batch;
+}
+
+void BatchingSession::RunBatch(const std::vector<Request*>& batch) {
+  const auto dispatch_time = Clock::now();
+  for (const Request* request : batch) {
+    queue_latency_.Record(
+        std::chrono::duration_cast<std::chrono::microseconds>(dispatch_time - request->enqueue_time).count());
+  }
+  num_batches_.fetch_add(1, std::memory_order_relaxed);
+
+  common::Status status;
+  ORT_TRY {
+    status = batch.size() == 1 ? RunSingle(*batch.front()) : RunBatchImpl(batch);
+  }
+  ORT_CATCH(const std::exception& ex) {
+    ORT_HANDLE_EXCEPTION([&]() {
+      status = ORT_MAKE_STATUS(ONNXRUNTIME, FAIL, "Batched Run failed: ", ex.what());
+    });
+  }
+
+  {
+    std::lock_guard<OrtMutex> lock(mutex_);
+    for (Request* request : batch) {
+      request->status = status;
+      request->done = true;
+    }
+  }
+  done_cv_.notify_all();
+}
+
+common::Status BatchingSession::RunSingle(Request& request) {
+  return session_.Run(run_options_, request.feed_names, request.feeds, request.output_names, request.fetches);
+}
+
+common::Status BatchingSession::RunBatchImpl(const std::vector<Request*>& batch) {
+  const Request& front = *batch.front();
+  const auto axis = gsl::narrow<size_t>(options_.batch_axis);
+  const size_t num_feeds = front.feeds.size();
+
+  AllocatorPtr allocator = session_.GetAllocator(OrtMemoryInfo(CPU, OrtDeviceAllocator));
+  ORT_RETURN_IF(allocator == nullptr, "Session has no CPU allocator. Was it initialized?");
+
+  int64_t total_rows = 0;
+  for (const Request* request : batch) {
+    total_rows += request->rows;
+  }
+
+  // Gather the feeds of all requests along the batch axis, padding smaller ones with zeros.
+  std::vector<OrtValue> batched_feeds(num_feeds);
+  for (size_t i = 0; i < num_feeds; ++i) {
+    const auto& first = front.feeds[i].Get<Tensor>();
+    TensorShapeVector dims = first.Shape().AsShapeVector();
+    bool padded = false;
+    for (const Request* request : batch) {
+      auto request_dims = request->feeds[i].Get<Tensor>().Shape().GetDims();
+      for (size_t d = 0; d < dims.size(); ++d) {
+        if (d != axis && request_dims[d] != dims[d]) {
+          padded = true;
+          dims[d] = std::max(dims[d], request_dims[d]);
+        }
+      }
+    }
+    dims[axis] = total_rows;
+
+    Tensor::InitOrtValue(first.DataType(), TensorShape(dims), allocator, batched_feeds[i]);
+    auto& batched = *batched_feeds[i].GetMutable<Tensor>();
+    if (padded) {
+      std::memset(batched.MutableDataRaw(), 0, batched.SizeInBytes());
+    }
+
+    int64_t offset = 0;
+    for (const Request* request : batch) {
+      const auto& src = request->feeds[i].Get<Tensor>();
+      auto src_dims = src.Shape().GetDims();
+      CopyBlock(src.DataRaw(), src_dims, 0, batched.MutableDataRaw(), batched.Shape().GetDims(), offset,
+                src_dims, axis, src.DataType()->Size());
+      offset += request->rows;
+    }
+  }
+
+  std::vector<OrtValue> batched_fetches;
+  ORT_RETURN_IF_ERROR(session_.Run(run_options_, front.feed_names, batched_feeds, front.output_names,
+                                   &batched_fetches));
+
+  for (Request* request : batch) {
+    request->fetches->resize(batched_fetches.size());
+  }
+
+  // Split the outputs declared with the batch axis back to the requests.
+  for (size_t o = 0; o < batched_fetches.size(); ++o) {
+    const OrtValue& batched_value = batched_fetches[o];
+    auto info = output_info_.find(front.output_names[o]);
+    const bool split = info != output_info_.end() && info->second.batched && batched_value.IsTensor() &&
+                       !batched_value.Get<Tensor>().IsDataTypeString() &&
+                       batched_value.Get<Tensor>().Shape().NumDimensions() > axis &&
+                       batched_value.Get<Tensor>().Shape()[axis] == total_rows;
+    if (!split) {
+      for (Request* request : batch) {
+        (*request->fetches)[o] = batched_value;
+      }
+      continue;
+    }
+
+    const auto& batched = batched_value.Get<Tensor>();
+    auto batched_dims = batched.Shape().GetDims();
+    const size_t element_size = batched.DataType()->Size();
+    int64_t offset = 0;
+    for (Request* request : batch) {
+      TensorShapeVector dims(batched_dims.begin(), batched_dims.end());
+      dims[axis] = request->rows;
+
+      // Crop the dimensions that were padded back to the extent of the request.
+      bool cropped = false;
+      for (const auto& input_dim : info->second.input_dims) {
+        auto feed = std::find(request->feed_names.begin(), request->feed_names.end(), input_dim.input_name);
+        if (feed == request->feed_names.end() || input_dim.output_dim >= dims.size()) {
+          continue;
+        }
+        const auto& feed_shape = request->feeds[feed - request->feed_names.begin()].Get<Tensor>().Shape();
+        const int64_t extent = std::min(feed_shape[input_dim.input_dim], batched_dims[input_dim.output_dim]);
+        if (extent != dims[input_dim.output_dim]) {
+          dims[input_dim.output_dim] = extent;
+          cropped = true;
+        }
+      }
+
+      OrtValue& fetch = (*request->fetches)[o];
+      if (axis == 0 && !cropped) {
+        // Rows along the outermost axis are contiguous, so hand out a view that keeps the batched output alive.
+        const int64_t row_elements = batched.Shape().SizeFromDimension(1);
+        void* data = static_cast<uint8_t*>(const_cast<void*>(batched.DataRaw())) +
+                     offset * row_elements * element_size;
+        auto view = std::make_unique<Tensor>(batched.DataType(), TensorShape(dims), data, batched.Location());
+        auto ml_tensor = DataTypeImpl::GetType<Tensor>();
+        fetch.Init(view.release(), ml_tensor,
+                   [batched_value](void* p) { delete static_cast<Tensor*>(p); });
+      } else {
+        Tensor::InitOrtValue(batched.DataType(), TensorShape(dims), allocator, fetch);
+        auto& dst = *fetch.GetMutable<Tensor>();
+        CopyBlock(batched.DataRaw(), batched_dims, offset, dst.MutableDataRaw(), dst.Shape().GetDims(), 0,
+                  dst.Shape().GetDims(), axis, element_size);
+      }
+      offset += request->rows;
+    }
+  }
+
+  return common::Status::OK();
+}
+
+}  // namespace onnxruntime
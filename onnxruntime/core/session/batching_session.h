@@ -0,0 +1,150 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+#include <gsl/gsl>
+
+#include "core/common/common.h"
+#include "core/common/latency_histogram.h"
+#include "core/framework/ort_value.h"
+#include "core/framework/run_options.h"
+#include "core/platform/ort_mutex.h"
+
+namespace onnxruntime {
+
+class InferenceSession;
+
+struct BatchingOptions {
+  // Maximum number of rows, summed over the batch axis of the coalesced requests, in a single Run.
+  int64_t max_batch_size = 32;
+  // Maximum time the oldest queued request waits for others to join its batch.
+  int64_t max_delay_us = 1000;
+  // Axis along which requests are concatenated. All feeds of a batchable request must have
+  // the same extent on this axis.
+  int64_t batch_axis = 0;
+  // Whether requests whose feeds differ in non-batch dimensions may share a batch. Smaller feeds
+  // are zero padded to the largest extent of each dimension.
+  bool allow_padding = true;
+  // Number of threads dispatching batches to the session.
+  int num_workers = 1;
+};
+
+// Front end for an InferenceSession that coalesces concurrent Run calls with compatible inputs
+// into one batched Run, then splits the outputs back to the callers.
+//
+// Requests are compatible if they use the same feed and output names, and each feed has the same
+// element type and rank (and, without padding, the same non-batch dimensions). Only non-string
+// tensors on CPU are batched; anything else, and any batch that ends up with a single request,
+// is run directly on the session.
+//
+// The outputs to split are found from the symbolic dimensions declared by the model: an output is
+// split per request if its dimension on the batch axis has the same name as the batch axis
+// dimension of an input. For batch_axis 0 the split outputs are views into the batched output,
+// without a copy. Other outputs are returned unchanged to every request of the batch. When inputs
+// were padded, each dimension of a split output that has the same name as a padded input dimension
+// is cropped back to the extent of that dimension in the request; other dimensions keep the padded
+// extent.
+//
+// The session must be loaded, and must outlive the BatchingSession.
+class BatchingSession {
+ public:
+  struct Stats {
+    // Time from the call to Run until the outputs are available.
+    LatencyHistogram::Snapshot request_latency;
+    // Time a request waited in the queue before its batch was dispatched.
+    LatencyHistogram::Snapshot queue_latency;
+    uint64_t num_requests;
+    uint64_t num_batches;
+  };
+
+  BatchingSession(InferenceSession& session, const BatchingOptions& options);
+  ~BatchingSession();
+
+  // Blocks until the request has run as part of a batch. Thread-safe.
+  // Requests with pre-allocated fetches are run on their own.
+  common::Status Run(gsl::span<const std::string> feed_names, gsl::span<const OrtValue> feeds,
+                     gsl::span<const std::string> output_names, std::vector<OrtValue>& fetches);
+
+  // Same semantics as the corresponding InferenceSession::Run overload: a null entry in fetches
+  // receives a newly allocated OrtValue.
+  common::Status Run(gsl::span<const char* const> feed_names, gsl::span<const OrtValue* const> feeds,
+                     gsl::span<const char* const> fetch_names, gsl::span<OrtValue*> fetches);
+
+  Stats GetStats() const;
+
+  const BatchingOptions& Options() const { return options_; }
+
+ private:
+  ORT_DISALLOW_COPY_ASSIGNMENT_AND_MOVE(BatchingSession);
+
+  using Clock = std::chrono::steady_clock;
+
+  struct Request {
+    gsl::span<const std::string> feed_names;
+    gsl::span<const OrtValue> feeds;
+    gsl::span<const std::string> output_names;
+    std::vector<OrtValue>* fetches;
+    int64_t rows;
+    Clock::time_point enqueue_time;
+
+    common::Status status;
+    bool done = false;
+  };
+
+  // An output dimension with the same symbolic name as an input dimension.
+  struct InputDim {
+    size_t output_dim;
+    std::string input_name;
+    size_t input_dim;
+  };
+
+  struct OutputInfo {
+    // Whether the output is split along the batch axis.
+    bool batched = false;
+    // Dimensions other than the batch axis that follow an input dimension, which are cropped when padding.
+    std::vector<InputDim> input_dims;
+  };
+
+  // Collect the OutputInfo of each model output from the shapes declared by the model.
+  void InitOutputInfo();
+
+  // Number of rows along the batch axis, or -1 if the request can not be batched.
+  int64_t BatchRows(gsl::span<const OrtValue> feeds) const;
+  bool Compatible(const Request& a, const Request& b) const;
+
+  void WorkerLoop();
+  // Remove the batch led by the request at the front of the queue. Called with mutex_ held.
+  std::vector<Request*> TakeBatch();
+  void RunBatch(const std::vector<Request*>& batch);
+  common::Status RunBatchImpl(const std::vector<Request*>& batch);
+  common::Status RunSingle(Request& request);
+
+  InferenceSession& session_;
+  const BatchingOptions options_;
+  RunOptions run_options_;
+  std::unordered_map<std::string, OutputInfo> output_info_;
+
+  mutable OrtMutex mutex_;
+  OrtCondVar queue_cv_;
+  OrtCondVar done_cv_;
+  std::deque<Request*> queue_;
+  bool shutdown_ = false;
+  std::vector<std::thread> workers_;
+
+  LatencyHistogram request_latency_;
+  LatencyHistogram queue_latency_;
+  std::atomic<uint64_t> num_requests_{0};
+  std::atomic<uint64_t> num_batches_{0};
+};
+
+}  // namespace onnxruntime
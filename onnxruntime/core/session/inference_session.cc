@@ -515,6 +515,8 @@ void InferenceSession::ConstructorCommon(const SessionOptions& session_options,
         if (session_options_.config_options.TryGetConfigEntry(kOrtSessionOptionsConfigIntraOpThreadAffinities, to.affinity_str)) {
           ORT_ENFORCE(!to.affinity_str.empty(), "Affinity string must not be empty");
         }
+        to.numa_aware =
+            session_options_.config_options.GetConfigOrDefault(kOrtSessionOptionsConfigIntraOpNumaAware, "0") == "1";
         to.auto_set_affinity = to.thread_pool_size == 0 &&
                                session_options_.execution_mode == ExecutionMode::ORT_SEQUENTIAL &&
                                to.affinity_str.empty();
@@ -1750,11 +1752,30 @@ common::Status InferenceSession::Initialize() {
       }
     }
 
+    ORT_RETURN_IF_ERROR_SESSIONID_(ConfigureCpuTunableOp());
+
+    const std::string prepacked_weights_cache_file =
+        session_options_.config_options.GetConfigOrDefault(kOrtSessionOptionsPrepackedWeightsCacheFile, "");
+    if (!prepacked_weights_cache_file.empty()) {
+      // Settings that change how kernels pre-pack their weights must be part of the cache's configuration.
+      const std::string prepacked_weights_cache_config = MakeString(
+          "fastmath_arm64_bf16=",
+          session_options_.config_options.GetConfigOrDefault(kOrtSessionOptionsMlasGemmFastMathArm64Bfloat16, "0"));
+      prepacked_weights_file_cache_ = std::make_unique<PrepackedWeightsFileCache>(
+          Env::Default(), ToPathString(prepacked_weights_cache_file), prepacked_weights_cache_config, *session_logger_);
+      session_state_->SetPrepackedWeightsFileCache(prepacked_weights_file_cache_.get());
+    }
+
 #if !defined(ORT_MINIMAL_BUILD) && defined(ORT_MEMORY_PROFILE)
     // Don't want to pollute SessionState constructor since memory profile is enabled optionally.
     session_state_->SetMemoryProfiler(&memory_profiler_);
 #endif
 
+    if (session_options_.config_options.GetConfigOrDefault(kOrtSessionOptionsEnableMetrics, "0") == "1") {
+      session_metrics_ = std::make_unique<SessionMetrics>(GetIntraOpThreadPoolToUse(), GetInterOpThreadPoolToUse());
+      session_state_->SetSessionMetrics(session_metrics_.get());
+    }
+
     // Collect the kernel registries from execution provider instances;
     // There are 2 kinds of kernel registries with priority from high to low as below,
     // 1. Custom execution provider type specific kernel registries.
@@ -2024,6 +2045,15 @@ common::Status InferenceSession::Initialize() {
                                              !saving_model,
                                              saving_ort_format));
 
+    if (prepacked_weights_file_cache_ != nullptr) {
+      // Failing to persist the pre-packed weights only costs the next session the time to pre-pack them again.
+      auto save_status = prepacked_weights_file_cache_->Save();
+      if (!save_status.IsOK()) {
+        LOGS(*session_logger_, WARNING) << "Failed to save the pre-packed weights cache: "
+                                        << save_status.ErrorMessage();
+      }
+    }
+
 #if !defined(ORT_MINIMAL_BUILD)
     if (saving_model) {
       if (session_state_->GetFuncMgr().NumFuncs() > 0) {
@@ -2916,6 +2946,41 @@ const profiling::Profiler& InferenceSession::GetProfiling() const {
   return session_profiler_;
 }
 
+Status InferenceSession::GetSessionMetrics(SessionMetrics::Snapshot& snapshot) const {
+  if (session_metrics_ == nullptr) {
+    return ORT_MAKE_STATUS(ONNXRUNTIME, INVALID_ARGUMENT, "Session metrics are not enabled. Set the session config ",
+                           "entry ", kOrtSessionOptionsEnableMetrics, " to 1 to enable them.");
+  }
+  snapshot = session_metrics_->GetSnapshot();
+  return Status::OK();
+}
+
+Status InferenceSession::ConfigureCpuTunableOp() {
+  auto* cpu_ep = execution_providers_.Get(onnxruntime::kCpuExecutionProvider);
+  auto* tuning_ctx = cpu_ep != nullptr ? cpu_ep->GetTuningContext() : nullptr;
+  if (tuning_ctx == nullptr) {
+    return Status::OK();
+  }
+
+  const auto& config_options = session_options_.config_options;
+  if (config_options.GetConfigOrDefault(kOrtSessionOptionsCpuTunableOpEnable, "0") == "1") {
+    tuning_ctx->EnableTunableOp();
+  }
+  if (config_options.GetConfigOrDefault(kOrtSessionOptionsCpuTunableOpTuningEnable, "0") == "1") {
+    tuning_ctx->EnableTuning();
+  }
+
+  const std::string max_tuning_duration_ms_str =
+      config_options.GetConfigOrDefault(kOrtSessionOptionsCpuTunableOpMaxTuningDurationMs, "0");
+  int max_tuning_duration_ms = 0;
+  ORT_RETURN_IF_NOT(TryParseStringWithClassicLocale(max_tuning_duration_ms_str, max_tuning_duration_ms) &&
+                        max_tuning_duration_ms >= 0,
+                    "Invalid value for ", kOrtSessionOptionsCpuTunableOpMaxTuningDurationMs, ": ",
+                    max_tuning_duration_ms_str);
+  tuning_ctx->SetMaxTuningDurationMs(max_tuning_duration_ms);
+  return Status::OK();
+}
+
 #if !defined(ORT_MINIMAL_BUILD)
 std::vector<TuningResults> InferenceSession::GetTuningResults() const {
   std::vector<TuningResults> ret;
@@ -20,6 +20,7 @@
 #include "core/framework/iexecutor.h"
 #include "core/framework/kernel_registry_manager.h"
 #include "core/framework/prepacked_weights_container.h"
+#include "core/framework/session_metrics.h"
 #include "core/framework/session_state.h"
 #include "core/framework/tuning_results.h"
 #include "core/framework/framework_provider_common.h"
@@ -486,6 +487,12 @@ class InferenceSession {
     */
   const profiling::Profiler& GetProfiling() const;
 
+  /**
+    * Get the current session metrics. Can be called while other threads run the session.
+    @return INVALID_ARGUMENT if the metrics were not enabled with kOrtSessionOptionsEnableMetrics.
+    */
+  Status GetSessionMetrics(SessionMetrics::Snapshot& snapshot) const;
+
 #if !defined(ORT_MINIMAL_BUILD)
   /**
    * Get the TuningResults of TunableOp for every execution providers.
@@ -690,6 +697,11 @@ class InferenceSession {
    */
   void ShrinkMemoryArenas(gsl::span<const AllocatorPtr> arenas_to_shrink);
 
+  /*
+   * Applies the session.cpu.tunable_op_* session options to the tuning context of the CPU execution provider.
+   */
+  [[nodiscard]] common::Status ConfigureCpuTunableOp();
+
 #ifdef _WIN32
   void LogAllSessions();
 #endif
@@ -727,10 +739,17 @@ class InferenceSession {
   // Profiler for this session.
   profiling::Profiler session_profiler_;
 
+  // Metrics for this session, if enabled with kOrtSessionOptionsEnableMetrics.
+  std::unique_ptr<SessionMetrics> session_metrics_;
+
 #if !defined(ORT_MINIMAL_BUILD) && defined(ORT_MEMORY_PROFILE)
   MemoryProfiler memory_profiler_;
 #endif
 
+  // File cache of pre-packed weights, if enabled with kOrtSessionOptionsPrepackedWeightsCacheFile.
+  // Declared ahead of session_state_ as its kernels may use buffers owned by the cache.
+  std::unique_ptr<PrepackedWeightsFileCache> prepacked_weights_file_cache_;
+
   // Immutable state for each op in the model. Shared by all executors.
   // It has a dependency on execution_providers_.
   std::unique_ptr<SessionState> session_state_;
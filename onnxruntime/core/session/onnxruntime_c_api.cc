@@ -18,6 +18,7 @@
 #include "core/common/common.h"
 #include "core/common/logging/logging.h"
 #include "core/common/narrow.h"
+#include "core/common/parse_string.h"
 #include "core/common/status.h"
 #include "core/common/safeint.h"
 #include "core/graph/constants.h"
@@ -30,6 +31,7 @@
 #include "core/framework/callback.h"
 #include "core/framework/tensorprotoutils.h"
 #include "core/framework/onnxruntime_typeinfo.h"
+#include "core/session/batching_session.h"
 #include "core/session/inference_session.h"
 #include "core/session/ort_apis.h"
 #include "core/session/ort_env.h"
@@ -1052,6 +1054,80 @@ ORT_API_STATUS_IMPL(OrtApis::SynchronizeBoundOutputs, _Inout_ OrtIoBinding* bind
   API_IMPL_END
 }
 
+ORT_API_STATUS_IMPL(OrtApis::CreateBatchingSession, _In_ OrtSession* sess,
+                    _In_reads_(num_options) const char* const* option_keys,
+                    _In_reads_(num_options) const char* const* option_values,
+                    _In_ size_t num_options, _Outptr_ OrtBatchingSession** out) {
+  API_IMPL_BEGIN
+  auto session = reinterpret_cast<::onnxruntime::InferenceSession*>(sess);
+  onnxruntime::BatchingOptions batching_options;
+  for (size_t i = 0; i != num_options; ++i) {
+    if (option_keys[i] == nullptr || option_values[i] == nullptr) {
+      return OrtApis::CreateStatus(ORT_INVALID_ARGUMENT, "Batching option key and value must not be null.");
+    }
+    const std::string key = option_keys[i];
+    const std::string value = option_values[i];
+    bool parsed = false;
+    if (key == "max_batch_size") {
+      parsed = TryParseStringWithClassicLocale(value, batching_options.max_batch_size);
+    } else if (key == "max_delay_us") {
+      parsed = TryParseStringWithClassicLocale(value, batching_options.max_delay_us);
+    } else if (key == "batch_axis") {
+      parsed = TryParseStringWithClassicLocale(value, batching_options.batch_axis);
+    } else if (key == "allow_padding") {
+      parsed = value == "0" || value == "1";
+      batching_options.allow_padding = value == "1";
+    } else if (key == "num_workers") {
+      parsed = TryParseStringWithClassicLocale(value, batching_options.num_workers);
+    } else {
+      return OrtApis::CreateStatus(ORT_INVALID_ARGUMENT, MakeString("Unknown batching option: ", key).c_str());
+    }
+    if (!parsed) {
+      return OrtApis::CreateStatus(ORT_INVALID_ARGUMENT,
+                                   MakeString("Invalid value for batching option ", key, ": ", value).c_str());
+    }
+  }
+
+  *out = reinterpret_cast<OrtBatchingSession*>(
+      std::make_unique<onnxruntime::BatchingSession>(*session, batching_options).release());
+  return nullptr;
+  API_IMPL_END
+}
+
+ORT_API_STATUS_IMPL(OrtApis::BatchingSessionRun, _Inout_ OrtBatchingSession* batching_session,
+                    _In_reads_(input_len) const char* const* input_names,
+                    _In_reads_(input_len) const OrtValue* const* inputs, size_t input_len,
+                    _In_reads_(output_names_len) const char* const* output_names, size_t output_names_len,
+                    _Inout_updates_all_(output_names_len) OrtValue** outputs) {
+  API_IMPL_BEGIN
+  auto session = reinterpret_cast<onnxruntime::BatchingSession*>(batching_session);
+  return ToOrtStatus(session->Run(gsl::span<const char* const>(input_names, input_len),
+                                  gsl::span<const OrtValue* const>(inputs, input_len),
+                                  gsl::span<const char* const>(output_names, output_names_len),
+                                  gsl::span<OrtValue*>(outputs, output_names_len)));
+  API_IMPL_END
+}
+
+ORT_API_STATUS_IMPL(OrtApis::GetBatchingSessionLatencyHistogram, _In_ const OrtBatchingSession* batching_session,
+                    _Out_writes_(num_buckets) uint64_t* bucket_counts, _In_ size_t num_buckets,
+                    _Out_ uint64_t* total_count) {
+  API_IMPL_BEGIN
+  if (num_buckets != onnxruntime::LatencyHistogram::kNumBuckets) {
+    return OrtApis::CreateStatus(ORT_INVALID_ARGUMENT,
+                                 MakeString("num_buckets must be ", onnxruntime::LatencyHistogram::kNumBuckets).c_str());
+  }
+  auto session = reinterpret_cast<const onnxruntime::BatchingSession*>(batching_session);
+  const auto stats = session->GetStats();
+  std::copy(stats.request_latency.bucket_counts.begin(), stats.request_latency.bucket_counts.end(), bucket_counts);
+  *total_count = stats.request_latency.count;
+  return nullptr;
+  API_IMPL_END
+}
+
+ORT_API(void, OrtApis::ReleaseBatchingSession, _Frees_ptr_opt_ OrtBatchingSession* value) {
+  delete reinterpret_cast<onnxruntime::BatchingSession*>(value);
+}
+
 ORT_API_STATUS_IMPL(OrtApis::IsTensor, _In_ const OrtValue* value, _Out_ int* out) {
   auto v = reinterpret_cast<const ::OrtValue*>(value);
   *out = v->IsTensor() ? 1 : 0;
@@ -1363,6 +1439,17 @@ ORT_API_STATUS_IMPL(OrtApis::SessionEndProfiling, _In_ OrtSession* sess, _Inout_
   API_IMPL_END
 }
 
+ORT_API_STATUS_IMPL(OrtApis::SessionGetMetrics, _In_ const OrtSession* sess, _Inout_ OrtAllocator* allocator,
+                    _Outptr_ char** out) {
+  API_IMPL_BEGIN
+  auto session = reinterpret_cast<const ::onnxruntime::InferenceSession*>(sess);
+  onnxruntime::SessionMetrics::Snapshot snapshot;
+  ORT_API_RETURN_IF_STATUS_NOT_OK(session->GetSessionMetrics(snapshot));
+  *out = StrDup(onnxruntime::SessionMetrics::ToJson(snapshot), allocator);
+  return nullptr;
+  API_IMPL_END
+}
+
 ORT_API_STATUS_IMPL(OrtApis::SessionGetModelMetadata, _In_ const OrtSession* sess,
                     _Outptr_ OrtModelMetadata** out) {
   API_IMPL_BEGIN
@@ -2229,6 +2316,8 @@ ORT_API_STATUS_IMPL(OrtApis::CreateArenaCfgV2, _In_reads_(num_keys) const char*
       cfg->initial_growth_chunk_size_bytes = static_cast<int>(arena_config_values[i]);
     } else if (strcmp(arena_config_keys[i], "max_power_of_two_extend_bytes") == 0) {
       cfg->max_power_of_two_extend_bytes = static_cast<int64_t>(arena_config_values[i]);
+    } else if (strcmp(arena_config_keys[i], "max_thread_cache_bytes") == 0) {
+      cfg->max_thread_cache_bytes = static_cast<int64_t>(arena_config_values[i]);
     } else {
       std::ostringstream oss;
       oss << "Invalid key found: " << arena_config_keys[i];
@@ -2730,6 +2819,12 @@ static constexpr OrtApi ort_api_1_to_20 = {
     &OrtApis::KernelInfoGetAllocator,
     &OrtApis::AddExternalInitializersFromFilesInMemory,
     // End of Version 18 - DO NOT MODIFY ABOVE (see above text for more information)
+
+    &OrtApis::CreateBatchingSession,
+    &OrtApis::BatchingSessionRun,
+    &OrtApis::GetBatchingSessionLatencyHistogram,
+    &OrtApis::ReleaseBatchingSession,
+    &OrtApis::SessionGetMetrics,
 };
 
 // OrtApiBase can never change as there is no way to know what version of OrtApiBase is returned by OrtGetApiBase.
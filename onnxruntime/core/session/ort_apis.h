@@ -523,4 +523,21 @@ ORT_API_STATUS_IMPL(SessionOptionsAppendExecutionProvider_VitisAI, _In_ OrtSessi
 ORT_API_STATUS_IMPL(KernelContext_GetScratchBuffer, _In_ const OrtKernelContext* context, _In_ const OrtMemoryInfo* mem_info, _In_ size_t count_or_bytes, _Outptr_ void** out);
 
 ORT_API_STATUS_IMPL(KernelInfoGetAllocator, _In_ const OrtKernelInfo* info, _In_ OrtMemType mem_type, _Outptr_ OrtAllocator** out);
+
+ORT_API_STATUS_IMPL(CreateBatchingSession, _In_ OrtSession* session,
+                    _In_reads_(num_options) const char* const* option_keys,
+                    _In_reads_(num_options) const char* const* option_values,
+                    _In_ size_t num_options, _Outptr_ OrtBatchingSession** out);
+ORT_API_STATUS_IMPL(BatchingSessionRun, _Inout_ OrtBatchingSession* batching_session,
+                    _In_reads_(input_len) const char* const* input_names,
+                    _In_reads_(input_len) const OrtValue* const* inputs, size_t input_len,
+                    _In_reads_(output_names_len) const char* const* output_names, size_t output_names_len,
+                    _Inout_updates_all_(output_names_len) OrtValue** outputs);
+ORT_API_STATUS_IMPL(GetBatchingSessionLatencyHistogram, _In_ const OrtBatchingSession* batching_session,
+                    _Out_writes_(num_buckets) uint64_t* bucket_counts, _In_ size_t num_buckets,
+                    _Out_ uint64_t* total_count);
+ORT_API(void, ReleaseBatchingSession, _Frees_ptr_opt_ OrtBatchingSession*);
+
+ORT_API_STATUS_IMPL(SessionGetMetrics, _In_ const OrtSession* session, _Inout_ OrtAllocator* allocator,
+                    _Outptr_ char** out);
 }  // namespace OrtApis
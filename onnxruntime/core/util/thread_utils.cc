@@ -24,6 +24,7 @@ std::ostream& operator<<(std::ostream& os, const OrtThreadPoolParams& params) {
   os << " affinity_str: " << params.affinity_str;
   // os << " name: " << (params.name ? params.name : L"nullptr");
   os << " set_denormal_as_zero: " << params.set_denormal_as_zero;
+  os << " numa_aware: " << params.numa_aware;
   // os << " custom_create_thread_fn: " << (params.custom_create_thread_fn ? "set" : "nullptr");
   // os << " custom_thread_creation_options: " << (params.custom_thread_creation_options ? "set" : "nullptr");
   // os << " custom_join_thread_fn: " << (params.custom_join_thread_fn ? "set" : "nullptr");
@@ -89,6 +90,56 @@ static std::vector<LogicalProcessors> ReadThreadAffinityConfig(const std::string
 }
 #endif
 
+// Assign each of the pool's threads (including the placeholder entry for the
+// caller at index 0) to a NUMA node.  Threads without an affinity are spread
+// over the nodes in contiguous blocks proportional to the nodes' processor
+// counts and bound to all processors of their node.  Threads with an
+// affinity keep it and are assigned the node of their first processor.
+static void SetNumaNodeAffinities(int thread_pool_size, ThreadOptions& to) {
+  const auto node_affinities = Env::Default().GetNumaNodeAffinities();
+  if (node_affinities.size() <= 1) {
+    return;
+  }
+
+  const size_t num_threads = static_cast<size_t>(thread_pool_size);
+  to.numa_node_ids.resize(num_threads, 0);
+  if (!to.affinities.empty()) {
+    for (size_t i = 0; i < num_threads && i < to.affinities.size(); ++i) {
+      if (to.affinities[i].empty()) {
+        continue;
+      }
+      for (size_t node = 0; node < node_affinities.size(); ++node) {
+        const auto& processors = node_affinities[node];
+        if (std::find(processors.begin(), processors.end(), to.affinities[i].front()) != processors.end()) {
+          to.numa_node_ids[i] = static_cast<int>(node);
+          break;
+        }
+      }
+    }
+    return;
+  }
+
+  size_t total_processors = 0;
+  for (const auto& processors : node_affinities) {
+    total_processors += processors.size();
+  }
+
+  to.affinities.resize(num_threads);
+  size_t node = 0;
+  size_t node_end = node_affinities[0].size();
+  for (size_t i = 0; i < num_threads; ++i) {
+    const size_t position = i * total_processors / num_threads;
+    while (position >= node_end) {
+      node_end += node_affinities[++node].size();
+    }
+    to.numa_node_ids[i] = static_cast<int>(node);
+    // The caller's entry is a placeholder and is dropped by the thread pool
+    if (i > 0) {
+      to.affinities[i] = node_affinities[node];
+    }
+  }
+}
+
 static std::unique_ptr<ThreadPool>
 CreateThreadPoolHelper(Env* env, OrtThreadPoolParams options) {
   ThreadOptions to;
@@ -145,6 +196,10 @@ CreateThreadPoolHelper(Env* env, OrtThreadPoolParams options) {
 #endif
   }
 
+  if (options.numa_aware) {
+    SetNumaNodeAffinities(options.thread_pool_size, to);
+  }
+
   to.set_denormal_as_zero = options.set_denormal_as_zero;
   // set custom thread management members
   to.custom_create_thread_fn = options.custom_create_thread_fn;
@@ -42,6 +42,11 @@ struct OrtThreadPoolParams {
   // Set or unset denormal as zero
   bool set_denormal_as_zero = false;
 
+  // If it is true and the machine has more than one NUMA node, threads are spread across the
+  // nodes in contiguous blocks and the pool keeps work and stealing node-local where it can.
+  // Threads without an explicit affinity are bound to all logical processors of their node.
+  bool numa_aware = false;
+
   // members to manage custom threads
   OrtCustomCreateThreadFn custom_create_thread_fn = nullptr;
   void* custom_thread_creation_options = nullptr;
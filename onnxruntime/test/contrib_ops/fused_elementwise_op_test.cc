@@ -0,0 +1,97 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "test/providers/provider_test_utils.h"
+
+namespace onnxruntime {
+namespace test {
+
+// x * sigmoid(x + bias) * scale, with the bias over the last axis and a scalar scale.
+TEST(FusedElementwiseTest, BroadcastOperands) {
+  const std::vector<float> x = {-2.0f, -1.0f, -0.5f, 0.0f, 0.5f, 1.0f};
+  const std::vector<float> bias = {0.25f, -0.5f, 1.0f};
+  const float scale = 0.5f;
+
+  std::vector<float> expected(x.size());
+  for (size_t i = 0; i < x.size(); ++i) {
+    const float sum = x[i] + bias[i % bias.size()];
+    expected[i] = sum * (1.0f / (1.0f + std::exp(-sum))) * scale;
+  }
+
+  OpTester test("FusedElementwise", 1, onnxruntime::kMSDomain);
+  test.AddAttribute("ops", std::vector<std::string>{"Add", "Sigmoid", "Mul", "Mul"});
+  test.AddAttribute("operands", std::vector<int64_t>{0, 1, 3, -1, 3, 4, 5, 2});
+  test.AddInput<float>("X", {2, 3}, x);
+  test.AddInput<float>("bias", {3}, bias);
+  test.AddInput<float>("scale", {}, {scale});
+  test.AddOutput<float>("Y", {2, 3}, expected);
+  test.SetOutputTolerance(1e-5f);
+  test.Run();
+}
+
+// erf(tanh(relu(x) - exp(-abs(x))) / sqrt(d)) covering the remaining operators.
+TEST(FusedElementwiseTest, AllOperators) {
+  const std::vector<float> x = {-3.0f, -1.5f, -0.25f, 0.0f, 0.1f, 0.75f, 2.0f, 4.0f};
+  const std::vector<float> d = {1.0f, 2.0f, 4.0f, 9.0f};
+
+  std::vector<float> expected(x.size());
+  for (size_t i = 0; i < x.size(); ++i) {
+    const float difference = std::max(x[i], 0.0f) - std::exp(-std::abs(x[i]));
+    expected[i] = std::erf(std::tanh(difference) / std::sqrt(d[i % d.size()]));
+  }
+
+  OpTester test("FusedElementwise", 1, onnxruntime::kMSDomain);
+  test.AddAttribute("ops", std::vector<std::string>{"Abs", "Neg", "Exp", "Relu", "Sub", "Tanh", "Sqrt", "Div", "Erf"});
+  test.AddAttribute("operands", std::vector<int64_t>{0, -1, 2, -1, 3, -1, 0, -1, 5, 4, 6, -1, 1, -1, 7, 8, 9, -1});
+  test.AddInput<float>("X", {2, 4}, x);
+  test.AddInput<float>("D", {1, 4}, d);
+  test.AddOutput<float>("Y", {2, 4}, expected);
+  test.SetOutputTolerance(1e-5f);
+  test.Run();
+}
+
+// The output spans several blocks, and the rows of the bias do not line up with the block boundaries.
+TEST(FusedElementwiseTest, MultipleBlocks) {
+  constexpr int64_t rows = 5;
+  constexpr int64_t columns = 999;
+  std::vector<float> x(rows * columns);
+  std::vector<float> bias(columns);
+  for (size_t i = 0; i < x.size(); ++i) {
+    x[i] = static_cast<float>(i % 17) * 0.125f - 1.0f;
+  }
+  for (size_t i = 0; i < bias.size(); ++i) {
+    bias[i] = static_cast<float>(i % 7) * 0.5f;
+  }
+
+  std::vector<float> expected(x.size());
+  for (size_t i = 0; i < x.size(); ++i) {
+    expected[i] = (x[i] + bias[i % columns]) * x[i];
+  }
+
+  OpTester test("FusedElementwise", 1, onnxruntime::kMSDomain);
+  test.AddAttribute("ops", std::vector<std::string>{"Add", "Mul"});
+  test.AddAttribute("operands", std::vector<int64_t>{1, 0, 2, 0});
+  test.AddInput<float>("X", {rows, columns}, x);
+  test.AddInput<float>("bias", {columns}, bias);
+  test.AddOutput<float>("Y", {rows, columns}, expected);
+  test.Run();
+}
+
+TEST(FusedElementwiseTest, InvalidBroadcast) {
+  OpTester test("FusedElementwise", 1, onnxruntime::kMSDomain);
+  test.AddAttribute("ops", std::vector<std::string>{"Add", "Relu"});
+  test.AddAttribute("operands", std::vector<int64_t>{0, 1, 2, -1});
+  test.AddInput<float>("X", {2, 3}, {1.0f, 2.0f, 3.0f, 4.0f, 5.0f, 6.0f});
+  test.AddInput<float>("B", {2, 1}, {1.0f, 2.0f});
+  test.AddOutput<float>("Y", {2, 3}, {0.0f, 0.0f, 0.0f, 0.0f, 0.0f, 0.0f});
+  test.Run(OpTester::ExpectResult::kExpectFailure, "must be broadcast along the leading dimensions");
+}
+
+}  // namespace test
+}  // namespace onnxruntime
@@ -1,10 +1,15 @@
 // Copyright (c) Microsoft Corporation. All rights reserved.
 // Licensed under the MIT License.
 
+#include <algorithm>
+#include <functional>
 #include <memory>
+#include <string>
+#include <utility>
 #include <vector>
 #include "gtest/gtest.h"
 #include <gsl/gsl>
+#include "core/graph/model.h"
 #include "core/session/onnxruntime_cxx_api.h"
 #include "test/common/cuda_op_test_utils.h"
 
@@ -183,5 +188,145 @@ TEST(GreedySearchTest, GptGreedySearchFp32) {
   }
 }
 
+namespace {
+
+// Runs tiny_gpt2_greedysearch_with_init_decoder.onnx on CPU after overriding integer attributes of GreedySearch.
+// update_node can make other changes to the GreedySearch node.
+std::vector<int32_t> RunGptGreedySearchOnCpu(const std::vector<std::pair<std::string, int64_t>>& attributes,
+                                             std::vector<int32_t> input_ids,
+                                             std::vector<int64_t> input_ids_shape,
+                                             int32_t max_length,
+                                             const std::function<void(ONNX_NAMESPACE::NodeProto&)>& update_node = {}) {
+  ONNX_NAMESPACE::ModelProto model_proto;
+  ORT_THROW_IF_ERROR(Model::Load(ORT_TSTR("testdata/transformers/tiny_gpt2_greedysearch_with_init_decoder.onnx"),
+                                 model_proto));
+  for (auto& node : *model_proto.mutable_graph()->mutable_node()) {
+    if (node.op_type() != "GreedySearch") {
+      continue;
+    }
+    for (const auto& attribute : attributes) {
+      auto attr = std::find_if(node.mutable_attribute()->begin(), node.mutable_attribute()->end(),
+                               [&](const auto& a) { return a.name() == attribute.first; });
+      ONNX_NAMESPACE::AttributeProto* proto = attr != node.mutable_attribute()->end() ? &*attr
+                                                                                        : node.add_attribute();
+      proto->set_name(attribute.first);
+      proto->set_type(ONNX_NAMESPACE::AttributeProto_AttributeType_INT);
+      proto->set_i(attribute.second);
+    }
+    if (update_node) {
+      update_node(node);
+    }
+  }
+  std::string model_data;
+  model_proto.SerializeToString(&model_data);
+
+  std::vector<int64_t> parameter_shape{1};
+  std::vector<int32_t> max_length_data{max_length};
+  std::vector<int32_t> min_length_data{1};
+  std::vector<float> repetition_penalty{1.0f};
+
+  Ort::MemoryInfo info("Cpu", OrtDeviceAllocator, 0, OrtMemTypeDefault);
+  std::vector<Ort::Value> ort_inputs;
+  ort_inputs.push_back(Ort::Value::CreateTensor(
+      info, input_ids.data(), input_ids.size(), input_ids_shape.data(), input_ids_shape.size()));
+  ort_inputs.push_back(Ort::Value::CreateTensor(
+      info, max_length_data.data(), max_length_data.size(), parameter_shape.data(), parameter_shape.size()));
+  ort_inputs.push_back(Ort::Value::CreateTensor(
+      info, min_length_data.data(), min_length_data.size(), parameter_shape.data(), parameter_shape.size()));
+  ort_inputs.push_back(Ort::Value::CreateTensor(
+      info, repetition_penalty.data(), repetition_penalty.size(), parameter_shape.data(), parameter_shape.size()));
+  const char* input_names[] = {"input_ids", "max_length", "min_length", "repetition_penalty"};
+  const char* const output_names[] = {"sequences"};
+
+  Ort::SessionOptions session_options;
+  Ort::Session session(*ort_env, model_data.data(), model_data.size(), session_options);
+  auto ort_outputs = session.Run(Ort::RunOptions{}, input_names, ort_inputs.data(), ort_inputs.size(),
+                                 output_names, 1);
+
+  const auto& sequences = ort_outputs[0];
+  std::vector<int64_t> expected_output_shape{input_ids_shape[0], max_length};
+  EXPECT_EQ(expected_output_shape, sequences.GetTensorTypeAndShapeInfo().GetShape());
+  const auto* result_vals = sequences.GetTensorData<int32_t>();
+  return std::vector<int32_t>(result_vals, result_vals + input_ids_shape[0] * max_length);
+}
+
+}  // namespace
+
+TEST(GreedySearchTest, GptGreedySearchContinuousBatching_CPU) {
+  // With eos_token_id 114, the second sequence is finished well before the others.
+  std::vector<int32_t> input_ids{
+      0, 0, 0, 52,
+      0, 0, 195, 731,
+      0, 195, 731, 321,
+      0, 0, 0, 52};
+  std::vector<int64_t> input_ids_shape{4, 4};
+  constexpr int32_t max_length = 10;
+
+  const std::vector<int32_t> expected_output = RunGptGreedySearchOnCpu({{"eos_token_id", 114}},
+                                                                       input_ids, input_ids_shape, max_length);
+  // The second sequence selects 114 as its second new token, so it is padded with pad_token_id 98 from there on,
+  // while the first one runs to max_length.
+  const std::vector<int32_t> second_sequence(expected_output.begin() + max_length,
+                                             expected_output.begin() + 2 * max_length);
+  ASSERT_EQ(second_sequence, (std::vector<int32_t>{0, 0, 195, 731, 731, 98, 98, 98, 98, 98}));
+  ASSERT_NE(expected_output[max_length - 1], 98);
+
+  // Sequences join the batch one by one, or as soon as the second sequence leaves it.
+  for (int64_t max_active_batch_size : {1, 2, 4, 8}) {
+    SCOPED_TRACE(max_active_batch_size);
+    const std::vector<int32_t> output = RunGptGreedySearchOnCpu(
+        {{"eos_token_id", 114}, {"max_active_batch_size", max_active_batch_size}},
+        input_ids, input_ids_shape, max_length);
+    ASSERT_EQ(expected_output, output);
+  }
+}
+
+TEST(GreedySearchTest, GptGreedySearchSpeculativeDecoding_CPU) {
+  std::vector<int32_t> input_ids{
+      0, 0, 0, 52,
+      0, 0, 195, 731,
+      0, 195, 731, 321};
+  std::vector<int64_t> input_ids_shape{3, 4};
+  constexpr int32_t max_length = 12;
+
+  const std::vector<int32_t> expected_output = RunGptGreedySearchOnCpu({{"eos_token_id", 114}},
+                                                                       input_ids, input_ids_shape, max_length);
+
+  // The draft decoder is a copy of the decoder, so all proposed tokens are accepted, or a copy with negated logits,
+  // so the proposed tokens are mostly rejected.
+  for (bool negate_logits : {false, true}) {
+    SCOPED_TRACE(negate_logits);
+    auto add_draft_decoder = [negate_logits](ONNX_NAMESPACE::NodeProto& node) {
+      const auto& attributes = node.attribute();
+      auto decoder = std::find_if(attributes.begin(), attributes.end(),
+                                  [](const auto& a) { return a.name() == "decoder"; });
+      ASSERT_NE(decoder, attributes.end());
+
+      auto* draft_decoder = node.add_attribute();
+      *draft_decoder = *decoder;
+      draft_decoder->set_name("draft_decoder");
+      if (negate_logits) {
+        auto* graph = draft_decoder->mutable_g();
+        for (auto& graph_node : *graph->mutable_node()) {
+          for (auto& output : *graph_node.mutable_output()) {
+            if (output == "logits") {
+              output = "draft_logits";
+            }
+          }
+        }
+        auto* neg = graph->add_node();
+        neg->set_op_type("Neg");
+        neg->add_input("draft_logits");
+        neg->add_output("logits");
+      }
+    };
+
+    const std::vector<int32_t> output = RunGptGreedySearchOnCpu(
+        {{"eos_token_id", 114}, {"num_speculative_tokens", 3}}, input_ids, input_ids_shape, max_length,
+        add_draft_decoder);
+    ASSERT_EQ(expected_output, output);
+  }
+}
+
 }  // namespace test
 }  // namespace onnxruntime
@@ -0,0 +1,603 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <algorithm>
+#include <cmath>
+#include <iterator>
+#include <sstream>
+#include <string>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "core/graph/model.h"
+#include "core/session/inference_session.h"
+#include "gtest/gtest.h"
+#include "test/common/tensor_op_test_utils.h"
+#include "test/framework/test_utils.h"
+#include "test/providers/provider_test_utils.h"
+#include "test/test_environment.h"
+#include "test/util/include/asserts.h"
+#include "test/util/include/default_providers.h"
+
+namespace onnxruntime {
+namespace test {
+
+namespace {
+
+struct PagedKVCacheTestParams {
+  int batch_size;
+  int sequence_length;
+  int num_heads;
+  int kv_num_heads;
+  int head_size;
+  int block_size;
+  int num_blocks;
+  int max_blocks_per_sequence;
+  std::vector<int32_t> seqlens_k;    // total sequence length - 1 of each sequence
+  std::vector<int32_t> block_table;  // (batch_size, max_blocks_per_sequence)
+};
+
+std::vector<float> MakeData(size_t size, float seed) {
+  std::vector<float> data(size);
+  for (size_t i = 0; i < size; i++) {
+    data[i] = std::sin(seed + 0.37f * static_cast<float>(i));
+  }
+  return data;
+}
+
+size_t PoolOffset(const PagedKVCacheTestParams& p, int batch, int position, int kv_head) {
+  const int block = p.block_table[static_cast<size_t>(batch) * p.max_blocks_per_sequence + position / p.block_size];
+  return ((static_cast<size_t>(block) * p.kv_num_heads + kv_head) * p.block_size + position % p.block_size) *
+         p.head_size;
+}
+
+// Writes the new keys and values to the pools and computes causal attention naively.
+void ComputeReference(const PagedKVCacheTestParams& p,
+                      const std::vector<float>& query,  // (B, S, N * H)
+                      const std::vector<float>& key,    // (B, S, N_kv * H)
+                      const std::vector<float>& value,  // (B, S, N_kv * H)
+                      std::vector<float>& key_pool,
+                      std::vector<float>& value_pool,
+                      std::vector<float>& output) {  // (B, S, N * H)
+  const int S = p.sequence_length;
+  const int H = p.head_size;
+  output.assign(static_cast<size_t>(p.batch_size) * S * p.num_heads * H, 0.0f);
+
+  const int max_total = *std::max_element(p.seqlens_k.begin(), p.seqlens_k.end()) + 1;
+  for (int b = 0; b < p.batch_size; b++) {
+    const int total = p.seqlens_k[b] + 1;
+    // only the first prompt (S == T) starts from an empty cache
+    const int past = S == max_total ? 0 : total - S;
+    const int new_tokens = std::min(S, total - past);
+    for (int kvh = 0; kvh < p.kv_num_heads; kvh++) {
+      for (int s = 0; s < new_tokens; s++) {
+        const size_t src = (static_cast<size_t>(b) * S + s) * p.kv_num_heads * H + static_cast<size_t>(kvh) * H;
+        std::copy_n(key.begin() + src, H, key_pool.begin() + PoolOffset(p, b, past + s, kvh));
+        std::copy_n(value.begin() + src, H, value_pool.begin() + PoolOffset(p, b, past + s, kvh));
+      }
+    }
+
+    for (int n = 0; n < p.num_heads; n++) {
+      const int kvh = n / (p.num_heads / p.kv_num_heads);
+      for (int s = 0; s < S; s++) {
+        const float* q = query.data() + (static_cast<size_t>(b) * S + s) * p.num_heads * H + static_cast<size_t>(n) * H;
+        const int causal = std::min(past + s + 1, total);
+        std::vector<float> scores(causal);
+        float max_score = -INFINITY;
+        for (int t = 0; t < causal; t++) {
+          const float* k = key_pool.data() + PoolOffset(p, b, t, kvh);
+          float dot = 0.0f;
+          for (int h = 0; h < H; h++) {
+            dot += q[h] * k[h];
+          }
+          scores[t] = dot / std::sqrt(static_cast<float>(H));
+          max_score = std::max(max_score, scores[t]);
+        }
+        float sum = 0.0f;
+        for (auto& score : scores) {
+          score = std::exp(score - max_score);
+          sum += score;
+        }
+        float* out = output.data() + (static_cast<size_t>(b) * S + s) * p.num_heads * H + static_cast<size_t>(n) * H;
+        for (int t = 0; t < causal; t++) {
+          const float* v = value_pool.data() + PoolOffset(p, b, t, kvh);
+          for (int h = 0; h < H; h++) {
+            out[h] += scores[t] / sum * v[h];
+          }
+        }
+      }
+    }
+  }
+}
+
+// Runs a GroupQueryAttention node in a session where, as with IOBinding, the present_key and present_value outputs
+// are the OrtValues fed as past_key and past_value, which OpTester cannot do. The present scales are those fed as the
+// past scales if share_scales is true, and new tensors otherwise. inputs are in the order of the schema, with an
+// empty name for a missing optional input. fetches receives all the outputs.
+Status RunWithSharedKVCache(int num_heads, int kv_num_heads,
+                            const std::vector<std::pair<std::string, OrtValue>>& inputs, bool share_scales,
+                            std::vector<OrtValue>& fetches) {
+  std::unordered_map<std::string, int> domain_to_version{{kOnnxDomain, 14}, {kMSDomain, 1}};
+  Model model("GroupQueryAttention", false, ModelMetaData(), PathString(), IOnnxRuntimeOpSchemaRegistryList(),
+              domain_to_version, {}, DefaultLoggingManager().DefaultLogger());
+  Graph& graph = model.MainGraph();
+
+  std::vector<NodeArg*> input_args;
+  NameMLValMap feeds;
+  std::unordered_map<std::string, OrtValue> values;
+  for (const auto& input : inputs) {
+    if (input.first.empty()) {
+      input_args.push_back(&graph.GetOrCreateNodeArg("", nullptr));
+      continue;
+    }
+    ONNX_NAMESPACE::TypeProto type;
+    type.mutable_tensor_type()->set_elem_type(input.second.Get<Tensor>().GetElementType());
+    input_args.push_back(&graph.GetOrCreateNodeArg(input.first, &type));
+    feeds[input.first] = input.second;
+    values[input.first] = input.second;
+  }
+
+  std::vector<std::string> output_names{"output", "present_key", "present_value"};
+  fetches = {OrtValue(), values["past_key"], values["past_value"]};
+  if (values.count("past_key_scale") != 0) {
+    output_names.insert(output_names.end(), {"present_key_scale", "present_value_scale"});
+    if (share_scales) {
+      fetches.insert(fetches.end(), {values["past_key_scale"], values["past_value_scale"]});
+    } else {
+      fetches.resize(output_names.size());
+    }
+  }
+  std::vector<NodeArg*> output_args;
+  for (const auto& name : output_names) {
+    output_args.push_back(&graph.GetOrCreateNodeArg(name, nullptr));
+  }
+
+  Node& node = graph.AddNode("gqa", "GroupQueryAttention", "", input_args, output_args, nullptr, kMSDomain);
+  node.AddAttribute("num_heads", static_cast<int64_t>(num_heads));
+  node.AddAttribute("kv_num_heads", static_cast<int64_t>(kv_num_heads));
+  ORT_RETURN_IF_ERROR(graph.Resolve());
+
+  std::string serialized_model;
+  ORT_RETURN_IF_NOT(model.ToProto().SerializeToString(&serialized_model), "Failed to serialize the model.");
+  std::stringstream model_stream(serialized_model);
+  SessionOptions so;
+  InferenceSession session{so, GetEnvironment()};
+  ORT_RETURN_IF_ERROR(session.Load(model_stream));
+  ORT_RETURN_IF_ERROR(session.Initialize());
+
+  std::vector<const void*> shared_buffers;
+  for (const auto& fetch : fetches) {
+    shared_buffers.push_back(fetch.IsAllocated() ? fetch.Get<Tensor>().DataRaw() : nullptr);
+  }
+  ORT_RETURN_IF_ERROR(session.Run(feeds, output_names, &fetches));
+  for (size_t i = 0; i < fetches.size(); i++) {
+    ORT_RETURN_IF_NOT(shared_buffers[i] == nullptr || fetches[i].Get<Tensor>().DataRaw() == shared_buffers[i],
+                      output_names[i], " does not share its buffer with the past.");
+  }
+  return Status::OK();
+}
+
+template <typename T>
+OrtValue MakeValue(const std::vector<int64_t>& dims, const std::vector<T>& data) {
+  OrtValue value;
+  CreateMLValue<T>(TestCPUExecutionProvider()->CreatePreferredAllocators()[0], dims, data, &value);
+  return value;
+}
+
+template <typename T>
+void ExpectValuesNear(const OrtValue& value, const std::vector<T>& expected, float tolerance) {
+  const auto actual = value.Get<Tensor>().DataAsSpan<T>();
+  ASSERT_EQ(actual.size(), expected.size());
+  for (size_t i = 0; i < expected.size(); i++) {
+    EXPECT_NEAR(static_cast<float>(actual[i]), static_cast<float>(expected[i]), tolerance) << "at index " << i;
+  }
+}
+
+void RunPagedKVCacheTest(const PagedKVCacheTestParams& p) {
+  const int S = p.sequence_length;
+  const size_t pool_size = static_cast<size_t>(p.num_blocks) * p.kv_num_heads * p.block_size * p.head_size;
+  const std::vector<float> query = MakeData(static_cast<size_t>(p.batch_size) * S * p.num_heads * p.head_size, 0.1f);
+  const std::vector<float> key = MakeData(static_cast<size_t>(p.batch_size) * S * p.kv_num_heads * p.head_size, 0.2f);
+  const std::vector<float> value = MakeData(static_cast<size_t>(p.batch_size) * S * p.kv_num_heads * p.head_size, 0.3f);
+  const std::vector<float> past_key = MakeData(pool_size, 0.4f);
+  const std::vector<float> past_value = MakeData(pool_size, 0.5f);
+
+  std::vector<float> present_key = past_key;
+  std::vector<float> present_value = past_value;
+  std::vector<float> output;
+  ComputeReference(p, query, key, value, present_key, present_value, output);
+
+  const int32_t total_sequence_length = *std::max_element(p.seqlens_k.begin(), p.seqlens_k.end()) + 1;
+  const std::vector<int64_t> pool_dims = {p.num_blocks, p.kv_num_heads, p.block_size, p.head_size};
+
+  // The kernel updates the pools in place.
+  OrtValue key_pool = MakeValue<float>(pool_dims, past_key);
+  OrtValue value_pool = MakeValue<float>(pool_dims, past_value);
+  std::vector<OrtValue> fetches;
+  ASSERT_STATUS_OK(RunWithSharedKVCache(
+      p.num_heads, p.kv_num_heads,
+      {{"query", MakeValue<float>({p.batch_size, S, p.num_heads * p.head_size}, query)},
+       {"key", MakeValue<float>({p.batch_size, S, p.kv_num_heads * p.head_size}, key)},
+       {"value", MakeValue<float>({p.batch_size, S, p.kv_num_heads * p.head_size}, value)},
+       {"past_key", key_pool},
+       {"past_value", value_pool},
+       {"seqlens_k", MakeValue<int32_t>({p.batch_size}, p.seqlens_k)},
+       {"total_sequence_length", MakeValue<int32_t>({1}, {total_sequence_length})},
+       {"", OrtValue()},
+       {"", OrtValue()},
+       {"block_table", MakeValue<int32_t>({p.batch_size, p.max_blocks_per_sequence}, p.block_table)}},
+      true, fetches));
+
+  ExpectValuesNear(fetches[0], output, 1e-4f);
+  ExpectValuesNear(key_pool, present_key, 0.0f);
+  ExpectValuesNear(value_pool, present_value, 0.0f);
+}
+
+// Runs with a contiguous kv cache of shape (B, N_kv, T, H), which is a paged kv cache with one block per sequence.
+void RunKVCacheTest(int batch_size, int sequence_length, int num_heads, int kv_num_heads, int head_size,
+                    int past_sequence_length, const std::vector<int32_t>& seqlens_k) {
+  const int S = sequence_length;
+  const int32_t total_sequence_length = *std::max_element(seqlens_k.begin(), seqlens_k.end()) + 1;
+  const int present_sequence_length = std::max<int>(total_sequence_length, past_sequence_length);
+
+  PagedKVCacheTestParams p{};
+  p.batch_size = batch_size;
+  p.sequence_length = S;
+  p.num_heads = num_heads;
+  p.kv_num_heads = kv_num_heads;
+  p.head_size = head_size;
+  p.block_size = present_sequence_length;
+  p.num_blocks = batch_size;
+  p.max_blocks_per_sequence = 1;
+  p.seqlens_k = seqlens_k;
+  for (int b = 0; b < batch_size; b++) {
+    p.block_table.push_back(b);
+  }
+
+  const std::vector<float> query = MakeData(static_cast<size_t>(batch_size) * S * num_heads * head_size, 0.1f);
+  const std::vector<float> key = MakeData(static_cast<size_t>(batch_size) * S * kv_num_heads * head_size, 0.2f);
+  const std::vector<float> value = MakeData(static_cast<size_t>(batch_size) * S * kv_num_heads * head_size, 0.3f);
+  const size_t past_size = static_cast<size_t>(batch_size) * kv_num_heads * past_sequence_length * head_size;
+  const std::vector<float> past_key = MakeData(past_size, 0.4f);
+  const std::vector<float> past_value = MakeData(past_size, 0.5f);
+
+  // The present kv cache has the past tokens of each sequence and zeros after its new tokens.
+  const size_t present_size = static_cast<size_t>(batch_size) * kv_num_heads * present_sequence_length * head_size;
+  std::vector<float> present_key(present_size, 0.0f);
+  std::vector<float> present_value(present_size, 0.0f);
+  if (S == 1) {
+    for (int b = 0; b < batch_size; b++) {
+      for (int kvh = 0; kvh < kv_num_heads; kvh++) {
+        const size_t src = (static_cast<size_t>(b) * kv_num_heads + kvh) * past_sequence_length * head_size;
+        const size_t dst = (static_cast<size_t>(b) * kv_num_heads + kvh) * present_sequence_length * head_size;
+        std::copy_n(past_key.begin() + src, seqlens_k[b] * head_size, present_key.begin() + dst);
+        std::copy_n(past_value.begin() + src, seqlens_k[b] * head_size, present_value.begin() + dst);
+      }
+    }
+  }
+  std::vector<float> output;
+  ComputeReference(p, query, key, value, present_key, present_value, output);
+
+  const std::vector<int64_t> past_dims = {batch_size, kv_num_heads, past_sequence_length, head_size};
+  const std::vector<int64_t> present_dims = {batch_size, kv_num_heads, present_sequence_length, head_size};
+
+  OpTester tester("GroupQueryAttention", 1, onnxruntime::kMSDomain);
+  tester.AddAttribute<int64_t>("num_heads", num_heads);
+  tester.AddAttribute<int64_t>("kv_num_heads", kv_num_heads);
+  tester.AddInput<float>("query", {batch_size, S, num_heads * head_size}, query);
+  tester.AddInput<float>("key", {batch_size, S, kv_num_heads * head_size}, key);
+  tester.AddInput<float>("value", {batch_size, S, kv_num_heads * head_size}, value);
+  if (past_sequence_length > 0) {
+    tester.AddInput<float>("past_key", past_dims, past_key);
+    tester.AddInput<float>("past_value", past_dims, past_value);
+  } else {
+    tester.AddOptionalInputEdge<float>();
+    tester.AddOptionalInputEdge<float>();
+  }
+  tester.AddInput<int32_t>("seqlens_k", {batch_size}, seqlens_k);
+  tester.AddInput<int32_t>("total_sequence_length", {1}, {total_sequence_length});
+  tester.AddOutput<float>("output", {batch_size, S, num_heads * head_size}, output, false, 0.0f, 1e-4f);
+  tester.AddOutput<float>("present_key", present_dims, present_key);
+  tester.AddOutput<float>("present_value", present_dims, present_value);
+
+  std::vector<std::unique_ptr<IExecutionProvider>> execution_providers;
+  execution_providers.push_back(DefaultCpuExecutionProvider());
+  tester.Run(OpTester::ExpectResult::kExpectSuccess, "", {}, nullptr, &execution_providers);
+}
+
+// Whether the present kv cache and its scales share their buffers with the past ones.
+enum class KVCacheBuffers {
+  kSeparate,
+  kShared,
+  kSharedExceptScales,
+};
+
+// Runs with a float16 or int8 kv cache of shape (B, N_kv, P, H). The keys and values are exactly representable in
+// the type of the cache, so the reference uses them as floats. Each int8 token has the scale kInt8Step, which is
+// also the scale of the new tokens since each of their heads has a value of 127 * kInt8Step.
+template <typename TCache>
+void RunQuantizedKVCacheTest(int batch_size, int sequence_length, int num_heads, int kv_num_heads, int head_size,
+                             int past_sequence_length, const std::vector<int32_t>& seqlens_k,
+                             KVCacheBuffers buffers = KVCacheBuffers::kSeparate) {
+  constexpr bool is_int8 = std::is_same_v<TCache, int8_t>;
+  constexpr float kInt8Step = 0.01f;
+  const int32_t total_sequence_length = *std::max_element(seqlens_k.begin(), seqlens_k.end()) + 1;
+  const int S = sequence_length;
+  const int P = past_sequence_length;
+  const size_t num_kv_heads = static_cast<size_t>(batch_size) * kv_num_heads;
+
+  // Values of rows of head_size elements that are exact in the cache type.
+  auto make_rows = [&](size_t rows, float seed) {
+    std::vector<float> data = MakeData(rows * head_size, seed);
+    for (auto& x : data) {
+      x = is_int8 ? std::nearbyint(x * 127.0f) * kInt8Step : MLFloat16(x).ToFloat();
+    }
+    if (is_int8) {
+      for (size_t r = 0; r < rows; r++) {
+        data[r * head_size] = 127.0f * kInt8Step;
+      }
+    }
+    return data;
+  };
+  auto to_cache = [&](float x) {
+    if constexpr (is_int8) {
+      return static_cast<int8_t>(std::nearbyint(x / kInt8Step));
+    } else {
+      return MLFloat16(x);
+    }
+  };
+
+  PagedKVCacheTestParams p{};
+  p.batch_size = batch_size;
+  p.sequence_length = S;
+  p.num_heads = num_heads;
+  p.kv_num_heads = kv_num_heads;
+  p.head_size = head_size;
+  p.block_size = P;
+  p.num_blocks = batch_size;
+  p.max_blocks_per_sequence = 1;
+  p.seqlens_k = seqlens_k;
+  for (int b = 0; b < batch_size; b++) {
+    p.block_table.push_back(b);
+  }
+
+  const std::vector<float> query = MakeData(static_cast<size_t>(batch_size) * S * num_heads * head_size, 0.1f);
+  const std::vector<float> key = make_rows(num_kv_heads * S, 0.2f);
+  const std::vector<float> value = make_rows(num_kv_heads * S, 0.3f);
+  const std::vector<float> past_key = make_rows(num_kv_heads * P, 0.4f);
+  const std::vector<float> past_value = make_rows(num_kv_heads * P, 0.5f);
+
+  std::vector<TCache> past_key_cache;
+  std::vector<TCache> past_value_cache;
+  std::transform(past_key.begin(), past_key.end(), std::back_inserter(past_key_cache), to_cache);
+  std::transform(past_value.begin(), past_value.end(), std::back_inserter(past_value_cache), to_cache);
+  const std::vector<float> past_scale(num_kv_heads * P, kInt8Step);
+
+  // A separate present kv cache has the past tokens of each sequence, its new tokens and zeros after them. A shared
+  // one keeps the rest of the past buffer, and so do shared scales.
+  const bool share_kv = buffers != KVCacheBuffers::kSeparate;
+  const bool share_scales = buffers == KVCacheBuffers::kShared;
+  std::vector<float> present_key(past_key.size(), 0.0f);
+  std::vector<float> present_value(past_value.size(), 0.0f);
+  std::vector<float> present_scale(num_kv_heads * P, 0.0f);
+  if (share_kv) {
+    present_key = past_key;
+    present_value = past_value;
+  }
+  if (share_scales) {
+    present_scale = past_scale;
+  }
+  for (int b = 0; b < batch_size; b++) {
+    const int total = seqlens_k[b] + 1;
+    const int past = S == total_sequence_length ? 0 : total - S;
+    for (int kvh = 0; kvh < kv_num_heads; kvh++) {
+      const size_t offset = (static_cast<size_t>(b) * kv_num_heads + kvh) * P;
+      std::copy_n(past_key.begin() + offset * head_size, past * head_size, present_key.begin() + offset * head_size);
+      std::copy_n(past_value.begin() + offset * head_size, past * head_size,
+                  present_value.begin() + offset * head_size);
+      std::fill_n(present_scale.begin() + offset, past + S, kInt8Step);
+    }
+  }
+  std::vector<float> output;
+  ComputeReference(p, query, key, value, present_key, present_value, output);
+
+  std::vector<TCache> present_key_cache;
+  std::vector<TCache> present_value_cache;
+  std::transform(present_key.begin(), present_key.end(), std::back_inserter(present_key_cache), to_cache);
+  std::transform(present_value.begin(), present_value.end(), std::back_inserter(present_value_cache), to_cache);
+
+  const std::vector<int64_t> cache_dims = {batch_size, kv_num_heads, P, head_size};
+  const std::vector<int64_t> scale_dims = {batch_size, kv_num_heads, P};
+
+  if (share_kv) {
+    std::vector<std::pair<std::string, OrtValue>> inputs{
+        {"query", MakeValue<float>({batch_size, S, num_heads * head_size}, query)},
+        {"key", MakeValue<float>({batch_size, S, kv_num_heads * head_size}, key)},
+        {"value", MakeValue<float>({batch_size, S, kv_num_heads * head_size}, value)},
+        {"past_key", MakeValue<TCache>(cache_dims, past_key_cache)},
+        {"past_value", MakeValue<TCache>(cache_dims, past_value_cache)},
+        {"seqlens_k", MakeValue<int32_t>({batch_size}, seqlens_k)},
+        {"total_sequence_length", MakeValue<int32_t>({1}, {total_sequence_length})}};
+    if (is_int8) {
+      inputs.insert(inputs.end(), {{"", OrtValue()},  // cos_cache
+                                   {"", OrtValue()},  // sin_cache
+                                   {"", OrtValue()},  // block_table
+                                   {"past_key_scale", MakeValue<float>(scale_dims, past_scale)},
+                                   {"past_value_scale", MakeValue<float>(scale_dims, past_scale)}});
+    }
+    std::vector<OrtValue> fetches;
+    ASSERT_STATUS_OK(RunWithSharedKVCache(num_heads, kv_num_heads, inputs, share_scales, fetches));
+    ExpectValuesNear(fetches[0], output, 1e-4f);
+    ExpectValuesNear(fetches[1], present_key_cache, 0.0f);
+    ExpectValuesNear(fetches[2], present_value_cache, 0.0f);
+    if (is_int8) {
+      ExpectValuesNear(fetches[3], present_scale, 0.0f);
+      ExpectValuesNear(fetches[4], present_scale, 0.0f);
+    }
+    return;
+  }
+
+  OpTester tester("GroupQueryAttention", 1, onnxruntime::kMSDomain);
+  tester.AddAttribute<int64_t>("num_heads", num_heads);
+  tester.AddAttribute<int64_t>("kv_num_heads", kv_num_heads);
+  tester.AddInput<float>("query", {batch_size, S, num_heads * head_size}, query);
+  tester.AddInput<float>("key", {batch_size, S, kv_num_heads * head_size}, key);
+  tester.AddInput<float>("value", {batch_size, S, kv_num_heads * head_size}, value);
+  tester.AddInput<TCache>("past_key", cache_dims, past_key_cache);
+  tester.AddInput<TCache>("past_value", cache_dims, past_value_cache);
+  tester.AddInput<int32_t>("seqlens_k", {batch_size}, seqlens_k);
+  tester.AddInput<int32_t>("total_sequence_length", {1}, {total_sequence_length});
+  if (is_int8) {
+    tester.AddOptionalInputEdge<float>();    // cos_cache
+    tester.AddOptionalInputEdge<float>();    // sin_cache
+    tester.AddOptionalInputEdge<int32_t>();  // block_table
+    tester.AddInput<float>("past_key_scale", scale_dims, past_scale);
+    tester.AddInput<float>("past_value_scale", scale_dims, past_scale);
+  }
+  tester.AddOutput<float>("output", {batch_size, S, num_heads * head_size}, output, false, 0.0f, 1e-4f);
+  tester.AddOutput<TCache>("present_key", cache_dims, present_key_cache);
+  tester.AddOutput<TCache>("present_value", cache_dims, present_value_cache);
+  if (is_int8) {
+    tester.AddOutput<float>("present_key_scale", scale_dims, present_scale);
+    tester.AddOutput<float>("present_value_scale", scale_dims, present_scale);
+  }
+
+  std::vector<std::unique_ptr<IExecutionProvider>> execution_providers;
+  execution_providers.push_back(DefaultCpuExecutionProvider());
+  tester.Run(OpTester::ExpectResult::kExpectSuccess, "", {}, nullptr, &execution_providers);
+}
+
+}  // namespace
+
+TEST(GroupQueryAttentionTest, KVCacheTokenGeneration) {
+  // The sequences have 4 and 1 past tokens in a buffer of 6 tokens.
+  RunKVCacheTest(2, 1, 4, 2, 8, 6, {4, 1});
+}
+
+TEST(GroupQueryAttentionTest, KVCachePrompt) {
+  RunKVCacheTest(2, 5, 4, 1, 16, 0, {4, 4});
+}
+
+TEST(GroupQueryAttentionTest, Float16KVCacheTokenGeneration) {
+  RunQuantizedKVCacheTest<MLFloat16>(2, 1, 4, 2, 8, 6, {4, 1});
+}
+
+TEST(GroupQueryAttentionTest, Int8KVCacheTokenGeneration) {
+  RunQuantizedKVCacheTest<int8_t>(2, 1, 4, 2, 16, 5, {4, 0});
+}
+
+TEST(GroupQueryAttentionTest, Int8KVCachePrompt) {
+  // The prompts of 5 tokens fill a buffer of 6 tokens.
+  RunQuantizedKVCacheTest<int8_t>(2, 5, 4, 2, 16, 6, {4, 4});
+}
+
+TEST(GroupQueryAttentionTest, Int8KVCacheSharedBuffer) {
+  RunQuantizedKVCacheTest<int8_t>(2, 1, 4, 2, 16, 5, {4, 0}, KVCacheBuffers::kShared);
+}
+
+TEST(GroupQueryAttentionTest, Int8KVCacheSharedBufferWithSeparateScales) {
+  // The past scales are copied to the present ones even though the kv cache is updated in place.
+  RunQuantizedKVCacheTest<int8_t>(2, 1, 4, 2, 16, 5, {4, 0}, KVCacheBuffers::kSharedExceptScales);
+}
+
+TEST(GroupQueryAttentionTest, PagedKVCacheTokenGeneration) {
+  PagedKVCacheTestParams params{};
+  params.batch_size = 2;
+  params.sequence_length = 1;
+  params.num_heads = 4;
+  params.kv_num_heads = 2;
+  params.head_size = 8;
+  params.block_size = 2;
+  params.num_blocks = 6;
+  params.max_blocks_per_sequence = 3;
+  // The first sequence has 4 tokens in blocks 3, 1 and gets its 5th in block 5. The second has 1 token in block 4.
+  params.seqlens_k = {4, 1};
+  params.block_table = {3, 1, 5,
+                        4, 0, 0};
+  RunPagedKVCacheTest(params);
+}
+
+TEST(GroupQueryAttentionTest, PagedKVCachePrompt) {
+  PagedKVCacheTestParams params{};
+  params.batch_size = 2;
+  params.sequence_length = 3;
+  params.num_heads = 2;
+  params.kv_num_heads = 1;
+  params.head_size = 8;
+  params.block_size = 2;
+  params.num_blocks = 4;
+  params.max_blocks_per_sequence = 2;
+  // The second sequence is right-padded to the length of the first.
+  params.seqlens_k = {2, 1};
+  params.block_table = {2, 0,
+                        1, 3};
+  RunPagedKVCacheTest(params);
+}
+
+TEST(GroupQueryAttentionTest, PagedKVCacheContinuedPrompt) {
+  PagedKVCacheTestParams params{};
+  params.batch_size = 2;
+  params.sequence_length = 3;
+  params.num_heads = 4;
+  params.kv_num_heads = 2;
+  params.head_size = 8;
+  params.block_size = 2;
+  params.num_blocks = 8;
+  params.max_blocks_per_sequence = 4;
+  // 3 new tokens follow the 4 cached tokens of the first sequence, which fill blocks 6 and 2, and the cached token
+  // of the second sequence in block 5.
+  params.seqlens_k = {6, 3};
+  params.block_table = {6, 2, 0, 7,
+                        5, 1, 0, 0};
+  RunPagedKVCacheTest(params);
+}
+
+TEST(GroupQueryAttentionTest, PagedKVCacheRequiresSharedBuffers) {
+  OpTester tester("GroupQueryAttention", 1, onnxruntime::kMSDomain);
+  tester.AddAttribute<int64_t>("num_heads", 1);
+  tester.AddAttribute<int64_t>("kv_num_heads", 1);
+  tester.AddInput<float>("query", {1, 1, 8}, MakeData(8, 0.1f));
+  tester.AddInput<float>("key", {1, 1, 8}, MakeData(8, 0.2f));
+  tester.AddInput<float>("value", {1, 1, 8}, MakeData(8, 0.3f));
+  tester.AddInput<float>("past_key", {2, 1, 2, 8}, MakeData(32, 0.4f));
+  tester.AddInput<float>("past_value", {2, 1, 2, 8}, MakeData(32, 0.5f));
+  tester.AddInput<int32_t>("seqlens_k", {1}, {1});
+  tester.AddInput<int32_t>("total_sequence_length", {1}, {2});
+  tester.AddOptionalInputEdge<float>();
+  tester.AddOptionalInputEdge<float>();
+  tester.AddInput<int32_t>("block_table", {1, 1}, {1});
+  tester.AddOutput<float>("output", {1, 1, 8}, std::vector<float>(8));
+  tester.AddOutput<float>("present_key", {2, 1, 2, 8}, std::vector<float>(32));
+  tester.AddOutput<float>("present_value", {2, 1, 2, 8}, std::vector<float>(32));
+
+  std::vector<std::unique_ptr<IExecutionProvider>> execution_providers;
+  execution_providers.push_back(DefaultCpuExecutionProvider());
+  tester.Run(OpTester::ExpectResult::kExpectFailure, "must share their buffers", {}, nullptr, &execution_providers);
+}
+
+TEST(GroupQueryAttentionTest, PagedKVCacheInvalidBlockIndex) {
+  OpTester tester("GroupQueryAttention", 1, onnxruntime::kMSDomain);
+  tester.AddAttribute<int64_t>("num_heads", 1);
+  tester.AddAttribute<int64_t>("kv_num_heads", 1);
+  tester.AddInput<float>("query", {1, 1, 8}, MakeData(8, 0.1f));
+  tester.AddInput<float>("key", {1, 1, 8}, MakeData(8, 0.2f));
+  tester.AddInput<float>("value", {1, 1, 8}, MakeData(8, 0.3f));
+  tester.AddInput<float>("past_key", {2, 1, 2, 8}, MakeData(32, 0.4f));
+  tester.AddInput<float>("past_value", {2, 1, 2, 8}, MakeData(32, 0.5f));
+  tester.AddInput<int32_t>("seqlens_k", {1}, {1});
+  tester.AddInput<int32_t>("total_sequence_length", {1}, {2});
+  tester.AddOptionalInputEdge<float>();
+  tester.AddOptionalInputEdge<float>();
+  tester.AddInput<int32_t>("block_table", {1, 1}, {2});
+  tester.AddOutput<float>("output", {1, 1, 8}, std::vector<float>(8));
+  tester.AddOutput<float>("present_key", {2, 1, 2, 8}, std::vector<float>(32));
+  tester.AddOutput<float>("present_value", {2, 1, 2, 8}, std::vector<float>(32));
+
+  std::vector<std::unique_ptr<IExecutionProvider>> execution_providers;
+  execution_providers.push_back(DefaultCpuExecutionProvider());
+  tester.Run(OpTester::ExpectResult::kExpectFailure, "which is out of range", {}, nullptr, &execution_providers);
+}
+
+}  // namespace test
+}  // namespace onnxruntime
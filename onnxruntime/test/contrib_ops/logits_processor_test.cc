@@ -0,0 +1,137 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "contrib_ops/cpu/transformers/logits_processor.h"
+
+namespace onnxruntime {
+namespace test {
+
+using contrib::transformers::BeamSearchParameters;
+using contrib::transformers::LogitsProcessorList;
+
+namespace {
+
+// More than one block of the fused processor.
+constexpr int kVocabSize = 5000;
+constexpr int kBatchSize = 2;
+constexpr int kNumBeams = 2;
+constexpr int kBatchBeamSize = kBatchSize * kNumBeams;
+
+std::vector<float> MakeScores() {
+  std::vector<float> scores(static_cast<size_t>(kBatchBeamSize) * kVocabSize);
+  for (size_t i = 0; i < scores.size(); i++) {
+    scores[i] = 4.0f * std::sin(0.1f + 0.37f * static_cast<float>(i));
+  }
+  return scores;
+}
+
+std::vector<int32_t> MakeMask(size_t size, int period, int offset) {
+  std::vector<int32_t> mask(size);
+  for (size_t i = 0; i < size; i++) {
+    mask[i] = (static_cast<int>(i) + offset) % period == 0 ? 0 : 1;
+  }
+  return mask;
+}
+
+BeamSearchParameters MakeParameters() {
+  BeamSearchParameters parameters{};
+  parameters.model_type = BeamSearchParameters::kModelTypeGpt;
+  parameters.repetition_penalty = 1.0f;
+  parameters.batch_size = kBatchSize;
+  parameters.num_beams = kNumBeams;
+  parameters.vocab_size = kVocabSize;
+  parameters.temperature = 1.0f;
+  return parameters;
+}
+
+// Applies the processors one after the other over all the scores, as the individual vocabulary mask, prefix
+// vocabulary mask, temperature and presence penalty processors did before they were fused.
+std::vector<float> ProcessUnfused(const BeamSearchParameters& parameters, std::vector<float> scores, int step) {
+  const float lowest = std::numeric_limits<float>::lowest();
+  for (int i = 0; i < kBatchBeamSize; i++) {
+    float* row = scores.data() + static_cast<size_t>(i) * kVocabSize;
+    if (!parameters.vocab_mask.empty()) {
+      for (int j = 0; j < kVocabSize; j++) {
+        if (parameters.vocab_mask[j] == 0) {
+          row[j] = lowest;
+        }
+      }
+    }
+    if (!parameters.prefix_vocab_mask.empty() && step <= 1) {
+      const int32_t* prefix_vocab_mask = parameters.prefix_vocab_mask.data() +
+                                         static_cast<size_t>(i / kNumBeams) * kVocabSize;
+      for (int j = 0; j < kVocabSize; j++) {
+        if (prefix_vocab_mask[j] == 0) {
+          row[j] = lowest;
+        }
+      }
+    }
+  }
+  if (parameters.temperature != 1.0f) {
+    for (auto& score : scores) {
+      score /= parameters.temperature;
+    }
+  }
+  if (!parameters.presence_mask.empty() && parameters.presence_penalty != 0.0f) {
+    for (size_t i = 0; i < scores.size(); i++) {
+      scores[i] -= parameters.presence_mask[i] * parameters.presence_penalty;
+    }
+  }
+  return scores;
+}
+
+void ExpectSameAsUnfused(const BeamSearchParameters& parameters, int step) {
+  LogitsProcessorList processors;
+  processors.Init(parameters);
+
+  const std::vector<float> scores = MakeScores();
+  const std::vector<float> expected = ProcessUnfused(parameters, scores, step);
+  std::vector<float> actual = scores;
+  gsl::span<float> actual_span(actual);
+  processors.Process(nullptr, actual_span, step);
+
+  for (size_t i = 0; i < expected.size(); i++) {
+    ASSERT_FLOAT_EQ(expected[i], actual[i]) << "at index " << i << " of step " << step;
+  }
+}
+
+}  // namespace
+
+TEST(FusedLogitsProcessorTest, PrefixVocabMaskOnFirstStepOnly) {
+  const std::vector<int32_t> prefix_vocab_mask = MakeMask(static_cast<size_t>(kBatchSize) * kVocabSize, 3, 1);
+  BeamSearchParameters parameters = MakeParameters();
+  parameters.prefix_vocab_mask = prefix_vocab_mask;
+
+  for (int step : {1, 2, 3}) {
+    SCOPED_TRACE(step);
+    ExpectSameAsUnfused(parameters, step);
+  }
+}
+
+TEST(FusedLogitsProcessorTest, VocabMaskTemperatureAndPresencePenalty) {
+  const std::vector<int32_t> vocab_mask = MakeMask(kVocabSize, 7, 0);
+  const std::vector<int32_t> prefix_vocab_mask = MakeMask(static_cast<size_t>(kBatchSize) * kVocabSize, 5, 2);
+  const std::vector<int32_t> presence_mask = MakeMask(static_cast<size_t>(kBatchBeamSize) * kVocabSize, 2, 1);
+  BeamSearchParameters parameters = MakeParameters();
+  parameters.vocab_mask = vocab_mask;
+  parameters.temperature = 0.7f;
+  parameters.presence_mask = presence_mask;
+  parameters.presence_penalty = 0.5f;
+
+  ExpectSameAsUnfused(parameters, 1);
+
+  // With the prefix vocabulary mask too, on the first step and after it.
+  parameters.prefix_vocab_mask = prefix_vocab_mask;
+  for (int step : {1, 2}) {
+    SCOPED_TRACE(step);
+    ExpectSameAsUnfused(parameters, step);
+  }
+}
+
+}  // namespace test
+}  // namespace onnxruntime
@@ -1,12 +1,20 @@
 // Copyright (c) Microsoft Corporation. All rights reserved.
 // Licensed under the MIT License.
 
+#include <algorithm>
 #include <memory>
+#include <numeric>
+#include <random>
 #include <vector>
 #include "gtest/gtest.h"
 #include <gsl/gsl>
 #include "core/session/onnxruntime_cxx_api.h"
+#include "core/providers/cpu/generator/random.h"
+#include "core/providers/cpu/math/softmax_shared.h"
+#include "contrib_ops/cpu/transformers/generation_device_helper.h"
+#include "contrib_ops/cpu/transformers/sampling_cpu_helper.h"
 #include "test/common/cuda_op_test_utils.h"
+#include "test/util/include/asserts.h"
 
 #ifdef USE_CUDA
 #include "core/providers/cuda/cuda_provider_options.h"
@@ -163,5 +171,48 @@ TEST(SamplingTest, Gpt2Sampling_CPU) {
   ASSERT_TRUE(std::equal(expected_output.cbegin(), expected_output.cend(), result_span.begin(), result_span.end()));
 }
 #endif
+
+TEST(SamplingTest, TopPSelectionMatchesFullSort) {
+  constexpr size_t vocab_size = 1000;
+  std::default_random_engine generator{123};
+  std::uniform_real_distribution<float> distribution(-8.0f, 8.0f);
+  std::vector<float> scores(vocab_size);
+  for (auto& score : scores) {
+    score = distribution(generator);
+  }
+  std::vector<float> probs(vocab_size);
+  ASSERT_STATUS_OK(SoftmaxCPU<float>(1, vocab_size, scores.data(), probs.data(), false, nullptr));
+
+  std::vector<int32_t> order(vocab_size);
+  std::iota(order.begin(), order.end(), 0);
+  std::sort(order.begin(), order.end(), [&probs](int32_t i1, int32_t i2) { return probs[i1] > probs[i2]; });
+
+  for (bool custom : {false, true}) {
+    for (float top_p : {0.1f, 0.5f, 0.9f, 0.999f, 1.0f}) {
+      for (int min_tokens_to_keep : {1, 100}) {
+        SCOPED_TRACE(::testing::Message() << "custom=" << custom << " top_p=" << top_p
+                                          << " min_tokens_to_keep=" << min_tokens_to_keep);
+        contrib::transformers::IGenerationParameters parameters{};
+        parameters.top_p = top_p;
+        parameters.custom_sampling = custom;
+        parameters.min_tokens_to_keep = min_tokens_to_keep;
+
+        // Scan the fully sorted row.
+        const size_t min_kept = custom ? 1 : static_cast<size_t>(min_tokens_to_keep);
+        size_t expected_num_kept = 0;
+        float cumulative_prob = 0.0f;
+        while (expected_num_kept < vocab_size &&
+               (expected_num_kept < min_kept || (custom ? cumulative_prob <= top_p : cumulative_prob < top_p))) {
+          cumulative_prob += probs[order[expected_num_kept++]];
+        }
+
+        std::vector<int32_t> sorted_indices(vocab_size);
+        const size_t num_kept = contrib::SamplingCpuHelper::SelectTopP<float>(probs, sorted_indices, &parameters);
+        ASSERT_EQ(expected_num_kept, num_kept);
+        ASSERT_TRUE(std::equal(order.begin(), order.begin() + num_kept, sorted_indices.begin()));
+      }
+    }
+  }
+}
 }  // namespace test
 }  // namespace onnxruntime
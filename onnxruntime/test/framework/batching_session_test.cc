@@ -0,0 +1,189 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "core/session/batching_session.h"
+
+#include <thread>
+
+#include "core/framework/tensor.h"
+#include "core/session/inference_session.h"
+#include "test_utils.h"
+#include "test/test_environment.h"
+#include "test/util/include/asserts.h"
+#include "gtest/gtest.h"
+
+namespace onnxruntime {
+namespace test {
+
+namespace {
+
+// A[M, 2] x B[2, 4] -> Y[M, 4], with B = [[0, 1, 2, 3], [4, 5, 6, 7]].
+constexpr const ORTCHAR_T* kMatMulModel = ORT_TSTR("testdata/matmul_with_dynamic_input_shape.onnx");
+// Abs(x[Dim1, Dim2]) -> y[Dim1, Dim2].
+constexpr const ORTCHAR_T* kAbsModel = ORT_TSTR("testdata/abs_free_dimensions.onnx");
+
+void LoadSession(InferenceSession& session, const ORTCHAR_T* model_uri) {
+  ASSERT_STATUS_OK(session.Load(model_uri));
+  ASSERT_STATUS_OK(session.Initialize());
+}
+
+OrtValue CreateInput(const std::vector<int64_t>& dims, const std::vector<float>& values) {
+  OrtValue value;
+  CreateMLValue<float>(TestCPUExecutionProvider()->CreatePreferredAllocators()[0], dims, values, &value);
+  return value;
+}
+
+struct Result {
+  Status status;
+  std::vector<OrtValue> fetches;
+};
+
+// Run one request per input concurrently and wait for all of them.
+std::vector<Result> RunConcurrently(BatchingSession& batching_session, const std::string& input_name,
+                                    const std::string& output_name, const std::vector<OrtValue>& inputs) {
+  std::vector<Result> results(inputs.size());
+  std::vector<std::thread> threads;
+  const std::vector<std::string> feed_names{input_name};
+  const std::vector<std::string> output_names{output_name};
+  for (size_t i = 0; i < inputs.size(); ++i) {
+    threads.emplace_back([&, i]() {
+      results[i].status = batching_session.Run(feed_names, gsl::make_span(&inputs[i], 1), output_names,
+                                               results[i].fetches);
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  return results;
+}
+
+void ExpectTensor(const OrtValue& value, const std::vector<int64_t>& expected_dims,
+                  const std::vector<float>& expected_values) {
+  const auto& tensor = value.Get<Tensor>();
+  ASSERT_EQ(tensor.Shape(), TensorShape(expected_dims));
+  auto data = tensor.DataAsSpan<float>();
+  ASSERT_EQ(data.size(), expected_values.size());
+  for (size_t i = 0; i < expected_values.size(); ++i) {
+    EXPECT_EQ(data[i], expected_values[i]) << "at " << i;
+  }
+}
+
+}  // namespace
+
+TEST(BatchingSessionTest, CoalescesConcurrentRequests) {
+  SessionOptions so;
+  InferenceSession session{so, GetEnvironment()};
+  LoadSession(session, kMatMulModel);
+
+  // The batch is dispatched as soon as all rows are queued, long before the delay expires.
+  BatchingOptions options;
+  options.max_batch_size = 6;
+  options.max_delay_us = 10 * 1000 * 1000;
+  BatchingSession batching_session(session, options);
+
+  std::vector<OrtValue> inputs{CreateInput({1, 2}, {1.f, 0.f}),
+                               CreateInput({2, 2}, {0.f, 1.f, 1.f, 1.f}),
+                               CreateInput({3, 2}, {2.f, 0.f, 0.f, 2.f, -1.f, 0.f})};
+  auto results = RunConcurrently(batching_session, "A", "Y", inputs);
+
+  for (const auto& result : results) {
+    ASSERT_STATUS_OK(result.status);
+    ASSERT_EQ(result.fetches.size(), 1u);
+  }
+  ExpectTensor(results[0].fetches[0], {1, 4}, {0.f, 1.f, 2.f, 3.f});
+  ExpectTensor(results[1].fetches[0], {2, 4}, {4.f, 5.f, 6.f, 7.f, 4.f, 6.f, 8.f, 10.f});
+  ExpectTensor(results[2].fetches[0], {3, 4},
+               {0.f, 2.f, 4.f, 6.f, 8.f, 10.f, 12.f, 14.f, 0.f, -1.f, -2.f, -3.f});
+
+  auto stats = batching_session.GetStats();
+  EXPECT_EQ(stats.num_requests, 3u);
+  EXPECT_EQ(stats.num_batches, 1u);
+  EXPECT_EQ(stats.request_latency.count, 3u);
+  EXPECT_EQ(stats.queue_latency.count, 3u);
+}
+
+TEST(BatchingSessionTest, PadsNonBatchDimensions) {
+  SessionOptions so;
+  InferenceSession session{so, GetEnvironment()};
+  LoadSession(session, kAbsModel);
+
+  BatchingOptions options;
+  options.max_batch_size = 3;
+  options.max_delay_us = 10 * 1000 * 1000;
+  BatchingSession batching_session(session, options);
+
+  std::vector<OrtValue> inputs{CreateInput({1, 2}, {-1.f, 2.f}),
+                               CreateInput({2, 3}, {-3.f, 4.f, -5.f, 6.f, -7.f, 8.f})};
+  auto results = RunConcurrently(batching_session, "x", "y", inputs);
+
+  ASSERT_STATUS_OK(results[0].status);
+  ASSERT_STATUS_OK(results[1].status);
+  // y[Dim1, Dim2] follows x[Dim1, Dim2], so the output of the smaller request is cropped back to its extent.
+  ExpectTensor(results[0].fetches[0], {1, 2}, {1.f, 2.f});
+  ExpectTensor(results[1].fetches[0], {2, 3}, {3.f, 4.f, 5.f, 6.f, 7.f, 8.f});
+  EXPECT_EQ(batching_session.GetStats().num_batches, 1u);
+}
+
+TEST(BatchingSessionTest, BatchesAlongInnerAxis) {
+  SessionOptions so;
+  InferenceSession session{so, GetEnvironment()};
+  LoadSession(session, kAbsModel);
+
+  BatchingOptions options;
+  options.max_batch_size = 3;
+  options.max_delay_us = 10 * 1000 * 1000;
+  options.batch_axis = 1;
+  options.allow_padding = false;
+  BatchingSession batching_session(session, options);
+
+  std::vector<OrtValue> inputs{CreateInput({2, 1}, {-1.f, 2.f}),
+                               CreateInput({2, 2}, {-3.f, 4.f, -5.f, 6.f})};
+  auto results = RunConcurrently(batching_session, "x", "y", inputs);
+
+  ASSERT_STATUS_OK(results[0].status);
+  ASSERT_STATUS_OK(results[1].status);
+  ExpectTensor(results[0].fetches[0], {2, 1}, {1.f, 2.f});
+  ExpectTensor(results[1].fetches[0], {2, 2}, {3.f, 4.f, 5.f, 6.f});
+  EXPECT_EQ(batching_session.GetStats().num_batches, 1u);
+}
+
+TEST(BatchingSessionTest, IncompatibleRequestsRunSeparately) {
+  SessionOptions so;
+  InferenceSession session{so, GetEnvironment()};
+  LoadSession(session, kAbsModel);
+
+  BatchingOptions options;
+  options.max_batch_size = 4;
+  options.max_delay_us = 1000;
+  options.allow_padding = false;
+  BatchingSession batching_session(session, options);
+
+  std::vector<OrtValue> inputs{CreateInput({1, 2}, {-1.f, 2.f}),
+                               CreateInput({1, 3}, {-3.f, 4.f, -5.f})};
+  auto results = RunConcurrently(batching_session, "x", "y", inputs);
+
+  ASSERT_STATUS_OK(results[0].status);
+  ASSERT_STATUS_OK(results[1].status);
+  ExpectTensor(results[0].fetches[0], {1, 2}, {1.f, 2.f});
+  ExpectTensor(results[1].fetches[0], {1, 3}, {3.f, 4.f, 5.f});
+  EXPECT_EQ(batching_session.GetStats().num_batches, 2u);
+}
+
+TEST(BatchingSessionTest, PreallocatedFetches) {
+  SessionOptions so;
+  InferenceSession session{so, GetEnvironment()};
+  LoadSession(session, kAbsModel);
+
+  BatchingSession batching_session(session, BatchingOptions{});
+
+  OrtValue input = CreateInput({1, 2}, {-1.f, 2.f});
+  std::vector<OrtValue> fetches{CreateInput({1, 2}, {0.f, 0.f})};
+  const void* buffer = fetches[0].Get<Tensor>().DataRaw();
+  ASSERT_STATUS_OK(batching_session.Run(std::vector<std::string>{"x"}, gsl::make_span(&input, 1),
+                                        std::vector<std::string>{"y"}, fetches));
+  EXPECT_EQ(fetches[0].Get<Tensor>().DataRaw(), buffer);
+  ExpectTensor(fetches[0], {1, 2}, {1.f, 2.f});
+}
+
+}  // namespace test
+}  // namespace onnxruntime
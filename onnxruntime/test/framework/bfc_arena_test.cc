@@ -7,6 +7,8 @@
 #include "gtest/gtest.h"
 #include "gmock/gmock.h"
 #include <cstdlib>
+#include <future>
+#include <thread>
 #include "core/framework/stream_handles.h"
 
 namespace onnxruntime {
@@ -481,5 +483,182 @@ TEST(BFCArenaTest, TestExtendStrategy) {
   ASSERT_EQ(extend_delta_bytes, extend_limit);
 }
 
+TEST(BFCArenaTest, TestThreadCache) {
+  BFCArena a(std::unique_ptr<IAllocator>(new CPUAllocator()), 1 << 30, ArenaExtendStrategy::kNextPowerOfTwo,
+             BFCArena::DEFAULT_INITIAL_CHUNK_SIZE_BYTES, BFCArena::DEFAULT_MAX_DEAD_BYTES_PER_CHUNK,
+             BFCArena::DEFAULT_INITIAL_GROWTH_CHUNK_SIZE_BYTES, BFCArena::DEFAULT_MAX_POWER_OF_TWO_EXTEND_BYTES,
+             64 * 1024);
+  AllocatorStats stats;
+
+  void* p = a.Alloc(1000);
+  a.Free(p);
+  a.GetStats(&stats);
+  EXPECT_EQ(stats.num_thread_cache_misses, 1);
+  EXPECT_EQ(stats.num_thread_cache_hits, 0);
+  EXPECT_EQ(stats.bytes_in_use, 0) << "Cached chunks should not be reported as in use";
+
+  // same rounded size is served from the cache
+  void* p2 = a.Alloc(1001);
+  EXPECT_EQ(p, p2);
+  a.GetStats(&stats);
+  EXPECT_EQ(stats.num_thread_cache_hits, 1);
+  EXPECT_EQ(stats.num_allocs, 2);
+  EXPECT_EQ(stats.bytes_in_use, 1024);
+  a.Free(p2);
+
+  // a different size class and large allocations are not
+  void* p3 = a.Alloc(100);
+  EXPECT_NE(p, p3);
+  void* large = a.Alloc(1024 * 1024);
+  a.GetStats(&stats);
+  EXPECT_EQ(stats.num_thread_cache_misses, 2);
+  a.Free(p3);
+  a.Free(large);
+
+  // cached chunks must not keep the arena from shrinking
+  void* p10M = a.Alloc(10 * 1024 * 1024);
+  void* small = a.Alloc(4096);
+  a.Free(small);
+  a.Free(p10M);
+  EXPECT_EQ(a.Shrink(), Status::OK());
+  a.GetStats(&stats);
+  EXPECT_EQ(stats.num_arena_extensions, 1);
+  EXPECT_EQ(stats.bytes_in_use, 0);
+}
+
+TEST(BFCArenaTest, TestThreadCacheFlushesInBatches) {
+  constexpr int64_t max_thread_cache_bytes = 16 * 1024;
+  BFCArena a(std::unique_ptr<IAllocator>(new CPUAllocator()), 1 << 30, ArenaExtendStrategy::kNextPowerOfTwo,
+             BFCArena::DEFAULT_INITIAL_CHUNK_SIZE_BYTES, BFCArena::DEFAULT_MAX_DEAD_BYTES_PER_CHUNK,
+             BFCArena::DEFAULT_INITIAL_GROWTH_CHUNK_SIZE_BYTES, BFCArena::DEFAULT_MAX_POWER_OF_TWO_EXTEND_BYTES,
+             max_thread_cache_bytes);
+
+  std::vector<void*> ptrs;
+  for (int i = 0; i < 64; ++i) {
+    ptrs.push_back(a.Alloc(1024));
+  }
+  for (void* p : ptrs) {
+    a.Free(p);
+  }
+
+  // everything beyond the cache budget went back to the bins
+  AllocatorStats stats;
+  a.GetStats(&stats);
+  EXPECT_EQ(stats.bytes_in_use, 0);
+
+  ptrs.clear();
+  for (int i = 0; i < 64; ++i) {
+    ptrs.push_back(a.Alloc(1024));
+  }
+  a.GetStats(&stats);
+  EXPECT_GT(stats.num_thread_cache_hits, 0);
+  EXPECT_LE(stats.num_thread_cache_hits, max_thread_cache_bytes / 1024);
+  for (void* p : ptrs) {
+    a.Free(p);
+  }
+}
+
+TEST(BFCArenaTest, TestThreadCacheCrossThreadFree) {
+  BFCArena a(std::unique_ptr<IAllocator>(new CPUAllocator()), 1 << 30, ArenaExtendStrategy::kNextPowerOfTwo,
+             BFCArena::DEFAULT_INITIAL_CHUNK_SIZE_BYTES, BFCArena::DEFAULT_MAX_DEAD_BYTES_PER_CHUNK,
+             BFCArena::DEFAULT_INITIAL_GROWTH_CHUNK_SIZE_BYTES, BFCArena::DEFAULT_MAX_POWER_OF_TWO_EXTEND_BYTES,
+             64 * 1024);
+  AllocatorStats stats;
+
+  // freed on another thread while the owning thread is alive: handed back to the owner's cache
+  void* p = a.Alloc(512);
+  std::thread([&a, p]() { a.Free(p); }).join();
+  void* p2 = a.Alloc(512);
+  EXPECT_EQ(p, p2);
+  a.GetStats(&stats);
+  EXPECT_EQ(stats.num_thread_cache_hits, 1);
+  a.Free(p2);
+
+  // allocated on a thread that exits before the free: goes straight back to the bins
+  void* q = nullptr;
+  std::thread([&a, &q]() { q = a.Alloc(2048); }).join();
+  a.GetStats(&stats);
+  EXPECT_EQ(stats.bytes_in_use, 2048);
+  a.Free(q);
+  a.GetStats(&stats);
+  EXPECT_EQ(stats.bytes_in_use, 0);
+
+  // concurrent use from several threads
+  std::vector<std::thread> threads;
+  for (int t = 0; t < 4; ++t) {
+    threads.emplace_back([&a, t]() {
+      for (int i = 0; i < 1000; ++i) {
+        void* ptr = a.Alloc(static_cast<size_t>(64 + (i * (t + 1)) % 8192));
+        memset(ptr, t, 64);
+        a.Free(ptr);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  a.GetStats(&stats);
+  EXPECT_EQ(stats.bytes_in_use, 0);
+  EXPECT_EQ(stats.num_thread_cache_hits + stats.num_thread_cache_misses, 4003);
+}
+
+TEST(BFCArenaTest, TestThreadCacheShrinkFlushesIdleThreads) {
+  BFCArena a(std::unique_ptr<IAllocator>(new CPUAllocator()), 1 << 30, ArenaExtendStrategy::kSameAsRequested,
+             BFCArena::DEFAULT_INITIAL_CHUNK_SIZE_BYTES, BFCArena::DEFAULT_MAX_DEAD_BYTES_PER_CHUNK,
+             BFCArena::DEFAULT_INITIAL_GROWTH_CHUNK_SIZE_BYTES, BFCArena::DEFAULT_MAX_POWER_OF_TWO_EXTEND_BYTES,
+             64 * 1024);
+
+  // the worker's cache holds a local and a remote free while the worker stays alive but idle
+  std::promise<void*> allocated;
+  std::promise<void> freed;
+  std::promise<void> shrunk;
+  std::thread worker([&]() {
+    void* p = a.Alloc(4096);
+    allocated.set_value(a.Alloc(8192));
+    a.Free(p);
+    freed.set_value();
+    shrunk.get_future().wait();
+  });
+  void* remote = allocated.get_future().get();
+  freed.get_future().wait();
+  a.Free(remote);
+
+  ASSERT_EQ(a.Shrink(), Status::OK());
+  AllocatorStats stats;
+  a.GetStats(&stats);
+  EXPECT_EQ(stats.bytes_in_use, 0);
+  EXPECT_EQ(stats.total_allocated_bytes, 0) << "Chunks cached by an idle thread should not keep regions alive";
+
+  shrunk.set_value();
+  worker.join();
+}
+
+TEST(BFCArenaTest, TestThreadCacheArenaDestroyedWhileThreadsExit) {
+  for (int iteration = 0; iteration < 20; ++iteration) {
+    auto a = std::make_unique<BFCArena>(std::unique_ptr<IAllocator>(new CPUAllocator()), 1 << 30,
+                                        ArenaExtendStrategy::kNextPowerOfTwo,
+                                        BFCArena::DEFAULT_INITIAL_CHUNK_SIZE_BYTES,
+                                        BFCArena::DEFAULT_MAX_DEAD_BYTES_PER_CHUNK,
+                                        BFCArena::DEFAULT_INITIAL_GROWTH_CHUNK_SIZE_BYTES,
+                                        BFCArena::DEFAULT_MAX_POWER_OF_TWO_EXTEND_BYTES, 64 * 1024);
+    std::vector<std::promise<void>> done(4);
+    std::vector<std::thread> threads;
+    for (auto& promise : done) {
+      threads.emplace_back([&a, &promise]() {
+        a->Free(a->Alloc(256));
+        promise.set_value();
+        // the thread releases its cache on exit, racing with the arena's destructor below
+      });
+    }
+    for (auto& promise : done) {
+      promise.get_future().wait();
+    }
+    a.reset();
+    for (auto& thread : threads) {
+      thread.join();
+    }
+  }
+}
+
 }  // namespace test
 }  // namespace onnxruntime
@@ -0,0 +1,85 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "core/framework/mem_pattern_cache.h"
+#include "core/framework/allocator.h"
+#include "core/framework/tensor.h"
+#include "gtest/gtest.h"
+
+namespace onnxruntime {
+namespace test {
+
+static std::vector<OrtValue> CreateFeeds(const std::vector<TensorShapeVector>& shapes) {
+  auto allocator = std::make_shared<CPUAllocator>();
+  std::vector<OrtValue> feeds(shapes.size());
+  for (size_t i = 0; i < shapes.size(); ++i) {
+    Tensor::InitOrtValue(DataTypeImpl::GetType<float>(), TensorShape(shapes[i]), allocator, feeds[i]);
+  }
+  return feeds;
+}
+
+static MemoryPatternCacheEntry CreateEntry(int value_idx, int64_t dim) {
+  MemoryPatternCacheEntry entry;
+  entry.resolved_shapes.emplace(value_idx, TensorShape({dim}));
+  return entry;
+}
+
+TEST(MemPatternCacheTest, KeyIsExactShape) {
+  // Shapes that used to collide when the key was the XOR of all dims.
+  auto key1 = MemoryPatternCache::MakeKey(CreateFeeds({{1, 128}}));
+  auto key2 = MemoryPatternCache::MakeKey(CreateFeeds({{128, 1}}));
+  auto key3 = MemoryPatternCache::MakeKey(CreateFeeds({{2, 2}}));
+  auto key4 = MemoryPatternCache::MakeKey(CreateFeeds({{2, 3}, {4}}));
+  auto key5 = MemoryPatternCache::MakeKey(CreateFeeds({{2}, {3, 4}}));
+  EXPECT_NE(key1, key2);
+  EXPECT_NE(key3, MemoryPatternCache::MakeKey(CreateFeeds({{3, 3}})));
+  EXPECT_NE(key4, key5);
+  EXPECT_EQ(key1, MemoryPatternCache::MakeKey(CreateFeeds({{1, 128}})));
+}
+
+TEST(MemPatternCacheTest, EvictsLeastRecentlyUsed) {
+  MemoryPatternCache cache(2);
+  auto key1 = MemoryPatternCache::MakeKey(CreateFeeds({{1, 16}}));
+  auto key2 = MemoryPatternCache::MakeKey(CreateFeeds({{1, 32}}));
+  auto key3 = MemoryPatternCache::MakeKey(CreateFeeds({{1, 64}}));
+
+  cache.Insert(key1, CreateEntry(0, 16));
+  cache.Insert(key2, CreateEntry(0, 32));
+  EXPECT_EQ(cache.Size(), 2u);
+
+  // Touch key1 so that key2 is the least recently used entry.
+  auto entry1 = cache.Find(key1);
+  ASSERT_NE(entry1, nullptr);
+  EXPECT_EQ(entry1->resolved_shapes.at(0), TensorShape({16}));
+
+  cache.Insert(key3, CreateEntry(0, 64));
+  EXPECT_EQ(cache.Size(), 2u);
+  EXPECT_NE(cache.Find(key1), nullptr);
+  EXPECT_EQ(cache.Find(key2), nullptr);
+  EXPECT_NE(cache.Find(key3), nullptr);
+}
+
+TEST(MemPatternCacheTest, InsertKeepsExistingEntry) {
+  MemoryPatternCache cache(0);
+  auto key = MemoryPatternCache::MakeKey(CreateFeeds({{4, 8}}));
+
+  auto first = cache.Insert(key, CreateEntry(0, 4));
+  auto second = cache.Insert(key, CreateEntry(0, 8));
+  EXPECT_EQ(first, second);
+  EXPECT_EQ(cache.Find(key)->resolved_shapes.at(0), TensorShape({4}));
+  EXPECT_EQ(cache.Size(), 1u);
+}
+
+TEST(MemPatternCacheTest, EvictedEntryStaysValidForHolder) {
+  MemoryPatternCache cache(1);
+  auto key1 = MemoryPatternCache::MakeKey(CreateFeeds({{1}}));
+  auto key2 = MemoryPatternCache::MakeKey(CreateFeeds({{2}}));
+
+  auto held = cache.Insert(key1, CreateEntry(3, 1));
+  cache.Insert(key2, CreateEntry(3, 2));
+  EXPECT_EQ(cache.Find(key1), nullptr);
+  EXPECT_EQ(held->resolved_shapes.at(3), TensorShape({1}));
+}
+
+}  // namespace test
+}  // namespace onnxruntime
@@ -0,0 +1,137 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "core/framework/session_metrics.h"
+
+#include <memory>
+#include <thread>
+
+#include "core/framework/tensor.h"
+#include "core/session/inference_session.h"
+#include "core/session/onnxruntime_session_options_config_keys.h"
+#include "test_utils.h"
+#include "test/test_environment.h"
+#include "test/util/include/asserts.h"
+#include "gtest/gtest.h"
+
+namespace onnxruntime {
+namespace test {
+
+namespace {
+
+// Abs(x[Dim1, Dim2]) -> y[Dim1, Dim2].
+constexpr const ORTCHAR_T* kAbsModel = ORT_TSTR("testdata/abs_free_dimensions.onnx");
+
+void RunAbs(InferenceSession& session) {
+  OrtValue input;
+  CreateMLValue<float>(TestCPUExecutionProvider()->CreatePreferredAllocators()[0], {2, 3},
+                       {-1.f, 2.f, -3.f, 4.f, -5.f, 6.f}, &input);
+  NameMLValMap feeds{{"x", input}};
+  const std::vector<std::string> output_names{"y"};
+  std::vector<OrtValue> fetches;
+  ASSERT_STATUS_OK(session.Run(feeds, output_names, &fetches));
+}
+
+}  // namespace
+
+TEST(SessionMetricsTest, RecordsRunsAndNodes) {
+  SessionOptions so;
+  ASSERT_STATUS_OK(so.config_options.AddConfigEntry(kOrtSessionOptionsEnableMetrics, "1"));
+  InferenceSession session{so, GetEnvironment()};
+  ASSERT_STATUS_OK(session.Load(kAbsModel));
+  ASSERT_STATUS_OK(session.Initialize());
+
+  // each thread records into its own buffer, and the snapshot merges them
+  std::vector<std::thread> threads;
+  for (int i = 0; i < 2; ++i) {
+    threads.emplace_back([&session]() {
+      for (int run = 0; run < 3; ++run) {
+        RunAbs(session);
+      }
+    });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+
+  SessionMetrics::Snapshot snapshot;
+  ASSERT_STATUS_OK(session.GetSessionMetrics(snapshot));
+  EXPECT_EQ(snapshot.runs.count, 6u);
+
+  ASSERT_EQ(snapshot.nodes.size(), 1u);
+  const auto& node = snapshot.nodes[0];
+  EXPECT_EQ(node.op_type, "Abs");
+  EXPECT_EQ(node.stats.latency.count, 6u);
+  EXPECT_EQ(node.stats.output_bytes, 6u * 6 * sizeof(float));
+  uint64_t bucket_total = 0;
+  for (auto count : node.stats.latency.bucket_counts) {
+    bucket_total += count;
+  }
+  EXPECT_EQ(bucket_total, 6u);
+
+  ASSERT_EQ(snapshot.op_types.size(), 1u);
+  EXPECT_EQ(snapshot.op_types[0].op_type, "Abs");
+  EXPECT_EQ(snapshot.op_types[0].stats.latency.count, 6u);
+  EXPECT_EQ(snapshot.op_types[0].stats.output_bytes, node.stats.output_bytes);
+
+  const auto json = SessionMetrics::ToJson(snapshot);
+  EXPECT_NE(json.find("\"op_type\":\"Abs\""), std::string::npos) << json;
+  EXPECT_NE(json.find("\"intra_op_thread_pool\""), std::string::npos) << json;
+}
+
+TEST(SessionMetricsTest, ThreadRecordsIntoSeveralSessions) {
+  SessionOptions so;
+  ASSERT_STATUS_OK(so.config_options.AddConfigEntry(kOrtSessionOptionsEnableMetrics, "1"));
+  auto make_session = [&so]() {
+    auto session = std::make_unique<InferenceSession>(so, GetEnvironment());
+    EXPECT_STATUS_OK(session->Load(kAbsModel));
+    EXPECT_STATUS_OK(session->Initialize());
+    return session;
+  };
+  auto first = make_session();
+  auto second = make_session();
+
+  // the thread keeps a buffer per session, and the counts of both survive its exit
+  std::thread thread([&first, &second]() {
+    for (int run = 0; run < 3; ++run) {
+      RunAbs(*first);
+      RunAbs(*second);
+    }
+  });
+  thread.join();
+
+  SessionMetrics::Snapshot snapshot;
+  ASSERT_STATUS_OK(first->GetSessionMetrics(snapshot));
+  EXPECT_EQ(snapshot.runs.count, 3u);
+  ASSERT_STATUS_OK(second->GetSessionMetrics(snapshot));
+  EXPECT_EQ(snapshot.runs.count, 3u);
+
+  // this thread outlives the first session, whose buffer it releases when it next records into a new session
+  RunAbs(*first);
+  RunAbs(*second);
+  first.reset();
+  auto third = make_session();
+  RunAbs(*third);
+  RunAbs(*second);
+
+  ASSERT_STATUS_OK(second->GetSessionMetrics(snapshot));
+  EXPECT_EQ(snapshot.runs.count, 5u);
+  ASSERT_STATUS_OK(third->GetSessionMetrics(snapshot));
+  EXPECT_EQ(snapshot.runs.count, 1u);
+  ASSERT_EQ(snapshot.nodes.size(), 1u);
+  EXPECT_EQ(snapshot.nodes[0].stats.latency.count, 1u);
+}
+
+TEST(SessionMetricsTest, DisabledByDefault) {
+  SessionOptions so;
+  InferenceSession session{so, GetEnvironment()};
+  ASSERT_STATUS_OK(session.Load(kAbsModel));
+  ASSERT_STATUS_OK(session.Initialize());
+  RunAbs(session);
+
+  SessionMetrics::Snapshot snapshot;
+  ASSERT_STATUS_NOT_OK_AND_HAS_SUBSTR(session.GetSessionMetrics(snapshot), kOrtSessionOptionsEnableMetrics);
+}
+
+}  // namespace test
+}  // namespace onnxruntime
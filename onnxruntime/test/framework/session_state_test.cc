@@ -1,7 +1,11 @@
 // Copyright (c) Microsoft Corporation. All rights reserved.
 // Licensed under the MIT License.
 
+#include <cstring>
+#include <filesystem>
+#include <fstream>
 #include <iostream>
+#include <thread>
 #include <absl/base/config.h>
 
 #include "asserts.h"
@@ -21,6 +25,7 @@
 #include "gtest/gtest.h"
 #include "test/test_environment.h"
 #include "test/util/include/default_providers.h"
+#include "test/util/include/temp_dir.h"
 #include "core/optimizer/layout_transformation/layout_transformation.h"
 
 using namespace ONNX_NAMESPACE;
@@ -344,6 +349,67 @@ TEST(SessionStateTest, TestInitializerMemoryAllocatedUsingNonArenaMemory) {
   }
 }
 
+// Initializers with external data used on CPU are used in place from the mapping of the data file, so the memory
+// pattern planner must not reserve a buffer for them.
+TEST(SessionStateTest, TestExternalInitializerNotPlannedOnCpu) {
+  AllocatorPtr cpu_allocator = std::make_shared<CPUAllocator>();
+  const std::basic_string<ORTCHAR_T> model_path = ORT_TSTR("testdata/model_with_external_initializers.onnx");
+  std::shared_ptr<Model> model;
+  ASSERT_STATUS_OK(Model::Load(model_path, model, nullptr, DefaultLoggingManager().DefaultLogger()));
+  Graph& graph = model->MainGraph();
+
+  ExecutionProviders execution_providers;
+  CPUExecutionProviderInfo epi{true};  // use an arena-based allocator for this EP
+  ASSERT_STATUS_OK(execution_providers.Add(onnxruntime::kCpuExecutionProvider,
+                                           std::make_unique<CPUExecutionProvider>(epi)));
+
+  KernelRegistryManager krm;
+  ASSERT_STATUS_OK(krm.RegisterKernels(execution_providers));
+
+  DataTransferManager dtm;
+  profiling::Profiler profiler;
+
+  SessionOptions sess_options;
+  sess_options.enable_mem_pattern = true;
+  sess_options.execution_mode = ExecutionMode::ORT_SEQUENTIAL;
+  sess_options.use_deterministic_compute = false;
+  sess_options.enable_mem_reuse = true;
+
+  SessionState session_state(graph, execution_providers, nullptr, nullptr, dtm,
+                             DefaultLoggingManager().DefaultLogger(), profiler, sess_options);
+
+  GraphPartitioner partitioner(krm, execution_providers);
+  ASSERT_STATUS_OK(partitioner.Partition(
+      graph, session_state.GetMutableFuncMgr(),
+      [&cpu_allocator](Graph& graph, bool& modified, const IExecutionProvider& execution_provider,
+                       const layout_transformation::DebugGraphFn& debug_graph_fn) -> Status {
+        return layout_transformation::TransformLayoutForEP(graph, modified, execution_provider,
+                                                           cpu_allocator, debug_graph_fn);
+      },
+      sess_options.config_options,
+      DefaultLoggingManager().DefaultLogger()));
+
+  ASSERT_STATUS_OK(session_state.FinalizeSessionState(model_path, krm));
+
+  // The initializer holds the external data
+  int ort_value_index;
+  ASSERT_STATUS_OK(session_state.GetOrtValueNameIdxMap().GetIdx("Pads", ort_value_index));
+  const auto& initializers = session_state.GetInitializedTensors();
+  auto it = initializers.find(ort_value_index);
+  ASSERT_NE(it, initializers.end());
+  const auto pads = it->second.Get<Tensor>().DataAsSpan<int64_t>();
+  ASSERT_EQ(std::vector<int64_t>(pads.begin(), pads.end()), (std::vector<int64_t>{0, 0, 1, 1}));
+
+  // but the arena neither reserved a planned buffer nor allocated memory for it
+  OrtMemoryInfo mem_info(CPU, OrtArenaAllocator);
+  AllocatorPtr alloc = session_state.GetAllocator(mem_info);
+  ASSERT_TRUE(alloc != nullptr);
+  AllocatorStats alloc_stats;
+  static_cast<BFCArena*>(alloc.get())->GetStats(&alloc_stats);
+  ASSERT_EQ(alloc_stats.num_reserves, 0);
+  ASSERT_EQ(alloc_stats.num_allocs, 0);
+}
+
 #endif
 
 INSTANTIATE_TEST_SUITE_P(SessionStateTests, SessionStateTestP, testing::ValuesIn(param_list));
@@ -368,6 +434,17 @@ class PrePackingTestOpKernel : public OpKernel {
     return Status::OK();
   }
 
+  Status UseCachedPrePackedBuffers(const Tensor& tensor, std::vector<BufferUniquePtr>& prepacked_buffers,
+                                   int input_idx, /*out*/ bool& used_cached_buffers) override {
+    ORT_UNUSED_PARAMETER(tensor);
+    ORT_UNUSED_PARAMETER(input_idx);
+
+    weight_packed_ = std::move(prepacked_buffers[0]);
+    used_cached_buffers = true;
+    ++use_cached_pre_packed_weight_calls_count;
+    return Status::OK();
+  }
+
   Status PrePack(const Tensor& tensor, int input_idx, AllocatorPtr alloc,
                  /*out*/ bool& is_packed, /*out*/ PrePackedWeights* prepacked_weights) override {
     ORT_UNUSED_PARAMETER(tensor);
@@ -391,6 +468,7 @@ class PrePackingTestOpKernel : public OpKernel {
 
   int prepack_calls_count = 0;
   int store_pre_packed_weight_calls_count = 0;
+  int use_cached_pre_packed_weight_calls_count = 0;
   IAllocatorUniquePtr<void> weight_packed_;
 };
 
@@ -983,6 +1061,155 @@ TEST_F(SessionStateTestSharedInitalizersWithPrePacking, test4) {
   ASSERT_EQ(if_node_branches_shared_prepack_counter_2, static_cast<size_t>(2));
 }
 
+// Pre-packing enabled + pre-packed weights file cache = pre-packed weights persisted across sessions
+TEST_F(SessionStateTestSharedInitalizersWithPrePacking, test5) {
+  SessionOptions sess_options;
+  sess_options.enable_mem_pattern = true;
+  sess_options.execution_mode = ExecutionMode::ORT_SEQUENTIAL;
+  sess_options.use_deterministic_compute = false;
+  sess_options.enable_mem_reuse = true;
+  // Enable pre-packing
+  sess_options.config_options.configurations[kOrtSessionOptionsConfigDisablePrepacking] = "0";
+
+  TemporaryDirectory tmp_dir(ORT_TSTR("prepacked_weights_file_cache_test"));
+  const PathString cache_file = tmp_dir.Path() + ORT_TSTR("/prepacked_weights.bin");
+
+  // First session/model
+  {
+    PrepackedWeightsFileCache file_cache(Env::Default(), cache_file, "", DefaultLoggingManager().DefaultLogger());
+    ASSERT_EQ(file_cache.GetNumberOfLoadedElements(), static_cast<size_t>(0));
+
+    Model model_1("graph_main", false, ModelMetaData(), PathString(), IOnnxRuntimeOpSchemaRegistryList(),
+                  domain_to_version, std::vector<ONNX_NAMESPACE::FunctionProto>(),
+                  DefaultLoggingManager().DefaultLogger());
+
+    CreateSimpleGraph(model_1.MainGraph());
+    PlaceAllNodesToCPUEP(model_1.MainGraph());
+    SessionState session_state_1(model_1.MainGraph(),
+                                 execution_providers,
+                                 tp.get(),
+                                 nullptr, /*inter_op_thread_pool*/
+                                 dtm,
+                                 DefaultLoggingManager().DefaultLogger(),
+                                 profiler,
+                                 sess_options);
+    session_state_1.SetPrepackedWeightsFileCache(&file_cache);
+
+    ASSERT_STATUS_OK(session_state_1.FinalizeSessionState(std::basic_string<PATH_CHAR_TYPE>(),
+                                                          kernel_registry_manager));
+
+    const auto* kernel = reinterpret_cast<const PrePackingTestOpKernel*>(session_state_1.GetKernel(0));
+    // Assert that a pre-pack call was made and the pre-packed weight was handed back to the kernel from the cache
+    ASSERT_EQ(session_state_1.GetNumberOfPrepacksCounter(), static_cast<size_t>(1));
+    ASSERT_EQ(kernel->prepack_calls_count, 1);
+    ASSERT_EQ(kernel->use_cached_pre_packed_weight_calls_count, 1);
+    ASSERT_EQ(session_state_1.GetUsedCachedPrePackedWeightCounter(), static_cast<size_t>(0));
+
+    ASSERT_STATUS_OK(file_cache.Save());
+  }
+
+  // Second session/model
+  PrepackedWeightsFileCache file_cache(Env::Default(), cache_file, "", DefaultLoggingManager().DefaultLogger());
+  ASSERT_EQ(file_cache.GetNumberOfLoadedElements(), static_cast<size_t>(1));
+
+  Model model_2("graph_main", false, ModelMetaData(), PathString(), IOnnxRuntimeOpSchemaRegistryList(),
+                domain_to_version, std::vector<ONNX_NAMESPACE::FunctionProto>(),
+                DefaultLoggingManager().DefaultLogger());
+
+  CreateSimpleGraph(model_2.MainGraph());
+  PlaceAllNodesToCPUEP(model_2.MainGraph());
+  SessionState session_state_2(model_2.MainGraph(),
+                               execution_providers,
+                               tp.get(),
+                               nullptr, /*inter_op_thread_pool*/
+                               dtm,
+                               DefaultLoggingManager().DefaultLogger(),
+                               profiler,
+                               sess_options);
+  session_state_2.SetPrepackedWeightsFileCache(&file_cache);
+
+  ASSERT_STATUS_OK(session_state_2.FinalizeSessionState(std::basic_string<PATH_CHAR_TYPE>(),
+                                                        kernel_registry_manager));
+
+  const auto* kernel = reinterpret_cast<const PrePackingTestOpKernel*>(session_state_2.GetKernel(0));
+  // Assert that no pre-pack call was made and the pre-packed weight read from the file was used instead
+  ASSERT_EQ(session_state_2.GetNumberOfPrepacksCounter(), static_cast<size_t>(1));
+  ASSERT_EQ(kernel->prepack_calls_count, 0);
+  ASSERT_EQ(kernel->use_cached_pre_packed_weight_calls_count, 1);
+  ASSERT_EQ(session_state_2.GetUsedCachedPrePackedWeightCounter(), static_cast<size_t>(1));
+  ASSERT_EQ(reinterpret_cast<const float*>(kernel->weight_packed_.get())[0], 1.2345f);
+
+  // A cache written with a different configuration is ignored
+  PrepackedWeightsFileCache other_file_cache(Env::Default(), cache_file, "other",
+                                             DefaultLoggingManager().DefaultLogger());
+  ASSERT_EQ(other_file_cache.GetNumberOfLoadedElements(), static_cast<size_t>(0));
+}
+
+// Caches saving to the same file at the same time each write their own temporary file
+TEST(PrepackedWeightsFileCacheTest, ConcurrentSaves) {
+  TemporaryDirectory tmp_dir(ORT_TSTR("prepacked_weights_file_cache_concurrent_test"));
+  const PathString cache_file = tmp_dir.Path() + ORT_TSTR("/prepacked_weights.bin");
+  AllocatorPtr alloc = std::make_shared<CPUAllocator>();
+
+  constexpr int kNumCaches = 4;
+  std::vector<std::unique_ptr<PrepackedWeightsFileCache>> file_caches;
+  for (int i = 0; i < kNumCaches; ++i) {
+    file_caches.push_back(std::make_unique<PrepackedWeightsFileCache>(Env::Default(), cache_file, "",
+                                                                      DefaultLoggingManager().DefaultLogger()));
+    PrePackedWeights weights;
+    weights.buffers_.push_back(IAllocator::MakeUniquePtr<void>(alloc, 1024, true));
+    std::memset(weights.buffers_[0].get(), i, 1024);
+    weights.buffer_sizes_.push_back(1024);
+    ASSERT_TRUE(file_caches[i]->WriteWeight("weight_" + std::to_string(i), std::move(weights), true));
+  }
+
+  std::vector<Status> statuses(kNumCaches);
+  std::vector<std::thread> threads;
+  for (int i = 0; i < kNumCaches; ++i) {
+    threads.emplace_back([&file_caches, &statuses, i]() { statuses[i] = file_caches[i]->Save(); });
+  }
+  for (auto& thread : threads) {
+    thread.join();
+  }
+  for (const auto& status : statuses) {
+    ASSERT_STATUS_OK(status);
+  }
+
+  // The last save wins, and its file is complete
+  PrepackedWeightsFileCache file_cache(Env::Default(), cache_file, "", DefaultLoggingManager().DefaultLogger());
+  ASSERT_EQ(file_cache.GetNumberOfLoadedElements(), static_cast<size_t>(1));
+  for (int i = 0; i < kNumCaches; ++i) {
+    if (const auto* weights = file_cache.GetWeight("weight_" + std::to_string(i))) {
+      const auto* data = static_cast<const uint8_t*>(weights->buffers_[0].get());
+      ASSERT_EQ(data[0], static_cast<uint8_t>(i));
+      ASSERT_EQ(data[1023], static_cast<uint8_t>(i));
+    }
+  }
+}
+
+// A failed save leaves neither the cache file nor its temporary file behind
+TEST(PrepackedWeightsFileCacheTest, FailedSaveRemovesTemporaryFile) {
+  TemporaryDirectory tmp_dir(ORT_TSTR("prepacked_weights_file_cache_failed_save_test"));
+  // The temporary file can be written next to the cache file, but not renamed over it, as it is a non-empty
+  // directory.
+  const std::filesystem::path cache_file = std::filesystem::path{tmp_dir.Path()} / ORT_TSTR("prepacked_weights.bin");
+  std::filesystem::create_directory(cache_file);
+  std::ofstream{cache_file / ORT_TSTR("file")} << "x";
+
+  AllocatorPtr alloc = std::make_shared<CPUAllocator>();
+  PrepackedWeightsFileCache file_cache(Env::Default(), cache_file.native(), "",
+                                       DefaultLoggingManager().DefaultLogger());
+  PrePackedWeights weights;
+  weights.buffers_.push_back(IAllocator::MakeUniquePtr<void>(alloc, 1024, true));
+  weights.buffer_sizes_.push_back(1024);
+  ASSERT_TRUE(file_cache.WriteWeight("weight", std::move(weights), true));
+  ASSERT_FALSE(file_cache.Save().IsOK());
+
+  for (const auto& entry : std::filesystem::directory_iterator(tmp_dir.Path())) {
+    ASSERT_EQ(entry.path(), cache_file);
+  }
+}
+
 INSTANTIATE_TEST_SUITE_P(SessionStateTests,
                          SessionStatePrepackingTest,
                          testing::Values(PrepackingTestParam{false, false},
@@ -0,0 +1,155 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include "test_util.h"
+
+template <bool Threaded>
+class MlasFlashAttentionTest : public MlasTestBase {
+ private:
+  MatrixGuardBuffer<float> BufferQuery;
+  MatrixGuardBuffer<float> BufferKey;
+  MatrixGuardBuffer<float> BufferValue;
+  MatrixGuardBuffer<float> BufferOutput;
+  MatrixGuardBuffer<float> BufferOutputReference;
+  MLAS_THREADPOOL* threadpool_;
+
+  //
+  // query is (B, N, S, H), key and value are (B, N_kv, T, H) of which the first KvLengths[b] tokens are valid, and
+  // output is (B, S, N, H).
+  //
+  void ReferenceAttention(const float* Query, const float* Key, const float* Value, float* Output,
+                          size_t B, size_t N, size_t NKv, size_t S, size_t T, size_t H,
+                          const std::vector<int32_t>& KvLengths, bool IsCausal, float Scale) {
+    for (size_t b = 0; b < B; b++) {
+      const size_t L = static_cast<size_t>(KvLengths[b]);
+      const size_t CausalOffset = L > S ? L - S : 0;
+      for (size_t n = 0; n < N; n++) {
+        const size_t n_kv = n / (N / NKv);
+        const float* K = Key + (b * NKv + n_kv) * T * H;
+        const float* V = Value + (b * NKv + n_kv) * T * H;
+        for (size_t s = 0; s < S; s++) {
+          const float* q = Query + ((b * N + n) * S + s) * H;
+          float* o = Output + ((b * S + s) * N + n) * H;
+          const size_t Visible = IsCausal ? std::min(L, CausalOffset + s + 1) : L;
+
+          std::vector<double> Scores(Visible);
+          double MaximumScore = -std::numeric_limits<double>::infinity();
+          for (size_t t = 0; t < Visible; t++) {
+            double Dot = 0.0;
+            for (size_t h = 0; h < H; h++) {
+              Dot += double(q[h]) * double(K[t * H + h]);
+            }
+            Scores[t] = Dot * Scale;
+            MaximumScore = std::max(MaximumScore, Scores[t]);
+          }
+          double Sum = 0.0;
+          for (auto& Score : Scores) {
+            Score = std::exp(Score - MaximumScore);
+            Sum += Score;
+          }
+          for (size_t h = 0; h < H; h++) {
+            double Weighted = 0.0;
+            for (size_t t = 0; t < Visible; t++) {
+              Weighted += Scores[t] / Sum * double(V[t * H + h]);
+            }
+            o[h] = float(Weighted);
+          }
+        }
+      }
+    }
+  }
+
+  void Test(size_t B, size_t N, size_t NKv, size_t S, size_t T, size_t H,
+            const std::vector<int32_t>& KvLengths, bool IsCausal, int QBlockSize, int KvBlockSize, int KvSplitCount) {
+    const size_t ThreadCount = 4;
+    const float Scale = 1.0f / std::sqrt(float(H));
+
+    float* Query = BufferQuery.GetBuffer(B * N * S * H);
+    float* Key = BufferKey.GetBuffer(B * NKv * T * H);
+    float* Value = BufferValue.GetBuffer(B * NKv * T * H);
+    float* Output = BufferOutput.GetBuffer(B * S * N * H);
+    float* OutputReference = BufferOutputReference.GetBuffer(B * S * N * H);
+
+    std::default_random_engine generator(static_cast<unsigned>(B * N * S * T * H));
+    std::uniform_real_distribution<float> distribution(-2.0f, 2.0f);
+    for (size_t i = 0; i < B * N * S * H; i++) {
+      Query[i] = distribution(generator);
+    }
+    for (size_t i = 0; i < B * NKv * T * H; i++) {
+      Key[i] = distribution(generator);
+      Value[i] = distribution(generator);
+    }
+
+    const size_t BufferSizePerThread = (size_t(QBlockSize) * 2 + size_t(QBlockSize) * size_t(KvBlockSize) +
+                                        size_t(QBlockSize) * H) *
+                                       sizeof(float);
+    std::vector<float> Buffer(BufferSizePerThread * ThreadCount / sizeof(float));
+    std::vector<float> SplitBuffer(B * N * S * size_t(KvSplitCount) * (H + 2));
+
+    MlasFlashAttentionThreadedArgs args;
+    args.batch_size = int(B);
+    args.num_heads = int(N);
+    args.q_sequence_length = int(S);
+    args.kv_sequence_length = int(T);
+    args.qk_head_size = int(H);
+    args.v_head_size = int(H);
+    args.q_block_size = QBlockSize;
+    args.kv_block_size = KvBlockSize;
+    args.scale = Scale;
+    args.thread_count = int(ThreadCount);
+    args.buffer = Buffer.data();
+    args.buffer_size_per_thread = BufferSizePerThread;
+    args.query = Query;
+    args.key = Key;
+    args.value = Value;
+    args.output = Output;
+    args.kv_num_heads = int(NKv);
+    args.kv_sequence_lengths = KvLengths.data();
+    args.is_causal = IsCausal;
+    args.kv_split_count = KvSplitCount;
+    args.split_buffer = KvSplitCount > 1 ? SplitBuffer.data() : nullptr;
+    MlasFlashAttention(&args, threadpool_);
+
+    ReferenceAttention(Query, Key, Value, OutputReference, B, N, NKv, S, T, H, KvLengths, IsCausal, Scale);
+
+    constexpr float AbsoluteTolerance = 1e-5f;
+    constexpr float RelativeTolerance = 1e-5f;
+    for (size_t i = 0; i < B * S * N * H; i++) {
+      float diff = std::fabs(Output[i] - OutputReference[i]);
+      ASSERT_TRUE(diff <= AbsoluteTolerance || diff <= std::fabs(OutputReference[i]) * RelativeTolerance)
+          << "B/N/N_kv/S/T/H " << B << "/" << N << "/" << NKv << "/" << S << "/" << T << "/" << H
+          << " causal " << IsCausal << " splits " << KvSplitCount << " @" << i
+          << ", got: " << Output[i] << ", expecting: " << OutputReference[i];
+    }
+  }
+
+ public:
+  static const char* GetTestSuiteName() {
+    static const std::string suite_name(Threaded ? "FlashAttention_Threaded" : "FlashAttention_SingleThread");
+    return suite_name.c_str();
+  }
+
+  MlasFlashAttentionTest() : threadpool_(Threaded ? GetMlasThreadPool() : nullptr) {}
+
+  void ExecuteShort(void) override {
+    for (int KvSplitCount = 1; KvSplitCount <= 5; KvSplitCount++) {
+      // decoding a token with a kv cache
+      Test(1, 4, 2, 1, 100, 16, {100}, true, 1, 16, KvSplitCount);
+      Test(2, 4, 1, 1, 64, 8, {37, 3}, true, 1, 8, KvSplitCount);
+      // a prompt, where the chunks of the last splits are masked for the first tokens
+      Test(2, 2, 2, 7, 7, 8, {7, 5}, true, 4, 3, KvSplitCount);
+      Test(1, 3, 3, 5, 40, 12, {40}, false, 2, 8, KvSplitCount);
+    }
+  }
+};
+
+static UNUSED_VARIABLE bool added_to_main = AddTestRegister([](bool is_short_execute) {
+  size_t count = 0;
+  if (is_short_execute) {
+    count += MlasDirectShortExecuteTests<MlasFlashAttentionTest<false>>::RegisterShortExecute();
+    if (GetMlasThreadPool() != nullptr) {
+      count += MlasDirectShortExecuteTests<MlasFlashAttentionTest<true>>::RegisterShortExecute();
+    }
+  }
+  return count;
+});
@@ -0,0 +1,117 @@
+// Copyright (c) Microsoft Corporation. All rights reserved.
+// Licensed under the MIT License.
+
+#include <functional>
+#include <map>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+#include "graph_transform_test_builder.h"
+
+#include "core/graph/graph.h"
+#include "core/session/onnxruntime_session_options_config_keys.h"
+#include "test/util/include/asserts.h"
+
+namespace onnxruntime {
+namespace test {
+
+#ifndef DISABLE_CONTRIB_OPS
+
+static void TestElementwiseChainFusion(const std::function<void(ModelTestBuilder& builder)>& build_test_case,
+                                       const std::map<std::string, int>& expected_op_counts) {
+  auto check_graph = [&](InferenceSessionWrapper& session) {
+    auto op_to_count = CountOpsInGraph(session.GetGraph());
+    for (const auto& [op_type, count] : expected_op_counts) {
+      EXPECT_EQ(op_to_count[op_type], count) << op_type;
+    }
+  };
+
+  TransformerTester(build_test_case,
+                    check_graph,
+                    TransformerLevel::Level2,
+                    TransformerLevel::Level3, 13, 1e-5, 1e-5, nullptr,
+                    [](SessionOptions& session_options) {
+                      ASSERT_STATUS_OK(session_options.config_options.AddConfigEntry(
+                          kOrtSessionOptionsEnableElementwiseChainFusion, "1"));
+                    });
+}
+
+TEST(ElementwiseChainFusionTests, Chain) {
+  // ((x + bias) * y) -> Sigmoid -> * 0.5
+  auto build_test_case = [](ModelTestBuilder& builder) {
+    auto* x_arg = builder.MakeInput<float>({2, 3, 64}, -2.f, 2.f);
+    auto* y_arg = builder.MakeInput<float>({2, 3, 64}, -2.f, 2.f);
+    auto* bias_arg = builder.MakeInitializer<float>({64}, -1.f, 1.f);
+    auto* scale_arg = builder.MakeScalarInitializer<float>(0.5f);
+    auto* add_out = builder.MakeIntermediate();
+    auto* mul_out = builder.MakeIntermediate();
+    auto* sigmoid_out = builder.MakeIntermediate();
+    auto* output_arg = builder.MakeOutput();
+
+    builder.AddNode("Add", {x_arg, bias_arg}, {add_out});
+    builder.AddNode("Mul", {add_out, y_arg}, {mul_out});
+    builder.AddNode("Sigmoid", {mul_out}, {sigmoid_out});
+    builder.AddNode("Mul", {sigmoid_out, scale_arg}, {output_arg});
+  };
+
+  TestElementwiseChainFusion(build_test_case,
+                             {{"com.microsoft.FusedElementwise", 1}, {"Add", 0}, {"Mul", 0}, {"Sigmoid", 0}});
+}
+
+TEST(ElementwiseChainFusionTests, Diamond) {
+  // a = x + bias; a * tanh(a)
+  auto build_test_case = [](ModelTestBuilder& builder) {
+    auto* x_arg = builder.MakeInput<float>({4, 32}, -2.f, 2.f);
+    auto* bias_arg = builder.MakeInitializer<float>({1, 32}, -1.f, 1.f);
+    auto* add_out = builder.MakeIntermediate();
+    auto* tanh_out = builder.MakeIntermediate();
+    auto* output_arg = builder.MakeOutput();
+
+    builder.AddNode("Add", {x_arg, bias_arg}, {add_out});
+    builder.AddNode("Tanh", {add_out}, {tanh_out});
+    builder.AddNode("Mul", {add_out, tanh_out}, {output_arg});
+  };
+
+  TestElementwiseChainFusion(build_test_case,
+                             {{"com.microsoft.FusedElementwise", 1}, {"Add", 0}, {"Tanh", 0}, {"Mul", 0}});
+}
+
+TEST(ElementwiseChainFusionTests, IntermediateGraphOutput) {
+  // the output of Add is also a graph output, so only Relu -> Mul is fused
+  auto build_test_case = [](ModelTestBuilder& builder) {
+    auto* x_arg = builder.MakeInput<float>({8, 16}, -2.f, 2.f);
+    auto* y_arg = builder.MakeInput<float>({8, 16}, -2.f, 2.f);
+    auto* add_out = builder.MakeOutput();
+    auto* relu_out = builder.MakeIntermediate();
+    auto* output_arg = builder.MakeOutput();
+
+    builder.AddNode("Add", {x_arg, y_arg}, {add_out});
+    builder.AddNode("Relu", {add_out}, {relu_out});
+    builder.AddNode("Mul", {relu_out, y_arg}, {output_arg});
+  };
+
+  TestElementwiseChainFusion(build_test_case,
+                             {{"com.microsoft.FusedElementwise", 1}, {"Add", 1}, {"Relu", 0}, {"Mul", 0}});
+}
+
+TEST(ElementwiseChainFusionTests, UnsupportedBroadcast) {
+  // x is broadcast along its last dimension, which FusedElementwise does not support
+  auto build_test_case = [](ModelTestBuilder& builder) {
+    auto* x_arg = builder.MakeInput<float>({4, 1}, -2.f, 2.f);
+    auto* y_arg = builder.MakeInput<float>({4, 8}, -2.f, 2.f);
+    auto* add_out = builder.MakeIntermediate();
+    auto* output_arg = builder.MakeOutput();
+
+    builder.AddNode("Add", {x_arg, y_arg}, {add_out});
+    builder.AddNode("Relu", {add_out}, {output_arg});
+  };
+
+  TestElementwiseChainFusion(build_test_case,
+                             {{"com.microsoft.FusedElementwise", 0}, {"Add", 1}, {"Relu", 1}});
+}
+
+#endif  // DISABLE_CONTRIB_OPS
+
+}  // namespace test
+}  // namespace onnxruntime
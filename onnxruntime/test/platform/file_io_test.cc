@@ -3,6 +3,7 @@
 
 #include "core/platform/env.h"
 
+#include <algorithm>
 #include <fstream>
 #include <random>
 #include <utility>
@@ -152,6 +153,28 @@ TEST(FileIoTest, MapFileIntoMemory) {
     ASSERT_FALSE(Env::Default().MapFileIntoMemory(tmp.path.c_str(), -1, 0, mapped_memory).IsOK());
   }
 }
+
+// Initializers with external data point into the mapping, so writes to it must go to a private copy of the page
+// rather than fault or change the file.
+TEST(FileIoTest, MapFileIntoMemoryIsCopyOnWrite) {
+  static const auto page_size = sysconf(_SC_PAGESIZE);
+  ASSERT_GT(page_size, 0);
+
+  TempFilePath tmp(ORT_TSTR("map_file_copy_on_write_test_"));
+  const auto expected_data = GenerateData(page_size * 2);
+  WriteDataToFile(gsl::make_span(expected_data), tmp.path);
+
+  const auto length = static_cast<size_t>(page_size);
+  Env::MappedMemoryPtr mapped_memory{};
+  ASSERT_TRUE(Env::Default().MapFileIntoMemory(tmp.path.c_str(), 0, length, mapped_memory).IsOK());
+  std::fill_n(mapped_memory.get(), length, '\0');
+
+  std::vector<char> file_data(expected_data.size());
+  std::ifstream in{tmp.path, std::ios_base::in | std::ios_base::binary};
+  in.read(file_data.data(), file_data.size());
+  ASSERT_TRUE(in);
+  ASSERT_TRUE(SpanEq(gsl::make_span(file_data), gsl::make_span(expected_data)));
+}
 #else
 TEST(FileIoTest, MapFileIntoMemory) {
   SYSTEM_INFO sysinfo;
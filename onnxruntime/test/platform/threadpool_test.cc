@@ -12,8 +12,10 @@
 
 #include "gtest/gtest.h"
 #include <algorithm>
+#include <chrono>
 #include <memory>
 #include <functional>
+#include <thread>
 
 #ifdef _WIN32
 #include <Windows.h>
@@ -510,6 +512,73 @@ TEST(ThreadPoolTest, TestStagedMultiLoopSections_4Thread_100Loop) {
   TestStagedMultiLoopSections("TestStagedMultiLoopSections_4Thread_100Loop", 4, 100);
 }
 
+// Pool with 4 worker threads split over two NUMA nodes.  The first
+// node id belongs to the main thread and is dropped by the pool.
+TEST(ThreadPoolTest, TestNumaNodeSections) {
+  ThreadOptions to;
+  to.numa_node_ids = {0, 0, 0, 1, 1};
+  auto tp = std::make_unique<ThreadPool>(&onnxruntime::Env::Default(), to, nullptr, 5, true);
+  ASSERT_EQ(ThreadPool::NumNumaNodes(tp.get()), 2);
+  const int dop_per_thread = ThreadPool::DegreeOfParallelism(tp.get()) / 5;
+
+  for (int numa_node = 0; numa_node < 2; numa_node++) {
+    constexpr int num_tasks = 1024;
+    constexpr int num_loops = 10;
+    auto test_data = CreateTestData(num_tasks);
+    {
+      ThreadPool::ParallelSection ps(tp.get(), numa_node);
+      // Two workers on each node, plus the main thread
+      ASSERT_EQ(ThreadPool::DegreeOfParallelism(tp.get()), 3 * dop_per_thread);
+      for (int l = 0; l < num_loops; l++) {
+        ThreadPool::TrySimpleParallelFor(tp.get(), num_tasks,
+                                         [&](std::ptrdiff_t i) { IncrementElement(*test_data, i); });
+      }
+    }
+    ValidateTestData(*test_data, num_loops);
+  }
+
+  // Sections for an unknown node use the whole pool
+  {
+    ThreadPool::ParallelSection ps(tp.get(), 2);
+    ASSERT_EQ(ThreadPool::DegreeOfParallelism(tp.get()), 5 * dop_per_thread);
+  }
+  ASSERT_EQ(ThreadPool::DegreeOfParallelism(tp.get()), 5 * dop_per_thread);
+
+  // Pools without NUMA information report a single node
+  auto tp_single = std::make_unique<ThreadPool>(&onnxruntime::Env::Default(), ThreadOptions{}, nullptr, 3, true);
+  ASSERT_EQ(ThreadPool::NumNumaNodes(tp_single.get()), 1);
+  ASSERT_EQ(ThreadPool::NumNumaNodes(nullptr), 1);
+}
+
+TEST(ThreadPoolTest, TestWaitTimes) {
+  auto empty = ThreadPool::GetWaitTimes(nullptr);
+  ASSERT_EQ(empty.caller_wait_ns + empty.worker_spin_ns + empty.worker_blocked_ns, 0u);
+
+  auto tp = std::make_unique<ThreadPool>(&onnxruntime::Env::Default(), ThreadOptions{}, nullptr, 4, true);
+  ThreadPool::TrySimpleParallelFor(tp.get(), 8, [](std::ptrdiff_t) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  });
+  // Nothing is counted until the wait times are enabled
+  auto disabled = ThreadPool::GetWaitTimes(tp.get());
+  ASSERT_EQ(disabled.caller_wait_ns + disabled.worker_spin_ns + disabled.worker_blocked_ns, 0u);
+
+  ThreadPool::EnableWaitTimes(tp.get());
+  ThreadPool::TrySimpleParallelFor(tp.get(), 8, [](std::ptrdiff_t) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  });
+  auto first = ThreadPool::GetWaitTimes(tp.get());
+  ASSERT_GT(first.caller_wait_ns + first.worker_spin_ns + first.worker_blocked_ns, 0u);
+
+  // The times are cumulative
+  ThreadPool::TrySimpleParallelFor(tp.get(), 8, [](std::ptrdiff_t) {
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  });
+  auto second = ThreadPool::GetWaitTimes(tp.get());
+  ASSERT_GE(second.caller_wait_ns, first.caller_wait_ns);
+  ASSERT_GE(second.worker_spin_ns, first.worker_spin_ns);
+  ASSERT_GE(second.worker_blocked_ns, first.worker_blocked_ns);
+}
+
 #ifdef _WIN32
 #if WINAPI_FAMILY_PARTITION(WINAPI_PARTITION_DESKTOP)
 #pragma warning(push)
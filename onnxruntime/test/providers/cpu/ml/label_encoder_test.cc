@@ -64,6 +64,42 @@ TEST(LabelEncoder, StringToIntOpset2) {
   test.Run();
 }
 
+TEST(LabelEncoder, StringToIntManyKeysOpset2) {
+  // Enough keys for the lookup table to grow several times, an empty key and a repeated key, of which the first
+  // value is used.
+  std::vector<std::string> keys{"", "AA"};
+  std::vector<std::int64_t> values{-1, -2};
+  for (int64_t i = 0; i < 1000; ++i) {
+    keys.push_back("key_" + std::to_string(i));
+    values.push_back(i);
+  }
+  keys.push_back("AA");
+  values.push_back(-3);
+
+  std::vector<std::string> input;
+  std::vector<std::int64_t> output;
+  for (int64_t i = 0; i < 1000; i += 7) {
+    input.push_back("key_" + std::to_string(i));
+    output.push_back(i);
+    input.push_back("key_" + std::to_string(i) + "_missing");
+    output.push_back(5566);
+  }
+  input.insert(input.end(), {"", "AA", "key_", "key_1000"});
+  output.insert(output.end(), {-1, -2, 5566, 5566});
+
+  OpTester test("LabelEncoder", 2, onnxruntime::kMLDomain);
+
+  test.AddAttribute("keys_strings", keys);
+  test.AddAttribute("values_int64s", values);
+  test.AddAttribute("default_int64", (std::int64_t)5566);
+
+  const std::vector<std::int64_t> dims{static_cast<std::int64_t>(input.size())};
+  test.AddInput<std::string>("X", dims, input);
+  test.AddOutput<std::int64_t>("Y", dims, output);
+
+  test.Run();
+}
+
 TEST(LabelEncoder, IntToStringOpset2) {
   std::vector<std::int64_t> dims{1, 5};
 
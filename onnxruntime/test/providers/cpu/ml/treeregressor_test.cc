@@ -1,8 +1,13 @@
 // Copyright (c) Microsoft Corporation. All rights reserved.
 // Licensed under the MIT License.
 
+#include <cmath>
+#include <limits>
+
 #include "gtest/gtest.h"
+#include "core/session/onnxruntime_session_options_config_keys.h"
 #include "test/providers/provider_test_utils.h"
+#include "test/util/include/asserts.h"
 
 namespace onnxruntime {
 namespace test {
@@ -760,5 +765,118 @@ TEST(MLOpTest, TreeRegressorTrueNodeBeforeNode) {
   test.Run();
 }
 
+TEST(MLOpTest, TreeRegressorMissingValueTracksTrue) {
+  OpTester test("TreeEnsembleRegressor", 3, onnxruntime::kMLDomain);
+
+  // Two trees of depth 1. A missing value of feature 0 goes to the true branch, a missing value of feature 1 does not.
+  std::vector<int64_t> nodes_treeids = {0, 0, 0, 1, 1, 1};
+  std::vector<int64_t> nodes_nodeids = {0, 1, 2, 0, 1, 2};
+  std::vector<int64_t> nodes_featureids = {0, 0, 0, 1, 0, 0};
+  std::vector<std::string> nodes_modes = {"BRANCH_LEQ", "LEAF", "LEAF", "BRANCH_LEQ", "LEAF", "LEAF"};
+  std::vector<float> nodes_values = {0.5f, 0.f, 0.f, 0.5f, 0.f, 0.f};
+  std::vector<int64_t> nodes_truenodeids = {1, 0, 0, 1, 0, 0};
+  std::vector<int64_t> nodes_falsenodeids = {2, 0, 0, 2, 0, 0};
+  std::vector<int64_t> nodes_missing_value_tracks_true = {1, 0, 0, 0, 0, 0};
+  std::vector<int64_t> target_treeids = {0, 0, 1, 1};
+  std::vector<int64_t> target_nodeids = {1, 2, 1, 2};
+  std::vector<int64_t> target_ids = {0, 0, 0, 0};
+  std::vector<float> target_weights = {1.f, 2.f, 10.f, 20.f};
+
+  test.AddAttribute("nodes_treeids", nodes_treeids);
+  test.AddAttribute("nodes_nodeids", nodes_nodeids);
+  test.AddAttribute("nodes_featureids", nodes_featureids);
+  test.AddAttribute("nodes_modes", nodes_modes);
+  test.AddAttribute("nodes_values", nodes_values);
+  test.AddAttribute("nodes_truenodeids", nodes_truenodeids);
+  test.AddAttribute("nodes_falsenodeids", nodes_falsenodeids);
+  test.AddAttribute("nodes_missing_value_tracks_true", nodes_missing_value_tracks_true);
+  test.AddAttribute("target_treeids", target_treeids);
+  test.AddAttribute("target_nodeids", target_nodeids);
+  test.AddAttribute("target_ids", target_ids);
+  test.AddAttribute("target_weights", target_weights);
+  test.AddAttribute("n_targets", static_cast<int64_t>(1));
+
+  // More rows than are traversed together, so that the last block is partial.
+  constexpr float nan = std::numeric_limits<float>::quiet_NaN();
+  std::vector<float> X;
+  std::vector<float> Y;
+  for (int i = 0; i < 5; ++i) {
+    X.insert(X.end(), {0.1f, 0.f, nan, 0.f, 0.9f, nan, nan, nan});
+    Y.insert(Y.end(), {11.f, 11.f, 22.f, 21.f});
+  }
+  test.AddInput<float>("X", {20, 2}, X);
+  test.AddOutput<float>("Y", {20, 1}, Y);
+  test.Run();
+}
+
+static void RunTreeRegressorQuantizedThresholds(const std::string& mode) {
+  OpTester test("TreeEnsembleRegressor", 3, onnxruntime::kMLDomain);
+
+  // Two trees sharing the threshold 1 of feature 0. A missing value of feature 0 goes to the true branch of tree 0.
+  std::vector<int64_t> nodes_treeids = {0, 0, 0, 0, 0, 1, 1, 1};
+  std::vector<int64_t> nodes_nodeids = {0, 1, 2, 3, 4, 0, 1, 2};
+  std::vector<int64_t> nodes_featureids = {0, 1, 0, 0, 0, 0, 0, 0};
+  std::vector<std::string> nodes_modes = {mode, mode, "LEAF", "LEAF", "LEAF", mode, "LEAF", "LEAF"};
+  std::vector<float> nodes_values = {1.f, 2.f, 0.f, 0.f, 0.f, 1.f, 0.f, 0.f};
+  std::vector<int64_t> nodes_truenodeids = {1, 3, 0, 0, 0, 1, 0, 0};
+  std::vector<int64_t> nodes_falsenodeids = {2, 4, 0, 0, 0, 2, 0, 0};
+  std::vector<int64_t> nodes_missing_value_tracks_true = {1, 0, 0, 0, 0, 0, 0, 0};
+  std::vector<int64_t> target_treeids = {0, 0, 0, 1, 1};
+  std::vector<int64_t> target_nodeids = {2, 3, 4, 1, 2};
+  std::vector<int64_t> target_ids = {0, 0, 0, 0, 0};
+  std::vector<float> target_weights = {4.f, 1.f, 2.f, 10.f, 20.f};
+
+  test.AddAttribute("nodes_treeids", nodes_treeids);
+  test.AddAttribute("nodes_nodeids", nodes_nodeids);
+  test.AddAttribute("nodes_featureids", nodes_featureids);
+  test.AddAttribute("nodes_modes", nodes_modes);
+  test.AddAttribute("nodes_values", nodes_values);
+  test.AddAttribute("nodes_truenodeids", nodes_truenodeids);
+  test.AddAttribute("nodes_falsenodeids", nodes_falsenodeids);
+  test.AddAttribute("nodes_missing_value_tracks_true", nodes_missing_value_tracks_true);
+  test.AddAttribute("target_treeids", target_treeids);
+  test.AddAttribute("target_nodeids", target_nodeids);
+  test.AddAttribute("target_ids", target_ids);
+  test.AddAttribute("target_weights", target_weights);
+  test.AddAttribute("n_targets", static_cast<int64_t>(1));
+
+  auto compare = [&mode](float x, float threshold) {
+    if (mode == "BRANCH_LEQ") return x <= threshold;
+    if (mode == "BRANCH_LT") return x < threshold;
+    if (mode == "BRANCH_GTE") return x >= threshold;
+    return x > threshold;
+  };
+
+  // Values below, equal to and above the thresholds, and missing ones.
+  constexpr float nan = std::numeric_limits<float>::quiet_NaN();
+  std::vector<float> X;
+  std::vector<float> Y;
+  for (float x0 : {0.5f, 1.f, 1.5f, 2.f, 2.5f, nan}) {
+    for (float x1 : {1.f, 2.f, 3.f, nan}) {
+      X.insert(X.end(), {x0, x1});
+      float y = 0.f;
+      if (std::isnan(x0) || compare(x0, 1.f)) {
+        y += !std::isnan(x1) && compare(x1, 2.f) ? 1.f : 2.f;
+      } else {
+        y += 4.f;
+      }
+      y += !std::isnan(x0) && compare(x0, 1.f) ? 10.f : 20.f;
+      Y.push_back(y);
+    }
+  }
+  test.AddInput<float>("X", {24, 2}, X);
+  test.AddOutput<float>("Y", {24, 1}, Y);
+
+  SessionOptions so;
+  ASSERT_STATUS_OK(so.config_options.AddConfigEntry(kOrtSessionOptionsTreeEnsembleQuantizeThresholds, "1"));
+  test.Config(so).RunWithConfig();
+}
+
+TEST(MLOpTest, TreeRegressorQuantizedThresholds) {
+  for (const std::string mode : {"BRANCH_LEQ", "BRANCH_LT", "BRANCH_GTE", "BRANCH_GT"}) {
+    RunTreeRegressorQuantizedThresholds(mode);
+  }
+}
+
 }  // namespace test
 }  // namespace onnxruntime
@@ -3,12 +3,21 @@
 
 #include "gtest/gtest.h"
 #include "test/providers/provider_test_utils.h"
+#include "test/providers/run_options_config_keys.h"
 using namespace std;
 namespace onnxruntime {
 namespace test {
 
 namespace {
 
+const onnxruntime::RunOptions run_options = []() {
+  onnxruntime::RunOptions options{};
+  ORT_THROW_IF_ERROR(options.config_options.AddConfigEntry(kOpTesterRunOptionsConfigTestTunableOp, "true"));
+  return options;
+}();
+
+const constexpr auto run_with_tunable_op = &run_options;
+
 struct ConvOpAndTestAttributes {
   string auto_pad;
   vector<int64_t> dilations;
@@ -68,7 +77,7 @@ void TestConvOp(const ConvOpAndTestAttributes& attributes,
   // QNN SDK 2.10.0 has a bug that breaks support for dynamic bias inputs.
   excluded_providers.insert(kQnnExecutionProvider);
 
-  test.Run(expect_result, err_str, excluded_providers);
+  test.Run(expect_result, err_str, excluded_providers, run_with_tunable_op);
 }
 
 }  // namespace
@@ -689,6 +689,31 @@ TEST(TfIdfVectorizerTest, String_TFIDFWeights_onlyBigrams_Skip5_2rows) {
   test.Run(OpTester::ExpectResult::kExpectSuccess);
 }
 
+TEST(TfIdfVectorizerTest, Int64_TF_OverlappingNgrams_Skip1) {
+  OpTester test("TfIdfVectorizer", opset_ver);
+  // s=1, Min=1, Max=3, weights empty, int64
+  // The n-grams are prefixes and suffixes of one another so that
+  // several n-grams of different sizes end at the same item.
+  InitTestAttr(test, "TF", 1, 3, 1,
+               {0, 2, 8},
+               {0, 1, 2, 3, 4, 5, 6, 7},  // 8 output indexes
+               {},
+               {1, 2,                        // 1-grams
+                1, 2, 2, 1, 2, 2,            // bi-grams
+                1, 1, 2, 1, 2, 1, 2, 1, 2},  // tri-grams
+               {});
+
+  std::vector<int64_t> dims{10};
+  std::vector<int64_t> input = {1, 1, 2, 1, 2, 2, 3, 1, 2, 1};
+  test.AddInput<int64_t>("T", dims, input);
+
+  std::vector<int64_t> out_dims{8};
+  std::vector<float> output = {5, 4, 5, 3, 2, 2, 3, 1};
+  test.AddOutput<float>("Y", out_dims, output);
+
+  test.Run(OpTester::ExpectResult::kExpectSuccess);
+}
+
 // This test runs the inference 100 times to test the improvement
 // It enables profiling while running inference multiple times.
 // So we can manually inspect the profiling output
@@ -383,5 +383,52 @@ TEST(NonMaxSuppressionOpTest, WithIOUThresholdOpset11) {
   test.Run();
 }
 
+TEST(NonMaxSuppressionOpTest, MultipleBatchesAndClassesManySelectedBoxes) {
+  // Each batch has 20 disjoint boxes and a slightly shifted copy of each of them,
+  // which overlaps its original with an IOU above the threshold. The originals score higher
+  // in the even classes and the copies in the odd classes, so each class keeps 20 boxes
+  // ordered by decreasing score.
+  constexpr int64_t num_batches = 2;
+  constexpr int64_t num_classes = 3;
+  constexpr int64_t num_disjoint = 20;
+  constexpr int64_t num_boxes = 2 * num_disjoint;
+
+  std::vector<float> boxes;
+  for (int64_t batch_index = 0; batch_index < num_batches; ++batch_index) {
+    for (int64_t copy = 0; copy < 2; ++copy) {
+      for (int64_t i = 0; i < num_disjoint; ++i) {
+        const float x = 2.0f * i + 0.1f * copy;
+        const float y = 10.0f * batch_index;
+        boxes.insert(boxes.end(), {y, x, y + 1.0f, x + 1.0f});
+      }
+    }
+  }
+
+  std::vector<float> scores;
+  std::vector<int64_t> selected_indices;
+  for (int64_t batch_index = 0; batch_index < num_batches; ++batch_index) {
+    for (int64_t class_index = 0; class_index < num_classes; ++class_index) {
+      const int64_t kept_copy = class_index % 2;
+      for (int64_t copy = 0; copy < 2; ++copy) {
+        for (int64_t i = 0; i < num_disjoint; ++i) {
+          scores.push_back(0.01f * (i + 1) + (copy == kept_copy ? 0.5f : 0.0f));
+        }
+      }
+      for (int64_t i = num_disjoint - 1; i >= 0; --i) {
+        selected_indices.insert(selected_indices.end(), {batch_index, class_index, kept_copy * num_disjoint + i});
+      }
+    }
+  }
+
+  OpTester test("NonMaxSuppression", 11, kOnnxDomain);
+  test.AddInput<float>("boxes", {num_batches, num_boxes, 4}, boxes);
+  test.AddInput<float>("scores", {num_batches, num_classes, num_boxes}, scores);
+  test.AddInput<int64_t>("max_output_boxes_per_class", {}, {100L});
+  test.AddInput<float>("iou_threshold", {}, {0.5f});
+  test.AddInput<float>("score_threshold", {}, {0.0f});
+  test.AddOutput<int64_t>("selected_indices", {num_batches * num_classes * num_disjoint, 3}, selected_indices);
+  test.Run();
+}
+
 }  // namespace test
 }  // namespace onnxruntime
@@ -194,6 +194,29 @@ TEST(ContribOpTest, StringNormalizerInsensitiveFilterOutUpperWithLocale) {
   test.Run(OpTester::ExpectResult::kExpectSuccess);
 }
 
+TEST(ContribOpTest, StringNormalizerInsensitiveFilterOutLowerMixedAscii) {
+  // - case-INSENSITIVE approach en_US locale
+  // - ASCII strings longer than 8 bytes, with all the characters around the letter ranges, and non ASCII strings
+  // - filter out the stopwords whatever the case of the input
+
+  OpTester test("StringNormalizer", opset_ver, domain);
+  InitTestAttr(test, "LOWER", false, {"Monday", "ÉCOLE"}, test_locale);
+  std::vector<int64_t> dims{6};
+  std::vector<std::string> input = {"MONDAY",
+                                    "@AZ[`az{ Tuesday @AZ[`az{",
+                                    "école",
+                                    "WEDNESDAY and THURSDAY",
+                                    "Besançon",
+                                    "mOnDaY"};
+  test.AddInput<std::string>("T", dims, input);
+
+  std::vector<std::string> output = {"@az[`az{ tuesday @az[`az{",
+                                     "wednesday and thursday",
+                                     "besançon"};
+  test.AddOutput<std::string>("Y", {3}, output);
+  test.Run(OpTester::ExpectResult::kExpectSuccess);
+}
+
 TEST(ContribOpTest, StringNormalizerSensitiveFilterOutUpperEmptyCase) {
   // Empty output case
   // - casesensitive approach